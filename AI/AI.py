@@ -17,16 +17,20 @@ import pandas as pd
 
 # CSV 로드 (C 프로그램이 생성한 파일)
 # header=None: 헤더 없는 파일이므로
-df = pd.read_csv('/mnt/uart_dataset.csv', header=None)
+# 컬럼명 지정 (C 프로그램의 기록 순서와 일치)
+# packet_len 열이 없는 옛 줄도 섞여 있을 수 있음 → names로 6개를 주면 빈칸(NaN)으로 읽힘
+df = pd.read_csv('/mnt/uart_dataset.csv', header=None,
+                 names=['timestamp', 'status', 'sent', 'length', 'baudrate', 'packet_len'])
 
-# 컬럼명 지정 (C 프로그램의 fprintf 순서와 일치)
-df.columns = ['timestamp', 'status', 'sent', 'length', 'baudrate']
+# 옛 줄은 보낸 문자열의 길이가 패킷 길이
+# (새 줄의 sent는 긴 패킷이면 앞부분만이라 packet_len 열을 믿음)
+df['packet_len'] = df['packet_len'].fillna(df['sent'].astype(str).str.len()).astype(int)
 
 # status를 숫자로 변환한 'error' 컬럼 추가
 df['error'] = df['status'].apply(convert)
 
 # 특성(X)과 타겟(y) 분리
-x = df[['length', 'baudrate']]  # 입력: 케이블 길이, 통신 속도
+x = df[['length', 'baudrate', 'packet_len']]  # 입력: 케이블 길이, 통신 속도, 패킷 길이
 y = df['error']                  # 출력: 에러 여부 (0 or 1)
 
 
@@ -50,9 +54,9 @@ model.fit(x_train, y_train)  # 훈련 데이터로 학습
 print("훈련 끝")
 
 
-def predict_error(length, baudrate):
+def predict_error(length, baudrate, packet_len=10):
     """특정 조건에서 에러 확률 예측 (0.0~1.0)"""
-    data = [[length, baudrate]]  # 2차원 형태로 (sklearn 요구사항)
+    data = [[length, baudrate, packet_len]]  # 2차원 형태로 (sklearn 요구사항)
     # predict_proba()[0][1]: 첫 샘플의 class=1(에러) 확률
     return model.predict_proba(data)[0][1]
 
@@ -0,0 +1,209 @@
+/*
+ * ============================================================================
+ * uart_dataset.csv 집계기 (uart_agg)
+ * ============================================================================
+ *
+ * AI.py는 OK/ERR 개수를 세려고 파일 전체를 pandas로 읽음
+ * 이 도구는 같은 질문(조건별 에러율)에 디스크 속도로 답함:
+ *   - 파일을 mmap하고 줄 경계에서 코어 수만큼 나눠 동시에 스캔 (uart_csv.hpp)
+ *   - 스레드마다 자기 해시 테이블에 세고 마지막에 한 번 합침 (락 없음)
+ *
+ * 출력: (케이블 길이, Baudrate, 패킷 길이)마다
+ *   n, OK, ERR, 에러율, Wilson 신뢰구간
+ *
+ * Wilson 구간을 쓰는 이유:
+ *   ERR가 0개이거나 샘플이 적으면 정규 근사(p ± z*sqrt(p(1-p)/n))는
+ *   폭이 0이 되거나 음수로 나감 → "1000개 중 0개"도 상한을 제대로 알려줌
+ *
+ * 사용법:
+ *   ./uart_agg [--csv] [--threads N] [--z Z] FILE...
+ *
+ * 빌드:
+ *   g++ -O2 -std=c++17 -pthread -o uart_agg uart_agg.cpp
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <getopt.h>
+
+#include "uart_csv.hpp"
+
+namespace {
+
+struct counts {
+    uint64_t ok = 0;
+    uint64_t err = 0;
+    uint64_t other = 0;     // OK/ERR가 아닌 상태 (TIMEOUT 등, 에러율에는 안 넣음)
+};
+
+struct table {
+    std::unordered_map<uint64_t, counts> cells;
+    uint64_t lines = 0;
+    uint64_t malformed = 0;     // 쓰다 만 줄, 빈 줄 등
+
+    void merge(const table &o) {
+        for (const auto &kv : o.cells) {
+            counts &c = cells[kv.first];
+            c.ok += kv.second.ok;
+            c.err += kv.second.err;
+            c.other += kv.second.other;
+        }
+        lines += o.lines;
+        malformed += o.malformed;
+    }
+};
+
+void scan_chunk(const char *begin, const char *end, table &t) {
+    // 설정 조합은 많아야 수백 개 → 처음부터 넉넉하게 잡아서 재해싱 없음
+    t.cells.reserve(1024);
+    uart::scan_lines(begin, end, [&](const char *line, size_t len,
+                                     const uint32_t *commas, int ncommas) {
+        t.lines++;
+        uart::dataset_row r;
+        if (!uart::parse_dataset_row(line, len, commas, ncommas, r)) {
+            t.malformed++;
+            return;
+        }
+        counts &c = t.cells[uart::config_key(r.length_cm, r.baudrate, r.packet_len)];
+        if (r.st == uart::status::ok) {
+            c.ok++;
+        } else if (r.st == uart::status::err) {
+            c.err++;
+        } else {
+            c.other++;
+        }
+    });
+}
+
+/* 파일 하나를 최대 nthreads조각으로 나눠 동시에 집계 */
+bool scan_file(const char *path, unsigned nthreads, table &total, uint64_t &bytes) {
+    uart::mapped_file f;
+    std::string err;
+    if (!f.open(path, err)) {
+        std::fprintf(stderr, "%s\n", err.c_str());
+        return false;
+    }
+    bytes += f.size();
+
+    std::vector<table> parts(nthreads);
+    unsigned n = uart::for_each_chunk(f.data(), f.size(), nthreads,
+                                      [&](const char *b, const char *e, unsigned i) {
+                                          scan_chunk(b, e, parts[i]);
+                                      });
+    for (unsigned i = 0; i < n; i++) {
+        total.merge(parts[i]);
+    }
+    return true;
+}
+
+/* Wilson 점수 구간 [lo, hi] */
+void wilson(uint64_t k, uint64_t n, double z, double &lo, double &hi) {
+    if (n == 0) {
+        lo = 0.0;
+        hi = 1.0;
+        return;
+    }
+    double p = (double)k / (double)n;
+    double z2n = z * z / (double)n;
+    double denom = 1.0 + z2n;
+    double center = (p + z2n / 2.0) / denom;
+    double half = z * std::sqrt(p * (1.0 - p) / (double)n + z2n / (4.0 * (double)n)) / denom;
+    lo = std::max(0.0, center - half);
+    hi = std::min(1.0, center + half);
+}
+
+void print_usage(const char *prog) {
+    std::printf("Usage: %s [options] DATASET.csv...\n", prog);
+    std::printf("Count OK/ERR per (cable length, baud, packet length) with Wilson intervals.\n");
+    std::printf("\nOptions:\n");
+    std::printf("  --csv          machine-readable CSV output (with header)\n");
+    std::printf("  --threads N    worker threads (default: all cores)\n");
+    std::printf("  --z Z          interval z-score (default 1.96 = 95%%)\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bool csv = false;
+    unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+    double z = 1.96;
+
+    static const struct option long_opts[] = {
+        { "csv",     no_argument,       nullptr, 'c' },
+        { "threads", required_argument, nullptr, 'j' },
+        { "z",       required_argument, nullptr, 'z' },
+        { "help",    no_argument,       nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "cj:z:h", long_opts, nullptr)) != -1) {
+        switch (opt) {
+        case 'c': csv = true; break;
+        case 'j': nthreads = (unsigned)std::max(1, std::atoi(optarg)); break;
+        case 'z': z = std::atof(optarg); break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    table total;
+    uint64_t bytes = 0;
+    int rc = 0;
+    for (int i = optind; i < argc; i++) {
+        if (!scan_file(argv[i], nthreads, total, bytes)) {
+            rc = 1;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // 길이 → Baudrate → 패킷 길이 순 (키의 비트 배치가 곧 정렬 순서)
+    std::vector<std::pair<uint64_t, counts>> rows(total.cells.begin(), total.cells.end());
+    std::sort(rows.begin(), rows.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    if (csv) {
+        std::printf("cable_length,baudrate,packet_len,n,ok,err,err_rate,wilson_lo,wilson_hi\n");
+    } else {
+        std::printf("%8s %9s %6s %12s %12s %10s %9s %19s\n",
+                    "length_m", "baud", "len", "n", "OK", "ERR", "err_rate", "wilson (95%)");
+    }
+    for (const auto &row : rows) {
+        int cm = uart::key_length_cm(row.first);
+        int baud = uart::key_baudrate(row.first);
+        int plen = uart::key_packet_len(row.first);
+        const counts &c = row.second;
+        uint64_t n = c.ok + c.err;
+        double lo, hi;
+        wilson(c.err, n, z, lo, hi);
+        double rate = n ? (double)c.err / (double)n : 0.0;
+
+        if (csv) {
+            std::printf("%.2f,%d,%d,%llu,%llu,%llu,%.6f,%.6f,%.6f\n",
+                        cm / 100.0, baud, plen, (unsigned long long)n,
+                        (unsigned long long)c.ok, (unsigned long long)c.err, rate, lo, hi);
+        } else {
+            std::printf("%8.2f %9d %6d %12llu %12llu %10llu %8.3f%% [%7.3f%%, %7.3f%%]\n",
+                        cm / 100.0, baud, plen, (unsigned long long)n,
+                        (unsigned long long)c.ok, (unsigned long long)c.err,
+                        100.0 * rate, 100.0 * lo, 100.0 * hi);
+        }
+    }
+
+    std::fprintf(stderr, "%llu lines (%llu malformed), %.1f MB in %.3f s (%.0f MB/s, %u threads)\n",
+                 (unsigned long long)total.lines, (unsigned long long)total.malformed,
+                 bytes / 1e6, secs, secs > 0 ? bytes / 1e6 / secs : 0.0, nthreads);
+    return rc;
+}
@@ -0,0 +1,376 @@
+/*
+ * ============================================================================
+ * uart_dataset.csv 고속 스캐너 (C++ 네이티브 도구 공용)
+ * ============================================================================
+ *
+ * pandas.read_csv()는 파일 전체를 DataFrame으로 올린 뒤에야 계산을 시작함
+ *   → 캠페인마다 만 줄 이상씩 늘어나는 데이터셋에서 점점 느려지고 메모리도 커짐
+ *
+ * 이 헤더:
+ *   - 파일을 mmap으로 매핑 (read()로 복사하지 않고 페이지 캐시를 바로 읽음)
+ *   - 16바이트 블록마다 '\n'과 ','의 위치를 비트마스크로 한 번에 구함
+ *       x86-64: SSE2 (_mm_cmpeq_epi8 + movemask)
+ *       AArch64(라즈베리파이 64비트): NEON (비교 결과를 4비트씩 좁혀서 마스크)
+ *       그 외: 8바이트 워드 SWAR
+ *   - 파일을 줄 경계에서 N조각으로 나눠 스레드마다 한 조각씩
+ *
+ * 데이터셋 형식 (raspberry/claud_ver.c가 쓰는 그대로, 헤더 없음):
+ *   timestamp,status,sent,cable_length,baudrate[,packet_len]
+ *   packet_len 열이 없는 옛 파일은 sent의 길이를 패킷 길이로 봄
+ */
+#ifndef UART_CSV_HPP
+#define UART_CSV_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UART_CSV_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UART_CSV_NEON 1
+#endif
+
+namespace uart {
+
+/*
+ * ----------------------------------------------------------------------------
+ * 읽기 전용 mmap
+ * ----------------------------------------------------------------------------
+ */
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file() { close(); }
+
+    // 실패하면 false, err에 이유
+    bool open(const char *path, std::string &err) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            err = std::string(path) + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            err = std::string(path) + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void *m = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m == MAP_FAILED) {
+                err = std::string(path) + ": " + std::strerror(errno);
+                ::close(fd);
+                size_ = 0;
+                return false;
+            }
+            madvise(m, size_, MADV_SEQUENTIAL | MADV_WILLNEED);
+            data_ = static_cast<const char *>(m);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void close() {
+        if (data_) {
+            munmap(const_cast<char *>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char *data_ = nullptr;
+    size_t      size_ = 0;
+};
+
+/*
+ * 파일을 줄 경계에서 n조각으로 나눌 때 i번째 조각의 시작
+ *   대략 size*i/n 위치에서 다음 '\n' 바로 뒤로 옮김
+ */
+inline size_t split_point(const char *data, size_t size, unsigned i, unsigned n) {
+    if (i == 0) {
+        return 0;
+    }
+    if (i >= n) {
+        return size;
+    }
+    size_t pos = (size_t)((unsigned __int128)size * i / n);
+    const void *nl = std::memchr(data + pos, '\n', size - pos);
+    return nl ? (size_t)(static_cast<const char *>(nl) - data) + 1 : size;
+}
+
+/*
+ * 파일을 줄 경계에서 최대 nthreads조각으로 나눠 fn(begin, end, i)를 동시에 실행
+ *   조각이 1MB보다 작아지면 스레드를 덜 씀 (띄우는 비용이 더 큼)
+ *   마지막 조각은 호출한 스레드가 직접 처리
+ * 반환값: 실제로 나눈 조각 수 (i는 0 ~ 반환값-1)
+ */
+template <class Fn>
+inline unsigned for_each_chunk(const char *data, size_t size, unsigned nthreads, Fn &&fn) {
+    const size_t min_chunk = 1 << 20;
+    unsigned n = (unsigned)std::min<size_t>(nthreads ? nthreads : 1, size / min_chunk + 1);
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < n; i++) {
+        size_t b = split_point(data, size, i, n);
+        size_t e = split_point(data, size, i + 1, n);
+        if (i + 1 == n) {
+            fn(data + b, data + e, i);
+        } else {
+            workers.emplace_back([&fn, data, b, e, i] { fn(data + b, data + e, i); });
+        }
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    return n;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 구분자 스캐너
+ * ----------------------------------------------------------------------------
+ * scan_lines(begin, end, fn):
+ *   줄마다 fn(line, len, commas, ncommas) 호출
+ *     line/len - 개행(\n, 끝의 \r)을 뺀 줄
+ *     commas   - 줄 안에서 ','의 위치 (앞에서부터 최대 MAX_FIELDS-1개)
+ *   마지막 줄에 개행이 없어도 처리함
+ */
+constexpr int MAX_FIELDS = 16;
+
+#if defined(UART_CSV_SSE2)
+constexpr int      MASK_SHIFT = 0;      // 바이트 하나 = 마스크 1비트
+constexpr uint64_t MASK_LANE  = 0x1;
+
+inline uint64_t delim_mask16(const char *p) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+    return (uint32_t)_mm_movemask_epi8(m);
+}
+#elif defined(UART_CSV_NEON)
+constexpr int      MASK_SHIFT = 2;      // 바이트 하나 = 마스크 4비트
+constexpr uint64_t MASK_LANE  = 0xF;
+
+inline uint64_t delim_mask16(const char *p) {
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+    uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8(',')));
+    // NEON에는 movemask가 없음 → 16비트씩 4비트 오른쪽으로 밀며 좁혀서 바이트당 4비트
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+#else
+constexpr int      MASK_SHIFT = 3;      // 바이트 하나 = 마스크 8비트 (블록은 8바이트)
+constexpr uint64_t MASK_LANE  = 0xFF;
+
+// 0인 바이트마다 그 바이트의 최상위 비트만 1 (오탐 없음)
+inline uint64_t zero_bytes(uint64_t x) {
+    const uint64_t lo7 = 0x7F7F7F7F7F7F7F7FULL;
+    return ~(((x & lo7) + lo7) | x | lo7);
+}
+
+// 16바이트 대신 8바이트 블록 (마스크 64비트에 바이트당 8비트)
+inline uint64_t delim_mask8(const char *p) {
+    uint64_t x;
+    std::memcpy(&x, p, 8);
+    return zero_bytes(x ^ 0x0A0A0A0A0A0A0A0AULL) | zero_bytes(x ^ 0x2C2C2C2C2C2C2C2CULL);
+}
+#endif
+
+#if defined(UART_CSV_SSE2) || defined(UART_CSV_NEON)
+constexpr size_t BLOCK = 16;
+inline uint64_t delim_mask(const char *p) { return delim_mask16(p); }
+#else
+constexpr size_t BLOCK = 8;
+inline uint64_t delim_mask(const char *p) { return delim_mask8(p); }
+#endif
+
+template <class Fn>
+inline void scan_lines(const char *begin, const char *end, Fn &&fn) {
+    uint32_t commas[MAX_FIELDS];
+    int ncommas = 0;
+    const char *line = begin;
+
+    auto on_delim = [&](const char *p) {
+        if (*p == ',') {
+            if (ncommas < MAX_FIELDS - 1) {
+                commas[ncommas++] = (uint32_t)(p - line);
+            }
+            return;
+        }
+        size_t len = (size_t)(p - line);
+        if (len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+        fn(line, len, commas, ncommas);
+        line = p + 1;
+        ncommas = 0;
+    };
+
+    const char *p = begin;
+    for (; p + BLOCK <= end; p += BLOCK) {
+        uint64_t m = delim_mask(p);
+        while (m) {
+            unsigned bit = (unsigned)__builtin_ctzll(m);
+            unsigned idx = bit >> MASK_SHIFT;
+            on_delim(p + idx);
+            m &= ~(MASK_LANE << (idx << MASK_SHIFT));
+        }
+    }
+    for (; p < end; p++) {
+        if (*p == '\n' || *p == ',') {
+            on_delim(p);
+        }
+    }
+    if (line < end) {
+        size_t len = (size_t)(end - line);
+        if (line[len - 1] == '\r') {
+            len--;
+        }
+        fn(line, len, commas, ncommas);
+    }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 숫자 해석 (strtod/atoi보다 빠르고 로케일 영향 없음)
+ * ----------------------------------------------------------------------------
+ */
+
+// 부호 없는 정수, 숫자가 아닌 글자가 있으면 false
+inline bool parse_uint(std::string_view s, uint64_t &out) {
+    if (s.empty() || s.size() > 19) {
+        return false;
+    }
+    uint64_t v = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        v = v * 10 + (uint64_t)(c - '0');
+    }
+    out = v;
+    return true;
+}
+
+// "12.34" 같은 십진수 (지수 표기 없음, claud_ver의 %.2f 출력용)
+inline bool parse_decimal(std::string_view s, double &out) {
+    size_t i = 0;
+    bool neg = false;
+    if (i < s.size() && (s[i] == '-' || s[i] == '+')) {
+        neg = s[i] == '-';
+        i++;
+    }
+    uint64_t ip = 0, fp = 0, scale = 1;
+    int digits = 0;
+    for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++, digits++) {
+        ip = ip * 10 + (uint64_t)(s[i] - '0');
+    }
+    if (i < s.size() && s[i] == '.') {
+        for (i++; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++, digits++) {
+            if (scale < 1000000000000ULL) {
+                fp = fp * 10 + (uint64_t)(s[i] - '0');
+                scale *= 10;
+            }
+        }
+    }
+    if (i != s.size() || digits == 0) {
+        return false;
+    }
+    double v = (double)ip + (double)fp / (double)scale;
+    out = neg ? -v : v;
+    return true;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 데이터셋 한 줄
+ * ----------------------------------------------------------------------------
+ */
+enum class status { ok, err, other };
+
+struct dataset_row {
+    std::string_view timestamp;
+    status           st;
+    std::string_view sent;
+    double           cable_length;
+    int              length_cm;     // 케이블 길이를 cm 정수로 (묶음 키, 부동소수 비교 회피)
+    int              baudrate;
+    int              packet_len;
+};
+
+inline std::string_view field(const char *line, size_t len, const uint32_t *commas,
+                              int ncommas, int i) {
+    size_t b = i == 0 ? 0 : commas[i - 1] + 1;
+    size_t e = i < ncommas ? commas[i] : len;
+    return std::string_view(line + b, e - b);
+}
+
+// 형식이 틀린 줄(쓰다 만 마지막 줄 등)은 false
+inline bool parse_dataset_row(const char *line, size_t len, const uint32_t *commas,
+                              int ncommas, dataset_row &r) {
+    if (ncommas < 4) {
+        return false;
+    }
+    r.timestamp = field(line, len, commas, ncommas, 0);
+    std::string_view st = field(line, len, commas, ncommas, 1);
+    r.st = st == "OK" ? status::ok : st == "ERR" ? status::err : status::other;
+    r.sent = field(line, len, commas, ncommas, 2);
+
+    uint64_t baud, plen;
+    if (!parse_decimal(field(line, len, commas, ncommas, 3), r.cable_length) ||
+        !parse_uint(field(line, len, commas, ncommas, 4), baud) || baud > 100000000) {
+        return false;
+    }
+    r.length_cm = (int)(r.cable_length * 100.0 + (r.cable_length < 0 ? -0.5 : 0.5));
+    r.baudrate = (int)baud;
+    if (ncommas >= 5 && parse_uint(field(line, len, commas, ncommas, 5), plen) &&
+        plen < 65536) {
+        r.packet_len = (int)plen;
+    } else {
+        r.packet_len = (int)r.sent.size();
+    }
+    return true;
+}
+
+/*
+ * (길이 cm, Baudrate, 패킷 길이) → 해시 키 하나
+ *   [63:40] 길이 cm (24비트)  [39:16] Baudrate (24비트)  [15:0] 패킷 길이
+ *   키의 크기 순서가 곧 길이 → Baudrate → 패킷 길이 순 정렬
+ */
+inline uint64_t config_key(int length_cm, int baud, int packet_len) {
+    return (uint64_t)(length_cm & 0xFFFFFF) << 40 | (uint64_t)(baud & 0xFFFFFF) << 16 |
+           (uint64_t)(uint16_t)packet_len;
+}
+
+inline int key_length_cm(uint64_t key) { return (int)(key >> 40); }
+inline int key_baudrate(uint64_t key) { return (int)((key >> 16) & 0xFFFFFF); }
+inline int key_packet_len(uint64_t key) { return (int)(key & 0xFFFF); }
+
+} // namespace uart
+
+#endif /* UART_CSV_HPP */
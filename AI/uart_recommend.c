@@ -0,0 +1,352 @@
+/*
+ * ============================================================================
+ * 케이블 길이/Baudrate 추천 라이브러리 구현 (uart_recommend.h 참고)
+ * ============================================================================
+ *
+ * 표 구조 (속도마다 한 열, 열 안에서 길이 순):
+ *   prob[j * n_len + i]  속도 j, 길이 i*step의 에러 확률
+ *   pmax[j * n_len + i]  prob[j][0..i]의 최댓값 (단조 증가, urec_max_length용)
+ *
+ * 기본 격자 (3001 길이 × 8 속도)는 float 두 벌로 약 190KB
+ */
+#include "uart_recommend.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UREC_MAX_FEATURES 8
+#define UREC_MAX_BAUDS    256
+
+static const int default_bauds[] = {
+    9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600
+};
+
+enum urec_feature { UF_LENGTH, UF_BAUD, UF_LOG_BAUD, UF_PACKET_LEN, UF_LENGTH_LOG_BAUD };
+
+static const char *const feature_names[] = {
+    "length", "baud", "log_baud", "packet_len", "length_log_baud"
+};
+
+struct urec_table {
+    int     n_len;          // 길이 격자 점 수
+    double  step;
+    double  max_length;
+    int     n_bauds;
+    int     bauds[UREC_MAX_BAUDS];
+    double  log_bauds[UREC_MAX_BAUDS];
+    float  *prob;
+    float  *pmax;
+};
+
+static int feature_id(const char *name) {
+    for (size_t i = 0; i < sizeof(feature_names) / sizeof(feature_names[0]); i++) {
+        if (strcmp(name, feature_names[i]) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static double feature_value(int f, double length, int baud, int packet_len) {
+    switch (f) {
+    case UF_LENGTH:          return length;
+    case UF_BAUD:            return baud;
+    case UF_LOG_BAUD:        return log2(baud / 9600.0);
+    case UF_PACKET_LEN:      return packet_len;
+    case UF_LENGTH_LOG_BAUD: return length * log2(baud / 9600.0);
+    default:                 return 0.0;
+    }
+}
+
+static double sigmoid(double z) {
+    return z >= 0 ? 1.0 / (1.0 + exp(-z)) : exp(z) / (1.0 + exp(z));
+}
+
+struct urec_table *urec_create(const char *const *features, const double *weights,
+                               int n_features, double bias, const struct urec_grid *grid) {
+    struct urec_grid g = { 30.0, 0.01, default_bauds,
+                           (int)(sizeof(default_bauds) / sizeof(default_bauds[0])), 10 };
+    if (grid) {
+        g = *grid;
+        if (!g.bauds) {
+            g.bauds = default_bauds;
+            g.n_bauds = (int)(sizeof(default_bauds) / sizeof(default_bauds[0]));
+        }
+    }
+    if (n_features < 0 || n_features > UREC_MAX_FEATURES || g.step <= 0 ||
+        g.max_length < 0 || g.n_bauds <= 0 || g.n_bauds > UREC_MAX_BAUDS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int ids[UREC_MAX_FEATURES];
+    for (int k = 0; k < n_features; k++) {
+        if ((ids[k] = feature_id(features[k])) < 0) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    for (int j = 0; j < g.n_bauds; j++) {
+        if (g.bauds[j] <= 0 || (j > 0 && g.bauds[j] <= g.bauds[j - 1])) {
+            errno = EINVAL;     // 양수, 오름차순이어야 이분 탐색/보간 가능
+            return NULL;
+        }
+    }
+
+    struct urec_table *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return NULL;
+    }
+    t->step = g.step;
+    t->n_len = (int)floor(g.max_length / g.step + 1e-9) + 1;
+    t->max_length = (t->n_len - 1) * g.step;
+    t->n_bauds = g.n_bauds;
+    size_t cells = (size_t)t->n_len * (size_t)t->n_bauds;
+    t->prob = malloc(cells * sizeof(float));
+    t->pmax = malloc(cells * sizeof(float));
+    if (!t->prob || !t->pmax) {
+        urec_free(t);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (int j = 0; j < t->n_bauds; j++) {
+        int baud = g.bauds[j];
+        t->bauds[j] = baud;
+        t->log_bauds[j] = log2((double)baud);
+        float *col = t->prob + (size_t)j * t->n_len;
+        float *run = t->pmax + (size_t)j * t->n_len;
+        float hi = 0.0f;
+        for (int i = 0; i < t->n_len; i++) {
+            double length = i * t->step;
+            double z = bias;
+            for (int k = 0; k < n_features; k++) {
+                z += weights[k] * feature_value(ids[k], length, baud, g.packet_len);
+            }
+            col[i] = (float)sigmoid(z);
+            hi = col[i] > hi ? col[i] : hi;
+            run[i] = hi;
+        }
+    }
+    return t;
+}
+
+struct urec_table *urec_load(const char *model_path, const struct urec_grid *grid) {
+    FILE *fp = fopen(model_path, "r");
+    if (!fp) {
+        return NULL;
+    }
+    char line[1024];
+    char names[UREC_MAX_FEATURES][32];
+    const char *name_ptrs[UREC_MAX_FEATURES];
+    double weights[UREC_MAX_FEATURES];
+    int version = 0, n_names = 0, n_weights = 0;
+    int too_many = 0;           // UREC_MAX_FEATURES를 넘는 특성/계수 (잘라 쓰면 표가 틀림)
+    double bias = 0.0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *save = NULL;
+        char *key = strtok_r(line, " \t\r\n", &save);
+        char *v;
+        if (!key || key[0] == '#') {
+            continue;
+        }
+        if (strcmp(key, "uart_model") == 0 && (v = strtok_r(NULL, " \t\r\n", &save))) {
+            version = atoi(v);
+        } else if (strcmp(key, "features") == 0) {
+            while ((v = strtok_r(NULL, " \t\r\n", &save))) {
+                if (n_names == UREC_MAX_FEATURES) {
+                    too_many = 1;
+                    break;
+                }
+                snprintf(names[n_names], sizeof(names[n_names]), "%s", v);
+                name_ptrs[n_names] = names[n_names];
+                n_names++;
+            }
+        } else if (strcmp(key, "bias") == 0 && (v = strtok_r(NULL, " \t\r\n", &save))) {
+            bias = strtod(v, NULL);
+        } else if (strcmp(key, "weights") == 0) {
+            while ((v = strtok_r(NULL, " \t\r\n", &save))) {
+                if (n_weights == UREC_MAX_FEATURES) {
+                    too_many = 1;
+                    break;
+                }
+                weights[n_weights++] = strtod(v, NULL);
+            }
+        }
+    }
+    fclose(fp);
+
+    if (version != 1 || too_many || n_names != n_weights) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return urec_create(name_ptrs, weights, n_names, bias, grid);
+}
+
+void urec_free(struct urec_table *t) {
+    if (!t) {
+        return;
+    }
+    free(t->prob);
+    free(t->pmax);
+    free(t);
+}
+
+/* 길이 → 격자 칸 i와 칸 안의 위치 f (0 ≤ f < 1), 범위 밖이면 -1 */
+static int length_index(const struct urec_table *t, double length, double *f) {
+    if (!(length >= 0.0) || length > t->max_length + 1e-9) {
+        return -1;
+    }
+    double x = length / t->step;
+    int i = (int)x;
+    if (i >= t->n_len - 1) {
+        *f = 0.0;
+        return t->n_len - 1;
+    }
+    *f = x - i;
+    return i;
+}
+
+/*
+ * 두 속도 열 사이의 보간은 확률이 아니라 로짓(log(p/(1-p))) 위에서
+ *   로지스틱 모델에서 로짓은 특성에 선형 → log_baud 특성이면 정확히 맞음
+ *   확률을 그대로 섞으면 0.5%와 23% 사이가 엉뚱하게 커짐
+ */
+static double logit(double p) {
+    p = p < 1e-12 ? 1e-12 : p > 1.0 - 1e-7 ? 1.0 - 1e-7 : p;
+    return log(p / (1.0 - p));
+}
+
+static double blend(double p, double q, double a) {
+    return a > 0.0 ? sigmoid(logit(p) + (logit(q) - logit(p)) * a) : p;
+}
+
+static double column_at(const float *col, int i, double f) {
+    return f > 0.0 ? col[i] + (col[i + 1] - col[i]) * f : col[i];
+}
+
+/*
+ * 속도 → 이웃한 두 열 j, j+1과 보간 비율 a (격자에 있는 속도면 a = 0)
+ * 범위 밖이면 -1
+ */
+static int baud_index(const struct urec_table *t, int baud, double *a) {
+    int lo = 0, hi = t->n_bauds - 1;
+    if (baud < t->bauds[lo] || baud > t->bauds[hi]) {
+        return -1;
+    }
+    while (lo < hi) {       // bauds[lo] ≤ baud인 가장 큰 lo
+        int mid = (lo + hi + 1) / 2;
+        if (t->bauds[mid] <= baud) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (t->bauds[lo] == baud || lo == t->n_bauds - 1) {
+        *a = 0.0;
+    } else {
+        *a = (log2((double)baud) - t->log_bauds[lo]) / (t->log_bauds[lo + 1] - t->log_bauds[lo]);
+    }
+    return lo;
+}
+
+double urec_probability(const struct urec_table *t, double length, int baud) {
+    double f, a;
+    int i = length_index(t, length, &f);
+    int j = baud_index(t, baud, &a);
+    if (i < 0 || j < 0) {
+        return -1.0;
+    }
+    double p = column_at(t->prob + (size_t)j * t->n_len, i, f);
+    if (a > 0.0) {
+        p = blend(p, column_at(t->prob + (size_t)(j + 1) * t->n_len, i, f), a);
+    }
+    return p;
+}
+
+int urec_best_baud(const struct urec_table *t, double length, double *prob) {
+    double f;
+    int i = length_index(t, length, &f);
+    if (i < 0) {
+        return -1;
+    }
+    int best = -1;
+    double best_p = 2.0;
+    for (int j = 0; j < t->n_bauds; j++) {
+        double p = column_at(t->prob + (size_t)j * t->n_len, i, f);
+        if (p <= best_p) {      // 같으면 빠른 속도
+            best_p = p;
+            best = j;
+        }
+    }
+    if (prob) {
+        *prob = best_p;
+    }
+    return t->bauds[best];
+}
+
+int urec_fastest_baud(const struct urec_table *t, double length, double threshold,
+                      double *prob) {
+    double f;
+    int i = length_index(t, length, &f);
+    if (i < 0) {
+        return -1;
+    }
+    for (int j = t->n_bauds - 1; j >= 0; j--) {
+        double p = column_at(t->prob + (size_t)j * t->n_len, i, f);
+        if (p < threshold) {
+            if (prob) {
+                *prob = p;
+            }
+            return t->bauds[j];
+        }
+    }
+    return -1;
+}
+
+double urec_max_length(const struct urec_table *t, int baud, double threshold) {
+    double a;
+    int j = baud_index(t, baud, &a);
+    if (j < 0) {
+        return -1.0;
+    }
+    const float *c0 = t->pmax + (size_t)j * t->n_len;
+    const float *c1 = a > 0.0 ? c0 + t->n_len : c0;
+    // 두 단조 증가 열을 로짓 위에서 섞어도 단조 증가
+#define PMAX(i) blend(c0[i], c1[i], a)
+
+    if (PMAX(0) >= threshold) {
+        return 0.0;
+    }
+    if (PMAX(t->n_len - 1) < threshold) {
+        return t->max_length;
+    }
+    int lo = 0, hi = t->n_len - 1;      // PMAX(lo) < threshold ≤ PMAX(hi)
+    while (hi - lo > 1) {
+        int mid = lo + (hi - lo) / 2;
+        if (PMAX(mid) < threshold) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    // 두 격자점 사이에서 threshold를 지나는 위치
+    double p0 = PMAX(lo), p1 = PMAX(hi);
+#undef PMAX
+    return (lo + (threshold - p0) / (p1 - p0)) * t->step;
+}
+
+int urec_n_bauds(const struct urec_table *t) {
+    return t->n_bauds;
+}
+
+int urec_baud_at(const struct urec_table *t, int i) {
+    return i >= 0 && i < t->n_bauds ? t->bauds[i] : -1;
+}
+
+double urec_grid_max_length(const struct urec_table *t) {
+    return t->max_length;
+}
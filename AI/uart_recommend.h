@@ -0,0 +1,93 @@
+/*
+ * ============================================================================
+ * 케이블 길이/Baudrate 추천 라이브러리 (C, 파이썬은 uart_recommend.py)
+ * ============================================================================
+ *
+ * AI.py의 recommend_length()는 0.5m마다 predict_proba()를 60번 부르고
+ * recommend_baudrate()는 후보 속도마다 한 번씩 부름
+ *   → 데모로는 괜찮지만 링크마다 돌리는 설치 스크립트에는 너무 느림
+ *
+ * 이 라이브러리는 학습된 계수(uart_train의 모델 파일 또는 sklearn의 coef_)로
+ * (길이, Baudrate) 격자 위의 에러 확률을 한 번 미리 계산해 두고:
+ *   urec_best_baud()    길이 L에서 에러 확률이 가장 낮은 속도  - 속도 수만큼 O(1) 보간
+ *   urec_fastest_baud() 길이 L에서 확률이 p 미만인 가장 빠른 속도
+ *   urec_max_length()   속도 B, 허용 확률 p에서 최대 안정 길이 - 이분 탐색 O(log n)
+ * 모두 마이크로초 이하
+ *
+ * 최대 안정 길이는 AI.py와 같은 뜻:
+ *   0m부터 늘려 가다가 처음으로 p 이상이 되기 직전까지
+ *   (길이에 따라 확률이 오르내려도 되도록, 속도마다 "지금까지의 최댓값" 배열을
+ *    만들어 두면 이 배열은 단조 증가 → 이분 탐색 가능)
+ *
+ * 격자에 없는 속도는 log2(속도) 기준으로 이웃한 두 열을 로짓 위에서 보간
+ *
+ * 빌드 (공유 라이브러리):
+ *   gcc -O2 -Wall -shared -fPIC -o libuart_recommend.so uart_recommend.c -lm
+ */
+#ifndef UART_RECOMMEND_H
+#define UART_RECOMMEND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 격자 설정 (urec_create/urec_load에 NULL을 주면 아래 기본값) */
+struct urec_grid {
+    double     max_length;  // 0 ~ max_length (m), 기본 30
+    double     step;        // 길이 간격 (m), 기본 0.01
+    const int *bauds;       // 후보 속도 (오름차순), NULL이면 표준 8개 (9600 ~ 921600)
+    int        n_bauds;
+    int        packet_len;  // packet_len 특성에 넣을 값, 기본 10
+};
+
+struct urec_table;
+
+/*
+ * 계수로 표 만들기
+ *   features - 특성 이름 (uart_train과 같은 이름: length, baud, log_baud,
+ *              packet_len, length_log_baud)
+ *   weights  - 특성마다 계수 (원래 단위), bias - 절편
+ * 반환값: 표, 실패 시 NULL (errno: EINVAL 모르는 특성/잘못된 격자, ENOMEM)
+ */
+struct urec_table *urec_create(const char *const *features, const double *weights,
+                               int n_features, double bias, const struct urec_grid *grid);
+
+/*
+ * uart_train이 쓴 모델 파일로 표 만들기
+ * 반환값: 표, 실패 시 NULL (errno: EINVAL 형식이 틀림 또는 특성/계수가 8개 초과)
+ */
+struct urec_table *urec_load(const char *model_path, const struct urec_grid *grid);
+
+void urec_free(struct urec_table *t);
+
+/* 길이 L, 속도 B의 에러 확률 (격자 보간, 범위 밖이면 -1) */
+double urec_probability(const struct urec_table *t, double length, int baud);
+
+/*
+ * 길이 L에서 에러 확률이 가장 낮은 후보 속도 (같으면 빠른 쪽)
+ * prob이 NULL이 아니면 그 확률도 돌려줌
+ * 반환값: 속도, L이 격자 밖이면 -1
+ */
+int urec_best_baud(const struct urec_table *t, double length, double *prob);
+
+/* 길이 L에서 확률이 threshold 미만인 가장 빠른 후보 속도 (없으면 -1) */
+int urec_fastest_baud(const struct urec_table *t, double length, double threshold,
+                      double *prob);
+
+/*
+ * 속도 B에서 0m부터 확률이 threshold 미만으로 유지되는 최대 길이 (m)
+ *   0m에서 이미 넘으면 0, 끝까지 안 넘으면 max_length
+ *   B가 후보 속도 범위 밖이면 -1
+ */
+double urec_max_length(const struct urec_table *t, int baud, double threshold);
+
+/* 격자 정보 (파이썬 래퍼용) */
+int urec_n_bauds(const struct urec_table *t);
+int urec_baud_at(const struct urec_table *t, int i);
+double urec_grid_max_length(const struct urec_table *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_RECOMMEND_H */
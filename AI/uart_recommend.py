@@ -0,0 +1,182 @@
+# -*- coding: utf-8 -*-
+"""
+추천 라이브러리(libuart_recommend.so)의 파이썬 래퍼 (ctypes)
+
+AI.py의 recommend_*()와 같은 질문을 미리 계산한 표로 마이크로초 안에 답함
+  - uart_train이 쓴 모델 파일에서:  Recommender.from_model('uart_model.txt')
+  - sklearn 모델에서:               Recommender.from_sklearn(model, ['length', 'baud', 'packet_len'])
+
+빌드:
+  gcc -O2 -Wall -shared -fPIC -o libuart_recommend.so uart_recommend.c -lm
+"""
+
+import ctypes
+import os
+
+
+class _Grid(ctypes.Structure):
+    _fields_ = [
+        ('max_length', ctypes.c_double),
+        ('step', ctypes.c_double),
+        ('bauds', ctypes.POINTER(ctypes.c_int)),
+        ('n_bauds', ctypes.c_int),
+        ('packet_len', ctypes.c_int),
+    ]
+
+
+def _load_library(path=None):
+    # 기본은 이 파일과 같은 폴더의 .so
+    if path is None:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            'libuart_recommend.so')
+    lib = ctypes.CDLL(path, use_errno=True)
+
+    p_table = ctypes.c_void_p
+    lib.urec_create.restype = p_table
+    lib.urec_create.argtypes = [ctypes.POINTER(ctypes.c_char_p),
+                                ctypes.POINTER(ctypes.c_double),
+                                ctypes.c_int, ctypes.c_double, ctypes.POINTER(_Grid)]
+    lib.urec_load.restype = p_table
+    lib.urec_load.argtypes = [ctypes.c_char_p, ctypes.POINTER(_Grid)]
+    lib.urec_free.restype = None
+    lib.urec_free.argtypes = [p_table]
+    lib.urec_probability.restype = ctypes.c_double
+    lib.urec_probability.argtypes = [p_table, ctypes.c_double, ctypes.c_int]
+    lib.urec_best_baud.restype = ctypes.c_int
+    lib.urec_best_baud.argtypes = [p_table, ctypes.c_double, ctypes.POINTER(ctypes.c_double)]
+    lib.urec_fastest_baud.restype = ctypes.c_int
+    lib.urec_fastest_baud.argtypes = [p_table, ctypes.c_double, ctypes.c_double,
+                                      ctypes.POINTER(ctypes.c_double)]
+    lib.urec_max_length.restype = ctypes.c_double
+    lib.urec_max_length.argtypes = [p_table, ctypes.c_int, ctypes.c_double]
+    lib.urec_n_bauds.restype = ctypes.c_int
+    lib.urec_n_bauds.argtypes = [p_table]
+    lib.urec_baud_at.restype = ctypes.c_int
+    lib.urec_baud_at.argtypes = [p_table, ctypes.c_int]
+    return lib
+
+
+def _make_grid(max_length, step, bauds, packet_len):
+    grid = _Grid(max_length, step, None, 0, packet_len)
+    if bauds is not None:
+        arr = (ctypes.c_int * len(bauds))(*sorted(bauds))
+        grid.bauds = arr
+        grid.n_bauds = len(bauds)
+        grid._keep = arr    # 호출이 끝날 때까지 배열이 살아 있도록
+    return grid
+
+
+class Recommender:
+    """(길이, Baudrate) 에러 확률 표"""
+
+    _lib = None
+
+    def __init__(self, handle):
+        self._handle = handle
+
+    @classmethod
+    def _library(cls):
+        if cls._lib is None:
+            cls._lib = _load_library()
+        return cls._lib
+
+    @classmethod
+    def _check(cls, handle, what):
+        if not handle:
+            err = ctypes.get_errno()
+            raise OSError(err, '%s: %s' % (what, os.strerror(err)))
+        return cls(handle)
+
+    @classmethod
+    def from_model(cls, path, max_length=30.0, step=0.01, bauds=None, packet_len=10):
+        """uart_train의 모델 파일로 표 만들기"""
+        lib = cls._library()
+        grid = _make_grid(max_length, step, bauds, packet_len)
+        return cls._check(lib.urec_load(path.encode(), ctypes.byref(grid)), path)
+
+    @classmethod
+    def from_coefficients(cls, features, weights, bias, max_length=30.0, step=0.01,
+                          bauds=None, packet_len=10):
+        """특성 이름 목록 + 계수로 표 만들기 (개수가 다르면 ValueError)"""
+        if len(weights) != len(features):
+            raise ValueError('%d weights for %d features (%s)'
+                             % (len(weights), len(features), ', '.join(features)))
+        lib = cls._library()
+        names = (ctypes.c_char_p * len(features))(*[f.encode() for f in features])
+        w = (ctypes.c_double * len(weights))(*[float(x) for x in weights])
+        grid = _make_grid(max_length, step, bauds, packet_len)
+        return cls._check(lib.urec_create(names, w, len(features), float(bias),
+                                          ctypes.byref(grid)), 'urec_create')
+
+    @classmethod
+    def from_sklearn(cls, model, features=('length', 'baud', 'packet_len'), **kw):
+        """AI.py의 LogisticRegression (입력 순서 = features, AI.py는 length/baudrate/packet_len)"""
+        return cls.from_coefficients(list(features), list(model.coef_[0]),
+                                     float(model.intercept_[0]), **kw)
+
+    def close(self):
+        if self._handle:
+            self._library().urec_free(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def bauds(self):
+        lib = self._library()
+        return [lib.urec_baud_at(self._handle, i) for i in range(lib.urec_n_bauds(self._handle))]
+
+    def probability(self, length, baudrate):
+        """에러 확률 (격자 밖이면 None)"""
+        p = self._library().urec_probability(self._handle, length, baudrate)
+        return None if p < 0 else p
+
+    def best_baud(self, length):
+        """길이에서 에러 확률이 가장 낮은 속도 → (baud, prob), AI.py의 recommend_baudrate()"""
+        p = ctypes.c_double()
+        b = self._library().urec_best_baud(self._handle, length, ctypes.byref(p))
+        return (None, None) if b < 0 else (b, p.value)
+
+    def fastest_baud(self, length, threshold=0.01):
+        """길이에서 에러 확률이 threshold 미만인 가장 빠른 속도 → (baud, prob)"""
+        p = ctypes.c_double()
+        b = self._library().urec_fastest_baud(self._handle, length, threshold, ctypes.byref(p))
+        return (None, None) if b < 0 else (b, p.value)
+
+    def max_length(self, baudrate, threshold=0.01):
+        """속도에서 안정적인 최대 케이블 길이 (m), AI.py의 recommend_length()"""
+        v = self._library().urec_max_length(self._handle, baudrate, threshold)
+        return None if v < 0 else v
+
+    def recommend(self, length=None, baudrate=None, threshold=0.01):
+        """AI.py의 recommend()와 같은 형식의 결과"""
+        if length is not None:
+            b, prob = self.best_baud(length)
+            return {
+                "input_length": length,
+                "recommended_baudrate": b,
+                "error_probability": prob
+            }
+        if baudrate is not None:
+            return {
+                "input_baudrate": baudrate,
+                "max_stable_length": self.max_length(baudrate, threshold)
+            }
+        return "length 또는 baudrate 중 하나를 넣어야 합니다."
+
+
+if __name__ == '__main__':
+    import sys
+    import time
+
+    rec = Recommender.from_model(sys.argv[1] if len(sys.argv) > 1 else 'uart_model.txt')
+    for b in rec.bauds():
+        print('%7d bps: max stable length %.2f m' % (b, rec.max_length(b)))
+    print(rec.recommend(length=10))
+    print(rec.recommend(baudrate=230400))
+
+    n = 100000
+    t0 = time.perf_counter()
+    for i in range(n):
+        rec.max_length(230400, 0.01)
+    print('max_length: %.2f us/call (incl. ctypes)' % ((time.perf_counter() - t0) / n * 1e6))
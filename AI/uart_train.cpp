@@ -0,0 +1,650 @@
+/*
+ * ============================================================================
+ * 에러 확률 로지스틱 회귀 학습기 (uart_train)
+ * ============================================================================
+ *
+ * AI.py는 측정할 때마다 pandas로 전체 CSV를 읽고 sklearn으로 처음부터 다시 학습
+ *   → 데이터가 늘수록 느려지고, 측정 루프 안에서 돌릴 수 없음
+ *
+ * 이 도구:
+ *   1) 파일을 mmap해서 한 번만 스캔 (uart_csv.hpp, 코어 수만큼 동시에)
+ *      같은 조건(길이, Baudrate, 패킷 길이)의 줄은 특성 값이 똑같으므로
+ *      조건마다 (OK 개수, ERR 개수) 한 칸으로 합침
+ *      → 메모리는 조건 수에만 비례 (줄 수와 무관)
+ *   2) 합친 칸들 위에서 뉴턴법(IRLS)으로 가중 로그 손실 + L2를 최소화
+ *      칸마다 n번 나온 샘플 = 가중치 n인 샘플 하나 → 줄 단위로 학습한 것과 같은 해
+ *      특성이 몇 개뿐이라 헤시안이 작아서 한 번에 수렴 (보통 10회 이내)
+ *   3) 저장한 계수(--init)에서 시작하면 새 데이터가 조금 늘었을 때 1~3회로 끝남
+ *
+ * 특성 (--features로 고름, 절편은 항상 포함):
+ *   length          케이블 길이 (m)
+ *   baud            Baudrate 그대로 (AI.py와 같은 입력)
+ *   log_baud        log2(Baudrate / 9600)  (9600 → 0, 230400 → 4.58)
+ *   packet_len      패킷 길이 (바이트)
+ *   length_log_baud length * log_baud  (긴 케이블일수록 고속에서 더 나빠지는 효과)
+ *
+ *   비트 에러 수와 지연은 그 패킷을 보낸 "결과"라서 입력으로 넣으면
+ *   정답을 미리 보여 주는 셈 (ERR ⇔ 비트 에러 > 0) → 특성으로는 두지 않음
+ *
+ * 검증:
+ *   페이로드의 해시로 줄마다 학습/검증을 고정 배정 (--holdout, 기본 20%)
+ *   → 실행할 때마다, 스레드 수가 달라도 같은 줄이 같은 쪽으로 감
+ *
+ * 모델 파일 (텍스트, 계수는 원래 단위 → 읽는 쪽은 특성을 그대로 넣으면 됨):
+ *   uart_model 1
+ *   features length log_baud packet_len length_log_baud
+ *   bias -17.75
+ *   weights -0.849 3.62 0 0.178
+ *   rows 9029          (학습에 쓴 줄 수)
+ *   loss 0.0936
+ *
+ * 사용법:
+ *   ./uart_train [options] DATASET.csv...
+ *   ./uart_train --init uart_model.txt -o uart_model.txt uart_dataset.csv
+ *
+ * 빌드:
+ *   g++ -O2 -std=c++17 -pthread -o uart_train uart_train.cpp
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <getopt.h>
+
+#include "uart_csv.hpp"
+
+namespace {
+
+/*
+ * ----------------------------------------------------------------------------
+ * 특성
+ * ----------------------------------------------------------------------------
+ */
+enum feature_id { F_LENGTH, F_BAUD, F_LOG_BAUD, F_PACKET_LEN, F_LENGTH_LOG_BAUD, F_COUNT };
+
+const char *const FEATURE_NAMES[F_COUNT] = {
+    "length", "baud", "log_baud", "packet_len", "length_log_baud"
+};
+
+constexpr int MAX_DIM = 1 + F_COUNT;    // 절편 + 특성
+
+double feature_value(feature_id f, double length, int baud, int packet_len) {
+    switch (f) {
+    case F_LENGTH:          return length;
+    case F_BAUD:            return baud;
+    case F_LOG_BAUD:        return std::log2(baud / 9600.0);
+    case F_PACKET_LEN:      return packet_len;
+    case F_LENGTH_LOG_BAUD: return length * std::log2(baud / 9600.0);
+    default:                return 0.0;
+    }
+}
+
+// "length,log_baud" → 특성 번호 목록, 모르는 이름이면 false
+bool parse_features(const char *spec, std::vector<feature_id> &out) {
+    out.clear();
+    std::string s(spec);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = s.find(',', pos);
+        std::string name = s.substr(pos, comma == std::string::npos ? std::string::npos
+                                                                    : comma - pos);
+        int id = -1;
+        for (int i = 0; i < F_COUNT; i++) {
+            if (name == FEATURE_NAMES[i]) {
+                id = i;
+            }
+        }
+        if (id < 0 || std::find(out.begin(), out.end(), (feature_id)id) != out.end()) {
+            std::fprintf(stderr, "unknown or repeated feature '%s'\n", name.c_str());
+            return false;
+        }
+        out.push_back((feature_id)id);
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    return !out.empty();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 스캔: 조건별 (OK, ERR) 개수
+ * ----------------------------------------------------------------------------
+ */
+struct counts {
+    uint64_t ok = 0;
+    uint64_t err = 0;
+};
+
+using cell_map = std::unordered_map<uint64_t, counts>;
+
+struct table {
+    cell_map train, test;
+    uint64_t lines = 0;
+    uint64_t malformed = 0;
+
+    void merge(const table &o) {
+        for (const auto &kv : o.train) {
+            train[kv.first].ok += kv.second.ok;
+            train[kv.first].err += kv.second.err;
+        }
+        for (const auto &kv : o.test) {
+            test[kv.first].ok += kv.second.ok;
+            test[kv.first].err += kv.second.err;
+        }
+        lines += o.lines;
+        malformed += o.malformed;
+    }
+};
+
+// FNV-1a (페이로드는 난수라 이것만으로 고르게 섞임)
+uint32_t hash_bytes(std::string_view s) {
+    uint32_t h = 2166136261u;
+    for (char c : s) {
+        h = (h ^ (uint8_t)c) * 16777619u;
+    }
+    return h;
+}
+
+void scan_chunk(const char *begin, const char *end, uint32_t holdout_per_mille, table &t) {
+    t.train.reserve(1024);
+    t.test.reserve(1024);
+    uart::scan_lines(begin, end, [&](const char *line, size_t len,
+                                     const uint32_t *commas, int ncommas) {
+        t.lines++;
+        uart::dataset_row r;
+        if (!uart::parse_dataset_row(line, len, commas, ncommas, r)) {
+            t.malformed++;
+            return;
+        }
+        if (r.st == uart::status::other) {
+            return;     // TIMEOUT 등은 OK/ERR 분류 대상이 아님
+        }
+        cell_map &m = hash_bytes(r.sent) % 1000 < holdout_per_mille ? t.test : t.train;
+        counts &c = m[uart::config_key(r.length_cm, r.baudrate, r.packet_len)];
+        if (r.st == uart::status::ok) {
+            c.ok++;
+        } else {
+            c.err++;
+        }
+    });
+}
+
+bool scan_file(const char *path, unsigned nthreads, uint32_t holdout_per_mille,
+               table &total, uint64_t &bytes) {
+    uart::mapped_file f;
+    std::string err;
+    if (!f.open(path, err)) {
+        std::fprintf(stderr, "%s\n", err.c_str());
+        return false;
+    }
+    bytes += f.size();
+
+    std::vector<table> parts(nthreads);
+    unsigned n = uart::for_each_chunk(f.data(), f.size(), nthreads,
+                                      [&](const char *b, const char *e, unsigned i) {
+                                          scan_chunk(b, e, holdout_per_mille, parts[i]);
+                                      });
+    for (unsigned i = 0; i < n; i++) {
+        total.merge(parts[i]);
+    }
+    return true;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 가중 로지스틱 회귀 (뉴턴법)
+ * ----------------------------------------------------------------------------
+ * 표준화한 특성 위에서 풀고 저장할 때 원래 단위로 되돌림
+ *   표준화하지 않으면 baud(~10^5)와 length(~1)의 L2 벌점 크기가 전혀 달라짐
+ */
+struct sample {
+    double x[MAX_DIM];      // x[0] = 1 (절편)
+    double n;               // 이 조건의 샘플 수
+    double k;               // 그중 ERR 수
+};
+
+struct problem {
+    int dim = 0;                    // 절편 포함
+    double mean[MAX_DIM] = {};      // 표준화 (x - mean) / sd, [0]은 안 씀
+    double sd[MAX_DIM] = {};
+    double l2 = 0.0;
+    double total_n = 0.0;
+    std::vector<sample> rows;
+};
+
+std::vector<sample> build_samples(const cell_map &cells, const std::vector<feature_id> &feat) {
+    // 키 순으로 (합치는 순서가 스레드 수에 따라 달라도 같은 계수가 나오도록)
+    std::vector<std::pair<uint64_t, counts>> sorted(cells.begin(), cells.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    std::vector<sample> out;
+    out.reserve(sorted.size());
+    for (const auto &kv : sorted) {
+        sample s;
+        s.x[0] = 1.0;
+        double length = uart::key_length_cm(kv.first) / 100.0;
+        int baud = uart::key_baudrate(kv.first);
+        int plen = uart::key_packet_len(kv.first);
+        for (size_t j = 0; j < feat.size(); j++) {
+            s.x[j + 1] = feature_value(feat[j], length, baud, plen);
+        }
+        s.n = (double)(kv.second.ok + kv.second.err);
+        s.k = (double)kv.second.err;
+        out.push_back(s);
+    }
+    return out;
+}
+
+void standardize(problem &p) {
+    for (int j = 1; j < p.dim; j++) {
+        double sum = 0.0, sq = 0.0;
+        for (const auto &s : p.rows) {
+            sum += s.n * s.x[j];
+        }
+        double m = p.total_n > 0 ? sum / p.total_n : 0.0;
+        for (const auto &s : p.rows) {
+            sq += s.n * (s.x[j] - m) * (s.x[j] - m);
+        }
+        double sd = p.total_n > 0 ? std::sqrt(sq / p.total_n) : 0.0;
+        p.mean[j] = m;
+        p.sd[j] = sd > 1e-12 ? sd : 0.0;    // 상수 특성은 0으로 (절편과 겹침)
+    }
+    for (auto &s : p.rows) {
+        for (int j = 1; j < p.dim; j++) {
+            s.x[j] = p.sd[j] > 0 ? (s.x[j] - p.mean[j]) / p.sd[j] : 0.0;
+        }
+    }
+}
+
+// log(1 + e^z), 큰 |z|에서도 넘치지 않게
+double log1pexp(double z) {
+    return z > 0 ? z + std::log1p(std::exp(-z)) : std::log1p(std::exp(z));
+}
+
+double sigmoid(double z) {
+    return z >= 0 ? 1.0 / (1.0 + std::exp(-z)) : std::exp(z) / (1.0 + std::exp(z));
+}
+
+double dot(const double *a, const double *b, int n) {
+    double s = 0.0;
+    for (int i = 0; i < n; i++) {
+        s += a[i] * b[i];
+    }
+    return s;
+}
+
+// 평균 로그 손실 + (l2/2)|w|^2 (절편 제외)
+double objective(const problem &p, const double *w) {
+    double f = 0.0;
+    for (const auto &s : p.rows) {
+        double z = dot(s.x, w, p.dim);
+        f += s.n * log1pexp(z) - s.k * z;
+    }
+    f /= p.total_n;
+    for (int j = 1; j < p.dim; j++) {
+        f += 0.5 * p.l2 * w[j] * w[j];
+    }
+    return f;
+}
+
+// 대칭 양의 정부호 A x = b (촐레스키, A는 덮어씀)
+bool cholesky_solve(double a[MAX_DIM][MAX_DIM], const double *b, double *x, int n) {
+    for (int j = 0; j < n; j++) {
+        double d = a[j][j] - dot(a[j], a[j], j);
+        if (d <= 0.0) {
+            return false;
+        }
+        a[j][j] = std::sqrt(d);
+        for (int i = j + 1; i < n; i++) {
+            a[i][j] = (a[i][j] - dot(a[i], a[j], j)) / a[j][j];
+        }
+    }
+    double y[MAX_DIM];
+    for (int i = 0; i < n; i++) {
+        y[i] = (b[i] - dot(a[i], y, i)) / a[i][i];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double s = y[i];
+        for (int k = i + 1; k < n; k++) {
+            s -= a[k][i] * x[k];
+        }
+        x[i] = s / a[i][i];
+    }
+    return true;
+}
+
+/*
+ * w에서 시작해 수렴할 때까지 뉴턴 스텝 (백트래킹 직선 탐색)
+ * 반환값: 반복 횟수, 실패하면 -1
+ */
+int fit(const problem &p, double *w, int max_iter, double &loss) {
+    const int d = p.dim;
+    loss = objective(p, w);
+    for (int iter = 1; iter <= max_iter; iter++) {
+        double g[MAX_DIM] = {};
+        double h[MAX_DIM][MAX_DIM] = {};
+        for (const auto &s : p.rows) {
+            double mu = sigmoid(dot(s.x, w, d));
+            double r = s.n * mu - s.k;
+            double v = s.n * mu * (1.0 - mu);
+            for (int i = 0; i < d; i++) {
+                g[i] += r * s.x[i];
+                for (int j = 0; j <= i; j++) {
+                    h[i][j] += v * s.x[i] * s.x[j];
+                }
+            }
+        }
+        for (int i = 0; i < d; i++) {
+            g[i] /= p.total_n;
+            for (int j = 0; j <= i; j++) {
+                h[i][j] /= p.total_n;
+                h[j][i] = h[i][j];
+            }
+            // 절편에도 아주 작은 값 (ERR가 하나도 없으면 절편이 -∞로 가려 함)
+            h[i][i] += i > 0 ? p.l2 : 1e-10;
+            if (i > 0) {
+                g[i] += p.l2 * w[i];
+            }
+        }
+
+        double step[MAX_DIM];
+        if (!cholesky_solve(h, g, step, d)) {
+            return -1;
+        }
+        double decrement = dot(g, step, d);     // 뉴턴 감소량 (≥ 0)
+        if (decrement < 1e-14) {
+            return iter - 1;
+        }
+
+        double t = 1.0, next[MAX_DIM], f_next = loss;
+        for (int ls = 0; ls < 40; ls++, t *= 0.5) {
+            for (int i = 0; i < d; i++) {
+                next[i] = w[i] - t * step[i];
+            }
+            f_next = objective(p, next);
+            if (f_next <= loss - 0.25 * t * decrement) {
+                break;
+            }
+        }
+        std::memcpy(w, next, sizeof(double) * d);
+        loss = f_next;
+    }
+    return max_iter;
+}
+
+// 원래 단위 ↔ 표준화 단위 계수 변환
+void to_standard(const problem &p, const double *raw, double *w) {
+    w[0] = raw[0];
+    for (int j = 1; j < p.dim; j++) {
+        w[j] = raw[j] * p.sd[j];
+        w[0] += raw[j] * p.mean[j];
+    }
+}
+
+void to_raw(const problem &p, const double *w, double *raw) {
+    raw[0] = w[0];
+    for (int j = 1; j < p.dim; j++) {
+        raw[j] = p.sd[j] > 0 ? w[j] / p.sd[j] : 0.0;
+        raw[0] -= raw[j] * p.mean[j];
+    }
+}
+
+struct eval_result {
+    double n = 0, logloss = 0, brier = 0;
+};
+
+// 원래 단위 계수로 평가 (표준화 전 샘플)
+eval_result evaluate(const std::vector<sample> &rows, const double *raw, int dim) {
+    eval_result e;
+    for (const auto &s : rows) {
+        double z = dot(s.x, raw, dim);
+        double mu = sigmoid(z);
+        e.n += s.n;
+        e.logloss += s.n * log1pexp(z) - s.k * z;
+        e.brier += s.k * (1.0 - mu) * (1.0 - mu) + (s.n - s.k) * mu * mu;
+    }
+    if (e.n > 0) {
+        e.logloss /= e.n;
+        e.brier /= e.n;
+    }
+    return e;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 모델 파일
+ * ----------------------------------------------------------------------------
+ */
+bool load_model(const char *path, const std::vector<feature_id> &feat, double *raw) {
+    FILE *fp = std::fopen(path, "r");
+    if (!fp) {
+        std::perror(path);
+        return false;
+    }
+    char line[1024];
+    int version = 0;
+    std::vector<std::string> names;
+    std::vector<double> weights;
+    double bias = 0.0;
+    while (std::fgets(line, sizeof(line), fp)) {
+        char *save = nullptr;
+        char *key = strtok_r(line, " \t\r\n", &save);
+        if (!key || key[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> vals;
+        for (char *v; (v = strtok_r(nullptr, " \t\r\n", &save));) {
+            vals.emplace_back(v);
+        }
+        if (!std::strcmp(key, "uart_model") && !vals.empty()) {
+            version = std::atoi(vals[0].c_str());
+        } else if (!std::strcmp(key, "features")) {
+            names = vals;
+        } else if (!std::strcmp(key, "bias") && !vals.empty()) {
+            bias = std::atof(vals[0].c_str());
+        } else if (!std::strcmp(key, "weights")) {
+            for (const auto &v : vals) {
+                weights.push_back(std::atof(v.c_str()));
+            }
+        }
+    }
+    std::fclose(fp);
+
+    if (version != 1 || names.size() != weights.size()) {
+        std::fprintf(stderr, "%s: not a uart_model 1 file\n", path);
+        return false;
+    }
+    if (names.size() != feat.size()) {
+        std::fprintf(stderr, "%s: feature list differs from --features\n", path);
+        return false;
+    }
+    for (size_t j = 0; j < feat.size(); j++) {
+        if (names[j] != FEATURE_NAMES[feat[j]]) {
+            std::fprintf(stderr, "%s: feature list differs from --features\n", path);
+            return false;
+        }
+    }
+    raw[0] = bias;
+    for (size_t j = 0; j < weights.size(); j++) {
+        raw[j + 1] = weights[j];
+    }
+    return true;
+}
+
+// 임시 파일에 쓰고 rename (읽는 쪽이 반쯤 쓴 파일을 보지 않도록)
+bool save_model(const char *path, const std::vector<feature_id> &feat, const double *raw,
+                uint64_t rows, double loss) {
+    std::string tmp = std::string(path) + ".tmp";
+    FILE *fp = std::fopen(tmp.c_str(), "w");
+    if (!fp) {
+        std::perror(tmp.c_str());
+        return false;
+    }
+    std::fprintf(fp, "uart_model 1\nfeatures");
+    for (feature_id f : feat) {
+        std::fprintf(fp, " %s", FEATURE_NAMES[f]);
+    }
+    std::fprintf(fp, "\nbias %.17g\nweights", raw[0]);
+    for (size_t j = 0; j < feat.size(); j++) {
+        std::fprintf(fp, " %.17g", raw[j + 1]);
+    }
+    std::fprintf(fp, "\nrows %llu\nloss %.9g\n", (unsigned long long)rows, loss);
+    if (std::fclose(fp) != 0 || std::rename(tmp.c_str(), path) != 0) {
+        std::perror(path);
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void print_usage(const char *prog) {
+    std::printf("Usage: %s [options] DATASET.csv...\n", prog);
+    std::printf("Fit P(ERR | features) by weighted logistic regression.\n");
+    std::printf("\nOptions:\n");
+    std::printf("  -o, --out FILE      write the model to FILE (default uart_model.txt)\n");
+    std::printf("  --init FILE         warm-start from a saved model\n");
+    std::printf("  --features LIST     comma-separated, from: ");
+    for (int i = 0; i < F_COUNT; i++) {
+        std::printf("%s%s", i ? "," : "", FEATURE_NAMES[i]);
+    }
+    std::printf("\n                      (default length,log_baud,packet_len,length_log_baud)\n");
+    std::printf("  --l2 LAMBDA         L2 penalty on standardized weights (default 1e-4)\n");
+    std::printf("  --holdout F         fraction of rows held out for validation (default 0.2)\n");
+    std::printf("  --max-iter N        Newton iterations (default 50)\n");
+    std::printf("  --threads N         scan threads (default: all cores)\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const char *out_path = "uart_model.txt";
+    const char *init_path = nullptr;
+    const char *feature_spec = "length,log_baud,packet_len,length_log_baud";
+    double l2 = 1e-4;
+    double holdout = 0.2;
+    int max_iter = 50;
+    unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    static const struct option long_opts[] = {
+        { "out",      required_argument, nullptr, 'o' },
+        { "init",     required_argument, nullptr, 'i' },
+        { "features", required_argument, nullptr, 'f' },
+        { "l2",       required_argument, nullptr, 'l' },
+        { "holdout",  required_argument, nullptr, 'H' },
+        { "max-iter", required_argument, nullptr, 'm' },
+        { "threads",  required_argument, nullptr, 'j' },
+        { "help",     no_argument,       nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:i:f:l:H:m:j:h", long_opts, nullptr)) != -1) {
+        switch (opt) {
+        case 'o': out_path = optarg; break;
+        case 'i': init_path = optarg; break;
+        case 'f': feature_spec = optarg; break;
+        case 'l': l2 = std::max(0.0, std::atof(optarg)); break;
+        case 'H': holdout = std::min(0.9, std::max(0.0, std::atof(optarg))); break;
+        case 'm': max_iter = std::max(1, std::atoi(optarg)); break;
+        case 'j': nthreads = (unsigned)std::max(1, std::atoi(optarg)); break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    std::vector<feature_id> feat;
+    if (optind >= argc || !parse_features(feature_spec, feat)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    table total;
+    uint64_t bytes = 0;
+    for (int i = optind; i < argc; i++) {
+        if (!scan_file(argv[i], nthreads, (uint32_t)(holdout * 1000.0 + 0.5), total, bytes)) {
+            return 1;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    problem p;
+    p.dim = 1 + (int)feat.size();
+    p.l2 = l2;
+    p.rows = build_samples(total.train, feat);
+    std::vector<sample> test_rows = build_samples(total.test, feat);
+    std::vector<sample> train_raw = p.rows;
+    for (const auto &s : p.rows) {
+        p.total_n += s.n;
+    }
+    if (p.total_n == 0) {
+        std::fprintf(stderr, "no OK/ERR rows to train on\n");
+        return 1;
+    }
+    standardize(p);
+
+    double raw[MAX_DIM] = {}, w[MAX_DIM] = {};
+    if (init_path) {
+        if (!load_model(init_path, feat, raw)) {
+            return 1;
+        }
+        to_standard(p, raw, w);
+    } else {
+        // 절편만 있는 모델 (전체 에러율)에서 시작
+        double k = 0.0;
+        for (const auto &s : p.rows) {
+            k += s.k;
+        }
+        double rate = std::min(std::max(k / p.total_n, 1e-6), 1.0 - 1e-6);
+        w[0] = std::log(rate / (1.0 - rate));
+    }
+
+    double start_loss = objective(p, w);
+    double loss;
+    int iters = fit(p, w, max_iter, loss);
+    if (iters < 0) {
+        std::fprintf(stderr, "Newton step failed (singular Hessian; try a larger --l2)\n");
+        return 1;
+    }
+    to_raw(p, w, raw);
+    auto t2 = std::chrono::steady_clock::now();
+
+    eval_result tr = evaluate(train_raw, raw, p.dim);
+    eval_result te = evaluate(test_rows, raw, p.dim);
+
+    std::printf("%-16s %14s\n", "coefficient", "value");
+    std::printf("%-16s %14.6g\n", "bias", raw[0]);
+    for (size_t j = 0; j < feat.size(); j++) {
+        std::printf("%-16s %14.6g\n", FEATURE_NAMES[feat[j]], raw[j + 1]);
+    }
+    std::printf("\n%-10s %10s %10s %10s\n", "set", "rows", "logloss", "brier");
+    std::printf("%-10s %10.0f %10.6f %10.6f\n", "train", tr.n, tr.logloss, tr.brier);
+    if (te.n > 0) {
+        std::printf("%-10s %10.0f %10.6f %10.6f\n", "holdout", te.n, te.logloss, te.brier);
+    }
+
+    if (!save_model(out_path, feat, raw, (uint64_t)p.total_n, loss)) {
+        return 1;
+    }
+
+    double scan_s = std::chrono::duration<double>(t1 - t0).count();
+    double fit_s = std::chrono::duration<double>(t2 - t1).count();
+    std::fprintf(stderr, "%llu lines (%llu malformed), %zu+%zu cells, scan %.3f s, "
+                 "fit %d iter %.3f s (objective %.6f -> %.6f) -> %s\n",
+                 (unsigned long long)total.lines, (unsigned long long)total.malformed,
+                 p.rows.size(), test_rows.size(), scan_s, iters, fit_s,
+                 start_loss, loss, out_path);
+    return 0;
+}
@@ -13,13 +13,82 @@
  *   3. 아두이노가 받은 데이터를 그대로 에코백(echo back)
  *   4. 송신/수신 데이터를 strcmp()로 비교
  *   5. 일치하면 OK, 불일치하면 ERR로 CSV에 기록
+ *   6. 비트 에러 수/편집 거리 등 상세 비교 결과는 uart_detail.csv에 따로 기록
+ *   7. 왕복 지연 분포(p50/p99/p99.9/max)는 설정마다 uart_latency.csv에 한 줄씩
  * 
  * 사용법: 
- *   ./program <케이블길이(m)> [baudrate]
+ *   ./program <케이블길이(m)> [baudrate] [옵션]
  * 
  * 예시: 
  *   ./program 1.5 9600      → 1.5m 케이블, 9600 bps
  *   ./program 2.0 115200    → 2.0m 케이블, 115200 bps
+ *   ./program 2.0 921600 --window 4
+ *                           → 패킷 4개를 동시에 보내는 파이프라인 모드
+ * 
+ * 옵션:
+ *   --window N      N개의 패킷을 응답 대기 없이 연속 전송 (파이프라인 모드)
+ *                   시퀀스 번호로 에코를 짝지음 (uart_window.h 참고)
+ *                   아두이노 UNO 수신 버퍼가 64바이트이므로 4 이하 권장
+ *   --count N       N개 패킷을 처리하면 종료 (기본: Ctrl+C까지 무한)
+ *   --timeout MS    파이프라인 모드에서 에코를 기다리는 시간 (기본 200ms)
+ *                   윈도우 한 바퀴가 회선을 오가는 시간은 따로 더해짐 (긴 --len 대비)
+ *   --len N         페이로드 길이 1 ~ 4096바이트 (기본 10)
+ *                   버퍼는 시작할 때 길이에 맞춰 한 번만 잡음 (uart_window.h의 페이로드 풀)
+ *                   기본값이 아니면 기존 루프 대신 윈도우 1 이상의 파이프라인 모드
+ *                   데이터셋(uart_dataset.csv)의 마지막 열이 패킷 길이
+ *   --len-sweep LIST  LIST의 길이들을 차례로 측정 (예: 16,64,256 또는 all = 1,2,4,...,4096)
+ *                   --sweep과 같이 주면 속도마다 모든 길이, 아니면 지금 속도에서만
+ *                   속도마다 goodput(OK 페이로드 바이트/초)이 가장 높은 길이를 보고
+ *                   → uart_len_sweep.csv
+ *   --threads       송신 스레드와 수신 스레드를 분리 (락 없는 큐로 연결)
+ *                   에코가 늦거나 사라져도 송신이 멈추지 않음
+ *   --binary        텍스트 줄 대신 COBS 프레임 + CRC-16으로 송수신
+ *                   (uart_send_input/uart_frame.h 참고, 에코 펌웨어도 같은 헤더 사용)
+ *                   펌웨어에 "!BIN" 명령을 보내 전환하고 끝나면 되돌림
+ *   --split         왕복 에러를 상향(파이→아두이노)/하향(아두이노→파이)으로 나눠 셈
+ *                   펌웨어가 상향 프레임의 CRC를 직접 확인하고 에코 대신
+ *                   seq로 만든 페이로드를 보냄 → 호스트는 그걸로 하향만 따로 판정
+ *                   ("!SPLIT", uart_frame.h 참고, --binary 포함, --len은 63 이하)
+ *                   설정마다 방향별 에러율 → uart_split.csv
+ *   --pattern P     페이로드 패턴 (기본 random = 영숫자, uart_payload.h 참고)
+ *                   bytes, prbs7/15/23/31, walk1, walk0, fixed:HEX
+ *                   random과 출력 가능한 fixed:HEX 말고는 --binary 필요
+ *                   CSV의 payload 열은 이때 16진수로 기록
+ *   --seed N        페이로드 시드 (기본: 시각으로 정하고 시작할 때 출력)
+ *                   같은 시드 → 같은 패킷 (포트 번호와 패킷 번호로 정해짐)
+ *   --ber SECONDS   패킷 대신 PRBS를 빈틈없이 흘려서 비트 에러율 측정 (uart_ber.h)
+ *                   펌웨어를 "!STREAM"(받은 바이트를 그대로 에코) 모드로 전환
+ *                   1초마다 + 끝에 BER과 95% 신뢰 구간, 슬립 횟수 → uart_ber.csv
+ *   --sweep LIST    LIST의 속도들을 한 번 실행으로 차례로 측정 (예: 9600,115200 또는 all)
+ *                   "115200:230400:5000"처럼 시작:끝:간격으로 촘촘한 구간도 가능
+ *                   펌웨어와 "!BAUD n"으로 속도를 맞추고 tcsetattr()만 다시 함
+ *                   --count는 속도당 패킷 수 (기본 1000), 위치 인자 baudrate는 시작 속도
+ *   --adapt LIST    LIST의 속도들 사이를 오가며 에러율/지연에 따라 속도를 자동 조정
+ *                   --count 패킷마다 판정 (기본 500), 판정은 uart_adapt.csv에 기록
+ *   --adapt-per P   적응형 모드의 허용 에러율 (%, 기본 1)
+ *   --flush-ms MS   CSV를 모아서 디스크에 쓰는 주기 (기본 1000ms, 0 = 결과마다)
+ *                   파일 쓰기는 별도 스레드가 함 (uart_log.h 참고)
+ *   --capture FILE  보내고 받은 바이트를 시각과 함께 FILE에 이어 씀 (uart_capture.h)
+ *                   uart_replay로 나중에 같은 판정/통계를 다시 돌려볼 수 있음
+ *                   시퀀스 번호가 필요하므로 윈도우를 안 주면 윈도우 1로 동작
+ *   --summary FILE  (케이블 길이, Baudrate, 패킷 길이)별 누적 통계를 쓸 파일 (기본 uart_summary.csv)
+ *                   몇 초마다 + 종료할 때 통째로 다시 씀 (uart_stats.h)
+ *   --device PATH   UART 장치 경로 (기본 /dev/serial0)
+ *                   하드웨어 없이 시험할 때는 uart_sim이 만든 pty 링크 (예: /tmp/ttySIM)
+ *   --port D:L:B    장치 D, 케이블 길이 L, Baudrate B로 측정
+ *                   여러 번 주면 모든 포트를 하나의 epoll 루프에서 동시에 구동
+ *                   (이때 위치 인자는 생략, 윈도우 기본값 4)
+ *   --verbose       패킷마다 송수신 바이트/결과를 바로 출력 (예전 루프의 출력)
+ *                   기본은 메모리 트레이스 링에만 남기고 1초에 한 줄 (uart_trace.h)
+ *                   kill -USR1 <pid> → 최근 패킷들의 트레이스를 stderr로 덤프
+ *   --trace-errors N  ERR/TIMEOUT이 날 때마다 최근 N개 패킷의 트레이스를 덤프
+ *   --metrics SPEC  포트별 카운터/처리량/지연 분위수를 OpenMetrics로 내줌 (uart_metrics.h)
+ *                   SPEC = 포트 번호 (127.0.0.1만) 또는 unix:/경로 (유닉스 도메인 소켓)
+ *                   예: --metrics 9100 → curl http://127.0.0.1:9100/metrics
+ * 
+ * 빌드:
+ *   gcc -O2 -Wall -pthread -o claud_ver claud_ver.c -lm
+ *   (read_line 내부까지 트레이스하려면 -DTRACE_LEVEL=3)
  * 
  * 아두이노 코드 (에코백):
  *   void setup() { Serial.begin(9600); }
@@ -52,7 +121,37 @@
  // time, localtime, strftime
 
 #include <stdlib.h>     // 유틸리티 함수
- // rand, srand, atof, atoi
+ // atof, atoi
+
+#include <getopt.h>     // getopt_long: --window 같은 긴 옵션 처리
+
+#include <signal.h>     // sigaction: Ctrl+C를 받아서 정상 종료
+
+#include <poll.h>       // poll: 스레드 모드에서 한 fd만 기다릴 때
+
+#include <pthread.h>    // 스레드 모드의 송신/수신 스레드
+
+#include <sys/eventfd.h> // 스레드 간 깨우기 신호
+
+#include <sys/epoll.h>  // epoll: 여러 포트의 이벤트(송신 가능/수신 데이터)를 한 번에 대기
+
+#include <errno.h>      // errno, EAGAIN, EINTR
+
+#include <limits.h>     // INT_MAX
+
+#include "uart_clock.h"   // mono_ns(): 나노초 단조 시계
+#include "uart_window.h"  // 슬라이딩 윈도우 에코 엔진
+#include "uart_rx.h"      // 수신 링 버퍼 + 줄 단위 프레이머
+#include "uart_spsc.h"    // 락 없는 SPSC 큐 (스레드 모드)
+#include "uart_compare.h" // 비트/바이트 단위 에코 비교
+#include "uart_baud.h"    // termios2/BOTHER: 표준 상수에 없는 Baudrate
+#include "uart_hist.h"    // 지연 시간 히스토그램
+#include "uart_log.h"     // 비동기 CSV 기록 스레드
+#include "uart_capture.h" // 송수신 바이트 캡처 (--capture, uart_replay.c)
+#include "uart_payload.h" // 시드 고정 페이로드 생성기 (--pattern, --seed)
+#include "uart_ber.h"     // 연속 PRBS 스트림 BER 수신기 (--ber)
+#include "uart_trace.h"   // 메모리 트레이스 링 (패킷마다 printf 대신, --verbose, SIGUSR1)
+#include "uart_metrics.h" // OpenMetrics 엔드포인트 (--metrics)
 
 /*
 * ----------------------------------------------------------------------------
@@ -102,6 +201,11 @@
 */
 #define CSV_PATH "uart_dataset.csv"
 
+/*
+* 패킷(페이로드) 기본 길이 (--len으로 1 ~ WIN_MAX_PAYLOAD)
+*/
+#define DEFAULT_PACKET_LEN 10
+
 
 /*
 * ============================================================================
@@ -141,6 +245,50 @@ default:      return -1;        // 지원하지 않는 값
 }
 }
 
+/*
+* ----------------------------------------------------------------------------
+* 표준 상수에 없는 Baudrate (예: 150000)
+* ----------------------------------------------------------------------------
+* 리눅스에서는 termios2/BOTHER로 임의의 정수 속도를 줄 수 있음 (uart_baud.h)
+* 표준 8개는 지금처럼 상수로, 나머지는 termios2로 설정
+*/
+static int baudrate_supported(int baudrate) {
+if (get_baudrate_constant(baudrate) != (speed_t)-1) {
+return 1;
+}
+return uart_baud_other_supported() &&
+baudrate >= UART_BAUD_MIN && baudrate <= UART_BAUD_MAX;
+}
+
+/*
+* 열려 있는 포트의 속도만 바꿈 (나머지 설정은 그대로)
+* TCSADRAIN: 이미 쓴 데이터는 이전 속도로 다 나간 뒤 적용
+* 반환값: 성공 0, 실패 -1
+*/
+static int set_uart_baud(int fd, int baudrate) {
+speed_t baud_const = get_baudrate_constant(baudrate);
+if (baud_const == (speed_t)-1) {
+// 드라이버는 분주비로 만들 수 있는 가장 가까운 속도를 고름 → 차이가 나면 알려줌
+int actual;
+if (uart_set_baud_other(fd, baudrate, &actual) < 0) {
+return -1;
+}
+if (actual != baudrate) {
+printf("[BAUD] requested %d bps, driver set %d bps (%+.2f%%)\n",
+baudrate, actual, 100.0 * (actual - baudrate) / baudrate);
+}
+return 0;
+}
+
+struct termios options;
+if (tcgetattr(fd, &options) < 0) {
+return -1;
+}
+cfsetispeed(&options, baud_const);
+cfsetospeed(&options, baud_const);
+return tcsetattr(fd, TCSADRAIN, &options);
+}
+
 
 /*
 * ============================================================================
@@ -187,138 +335,2571 @@ printf("%c", str[i]);  // 그대로 출력
 printf("<%02X>", (unsigned char)str[i]);
 }
 }
-printf("\"\n");
+printf("\"\n");
+}
+
+
+/*
+* ============================================================================
+* UART 한 줄 읽기 함수
+* ============================================================================
+* 
+* 아두이노는 Serial.println()으로 데이터 끝에 \r\n을 붙여서 전송
+* 이 함수는 개행 문자를 만날 때까지 읽어서 한 줄을 돌려줌
+* 
+* 예전에는 read(fd, &c, 1)로 1바이트씩 읽고, 데이터가 없으면 1ms씩 잤음
+*   - 바이트마다 시스템 콜 → 고속 Baudrate에서 CPU 낭비
+*   - 1ms sleep → 모든 지연 측정이 1ms 단위로 뭉개짐
+* 
+* 지금은 uart_rx.h의 링 버퍼 프레이머를 사용:
+*   - read() 한 번에 도착한 만큼 전부 가져옴
+*   - memchr()로 개행 위치 검색
+*   - poll()로 데이터가 오는 즉시 깨어남
+*   - 개행 뒤에 같이 온 바이트는 링에 남아서 다음 호출에 사용됨
+* 
+* 파라미터:
+*   fd      - UART 파일 디스크립터 (open()의 반환값)
+*   buf     - 읽은 데이터를 저장할 버퍼
+*   max_len - 버퍼의 최대 크기
+* 
+* 반환값:
+*   읽은 문자 수 (개행 문자 제외, null 포함 안 함)
+* 
+* 타임아웃:
+*   호출 시점부터 200ms (CLOCK_MONOTONIC 기준 마감 시각)
+*   무한 대기 방지
+*/
+#define READ_LINE_TIMEOUT_MS 200
+
+/*
+* read_line()이 쓰는 링 버퍼
+* 함수 밖에 두는 이유: tcflush(TCIFLUSH)로 커널 버퍼를 비울 때
+* uart_rx_flush()로 링도 같이 비워야 하기 때문
+*/
+static struct uart_rx line_rx = { .fd = -1 };
+
+int read_line(int fd, char *buf, int max_len) {
+// 다른 fd로 처음 호출되면 링 초기화
+if (line_rx.fd != fd) {
+uart_rx_init(&line_rx, fd);
+}
+
+uint64_t reads_before = line_rx.reads;
+int idx = uart_rx_read_line(&line_rx, buf, max_len,
+(uint64_t)READ_LINE_TIMEOUT_MS * NS_PER_MS);
+if (idx < 0) {
+perror("UART read");
+idx = 0;
+buf[0] = '\0';
+}
+
+// 예전에는 여기서 [DEBUG] 줄을 두 번 출력했음 (지금은 디버그 빌드의 트레이스에만)
+TRACE_DEBUG(TE_READ, 0, idx, line_rx.reads - reads_before, NULL, 0);
+(void)reads_before;
+return idx;
+}
+
+
+/*
+* ============================================================================
+* 랜덤 패킷 생성 함수
+* ============================================================================
+* 
+* UART 통신 테스트를 위해 무작위 문자열 생성
+* 
+* 왜 랜덤 패킷을 사용하나?
+*   1. 항상 같은 문자열(예: "Hello")을 보내면:
+*      - 버퍼에 이전 데이터가 남아있어도 우연히 일치할 수 있음
+*      - 실제 통신 없이도 "OK"로 판정될 수 있음
+*   
+*   2. 매번 다른 문자열을 보내면:
+*      - 송신한 것과 정확히 일치해야만 OK
+*      - 진짜 통신이 성공했는지 확실히 검증 가능
+*   
+*   3. 다양한 비트 패턴 테스트:
+*      - 특정 문자 조합에서만 에러가 발생할 수 있음
+*      - 랜덤하면 다양한 패턴을 커버
+*      - --pattern으로 PRBS, walking-ones, 고정 바이트도 보낼 수 있음
+* 
+* 예전에는 rand()를 썼지만 지금은 uart_payload.h의 생성기 사용
+*   패킷 내용이 (시드, 포트 번호, 패킷 번호)로만 정해짐
+*   → --seed를 같게 주면 같은 패킷을 그대로 다시 보낼 수 있음
+* 
+* 파라미터:
+*   g      - 패턴과 시드 (--pattern, --seed)
+*   stream - 포트 번호 (멀티 포트에서 포트마다 다른 패킷)
+*   index  - 패킷 번호 (0부터)
+*   buf    - 생성된 패킷을 저장할 버퍼 (len+1 이상 크기 필요)
+*   len    - 생성할 패킷 길이 (null 제외)
+*/
+void generate_random_packet(const struct payload_gen *g, int stream, uint64_t index,
+char *buf, int len) {
+payload_make(g, (uint64_t)stream, index, (uint8_t *)buf, len);
+
+// 문자열 종료 (텍스트 모드용, 바이너리 패턴은 길이로 다룸)
+buf[len] = '\0';
+}
+
+
+/*
+* 사용법 출력
+*/
+static void print_usage(const char *prog) {
+printf("Usage: %s <cable_length> [baudrate] [options]\n", prog);
+printf("       %s --port DEV:LEN:BAUD [--port ...] [options]\n", prog);
+printf("Example: %s 1.5 115200\n", prog);
+printf("         %s 1.5 921600 --window 4\n", prog);
+printf("         %s --port /dev/ttyUSB0:1.5:115200 --port /dev/ttyUSB1:5.0:115200\n", prog);
+printf("\nOptions:\n");
+printf("  --window N     keep N packets in flight (pipelined mode, 1..%d)\n", WIN_MAX_WINDOW);
+printf("  --count N      stop after N packets\n");
+printf("  --timeout MS   echo timeout in pipelined mode (default 200), on top of the\n");
+printf("                 time a full window of packets takes on the wire both ways\n");
+printf("  --len N        payload length in bytes, 1..%d (default %d); anything but\n",
+WIN_MAX_PAYLOAD, DEFAULT_PACKET_LEN);
+printf("                 the default runs pipelined (window 1 unless --window)\n");
+printf("  --len-sweep LIST  measure each payload length in LIST (comma-separated,\n");
+printf("                 START:END:STEP, or 'all' = powers of two up to %d) at the\n",
+WIN_MAX_PAYLOAD);
+printf("                 current baud, or at every --sweep rate; reports the length\n");
+printf("                 with the best goodput per baud (uart_len_sweep.csv)\n");
+printf("  --threads      separate TX and RX threads (window defaults to 4)\n");
+printf("  --binary       COBS-framed packets with CRC-16 instead of text lines\n");
+printf("  --split        attribute errors to a direction (implies --binary): the firmware\n");
+printf("                 checks each uplink frame's CRC and answers with a payload generated\n");
+printf("                 from the sequence number, which is checked here for the downlink;\n");
+printf("                 per-direction rates go to uart_split.csv; --len up to %d\n",
+FRAME_GEN_MAX);
+printf("  --pattern P    payload pattern: random (alphanumeric, default), bytes,\n");
+printf("                 prbs7, prbs15, prbs23, prbs31, walk1, walk0, fixed:HEX;\n");
+printf("                 all but random and printable fixed:HEX need --binary\n");
+printf("  --seed N       payload seed (default: from the clock, printed at start);\n");
+printf("                 the same seed regenerates the same packets\n");
+printf("  --ber SECS     stream PRBS (--pattern prbsN, default prbs23) for SECS seconds\n");
+printf("                 through the firmware's raw echo and report bit error rate,\n");
+printf("                 slips and 95%% bounds per second and overall (uart_ber.csv)\n");
+printf("  --sweep LIST   measure each baud in LIST (comma-separated, or 'all') in one run,\n");
+printf("                 switching the firmware over the link; --count is per rate;\n");
+printf("                 START:END:STEP expands to a fine-grained range\n");
+printf("  --adapt LIST   closed-loop baud control over the rates in LIST: step down when\n");
+printf("                 PER or p99 latency is too high, probe upward after clean epochs;\n");
+printf("                 --count is packets per epoch, decisions go to uart_adapt.csv\n");
+printf("  --adapt-per P  acceptable packet error rate in percent (default 1)\n");
+printf("  --flush-ms MS  write CSV rows to disk every MS ms (default %d, 0 = every row)\n",
+LOG_DEFAULT_FLUSH_MS);
+printf("  --capture FILE append raw TX/RX bytes with timestamps to FILE (see uart_replay)\n");
+printf("  --summary FILE per-(cable, baud, --len) running totals, rewritten every %ds\n",
+STATS_WRITE_MS / 1000);
+printf("                 and at exit (default %s)\n", STATS_DEFAULT_PATH);
+printf("  --device PATH  UART device (default %s)\n", UART_PATH);
+printf("  --port D:L:B   test device D with cable length L at baud B;\n");
+printf("                 repeat for several ports on one event loop\n");
+printf("  --verbose      print every trace event as it happens (old per-packet output)\n");
+printf("  --trace-errors N  on each ERR/TIMEOUT dump the last N packets' trace to stderr\n");
+printf("                 (kill -USR1 <pid> dumps the last %d at any time)\n",
+TRACE_DUMP_PACKETS);
+printf("  --metrics SPEC serve live counters and latency quantiles in OpenMetrics text:\n");
+printf("                 PORT listens on 127.0.0.1:PORT (GET /metrics),\n");
+printf("                 unix:PATH or /PATH on a Unix domain socket\n");
+printf("\nSupported baudrates: 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600\n");
+if (uart_baud_other_supported()) {
+printf("                     or any integer %d..%d via termios2 (e.g. 150000)\n",
+UART_BAUD_MIN, UART_BAUD_MAX);
+}
+}
+
+
+/*
+* ============================================================================
+* 종료 신호 처리
+* ============================================================================
+* 
+* Ctrl+C(SIGINT)를 받으면 즉시 죽지 않고 플래그만 세움
+* 루프가 플래그를 보고 빠져나와서:
+*   - 최종 통계 출력
+*   - CSV 파일 닫기
+*   - UART 닫기
+* 
+* volatile sig_atomic_t:
+*   시그널 핸들러와 main이 안전하게 공유할 수 있는 유일한 타입
+*/
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+(void)sig;
+stop_requested = 1;
+}
+
+
+/*
+* ============================================================================
+* 패킷별 상세 에러 로그 (uart_detail.csv)
+* ============================================================================
+* 
+* uart_dataset.csv는 AI/AI.py가 그대로 읽으므로 형식을 바꾸지 않고 (끝에 packet_len 열만 추가)
+* 비트 단위 비교 결과(uart_compare.h)는 별도 파일에 같은 순서로 기록
+* 
+* 형식 (첫 줄은 헤더):
+*   timestamp,status,seq,tx_len,rx_len,bit_errors,byte_subs,edit_distance,
+*   first_err,last_err,cable_length,baudrate
+* 
+* BER(비트 에러율) = sum(bit_errors) / sum(min(tx_len, rx_len) * 8)
+* 
+* 실제 기록은 uart_log.h의 기록 스레드가 함 (seq가 없는 기존 루프는 -1)
+*/
+#define DETAIL_CSV_PATH "uart_detail.csv"
+
+static FILE *open_detail_csv(void) {
+FILE *fp = fopen(DETAIL_CSV_PATH, "a");
+if (!fp) {
+perror("detail CSV open error");
+return NULL;
+}
+// 새 파일이면 헤더부터
+if (ftell(fp) == 0) {
+fprintf(fp, "timestamp,status,seq,tx_len,rx_len,bit_errors,byte_subs,"
+"edit_distance,first_err,last_err,cable_length,baudrate\n");
+}
+return fp;
+}
+
+
+
+/*
+* ============================================================================
+* 왕복 지연 (latency) 기록
+* ============================================================================
+* 
+* 패킷마다 세 시각을 CLOCK_MONOTONIC_RAW로 잼:
+*   t_write - 그 패킷의 write()가 끝난 시각
+*   t_first - 에코의 첫 바이트가 들어온 read() 시각
+*   t_last  - 에코의 마지막 바이트(개행/0x00)가 들어온 read() 시각
+* 
+* 히스토그램 두 개 (uart_hist.h):
+*   first = t_first - t_write  → 아두이노 반응 시간 + 선로 지연 (케이블 영향)
+*   last  = t_last  - t_write  → 패킷 전체 왕복 (타임아웃을 정하는 기준)
+* 
+* 측정 설정(케이블 길이, Baudrate)마다 한 쌍
+* 끝날 때 p50/p99/p99.9/max를 출력하고 uart_latency.csv에 한 줄 추가
+*/
+#define LATENCY_CSV_PATH "uart_latency.csv"
+#define SPLIT_CSV_PATH   "uart_split.csv"     // --split의 방향별 에러율
+
+struct latency {
+struct hist first;
+struct hist last;
+};
+
+static void latency_reset(struct latency *l) {
+hist_reset(&l->first);
+hist_reset(&l->last);
+}
+
+static void latency_record(struct latency *l, uint64_t t_write,
+uint64_t t_first, uint64_t t_last) {
+// 시각을 모르는 경우 (타임아웃 직후의 부분 데이터 등)는 건너뜀
+if (t_write == 0 || t_last < t_write) {
+return;
+}
+if (t_first >= t_write) {
+hist_record(&l->first, t_first - t_write);
+}
+hist_record(&l->last, t_last - t_write);
+}
+
+static void print_hist_line(const char *tag, const char *path, const char *what,
+const struct hist *h) {
+printf("[%s] %s latency %-5s n=%llu p50=%.1f p99=%.1f p99.9=%.1f max=%.1f us\n",
+tag, path, what, (unsigned long long)h->count,
+hist_percentile(h, 0.50) / 1e3, hist_percentile(h, 0.99) / 1e3,
+hist_percentile(h, 0.999) / 1e3, h->max / 1e3);
+}
+
+static void print_latency(const char *tag, const char *path, const struct latency *l) {
+if (l->last.count == 0) {
+return;
+}
+print_hist_line(tag, path, "first", &l->first);
+print_hist_line(tag, path, "last", &l->last);
+}
+
+/*
+* 한 설정의 결과를 uart_latency.csv에 한 줄 추가 (단위 us)
+* 형식 (첫 줄은 헤더):
+*   timestamp,cable_length,baudrate,count,
+*   first_p50,first_p99,first_p999,first_max,last_p50,last_p99,last_p999,last_max
+*/
+static void append_latency_csv(double cable_length, int baudrate,
+const struct latency *l) {
+if (l->last.count == 0) {
+return;
+}
+FILE *fp = fopen(LATENCY_CSV_PATH, "a");
+if (!fp) {
+perror("latency CSV open error");
+return;
+}
+if (ftell(fp) == 0) {
+fprintf(fp, "timestamp,cable_length,baudrate,count,"
+"first_p50,first_p99,first_p999,first_max,"
+"last_p50,last_p99,last_p999,last_max\n");
+}
+
+time_t t_now = time(NULL);
+char timestamp[64];
+strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&t_now));
+
+const struct hist *f = &l->first, *a = &l->last;
+fprintf(fp, "%s,%.2f,%d,%llu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+timestamp, cable_length, baudrate, (unsigned long long)a->count,
+hist_percentile(f, 0.50) / 1e3, hist_percentile(f, 0.99) / 1e3,
+hist_percentile(f, 0.999) / 1e3, f->max / 1e3,
+hist_percentile(a, 0.50) / 1e3, hist_percentile(a, 0.99) / 1e3,
+hist_percentile(a, 0.999) / 1e3, a->max / 1e3);
+fclose(fp);
+}
+
+
+/*
+* ============================================================================
+* 펌웨어 제어 명령 (링크 제어)
+* ============================================================================
+* 
+* 측정 데이터 말고 에코 펌웨어 자체에 내리는 명령
+*   텍스트 모드:   "!CMD ARG\n"         → 응답 "!OK CMD ARG\n" 또는 "!ERR ...\n"
+*   바이너리 모드: CTRL 프레임 "CMD ARG" → 응답 CTRL 프레임 "OK CMD ARG"
+* 
+* 명령 목록 (uart_send_input.ino 참고):
+*   BIN   - 바이너리(COBS) 모드로 전환
+*   SPLIT - 방향 분리 모드로 전환 (바이너리 프레임, 에코 대신 만든 페이로드)
+*   STATS - (바이너리) 상향 프레임 누적 "OK STATS <정상> <깨짐>"
+*   TEXT  - 텍스트 모드로 복귀
+*   PING  - 살아 있는지 확인
+* 
+* 에코 패킷의 시퀀스 헤더는 16진수로 시작하므로 '!'로 시작하는 줄과 겹치지 않음
+*/
+#define LINK_CMD_TIMEOUT_MS 500
+#define LINK_CMD_RETRIES    3
+
+/*
+* write()가 EAGAIN이면 송신 가능해질 때까지 poll()로 기다리며 전부 보냄
+* 반환값: 성공 0, 에러 -1
+*/
+static int write_all(int fd, const char *buf, size_t len) {
+while (len > 0) {
+ssize_t k = write(fd, buf, len);
+if (k > 0) {
+buf += k;
+len -= k;
+continue;
+}
+if (k < 0 && errno != EAGAIN && errno != EINTR) {
+return -1;
+}
+if (stop_requested) {
+return 0;
+}
+struct pollfd pfd = { fd, POLLOUT, 0 };
+poll(&pfd, 1, 100);
+}
+return 0;
+}
+
+/*
+* 응답 한 건이 기다리던 것인지 확인
+*   msg = "OK BIN" / "ERR BIN" 같은 문자열 ('!'나 프레임 헤더는 뗀 상태)
+* 반환값: 성공 응답 1, 실패 응답 -1, 상관없는 메시지 0
+*/
+static int link_check_reply(const char *msg, const char *cmd,
+char *reply, size_t reply_cap) {
+// 명령의 첫 단어 (예: "BAUD 115200" → "BAUD")
+size_t verb = strcspn(cmd, " ");
+
+int ok = strncmp(msg, "OK ", 3) == 0;
+if (!ok && strncmp(msg, "ERR ", 4) != 0) {
+return 0;
+}
+const char *rest = msg + (ok ? 3 : 4);
+if (strncmp(rest, cmd, verb) != 0 || (rest[verb] != '\0' && rest[verb] != ' ')) {
+return 0;
+}
+if (reply && reply_cap > 0) {
+snprintf(reply, reply_cap, "%s", rest);
+}
+return ok ? 1 : -1;
+}
+
+/*
+* 제어 명령을 보내고 응답을 기다림
+*   그 사이에 도착하는 에코/잡음은 버림
+* 
+* 파라미터:
+*   binary - 현재 링크가 바이너리 모드인지 (명령을 보낼 형식)
+*   reply  - 응답 내용 ("BIN", "BAUD 115200" 등, NULL 가능)
+* 
+* 반환값: 성공 0, 실패/타임아웃 -1
+*/
+static int link_command(int fd, struct uart_rx *rx, int binary, const char *cmd,
+char *reply, size_t reply_cap) {
+char wire[FRAME_MAX_WIRE(FRAME_STREAM_CTRL_MAX)];
+size_t wire_len;
+size_t cmd_len = strlen(cmd);
+if (cmd_len > FRAME_STREAM_CTRL_MAX) {
+return -1;
+}
+
+if (binary) {
+uint8_t scratch[FRAME_STREAM_CTRL_MAX + FRAME_OVERHEAD];
+wire_len = frame_encode(FRAME_TYPE_CTRL, 0, (const uint8_t *)cmd,
+(uint16_t)cmd_len, scratch, (uint8_t *)wire);
+} else {
+wire_len = (size_t)snprintf(wire, sizeof(wire), "!%s\n", cmd);
+}
+
+// Ctrl+C 뒤에도 모드 복귀(TEXT)는 한 번은 시도함
+for (int attempt = 0; attempt < LINK_CMD_RETRIES; attempt++) {
+if (attempt > 0 && stop_requested) {
+break;
+}
+if (write_all(fd, wire, wire_len) < 0) {
+return -1;
+}
+
+uint64_t deadline = mono_ns() + (uint64_t)LINK_CMD_TIMEOUT_MS * NS_PER_MS;
+for (;;) {
+char msg[WIN_MAX_WIRE + 64];
+int r = 0;
+
+if (binary) {
+uint8_t raw[sizeof(msg)];
+uint8_t type;
+uint16_t seq, plen;
+const uint8_t *payload;
+int n = uart_rx_next_frame(rx, (unsigned char *)msg, sizeof(msg), NULL);
+if (n >= 0) {
+int d = cobs_decode((const uint8_t *)msg, n, raw);
+if (d >= 0 && frame_parse(raw, d, &type, &seq, &payload, &plen) == 0 &&
+type == FRAME_TYPE_CTRL && plen < sizeof(msg)) {
+memcpy(msg, payload, plen);
+msg[plen] = '\0';
+r = link_check_reply(msg, cmd, reply, reply_cap);
+}
+if (r == 0) {
+continue;
+}
+}
+} else {
+int n = uart_rx_next_line(rx, msg, sizeof(msg));
+if (n >= 0) {
+if (msg[0] == '!') {
+r = link_check_reply(msg + 1, cmd, reply, reply_cap);
+}
+if (r == 0) {
+continue;
+}
+}
+}
+
+if (r != 0) {
+return r > 0 ? 0 : -1;
+}
+
+// 버퍼에 완성된 메시지가 없음 → 더 기다림
+uint64_t now = mono_ns();
+if (now >= deadline) {
+break;
+}
+struct pollfd pfd = { fd, POLLIN, 0 };
+int wait_ms = (int)((deadline - now + NS_PER_MS - 1) / NS_PER_MS);
+if (poll(&pfd, 1, wait_ms) > 0 && uart_rx_fill(rx) < 0) {
+return -1;
+}
+}
+}
+return -1;
+}
+
+
+/*
+* ============================================================================
+* 파이프라인 모드 (--window N) / 멀티 포트 모드 (--port)
+* ============================================================================
+* 
+* 기존 루프처럼 한 패킷씩 보내고 기다리는 대신,
+* 최대 N개의 패킷을 연속으로 보내고 돌아오는 에코를 시퀀스 번호로 짝지음
+* (짝짓기 규칙은 uart_window.h 참고)
+* 
+* sleep이 없음:
+*   epoll로 "보낼 수 있음(EPOLLOUT)"과 "읽을 데이터 있음(EPOLLIN)"을 기다림
+*   → 선로가 허용하는 만큼 빠르게 돌아감
+* 
+* 포트 여러 개:
+*   USB-시리얼 어댑터마다 케이블 길이가 다른 테스트 장비에서
+*   어댑터마다 프로세스를 따로 띄우지 않고, 하나의 epoll 루프로 전부 구동
+*   포트마다 자기 상태 머신 / 윈도우 / 수신 링 / 통계를 가짐
+*   결과는 모두 같은 CSV 파일에 (각 줄에 그 포트의 길이/Baudrate가 기록됨)
+* 
+*   ./program --port /dev/ttyUSB0:1.5:115200 --port /dev/ttyUSB1:5.0:115200
+* 
+* 포트 상태 머신:
+*   WAIT_RESET → RUNNING → DRAINING → DONE
+*        │           │          │
+*        └───────────┴──────────┴──→ FAILED (I/O 에러)
+* 
+*   WAIT_RESET - 포트를 연 직후 아두이노 리셋(약 2초) 대기
+*                sleep(2)로 전체를 멈추지 않고 포트별 시각만 기록
+*   RUNNING    - 윈도우를 채우며 송수신
+*   DRAINING   - --count만큼 다 보냄, 남은 에코만 기다림
+*   DONE       - 끝 (epoll에서 제거)
+* 
+* 1초마다 [STAT] 줄로 처리량 출력:
+*   pkt/s   - 초당 판정 완료된 패킷 수 (OK + ERR + TIMEOUT)
+*   goodput - 초당 OK로 돌아온 페이로드 바이트 수
+*   line    - 송신 선로 사용률 (8N1 = 1바이트당 10비트)
+*/
+#define MAX_PORTS       16
+#define ARDUINO_RESET_MS 2000
+
+enum port_state {
+PORT_WAIT_RESET,
+PORT_RUNNING,
+PORT_DRAINING,
+PORT_DONE,
+PORT_FAILED
+};
+
+/* 한 번의 측정(포트 하나) 결과 요약 (스윕 표에 사용) */
+struct run_summary {
+uint64_t sent, ok, err, timeouts;
+uint64_t ok_bytes;      // OK 패킷의 페이로드 바이트 합 (goodput)
+uint64_t bit_errors, bits_checked;
+double   secs;
+double   lat_p99_us;    // 전체 왕복 지연 p99 (샘플이 없으면 0)
+double   timeout_us;    // 실제로 쓴 에코 타임아웃 (--timeout + 윈도우의 회선 시간)
+};
+
+/*
+* 모든 포트가 공유하는 실행 설정과 출력
+*/
+struct run_ctx {
+struct async_log *log;  // 공유 CSV 두 개 (uart_dataset.csv, uart_detail.csv)
+int      packet_len;
+unsigned window;
+uint64_t timeout_ns;
+long     max_packets;   // 포트당 패킷 수 (0 = 무한)
+int      binary;        // 1 = COBS/CRC 프레임 (--binary), 0 = 텍스트 줄
+int      split;         // 1 = 상향/하향 에러를 따로 셈 (--split, binary도 1)
+struct payload_gen gen; // 페이로드 패턴과 시드 (--pattern, --seed)
+uint64_t payload_base;  // 이번 실행의 첫 패킷 번호 (스윕/적응 단계마다 이어서 셈)
+struct uart_capture *cap; // 송수신 바이트 캡처 (--capture, NULL = 안 함)
+struct run_summary last; // 단일 포트 실행(run_pipelined/run_threaded)의 마지막 결과
+unsigned trace_errors;  // ERR/TIMEOUT마다 최근 N개 패킷의 트레이스 덤프 (0 = 안 함)
+struct metrics_server *metrics; // 실시간 지표 (--metrics, NULL = 안 함)
+};
+
+/* 한 번의 write()로 모아 보내는 최대 패킷 수 */
+#define TX_BATCH 16
+
+struct uart_port {
+char            path[128];
+int             index;          // 캡처 파일의 포트 번호 (--port 순서)
+double          cable_length;
+int             baudrate;
+int             fd;
+enum port_state state;
+uint64_t        ready_at;       // WAIT_RESET이 끝나는 시각
+uint64_t        start;          // RUNNING 진입 시각
+uint64_t        end;            // DONE/FAILED 시각 (통계 기간의 끝)
+uint64_t        wire_bytes;     // 송신한 바이트 수
+uint64_t        bit_errors;     // 받은 에코의 비트 에러 합계
+uint64_t        bits_checked;   // 비교한 비트 수 (BER의 분모)
+struct latency  lat;            // 왕복 지연 히스토그램
+int             in_epoll;       // epoll에 등록되어 있는지
+int             want_out;       // epoll에 EPOLLOUT을 등록했는지
+
+struct run_ctx     *run;
+struct echo_window  win;
+
+// 송신 버퍼: 윈도우에 자리가 나면 여러 줄을 모아서 write() 한 번에 보냄
+// 크기는 port_init()에서 패킷 길이(--len)에 맞춰 잡음 (TX_BATCH개분)
+char    *txbuf;
+size_t   tx_cap, tx_wire;       // 버퍼 크기, 패킷 하나의 최대 회선 길이
+size_t   tx_len, tx_off;
+uint16_t batch_first;
+unsigned batch_n;
+
+// 수신 링 버퍼 (uart_rx.h)
+struct uart_rx rx;
+};
+
+/*
+* "DEV:LEN:BAUD" 형식의 --port 인자 해석
+* 장치 경로에 ':'가 들어갈 수 있으므로 뒤에서부터 자름
+* 반환값: 성공 0, 형식 오류 -1
+*/
+static int parse_port_spec(const char *spec, struct uart_port *p) {
+const char *baud_sep = strrchr(spec, ':');
+if (!baud_sep || baud_sep == spec) {
+return -1;
+}
+const char *len_sep = baud_sep - 1;
+while (len_sep > spec && *len_sep != ':') {
+len_sep--;
+}
+size_t path_len = (size_t)(len_sep - spec);
+if (*len_sep != ':' || path_len == 0 || path_len >= sizeof(p->path)) {
+return -1;
+}
+
+memset(p, 0, sizeof(*p));
+memcpy(p->path, spec, path_len);
+p->path[path_len] = '\0';
+p->cable_length = atof(len_sep + 1);
+p->baudrate = atoi(baud_sep + 1);
+p->fd = -1;
+return 0;
+}
+
+/*
+* UART 열기 + 설정
+* main()의 단일 포트 설정과 똑같이 8N1 Raw 모드로 맞춤
+* (각 플래그의 의미는 main()의 설명 참고)
+* 
+* 반환값: fd, 실패 시 -1
+*/
+static int open_uart(const char *path, int baudrate) {
+if (!baudrate_supported(baudrate)) {
+fprintf(stderr, "%s: unsupported baudrate %d\n", path, baudrate);
+return -1;
+}
+// 표준 상수가 없으면 일단 B38400으로 열고 아래에서 termios2로 덮어씀
+speed_t baud_const = get_baudrate_constant(baudrate);
+int custom = baud_const == (speed_t)-1;
+if (custom) {
+baud_const = B38400;
+}
+
+int fd = open(path, O_RDWR | O_NOCTTY);
+if (fd < 0) {
+perror(path);
+return -1;
+}
+
+struct termios options;
+if (tcgetattr(fd, &options) < 0) {
+perror(path);
+close(fd);
+return -1;
+}
+cfsetispeed(&options, baud_const);
+cfsetospeed(&options, baud_const);
+options.c_cflag = baud_const | CS8 | CLOCAL | CREAD;
+options.c_iflag = IGNPAR;
+options.c_oflag = 0;
+options.c_lflag = 0;
+options.c_cc[VMIN] = 0;
+options.c_cc[VTIME] = 10;
+
+tcflush(fd, TCIOFLUSH);
+if (tcsetattr(fd, TCSANOW, &options) < 0 ||
+(custom && set_uart_baud(fd, baudrate) < 0)) {
+perror(path);
+close(fd);
+return -1;
+}
+return fd;
+}
+
+/*
+* 패킷 하나의 판정이 끝날 때마다 호출됨
+* CSV 포맷은 기존 루프와 동일 (시퀀스 헤더는 빼고 페이로드만 기록)
+*/
+static void port_on_result(void *ctx, const struct inflight *pkt,
+enum echo_result r,
+const char *rx, int rx_len, uint64_t now) {
+struct uart_port *p = ctx;
+(void)now;
+
+TRACE_INFO(TE_ECHO, p->index, pkt->seq, r, rx, rx_len);
+
+// 기존 루프와 마찬가지로 응답 없음은 CSV에 기록하지 않음 (통계에만 반영)
+if (r == ECHO_TIMEOUT) {
+log_timeout(p->run->log, time(NULL), p->cable_length, p->baudrate, pkt->seq, pkt->len);
+if (p->run->trace_errors > 0) {
+trace_dump(stderr, p->run->trace_errors, "TIMEOUT");
+}
+return;
+}
+
+latency_record(&p->lat, pkt->t_write, p->win.echo_first, p->win.echo_last);
+
+// 비트 단위 비교 (OK는 전부 일치이므로 실제 비교는 ERR만)
+// 방향 분리 모드에서는 펌웨어가 만든 페이로드와 비교 → 하향 비트 에러만 셈
+// 페이로드 위치를 모르는 깨진 프레임(echo_raw)은 비교하지 않음 (compared = 0)
+struct echo_diff d;
+if (r == ECHO_ERR && !p->win.echo_raw) {
+char expect[WIN_MAX_PAYLOAD];
+echo_compare(window_expect(&p->win, pkt, expect), pkt->len, rx, rx_len, &d);
+} else {
+memset(&d, 0, sizeof(d));
+d.compared = r == ECHO_OK ? pkt->len : 0;
+d.first_err = d.last_err = -1;
+}
+p->bit_errors += d.bit_errors;
+p->bits_checked += (uint64_t)d.compared * 8;
+
+// 파일 쓰기는 기록 스레드가 함 (여기서는 링에 넣기만)
+// 텍스트가 아닌 패턴은 CSV가 깨지지 않도록 16진수로
+uint64_t rtt = pkt->t_write && p->win.echo_last >= pkt->t_write ?
+p->win.echo_last - pkt->t_write : 0;
+// 데이터셋에는 앞부분만 남으므로 (LOG_PAYLOAD_MAX) 그만큼만 변환
+char hex[LOG_PAYLOAD_MAX + 1];
+const char *sent = pkt->payload;
+if (!payload_text_safe(&p->run->gen)) {
+int n = pkt->len < LOG_PAYLOAD_MAX / 2 ? pkt->len : LOG_PAYLOAD_MAX / 2;
+payload_hex((const uint8_t *)pkt->payload, n, hex);
+sent = hex;
+}
+log_packet(p->run->log, time(NULL), echo_result_name(r), sent,
+p->cable_length, p->baudrate, pkt->seq, pkt->len, (size_t)rx_len, rtt, &d);
+
+// 예전에는 ERR마다 [ERR] 줄을 출력했음 → 에러가 몰리면 출력이 처리량을 깎음
+// 지금은 트레이스에만 (보낸 바이트는 TE_TX, 받은 바이트는 위의 TE_ECHO)
+if (r == ECHO_ERR) {
+TRACE_INFO(TE_DIFF, p->index, d.bit_errors, d.edit_distance, NULL, 0);
+if (p->run->trace_errors > 0) {
+trace_dump(stderr, p->run->trace_errors, "ERR");
+}
+}
+}
+
+/*
+* 포트 준비
+*   fd가 이미 열려 있으면 (단일 포트 모드) 바로 RUNNING
+*   새로 연 포트는 아두이노 리셋을 기다리는 WAIT_RESET에서 시작
+* 반환값: 성공 0, 메모리 부족 -1
+*/
+static int port_init(struct uart_port *p, struct run_ctx *run, uint64_t now) {
+p->run = run;
+// 바이너리 프레임이 텍스트 줄(+ snprintf의 null)보다 항상 김
+p->tx_wire = FRAME_MAX_WIRE((size_t)run->packet_len);
+p->tx_cap = p->tx_wire * TX_BATCH;
+p->txbuf = malloc(p->tx_cap);
+
+// --timeout은 회선 시간 뒤의 여유
+// t_send는 write()가 커널 버퍼에 넣은 시각이라, 윈도우의 앞 패킷들이 다 나가고
+// 에코가 돌아오는 시간을 더함 (4KB면 115200 bps에서도 왕복 0.7초)
+// ms 단위로 올림 → 캡처의 timeout_ms로 uart_replay가 같은 값을 씀
+uint64_t wire_ms = p->baudrate > 0
+? ((uint64_t)p->tx_wire * run->window * 2 * 10 * 1000 + (uint64_t)p->baudrate - 1) /
+(uint64_t)p->baudrate
+: 0;
+if (!p->txbuf ||
+window_init(&p->win, run->window, run->packet_len,
+run->timeout_ns + wire_ms * NS_PER_MS, port_on_result, p) < 0) {
+free(p->txbuf);
+p->txbuf = NULL;
+return -1;
+}
+p->win.split = run->split;
+uart_rx_init(&p->rx, p->fd);
+p->tx_len = p->tx_off = 0;
+p->wire_bytes = 0;
+p->bit_errors = p->bits_checked = 0;
+latency_reset(&p->lat);
+p->want_out = 0;
+p->ready_at = now + (uint64_t)ARDUINO_RESET_MS * NS_PER_MS;
+p->state = PORT_WAIT_RESET;
+return 0;
+}
+
+static void port_free(struct uart_port *p) {
+window_free(&p->win);
+free(p->txbuf);
+p->txbuf = NULL;
+}
+
+static void port_fail(struct uart_port *p, const char *what) {
+fprintf(stderr, "[%s] %s: %s\n", p->path, what, strerror(errno));
+p->state = PORT_FAILED;
+p->end = mono_ns();
+}
+
+/*
+* 윈도우에 자리가 있으면 새 패킷들을 송신 버퍼에 채움
+*/
+static void port_fill_tx(struct uart_port *p, uint64_t now) {
+if (p->state != PORT_RUNNING || p->tx_off != p->tx_len) {
+return;
+}
+
+struct run_ctx *run = p->run;
+p->tx_len = p->tx_off = 0;
+p->batch_n = 0;
+
+while (window_has_room(&p->win) &&
+(run->max_packets <= 0 || p->win.sent < (uint64_t)run->max_packets) &&
+p->tx_len + p->tx_wire <= p->tx_cap) {
+// 윈도우 슬롯의 페이로드 자리에 바로 만듦 (스택 버퍼 → 슬롯 복사 없음)
+struct inflight *pkt = window_push(&p->win, NULL, run->packet_len, now);
+generate_random_packet(&run->gen, p->index, run->payload_base + p->win.sent - 1,
+pkt->payload, run->packet_len);
+TRACE_INFO(TE_TX, p->index, pkt->seq, 0, pkt->payload, pkt->len);
+if (p->batch_n++ == 0) {
+p->batch_first = pkt->seq;
+}
+p->tx_len += window_wire(pkt, run->binary, p->txbuf + p->tx_len,
+p->tx_cap - p->tx_len);
+}
+}
+
+static void port_on_writable(struct uart_port *p, uint64_t now) {
+if (p->tx_off == p->tx_len) {
+return;
+}
+
+ssize_t k = write(p->fd, p->txbuf + p->tx_off, p->tx_len - p->tx_off);
+if (k < 0) {
+if (errno != EAGAIN && errno != EINTR) {
+port_fail(p, "UART write");
+}
+return;
+}
+
+uint64_t t_raw = mono_raw_ns();
+cap_write(p->run->cap, CAP_TX, (uint8_t)p->index, t_raw,
+p->txbuf + p->tx_off, (size_t)k);
+p->tx_off += k;
+p->wire_bytes += k;
+if (p->tx_off == p->tx_len) {
+// 배치가 모두 나간 시각을 송신 시각으로 (타임아웃 기준점)
+for (unsigned i = 0; i < p->batch_n; i++) {
+window_slot(&p->win, (uint16_t)(p->batch_first + i))->t_send = now;
+}
+window_mark_written(&p->win, p->batch_first, p->batch_n, t_raw);
+}
+}
+
+/*
+* 읽을 수 있는 만큼 한 번에 읽고 개행(바이너리 모드는 0x00) 단위로 잘라서 엔진에 전달
+*/
+static void port_on_readable(struct uart_port *p, int hangup, uint64_t now) {
+ssize_t k = uart_rx_fill(&p->rx);
+if (k < 0 || (k == 0 && hangup)) {
+port_fail(p, "UART read");
+return;
+}
+
+// 아두이노 리셋 중에 들어온 쓰레기(부트로더 출력 등)는 버림
+if (p->state == PORT_WAIT_RESET) {
+uart_rx_flush(&p->rx);
+return;
+}
+
+// 줄이 너무 길면 uart_rx_next_line()이 잘라서 주므로
+// 개행 없는 쓰레기 데이터도 링을 막지 않음
+if (p->run->binary) {
+unsigned char frame[WIN_MAX_WIRE];
+int len;
+while ((len = uart_rx_next_frame(&p->rx, frame, sizeof(frame),
+&p->win.bad_frames)) >= 0) {
+p->win.echo_first = p->rx.t_first;
+p->win.echo_last = p->rx.t_last;
+window_on_frame(&p->win, frame, len, now);
+}
+return;
+}
+
+char line[WIN_MAX_LINE + 64];
+int len;
+while ((len = uart_rx_next_line(&p->rx, line, sizeof(line))) >= 0) {
+p->win.echo_first = p->rx.t_first;
+p->win.echo_last = p->rx.t_last;
+window_on_line(&p->win, line, len, now);
+}
+}
+
+/*
+* 펌웨어를 바이너리 모드로 전환 (--binary, --split이면 "!SPLIT")
+* 실패하면 포트를 FAILED로 (텍스트 펌웨어에 프레임을 보내 봐야 전부 ERR)
+*
+* 명령 응답을 기다리는 동안만 잠깐 블록됨 (포트당 한 번, 최대 1.5초)
+*/
+static int port_enter_binary(struct uart_port *p) {
+if (!p->run->binary) {
+return 0;
+}
+if (link_command(p->fd, &p->rx, 0, p->run->split ? "SPLIT" : "BIN", NULL, 0) < 0) {
+fprintf(stderr, "[%s] firmware did not accept binary mode\n", p->path);
+p->state = PORT_FAILED;
+p->end = mono_ns();
+return -1;
+}
+return 0;
+}
+
+/*
+* 측정이 끝난 뒤 펌웨어를 텍스트 모드로 되돌림
+* (다음 실행이 텍스트 모드로 시작해도 되도록, 실패해도 결과에는 영향 없음)
+*/
+static void port_leave_binary(struct uart_port *p) {
+// start == 0: 바이너리로 전환하기 전에 끝난 포트
+if (!p->run->binary || p->state == PORT_FAILED || p->fd < 0 || p->start == 0) {
+return;
+}
+// 방향 분리 모드: 펌웨어의 마지막 상향 카운터 (응답 프레임째 사라진 패킷까지 포함)
+char reply[FRAME_CTRL_REPLY_MAX + 1];
+if (p->run->split &&
+link_command(p->fd, &p->rx, 1, "STATS", reply, sizeof(reply)) == 0) {
+char msg[sizeof(reply) + 3];
+snprintf(msg, sizeof(msg), "OK %s", reply);
+window_on_stats(&p->win, msg, strlen(msg));
+}
+if (link_command(p->fd, &p->rx, 1, "TEXT", NULL, 0) < 0) {
+fprintf(stderr, "[%s] firmware did not return to text mode\n", p->path);
+}
+}
+
+/*
+* 캡처 (--capture)
+*   측정이 시작되는 순간부터 (모드 전환 명령의 응답 등은 빼고)
+*   받은 바이트는 uart_rx의 tap으로, 보낸 바이트는 write() 직후에 기록
+*/
+static void port_capture_rx(void *ctx, const unsigned char *data, size_t len,
+uint64_t t) {
+struct uart_port *p = ctx;
+cap_write(p->run->cap, CAP_RX, (uint8_t)p->index, t, data, len);
+}
+
+static void port_capture_start(struct uart_port *p) {
+struct run_ctx *run = p->run;
+if (!run->cap) {
+return;
+}
+// uart_replay가 같은 설정으로 다시 돌릴 수 있도록 측정 조건을 남김
+// pattern/seed/first가 있으면 보낸 패킷을 (seed, port, first + 순번)으로 다시 만들 수 있음
+char desc[384];
+int n = snprintf(desc, sizeof(desc),
+"port=%d path=%s cable=%.2f baud=%d binary=%d split=%d window=%u timeout_ms=%llu "
+"len=%d pattern=%s seed=%llu first=%llu",
+p->index, p->path, p->cable_length, p->baudrate, run->binary, run->split, run->window,
+(unsigned long long)(p->win.timeout_ns / NS_PER_MS), run->packet_len,
+run->gen.spec, (unsigned long long)run->gen.seed,
+(unsigned long long)run->payload_base);
+cap_write(run->cap, CAP_RUN, (uint8_t)p->index, mono_raw_ns(), desc,
+n < (int)sizeof(desc) ? (size_t)n : sizeof(desc) - 1);
+p->rx.tap = port_capture_rx;
+p->rx.tap_ctx = p;
+}
+
+static void port_capture_stop(struct uart_port *p) {
+p->rx.tap = NULL;
+}
+
+/*
+* 시간에 따른 상태 전이 + 타임아웃 정리
+*/
+static void port_tick(struct uart_port *p, uint64_t now) {
+switch (p->state) {
+case PORT_WAIT_RESET:
+if (now >= p->ready_at) {
+// 초기화 중 들어온 쓰레기 데이터 제거 후 측정 시작
+tcflush(p->fd, TCIOFLUSH);
+uart_rx_flush(&p->rx);
+if (port_enter_binary(p) < 0) {
+break;
+}
+port_capture_start(p);
+p->start = mono_ns();
+p->state = PORT_RUNNING;
+}
+break;
+
+case PORT_RUNNING:
+case PORT_DRAINING:
+window_expire(&p->win, now);
+if (p->run->max_packets > 0 &&
+p->win.sent >= (uint64_t)p->run->max_packets &&
+p->tx_off == p->tx_len) {
+if (p->win.outstanding == 0) {
+p->state = PORT_DONE;
+p->end = now;
+} else {
+p->state = PORT_DRAINING;
+}
+}
+break;
+
+default:
+break;
+}
+}
+
+/*
+* 이 포트가 다음에 깨어나야 하는 시각
+*/
+static uint64_t port_deadline(const struct uart_port *p) {
+switch (p->state) {
+case PORT_WAIT_RESET: return p->ready_at;
+case PORT_RUNNING:
+case PORT_DRAINING:   return window_next_deadline(&p->win);
+default:              return UINT64_MAX;
+}
+}
+
+/*
+* 방향별 에러율 (--split)
+*   uplink   - 펌웨어가 CRC로 판정한 상향 프레임
+*              펌웨어 누적(STATS)이 있으면 그쪽이 기준, 없으면 호스트가 본 GEN/GEN_BAD
+*   downlink - 돌아온 응답 프레임의 CRC + 펌웨어가 만든 페이로드와의 비트 비교
+*   응답이 통째로 사라진 패킷(TIMEOUT)은 어느 쪽인지 모르므로 따로 셈
+*/
+static void split_rates(const struct echo_window *w, uint64_t *up_n, uint64_t *up_err,
+uint64_t *down_n, uint64_t *down_err) {
+*up_n = w->fw_stats ? w->fw_up_ok + w->fw_up_bad : w->up_ok + w->up_err;
+*up_err = w->fw_stats ? w->fw_up_bad : w->up_err;
+*down_n = w->down_ok + w->down_err;
+*down_err = w->down_err;
+}
+
+static void print_split_stats(const char *tag, const struct uart_port *p) {
+const struct echo_window *w = &p->win;
+uint64_t up_n, up_err, down_n, down_err;
+split_rates(w, &up_n, &up_err, &down_n, &down_err);
+printf("[%s] %s uplink   %llu / %llu frames bad (%.3e)%s\n",
+tag, p->path, (unsigned long long)up_err, (unsigned long long)up_n,
+up_n ? (double)up_err / up_n : 0.0,
+w->fw_stats ? " [firmware]" : " [replies only]");
+printf("[%s] %s downlink %llu / %llu frames bad (%.3e), %llu / %llu bits (BER %.3e,"
+" %llu frames not compared)\n",
+tag, p->path, (unsigned long long)down_err, (unsigned long long)down_n,
+down_n ? (double)down_err / down_n : 0.0,
+(unsigned long long)p->bit_errors, (unsigned long long)p->bits_checked,
+p->bits_checked ? (double)p->bit_errors / p->bits_checked : 0.0,
+(unsigned long long)w->raw_echoes);
+}
+
+static void print_port_stats(const char *tag, const struct uart_port *p,
+uint64_t now) {
+const struct echo_window *w = &p->win;
+if (p->end) {
+now = p->end;
+}
+double secs = p->start && now > p->start
+? (double)(now - p->start) / NS_PER_SEC : 1e-9;
+uint64_t done = w->ok + w->err + w->timeouts;
+
+printf("[%s] %s %.2fm %d | %.1fs sent=%llu OK=%llu ERR=%llu TIMEOUT=%llu"
+" | %.1f pkt/s, goodput %.0f B/s, line %.1f%%\n",
+tag, p->path, p->cable_length, p->baudrate, secs,
+(unsigned long long)w->sent, (unsigned long long)w->ok,
+(unsigned long long)w->err, (unsigned long long)w->timeouts,
+done / secs,
+w->ok_bytes / secs,
+100.0 * p->wire_bytes * 10 / ((double)p->baudrate * secs));
+if (w->stale > 0 && strcmp(tag, "DONE") == 0) {
+printf("[%s] %s stale/unmatched echoes: %llu\n",
+tag, p->path, (unsigned long long)w->stale);
+}
+if (p->bits_checked > 0 && strcmp(tag, "DONE") == 0) {
+printf("[%s] %s bit errors: %llu / %llu bits (BER %.3e)\n",
+tag, p->path, (unsigned long long)p->bit_errors,
+(unsigned long long)p->bits_checked,
+(double)p->bit_errors / p->bits_checked);
+}
+if (w->bad_frames > 0 && strcmp(tag, "DONE") == 0) {
+printf("[%s] %s bad frames (CRC/COBS): %llu, %llu misaligned (not in BER)\n",
+tag, p->path, (unsigned long long)w->bad_frames,
+(unsigned long long)w->raw_echoes);
+}
+if (w->split && strcmp(tag, "DONE") == 0) {
+print_split_stats(tag, p);
+}
+// 지연: 주기 출력은 전체 왕복만, 마지막에는 첫 바이트까지
+if (strcmp(tag, "DONE") == 0) {
+print_latency(tag, p->path, &p->lat);
+} else if (p->lat.last.count > 0) {
+print_hist_line(tag, p->path, "last", &p->lat.last);
+}
+}
+
+static void port_summarize(const struct uart_port *p, struct run_summary *s) {
+uint64_t end = p->end ? p->end : mono_ns();
+s->sent = p->win.sent;
+s->ok = p->win.ok;
+s->err = p->win.err;
+s->timeouts = p->win.timeouts;
+s->ok_bytes = p->win.ok_bytes;
+s->bit_errors = p->bit_errors;
+s->bits_checked = p->bits_checked;
+s->secs = p->start && end > p->start ? (double)(end - p->start) / NS_PER_SEC : 0.0;
+s->lat_p99_us = p->lat.last.count ? hist_percentile(&p->lat.last, 0.99) / 1e3 : 0.0;
+s->timeout_us = (double)p->win.timeout_ns / 1e3;
+}
+
+/*
+* 방향별 결과를 uart_split.csv에 한 줄 추가 (--split, 설정마다)
+* 형식 (첫 줄은 헤더):
+*   timestamp,cable_length,baudrate,packet_len,
+*   up_frames,up_err,up_rate,down_frames,down_err,down_rate,
+*   down_bit_errors,down_bits,timeouts,fw_up_ok,fw_up_bad
+* fw_up_*는 펌웨어가 알려 준 누적값 (못 받았으면 빈칸)
+* down_bit_*는 회선 바이트 위치를 맞출 수 있었던 응답만 (길이가 어긋난 프레임은 down_err에만)
+*/
+static void append_split_csv(const struct uart_port *p) {
+const struct echo_window *w = &p->win;
+if (!w->split || w->sent == 0) {
+return;
+}
+FILE *fp = fopen(SPLIT_CSV_PATH, "a");
+if (!fp) {
+perror("split CSV open error");
+return;
+}
+if (ftell(fp) == 0) {
+fprintf(fp, "timestamp,cable_length,baudrate,packet_len,"
+"up_frames,up_err,up_rate,down_frames,down_err,down_rate,"
+"down_bit_errors,down_bits,timeouts,fw_up_ok,fw_up_bad\n");
+}
+
+time_t t_now = time(NULL);
+char timestamp[64];
+strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&t_now));
+
+uint64_t up_n, up_err, down_n, down_err;
+split_rates(w, &up_n, &up_err, &down_n, &down_err);
+char fw[64] = ",";
+if (w->fw_stats) {
+snprintf(fw, sizeof(fw), "%llu,%llu",
+(unsigned long long)w->fw_up_ok, (unsigned long long)w->fw_up_bad);
+}
+fprintf(fp, "%s,%.2f,%d,%d,%llu,%llu,%.6e,%llu,%llu,%.6e,%llu,%llu,%llu,%s\n",
+timestamp, p->cable_length, p->baudrate, p->run->packet_len,
+(unsigned long long)up_n, (unsigned long long)up_err,
+up_n ? (double)up_err / up_n : 0.0,
+(unsigned long long)down_n, (unsigned long long)down_err,
+down_n ? (double)down_err / down_n : 0.0,
+(unsigned long long)p->bit_errors, (unsigned long long)p->bits_checked,
+(unsigned long long)w->timeouts, fw);
+fclose(fp);
+}
+
+/*
+* 지표 엔드포인트에 이 포트의 스냅샷 게시 (--metrics)
+* [STAT] 출력과 같은 시점(1초마다 + 끝)에 측정 스레드가 호출, 복사만 하고 돌아옴
+*/
+static void port_publish_metrics(const struct uart_port *p, uint64_t now) {
+struct metrics_server *m = p->run ? p->run->metrics : NULL;
+if (!m) {
+return;
+}
+const struct echo_window *w = &p->win;
+struct metrics_snapshot s;
+memset(&s, 0, sizeof(s));
+snprintf(s.device, sizeof(s.device), "%s", p->path);
+s.length = p->cable_length;
+s.baud = p->baudrate;
+s.sent = w->sent;
+s.received = w->ok + w->err;
+s.ok = w->ok;
+s.err = w->err;
+s.timeouts = w->timeouts;
+s.tx_bytes = p->wire_bytes;
+s.rx_bytes = p->rx.bytes;
+s.goodput_bytes = w->ok_bytes;
+s.bit_errors = p->bit_errors;
+s.bits_checked = p->bits_checked;
+metrics_fill_latency(&s, &p->lat.last);
+metrics_fill_icount(&s, p->fd);
+metrics_publish(m, p->index, &s, now);
+}
+
+/*
+* 모든 포트의 합계 (포트가 2개 이상일 때만 출력)
+* 기간은 가장 먼저 측정을 시작한 포트부터 (아두이노 리셋 대기 시간 제외)
+*/
+static void print_total_stats(const char *tag, const struct uart_port *ports,
+int n, uint64_t now) {
+uint64_t ok = 0, err = 0, timeouts = 0, done = 0, ok_bytes = 0;
+uint64_t start = UINT64_MAX;
+for (int i = 0; i < n; i++) {
+const struct echo_window *w = &ports[i].win;
+if (ports[i].start && ports[i].start < start) {
+start = ports[i].start;
+}
+ok += w->ok;
+err += w->err;
+timeouts += w->timeouts;
+done += w->ok + w->err + w->timeouts;
+ok_bytes += w->ok_bytes;
+}
+if (start == UINT64_MAX) {
+return;     // 아직 측정을 시작한 포트가 없음
+}
+double secs = now > start ? (double)(now - start) / NS_PER_SEC : 1e-9;
+
+printf("[%s] TOTAL %d ports | OK=%llu ERR=%llu TIMEOUT=%llu"
+" | %.1f pkt/s, goodput %.0f B/s\n",
+tag, n, (unsigned long long)ok, (unsigned long long)err,
+(unsigned long long)timeouts, done / secs, ok_bytes / secs);
+}
+
+/*
+* epoll 이벤트 루프: 모든 포트를 하나의 스레드에서 구동
+* 
+* 반환값: 모든 포트 정상 0, 하나라도 FAILED면 -1
+*/
+static int run_ports(struct uart_port *ports, int n) {
+int epfd = epoll_create1(0);
+if (epfd < 0) {
+perror("epoll_create1");
+return -1;
+}
+
+for (int i = 0; i < n; i++) {
+struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &ports[i] };
+if (epoll_ctl(epfd, EPOLL_CTL_ADD, ports[i].fd, &ev) < 0) {
+port_fail(&ports[i], "epoll_ctl");
+} else {
+ports[i].in_epoll = 1;
+}
+}
+
+uint64_t next_report = mono_ns() + NS_PER_SEC;
+struct epoll_event events[MAX_PORTS];
+
+while (!stop_requested) {
+uint64_t now = mono_ns();
+uint64_t deadline = next_report;
+int active = 0;
+
+// 1. 포트별 상태 전이, 송신 버퍼 채우기, EPOLLOUT 관심 갱신
+for (int i = 0; i < n; i++) {
+struct uart_port *p = &ports[i];
+port_tick(p, now);
+port_fill_tx(p, now);
+
+if (p->state == PORT_DONE || p->state == PORT_FAILED) {
+if (p->in_epoll) {
+epoll_ctl(epfd, EPOLL_CTL_DEL, p->fd, NULL);
+p->in_epoll = 0;
+}
+continue;
+}
+active++;
+
+int need_out = p->tx_off < p->tx_len;
+if (need_out != p->want_out) {
+struct epoll_event ev = {
+.events = EPOLLIN | (need_out ? EPOLLOUT : 0),
+.data.ptr = p
+};
+epoll_ctl(epfd, EPOLL_CTL_MOD, p->fd, &ev);
+p->want_out = need_out;
+}
+
+uint64_t d = port_deadline(p);
+if (d < deadline) {
+deadline = d;
+}
+}
+if (active == 0) {
+break;
+}
+
+// 2. 가장 가까운 마감 시각까지만 대기
+int wait_ms = deadline > now
+? (int)((deadline - now + NS_PER_MS - 1) / NS_PER_MS) : 0;
+int nev = epoll_wait(epfd, events, MAX_PORTS, wait_ms);
+if (nev < 0) {
+if (errno == EINTR) {
+continue;       // Ctrl+C → 루프 조건에서 종료
+}
+perror("epoll_wait");
+break;
+}
+now = mono_ns();
+
+// 3. 준비된 포트만 처리
+for (int i = 0; i < nev; i++) {
+struct uart_port *p = events[i].data.ptr;
+if (events[i].events & EPOLLOUT) {
+port_on_writable(p, now);
+}
+if (p->state != PORT_FAILED &&
+(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+port_on_readable(p, events[i].events & (EPOLLERR | EPOLLHUP), now);
+}
+}
+
+// 4. SIGUSR1 덤프 요청, 1초마다 처리량 출력
+trace_poll(stderr, TRACE_DUMP_PACKETS);
+if (now >= next_report) {
+for (int i = 0; i < n; i++) {
+if (ports[i].state == PORT_RUNNING || ports[i].state == PORT_DRAINING) {
+print_port_stats("STAT", &ports[i], now);
+port_publish_metrics(&ports[i], now);
+}
+}
+if (n > 1) {
+print_total_stats("STAT", ports, n, now);
+}
+next_report += NS_PER_SEC;
+}
+}
+
+for (int i = 0; i < n; i++) {
+port_capture_stop(&ports[i]);
+port_leave_binary(&ports[i]);
+}
+
+uint64_t now = mono_ns();
+int rc = 0;
+for (int i = 0; i < n; i++) {
+print_port_stats("DONE", &ports[i], now);
+port_publish_metrics(&ports[i], now);
+append_latency_csv(ports[i].cable_length, ports[i].baudrate, &ports[i].lat);
+append_split_csv(&ports[i]);
+if (ports[i].state == PORT_FAILED) {
+rc = -1;
+}
+}
+if (n > 1) {
+print_total_stats("DONE", ports, n, now);
+}
+
+close(epfd);
+return rc;
+}
+
+/*
+* 단일 포트 파이프라인 (--window N)
+* main()이 이미 열고 설정하고 아두이노 대기까지 끝낸 fd를 포트 하나로 구동
+*/
+static int run_pipelined(int fd, const char *path, double cable_length,
+int baudrate, struct run_ctx *run) {
+struct uart_port *p = calloc(1, sizeof(*p));
+if (!p) {
+perror("port alloc");
+return -1;
+}
+snprintf(p->path, sizeof(p->path), "%s", path);
+p->cable_length = cable_length;
+p->baudrate = baudrate;
+p->fd = fd;
+
+// write()가 절대 블록되지 않도록 (대기는 epoll만 담당)
+// 수신 쪽은 uart_rx_init()이 같은 설정을 해 줌
+fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+uint64_t now = mono_ns();
+if (port_init(p, run, now) < 0) {
+perror("window alloc");
+free(p);
+return -1;
+}
+// 아두이노 대기는 main()에서 이미 끝냄
+p->ready_at = now;
+
+printf("Pipelined mode: window=%u, len=%d, timeout=%llums\n\n",
+run->window, run->packet_len, (unsigned long long)(p->win.timeout_ns / NS_PER_MS));
+
+int rc = run_ports(p, 1);
+port_summarize(p, &run->last);
+run->payload_base += run->last.sent;
+port_free(p);
+free(p);
+return rc;
+}
+
+/*
+* 멀티 포트 (--port DEV:LEN:BAUD 여러 개)
+* 모든 포트를 열고, 각자 아두이노 리셋을 기다린 뒤 한 루프로 측정
+*/
+static int run_multiport(struct uart_port *ports, int n, struct run_ctx *run) {
+int rc = 0;
+uint64_t now = mono_ns();
+
+for (int i = 0; i < n; i++) {
+struct uart_port *p = &ports[i];
+p->index = i;
+p->fd = open_uart(p->path, p->baudrate);
+if (p->fd < 0) {
+rc = -1;
+break;
+}
+fcntl(p->fd, F_SETFL, fcntl(p->fd, F_GETFL) | O_NONBLOCK);
+if (port_init(p, run, now) < 0) {
+perror("window alloc");
+rc = -1;
+break;
+}
+printf("Port %d: %s, %.2f m, %d bps\n",
+i, p->path, p->cable_length, p->baudrate);
+}
+
+if (rc == 0) {
+printf("Multi-port mode: %d ports, window=%u, timeout=%llums\n",
+n, run->window, (unsigned long long)(run->timeout_ns / NS_PER_MS));
+printf("Waiting for Arduino initialization...\n\n");
+rc = run_ports(ports, n);
+}
+
+for (int i = 0; i < n; i++) {
+port_free(&ports[i]);
+if (ports[i].fd >= 0) {
+close(ports[i].fd);
+}
+}
+return rc;
+}
+
+
+/*
+* ============================================================================
+* 스레드 모드 (--threads)
+* ============================================================================
+* 
+* 파이프라인 모드는 송신/수신/비교가 한 스레드에서 돌아감
+* 스레드 모드는 역할을 완전히 나눔:
+* 
+*   송신 스레드                          수신 스레드
+*   ───────────                          ───────────
+*   패킷 생성                            read() → 줄 단위로 자르기
+*   기술자(descriptor)를 큐에 push  ──→  큐에서 pop → 윈도우에 등록
+*   write()                              에코와 짝짓기, 판정, CSV 기록
+*   (윈도우 크레딧이 있는 동안 계속)      판정한 만큼 크레딧 반환 (eventfd로 깨움)
+* 
+* 큐는 락 없는 SPSC 링 (uart_spsc.h)
+*   → 수신 쪽이 느리거나 에코가 안 와도 송신 스레드는 락에 막히지 않음
+*   → 에러가 몰려도 윈도우가 허용하는 한 선로가 계속 바쁨
+* 
+* 순서 보장:
+*   송신 스레드는 write() 전에 기술자를 push함
+*   → 수신 스레드가 에코를 읽었을 때 그 패킷의 기술자는 이미 큐에 있음
+*   두 스레드 모두 0번부터 1씩 번호를 매기므로 윈도우의 번호와 회선의 번호가 일치
+* 
+* 수신 처리 지연 (RX processing latency):
+*   read()가 데이터를 가져온 순간 → 그 줄의 판정이 끝난 순간
+*   송신과 무관하게 수신 쪽 처리 비용만 따로 측정
+*/
+struct thread_ctx {
+struct uart_port   *port;       // 수신 쪽 상태 (윈도우, 링, 통계)
+struct spsc_ring    queue;      // 송신 → 수신 기술자 큐
+int                 efd;        // 크레딧 반환 알림 (eventfd)
+atomic_uint_fast64_t retired;   // 수신 스레드가 판정을 끝낸 패킷 수
+atomic_uint_fast64_t tx_bytes;  // 송신 스레드가 보낸 바이트 수
+atomic_int          tx_done;    // 송신 스레드가 더 보낼 것이 없음
+atomic_int          failed;     // 어느 한쪽에서 I/O 에러
+
+// 송신 스레드 전용 (run_threaded()가 패킷 길이에 맞춰 한 번만 잡음)
+// 풀 자리 (sent % window)는 window개 뒤의 패킷이 다시 씀:
+// 그 패킷을 보낼 크레딧이 생겼다면 이 자리의 패킷은 이미 판정됨
+// → 수신 스레드가 기술자를 pop해서 윈도우로 복사한 뒤 (rx_drain_queue)
+// 회선 포맷은 port의 txbuf (스레드 모드에서는 수신 스레드가 안 씀)
+char               *tx_pool;    // 기술자가 가리키는 페이로드 (window × (len + 1))
+
+// 수신 처리 지연 통계 (수신 스레드 전용)
+uint64_t rx_lines;
+uint64_t rx_proc_ns_sum;
+uint64_t rx_proc_ns_max;
+};
+
+static void *tx_thread_main(void *arg) {
+struct thread_ctx *tc = arg;
+struct uart_port *p = tc->port;
+struct run_ctx *run = p->run;
+uint64_t sent = 0;
+
+const unsigned max_batch = TX_BATCH;
+const size_t stride = (size_t)run->packet_len + 1;
+char *txbuf = p->txbuf;
+
+while (!stop_requested && !atomic_load(&tc->failed) &&
+(run->max_packets <= 0 || sent < (uint64_t)run->max_packets)) {
+// 크레딧 = 윈도우 크기 - (보낸 수 - 판정 끝난 수)
+uint64_t in_flight = sent - atomic_load_explicit(&tc->retired, memory_order_acquire);
+if (in_flight >= run->window) {
+// 크레딧이 없으면 수신 스레드가 eventfd로 깨울 때까지 대기
+struct pollfd pfd = { tc->efd, POLLIN, 0 };
+if (poll(&pfd, 1, 100) > 0) {
+uint64_t v;
+if (read(tc->efd, &v, sizeof(v)) < 0 && errno != EAGAIN) {
+break;
+}
+}
+continue;
+}
+
+unsigned credit = run->window - (unsigned)in_flight;
+if (credit > max_batch) {
+credit = max_batch;
+}
+
+// 크레딧만큼 패킷을 만들어서 기술자는 큐에, 회선 포맷은 송신 버퍼에
+size_t tx_len = 0;
+uint64_t now = mono_ns();
+for (unsigned i = 0; i < credit; i++) {
+if (run->max_packets > 0 && sent >= (uint64_t)run->max_packets) {
+break;
+}
+struct inflight d;
+d.seq = (uint16_t)sent;
+d.len = run->packet_len;
+d.t_send = now;
+d.t_write = mono_raw_ns();  // 큐에 넣은 뒤에는 못 고치므로 write() 직전 시각
+d.payload = tc->tx_pool + (size_t)(sent % run->window) * stride;
+generate_random_packet(&run->gen, p->index, run->payload_base + sent,
+d.payload, run->packet_len);
+
+if (spsc_push(&tc->queue, &d) < 0) {
+break;      // 큐가 꽉 참 (윈도우 ≤ 큐 용량이라 보통은 안 생김)
+}
+TRACE_INFO(TE_TX, p->index, d.seq, 0, d.payload, d.len);
+tx_len += window_wire(&d, run->binary, txbuf + tx_len, p->tx_cap - tx_len);
+sent++;
+}
+
+// 수신 스레드가 에코를 기록하기 전에 남도록 write() 전에 기록
+cap_write(run->cap, CAP_TX, (uint8_t)p->index, mono_raw_ns(), txbuf, tx_len);
+if (write_all(p->fd, txbuf, tx_len) < 0) {
+perror("UART write");
+atomic_store(&tc->failed, 1);
+break;
+}
+atomic_fetch_add_explicit(&tc->tx_bytes, tx_len, memory_order_relaxed);
+}
+
+// 다음 단계(스윕/적응)는 이어지는 번호부터 (수신 스레드는 안 읽는 값)
+run->payload_base += sent;
+atomic_store(&tc->tx_done, 1);
+return NULL;
+}
+
+/*
+* 송신 스레드가 넣어 둔 기술자를 전부 윈도우로 옮김
+*/
+static void rx_drain_queue(struct thread_ctx *tc) {
+struct uart_port *p = tc->port;
+struct inflight d;
+while (spsc_pop(&tc->queue, &d) == 0) {
+struct inflight *slot = window_push(&p->win, d.payload, d.len, d.t_send);
+if (slot) {
+slot->t_write = d.t_write;
+}
+}
+}
+
+static void *rx_thread_main(void *arg) {
+struct thread_ctx *tc = arg;
+struct uart_port *p = tc->port;
+struct echo_window *w = &p->win;
+uint64_t next_report = mono_ns() + NS_PER_SEC;
+uint64_t last_retired = 0;
+char line[WIN_MAX_LINE + 64];
+unsigned char frame[WIN_MAX_WIRE];
+
+while (!stop_requested && !atomic_load(&tc->failed)) {
+rx_drain_queue(tc);
+trace_poll(stderr, TRACE_DUMP_PACKETS);
+
+// 송신이 끝났고 모든 패킷이 판정됐으면 종료
+if (atomic_load(&tc->tx_done) && spsc_size(&tc->queue) == 0 &&
+w->outstanding == 0) {
+rx_drain_queue(tc);
+if (w->outstanding == 0) {
+break;
+}
+}
+
+// 새로 들어온 기술자의 타임아웃을 놓치지 않도록 최대 10ms씩만 대기
+uint64_t now = mono_ns();
+uint64_t deadline = window_next_deadline(w);
+if (deadline > next_report) {
+deadline = next_report;
+}
+if (deadline > now + 10 * NS_PER_MS) {
+deadline = now + 10 * NS_PER_MS;
+}
+int wait_ms = deadline > now
+? (int)((deadline - now + NS_PER_MS - 1) / NS_PER_MS) : 0;
+
+struct pollfd pfd = { p->fd, POLLIN, 0 };
+int n = poll(&pfd, 1, wait_ms);
+if (n < 0 && errno != EINTR) {
+perror("poll");
+atomic_store(&tc->failed, 1);
+break;
+}
+
+if (n > 0) {
+ssize_t k = uart_rx_fill(&p->rx);
+uint64_t t_arrival = mono_ns();
+if (k < 0 || (k == 0 && (pfd.revents & (POLLERR | POLLHUP)))) {
+perror("UART read");
+atomic_store(&tc->failed, 1);
+break;
+}
+
+// 에코보다 먼저 push된 기술자가 반드시 윈도우에 있도록
+rx_drain_queue(tc);
+
+int len;
+for (;;) {
+if (p->run->binary) {
+len = uart_rx_next_frame(&p->rx, frame, sizeof(frame), &w->bad_frames);
+if (len < 0) {
+break;
+}
+w->echo_first = p->rx.t_first;
+w->echo_last = p->rx.t_last;
+window_on_frame(w, frame, len, t_arrival);
+} else {
+len = uart_rx_next_line(&p->rx, line, sizeof(line));
+if (len < 0) {
+break;
+}
+w->echo_first = p->rx.t_first;
+w->echo_last = p->rx.t_last;
+window_on_line(w, line, len, t_arrival);
+}
+
+uint64_t dt = mono_ns() - t_arrival;
+tc->rx_lines++;
+tc->rx_proc_ns_sum += dt;
+if (dt > tc->rx_proc_ns_max) {
+tc->rx_proc_ns_max = dt;
+}
+}
+}
+
+now = mono_ns();
+window_expire(w, now);
+
+// 판정이 끝난 만큼 송신 스레드에 크레딧 반환
+uint64_t retired = w->ok + w->err + w->timeouts;
+if (retired != last_retired) {
+atomic_store_explicit(&tc->retired, retired, memory_order_release);
+uint64_t one = 1;
+if (write(tc->efd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+perror("eventfd");
+}
+last_retired = retired;
+}
+
+if (now >= next_report) {
+p->wire_bytes = atomic_load_explicit(&tc->tx_bytes, memory_order_relaxed);
+print_port_stats("STAT", p, now);
+port_publish_metrics(p, now);
+next_report += NS_PER_SEC;
+}
+}
+
+p->end = mono_ns();
+return NULL;
+}
+
+/*
+* 단일 포트 스레드 모드
+* main()이 이미 열고 설정하고 아두이노 대기까지 끝낸 fd를 사용
+*/
+static int run_threaded(int fd, const char *path, double cable_length,
+int baudrate, struct run_ctx *run) {
+struct uart_port *p = calloc(1, sizeof(*p));
+struct thread_ctx *tc = calloc(1, sizeof(*tc));
+if (!p || !tc) {
+perror("alloc");
+free(p);
+free(tc);
+return -1;
+}
+snprintf(p->path, sizeof(p->path), "%s", path);
+p->cable_length = cable_length;
+p->baudrate = baudrate;
+p->fd = fd;
+
+int rc = -1;
+tc->port = p;
+tc->efd = eventfd(0, EFD_NONBLOCK);
+if (tc->efd < 0) {
+perror("eventfd");
+goto out;
+}
+tc->tx_pool = malloc(((size_t)run->packet_len + 1) * run->window);
+if (!tc->tx_pool || port_init(p, run, mono_ns()) < 0 ||
+spsc_init(&tc->queue, run->window, sizeof(struct inflight)) < 0) {
+perror("alloc");
+goto out;
+}
+fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+// 스레드를 띄우기 전에 모드 전환 (명령 응답은 아직 이 스레드 혼자 읽음)
+if (port_enter_binary(p) < 0) {
+goto out;
+}
+port_capture_start(p);
+p->start = mono_ns();
+p->state = PORT_RUNNING;
+
+printf("Threaded mode: window=%u, len=%d, timeout=%llums\n\n",
+run->window, run->packet_len, (unsigned long long)(p->win.timeout_ns / NS_PER_MS));
+
+pthread_t tx, rx;
+if (pthread_create(&rx, NULL, rx_thread_main, tc) != 0) {
+perror("pthread_create");
+goto out;
+}
+if (pthread_create(&tx, NULL, tx_thread_main, tc) != 0) {
+perror("pthread_create");
+atomic_store(&tc->failed, 1);
+pthread_join(rx, NULL);
+goto out;
+}
+pthread_join(tx, NULL);
+pthread_join(rx, NULL);
+port_capture_stop(p);
+if (!atomic_load(&tc->failed)) {
+port_leave_binary(p);
+}
+
+p->wire_bytes = atomic_load(&tc->tx_bytes);
+port_summarize(p, &run->last);
+print_port_stats("DONE", p, p->end);
+port_publish_metrics(p, p->end);
+append_latency_csv(p->cable_length, p->baudrate, &p->lat);
+append_split_csv(p);
+if (tc->rx_lines > 0) {
+printf("[DONE] RX processing: %llu lines, mean %.2f us, max %.2f us\n",
+(unsigned long long)tc->rx_lines,
+tc->rx_proc_ns_sum / 1e3 / tc->rx_lines,
+tc->rx_proc_ns_max / 1e3);
+}
+rc = atomic_load(&tc->failed) ? -1 : 0;
+
+out:
+if (tc->efd >= 0) {
+close(tc->efd);
+}
+spsc_free(&tc->queue);
+port_free(p);
+free(tc->tx_pool);
+free(tc);
+free(p);
+return rc;
+}
+
+
+/*
+* ============================================================================
+* Baudrate 스윕 (--sweep RATES)
+* ============================================================================
+* 
+* 한 번 실행으로 여러 Baudrate를 차례로 측정
+* 프로그램을 다시 시작하거나 아두이노를 다시 굽지 않고 링크 위에서 속도를 바꿈
+* 
+* 속도 하나를 바꾸는 순서:
+*   1. 현재 속도로 "!BAUD 230400" 전송 → 펌웨어가 "!OK BAUD 230400"으로 응답
+*   2. 펌웨어는 응답을 다 보낸 뒤 새 속도로 Serial.begin()
+*   3. 우리도 tcsetattr()로 새 속도 적용 (포트를 닫지 않음 → 아두이노 리셋 없음)
+*   4. 새 속도로 "!PING" → "!OK PING"이 오면 링크 확인 끝
+* 
+* 새 속도에서 PING이 안 되면 (케이블이 못 버티는 속도 등):
+*   펌웨어는 BAUD_CONFIRM_MS 안에 PING을 못 받으면 이전 속도로 스스로 돌아감
+*   우리도 이전 속도로 돌아가서 다음 속도로 넘어감
+* 
+* 전환에 걸린 시간을 측정 시간과 같이 출력
+* → 전환 비용이 측정 시간에 비해 충분히 작은지 확인
+* 
+* 길이 스윕 (--len-sweep):
+*   속도 하나에서 페이로드 길이들을 차례로 측정 (속도 × 길이 격자)
+*   짧은 패킷은 헤더/CRC/개행 비용이 크고, 긴 패킷은 비트 에러 하나에 통째로 버려짐
+*   → goodput(OK 페이로드 바이트/초)이 가장 높은 길이가 케이블과 속도마다 다름
+*   속도마다 그 길이를 [SWEEP] best로 출력하고 격자 전체를 uart_len_sweep.csv에
+*/
+#define MAX_SWEEP_RATES     256
+#define MAX_SWEEP_LENS      64
+#define SWEEP_DEFAULT_COUNT 1000    // --count가 없을 때 속도(길이)당 패킷 수
+#define BAUD_CONFIRM_MS     2000    // 펌웨어의 새 속도 확인 대기 (uart_send_input.ino와 같게)
+#define LEN_SWEEP_CSV_PATH  "uart_len_sweep.csv"
+
+struct sweep_step {
+int      baudrate;
+int      packet_len;
+int      switched;      // 1 = 이 속도로 전환 성공 (또는 시작 속도)
+double   switch_ms;     // 전환에 걸린 시간 (속도의 첫 길이에만)
+struct run_summary result;
+};
+
+/*
+* "9600,115200,921600" 또는 "all" (get_baudrate_constant()의 8개)
+* 항목 하나를 "시작:끝:간격"으로 쓰면 그 구간을 촘촘하게
+*   예: "115200:230400:5000" → 115200, 120200, ..., 230200
+*   (표준 상수가 없는 속도는 termios2로 설정)
+* 반환값: 속도 개수, 형식 에러 -1
+*/
+static int parse_rate_list(const char *spec, int *rates, int max) {
+static const int standard[] = {
+9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600
+};
+int n = 0;
+
+if (strcmp(spec, "all") == 0) {
+for (size_t i = 0; i < sizeof(standard) / sizeof(standard[0]) && n < max; i++) {
+rates[n++] = standard[i];
+}
+return n;
+}
+
+const char *s = spec;
+while (*s) {
+char *end;
+long v = strtol(s, &end, 10);
+long last = v, step = 1;
+if (*end == ':') {
+const char *p = end + 1;
+last = strtol(p, &end, 10);
+if (end == p || *end != ':') {
+return -1;
+}
+p = end + 1;
+step = strtol(p, &end, 10);
+if (end == p || step <= 0 || last < v) {
+return -1;
+}
+}
+if (end == s || (*end != ',' && *end != '\0') || v <= 0 || last > INT_MAX) {
+return -1;
+}
+for (long r = v; r <= last; r += step) {
+if (n == max || !baudrate_supported((int)r)) {
+return -1;
+}
+rates[n++] = (int)r;
+}
+s = *end == ',' ? end + 1 : end;
+}
+return n;
+}
+
+/*
+* "16,64,256", "1:64:1" (시작:끝:간격) 또는 "all" (1, 2, 4, ..., WIN_MAX_PAYLOAD)
+* 반환값: 길이 개수, 형식 에러 -1
+*/
+static int parse_len_list(const char *spec, int *lens, int max) {
+int n = 0;
+
+if (strcmp(spec, "all") == 0) {
+for (int len = 1; len <= WIN_MAX_PAYLOAD && n < max; len <<= 1) {
+lens[n++] = len;
+}
+return n;
+}
+
+const char *s = spec;
+while (*s) {
+char *end;
+long v = strtol(s, &end, 10);
+long last = v, step = 1;
+if (*end == ':') {
+const char *p = end + 1;
+last = strtol(p, &end, 10);
+if (end == p || *end != ':') {
+return -1;
+}
+p = end + 1;
+step = strtol(p, &end, 10);
+if (end == p || step <= 0 || last < v) {
+return -1;
+}
+}
+if (end == s || (*end != ',' && *end != '\0') || v < 1 || last > WIN_MAX_PAYLOAD) {
+return -1;
+}
+for (long len = v; len <= last; len += step) {
+if (n == max) {
+return -1;
+}
+lens[n++] = (int)len;
+}
+s = *end == ',' ? end + 1 : end;
+}
+return n;
+}
+
+/*
+* 펌웨어와 함께 속도 전환
+* 반환값: 성공 0 (새 속도), 실패 -1 (이전 속도로 복귀한 상태)
+*/
+static int link_switch_baud(int fd, struct uart_rx *rx, int from, int to) {
+char cmd[32];
+snprintf(cmd, sizeof(cmd), "BAUD %d", to);
+if (link_command(fd, rx, 0, cmd, NULL, 0) < 0) {
+fprintf(stderr, "[SWEEP] firmware refused %s\n", cmd);
+return -1;
+}
+
+uint64_t t_switch = mono_ns();
+if (set_uart_baud(fd, to) < 0) {
+perror("tcsetattr");
+return -1;
+}
+// 전환 순간에 깨진 바이트 버림
+tcflush(fd, TCIFLUSH);
+uart_rx_flush(rx);
+
+if (link_command(fd, rx, 0, "PING", NULL, 0) == 0) {
+return 0;
+}
+
+// 새 속도로 확인 실패 → 펌웨어가 이전 속도로 돌아갈 때까지 기다렸다가 따라감
+fprintf(stderr, "[SWEEP] no PING reply at %d bps, falling back to %d\n", to, from);
+uint64_t revert_at = t_switch + (uint64_t)BAUD_CONFIRM_MS * NS_PER_MS;
+uint64_t now = mono_ns();
+if (now < revert_at) {
+usleep((useconds_t)((revert_at - now) / 1000) + 100000);
+}
+set_uart_baud(fd, from);
+tcflush(fd, TCIFLUSH);
+uart_rx_flush(rx);
+if (link_command(fd, rx, 0, "PING", NULL, 0) < 0) {
+fprintf(stderr, "[SWEEP] link lost at %d bps too\n", from);
+}
+return -1;
+}
+
+/* 한 단계의 goodput (OK 페이로드 바이트/초) */
+static double sweep_goodput(const struct sweep_step *st) {
+return st->result.secs > 0 ? (double)st->result.ok_bytes / st->result.secs : 0.0;
+}
+
+/*
+* 길이 스윕 격자를 uart_len_sweep.csv에 추가 (단계마다 한 줄)
+* 형식 (첫 줄은 헤더):
+*   timestamp,cable_length,baudrate,packet_len,sent,ok,err,timeouts,
+*   secs,goodput_Bps,best
+* best = 1이면 그 속도에서 goodput이 가장 높은 길이
+*/
+static void append_len_sweep_csv(double cable_length, const struct sweep_step *steps,
+int n, const int *best) {
+FILE *fp = fopen(LEN_SWEEP_CSV_PATH, "a");
+if (!fp) {
+perror("length sweep CSV open error");
+return;
+}
+if (ftell(fp) == 0) {
+fprintf(fp, "timestamp,cable_length,baudrate,packet_len,sent,ok,err,timeouts,"
+"secs,goodput_Bps,best\n");
+}
+
+time_t t_now = time(NULL);
+char timestamp[64];
+strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&t_now));
+
+for (int i = 0; i < n; i++) {
+const struct sweep_step *st = &steps[i];
+if (!st->switched) {
+continue;
+}
+const struct run_summary *s = &st->result;
+fprintf(fp, "%s,%.2f,%d,%d,%llu,%llu,%llu,%llu,%.3f,%.1f,%d\n",
+timestamp, cable_length, st->baudrate, st->packet_len,
+(unsigned long long)s->sent, (unsigned long long)s->ok,
+(unsigned long long)s->err, (unsigned long long)s->timeouts,
+s->secs, sweep_goodput(st), best[i]);
+}
+fclose(fp);
+}
+
+/*
+* 스윕 실행
+*   main()이 이미 열고 설정하고 아두이노 대기까지 끝낸 fd를 사용
+*   baudrate = 지금 펌웨어와 맞춰져 있는 속도 (끝나면 이 속도로 되돌림)
+*   속도마다 lens의 길이들을 차례로 (n_lens = 0이면 run->packet_len 하나)
+*   단계마다 파이프라인 (또는 --threads면 스레드) 모드로 측정
+*/
+static int run_sweep(int fd, const char *path, double cable_length, int baudrate,
+const int *rates, int n_rates, const int *lens, int n_lens,
+int threaded, struct run_ctx *run) {
+const int base_len = run->packet_len;
+if (n_lens <= 0) {
+lens = &base_len;
+n_lens = 1;
+}
+struct sweep_step *steps = calloc((size_t)n_rates * n_lens, sizeof(*steps));
+int *best = calloc((size_t)n_rates * n_lens, sizeof(*best));
+if (!steps || !best) {
+perror("sweep alloc");
+free(steps);
+free(best);
+return -1;
+}
+struct uart_rx link_rx;
+int cur = baudrate;
+int rc = 0;
+
+uart_rx_init(&link_rx, fd);
+if (run->max_packets <= 0) {
+run->max_packets = SWEEP_DEFAULT_COUNT;
+}
+if (n_lens > 1) {
+printf("Sweep mode: %d rates x %d lengths, %ld packets each\n",
+n_rates, n_lens, run->max_packets);
+} else {
+printf("Sweep mode: %d rates, %ld packets each\n", n_rates, run->max_packets);
+}
+
+int done = 0;
+for (int i = 0; i < n_rates && !stop_requested; i++) {
+double switch_ms = 0;
+if (rates[i] != cur) {
+uint64_t t0 = mono_ns();
+if (link_switch_baud(fd, &link_rx, cur, rates[i]) < 0) {
+steps[done].baudrate = rates[i];
+steps[done++].packet_len = lens[0];
+rc = -1;
+continue;
+}
+switch_ms = (double)(mono_ns() - t0) / NS_PER_MS;
+cur = rates[i];
+printf("\n[SWEEP] switched to %d bps in %.1f ms\n", cur, switch_ms);
+}
+
+for (int j = 0; j < n_lens && !stop_requested; j++) {
+struct sweep_step *st = &steps[done++];
+st->baudrate = cur;
+st->packet_len = lens[j];
+st->switch_ms = j == 0 ? switch_ms : 0.0;
+st->switched = 1;
+if (n_lens > 1) {
+printf("\n[SWEEP] %d bps, packet length %d\n", cur, lens[j]);
+}
+
+// 버퍼(송신 버퍼, 윈도우의 페이로드 풀)는 단계마다 이 길이에 맞춰 새로 잡힘
+run->packet_len = lens[j];
+int r = threaded
+? run_threaded(fd, path, cable_length, cur, run)
+: run_pipelined(fd, path, cable_length, cur, run);
+if (r < 0) {
+rc = -1;
+}
+st->result = run->last;
+uart_rx_flush(&link_rx);
+}
+}
+run->packet_len = base_len;
+
+// 시작 속도로 복귀 (다음 실행이 같은 argv로 바로 붙을 수 있도록)
+if (cur != baudrate && link_switch_baud(fd, &link_rx, cur, baudrate) < 0) {
+fprintf(stderr, "[SWEEP] could not return to %d bps (firmware stays at %d)\n",
+baudrate, cur);
+}
+
+double switch_total = 0, measure_total = 0;
+printf("\n[SWEEP] %-8s %5s %10s %9s %8s %8s %8s %8s %9s %10s %11s\n",
+"baud", "len", "switch_ms", "measure_s", "sent", "OK", "ERR", "TIMEOUT", "PER", "BER",
+"goodput_Bps");
+for (int i = 0; i < done; i++) {
+const struct sweep_step *st = &steps[i];
+if (!st->switched) {
+printf("[SWEEP] %-8d %5s %10s\n", st->baudrate, "-", "failed");
+continue;
+}
+const struct run_summary *s = &st->result;
+uint64_t judged = s->ok + s->err + s->timeouts;
+printf("[SWEEP] %-8d %5d %10.1f %9.2f %8llu %8llu %8llu %8llu %8.2f%% %10.3e %11.1f\n",
+st->baudrate, st->packet_len, st->switch_ms, s->secs,
+(unsigned long long)s->sent, (unsigned long long)s->ok,
+(unsigned long long)s->err, (unsigned long long)s->timeouts,
+judged ? 100.0 * (s->err + s->timeouts) / judged : 0.0,
+s->bits_checked ? (double)s->bit_errors / s->bits_checked : 0.0,
+sweep_goodput(st));
+switch_total += st->switch_ms / 1e3;
+measure_total += s->secs;
+}
+printf("[SWEEP] switching %.2f s, measuring %.2f s (switching %.1f%% of total)\n",
+switch_total, measure_total,
+switch_total + measure_total > 0
+? 100.0 * switch_total / (switch_total + measure_total) : 0.0);
+
+// 속도마다 goodput이 가장 높은 길이 (같은 속도의 단계는 연속으로 놓여 있음)
+if (n_lens > 1) {
+for (int i = 0; i < done;) {
+int k = i, top = -1;
+for (; k < done && steps[k].baudrate == steps[i].baudrate; k++) {
+if (steps[k].switched && steps[k].result.ok_bytes > 0 &&
+(top < 0 || sweep_goodput(&steps[k]) > sweep_goodput(&steps[top]))) {
+top = k;
+}
+}
+if (top >= 0) {
+best[top] = 1;
+const struct run_summary *s = &steps[top].result;
+uint64_t judged = s->ok + s->err + s->timeouts;
+printf("[SWEEP] best at %d bps: len %d, goodput %.1f B/s, PER %.2f%%\n",
+steps[top].baudrate, steps[top].packet_len, sweep_goodput(&steps[top]),
+judged ? 100.0 * (s->err + s->timeouts) / judged : 0.0);
+} else {
+printf("[SWEEP] best at %d bps: none (no packet got through)\n",
+steps[i].baudrate);
+}
+i = k;
+}
+append_len_sweep_csv(cable_length, steps, done, best);
+}
+free(steps);
+free(best);
+return rc;
+}
+
+
+
+/*
+* ============================================================================
+* 적응형 Baudrate 제어 (--adapt)
+* ============================================================================
+* 
+* 고정 속도로만 측정하면 케이블이 못 버티는 속도(예: 230400에서 ERR 약 25%)로도
+* 끝까지 보냄 → 빠른 속도인데 유효 처리량(goodput)은 오히려 낮음
+* 
+* 이 모드는 측정을 구간(epoch, --count 패킷, 기본 500)으로 나눠 돌리면서
+* 구간마다 에러율((ERR+TIMEOUT)/판정 수)과 왕복 지연 p99를 보고 속도를 고름:
+* 
+*   내려가기: 에러율 > 허용치 (--adapt-per, 기본 1%)
+*             또는 지연 p99 > 타임아웃의 80% (곧 TIMEOUT이 쏟아질 징후)
+*             → 바로 한 단계 아래로
+*   올라가기: 에러율 < 허용치/10인 구간이 hold번 연속이면 한 단계 위를 시험(probe)
+*   시험 판정: 시험 구간이 허용치 이내이고 goodput이 직전 속도보다 높으면 유지
+*             아니면 되돌아가고 그 속도의 hold를 두 배로 (최대 ADAPT_HOLD_MAX)
+*             → 못 버티는 속도를 계속 두드리지 않음 (히스테리시스)
+* 
+* 속도 전환은 스윕과 같은 link_switch_baud() (펌웨어와 "!BAUD n" + PING 확인)
+* 판정은 모두 화면([ADAPT])과 uart_adapt.csv에 한 줄씩 남김
+* Ctrl+C로 끝내면 시작 속도로 되돌림
+*/
+#define ADAPT_CSV_PATH      "uart_adapt.csv"
+#define ADAPT_DEFAULT_COUNT 500     // 구간당 패킷 수
+#define ADAPT_DEFAULT_PER   1.0     // 허용 에러율 (%)
+#define ADAPT_HOLD_MIN      3       // 올라가기 전에 깨끗해야 하는 구간 수
+#define ADAPT_HOLD_MAX      64
+#define ADAPT_LAT_FRACTION  0.8     // 지연 p99가 타임아웃의 이 비율을 넘으면 내려감
+
+enum adapt_decision {
+ADAPT_STAY,     // 그대로
+ADAPT_DOWN,     // 에러/지연 초과 → 한 단계 아래
+ADAPT_PROBE,    // 충분히 깨끗함 → 한 단계 위를 시험
+ADAPT_KEEP,     // 시험 성공 → 새 속도 유지
+ADAPT_REVERT    // 시험 실패 → 이전 속도로
+};
+
+static const char *const adapt_names[] = { "stay", "down", "probe", "keep", "revert" };
+
+static int compare_int(const void *a, const void *b) {
+int x = *(const int *)a, y = *(const int *)b;
+return (x > y) - (x < y);
+}
+
+/* 판정 기록 파일 (첫 줄은 헤더) */
+static FILE *open_adapt_csv(void) {
+FILE *fp = fopen(ADAPT_CSV_PATH, "a");
+if (!fp) {
+perror("adapt CSV open error");
+return NULL;
+}
+if (ftell(fp) == 0) {
+fprintf(fp, "timestamp,epoch,cable_length,baudrate,sent,ok,err,timeouts,"
+"per,lat_p99_us,goodput,decision,next_baudrate\n");
+}
+return fp;
+}
+
+/*
+* 적응형 실행
+*   main()이 이미 열고 설정하고 아두이노 대기까지 끝낸 fd를 사용
+*   baudrate = 지금 펌웨어와 맞춰져 있는 속도 (끝나면 이 속도로 되돌림)
+*   rates = 쓸 수 있는 속도들 (순서 무관, 여기서 오름차순 정리)
+*/
+static int run_adapt(int fd, const char *path, double cable_length, int baudrate,
+int *rates, int n_rates, double max_per, int threaded, struct run_ctx *run) {
+int hold[MAX_SWEEP_RATES];
+double secs_at[MAX_SWEEP_RATES];
+struct uart_rx link_rx;
+
+// 오름차순 + 중복 제거 (사다리의 한 칸 = 속도 하나)
+qsort(rates, (size_t)n_rates, sizeof(int), compare_int);
+int n = 0;
+for (int i = 0; i < n_rates; i++) {
+if (n == 0 || rates[i] != rates[n - 1]) {
+rates[n++] = rates[i];
+}
+}
+for (int i = 0; i < n; i++) {
+hold[i] = ADAPT_HOLD_MIN;
+secs_at[i] = 0.0;
+}
+
+FILE *log_fp = open_adapt_csv();
+if (!log_fp) {
+return -1;
+}
+uart_rx_init(&link_rx, fd);
+if (run->max_packets <= 0) {
+run->max_packets = ADAPT_DEFAULT_COUNT;
+}
+
+// 시작 칸: 지금 속도 (목록에 없으면 그보다 느린 것 중 가장 빠른 것으로 전환)
+int cur = 0;
+for (int i = 0; i < n; i++) {
+if (rates[i] <= baudrate) {
+cur = i;
+}
+}
+int link_baud = baudrate;
+if (rates[cur] != link_baud) {
+if (link_switch_baud(fd, &link_rx, link_baud, rates[cur]) < 0) {
+fclose(log_fp);
+return -1;
+}
+link_baud = rates[cur];
+}
+printf("Adaptive mode: %d rates (%d..%d), %ld packets per epoch, max PER %.2f%%\n",
+n, rates[0], rates[n - 1], run->max_packets, max_per);
+
+int clean = 0;              // 허용치/10 미만인 구간이 연속 몇 번인지
+int probing = 0;            // 1 = 지금 구간이 시험 구간
+int probe_from = cur;
+double probe_base = 0.0;    // 시험 전 속도의 goodput
+int rc = 0;
+
+for (long epoch = 1; !stop_requested; epoch++) {
+int r = threaded
+? run_threaded(fd, path, cable_length, rates[cur], run)
+: run_pipelined(fd, path, cable_length, rates[cur], run);
+uart_rx_flush(&link_rx);
+if (r < 0) {
+rc = -1;
+break;
+}
+const struct run_summary *s = &run->last;
+uint64_t judged = s->ok + s->err + s->timeouts;
+if (judged == 0) {
+break;      // Ctrl+C로 구간이 바로 끝남
+}
+double per = 100.0 * (double)(s->err + s->timeouts) / (double)judged;
+double goodput = s->secs > 0 ? (double)s->ok * run->packet_len / s->secs : 0.0;
+// 타임아웃은 속도와 길이마다 다름 (port_init에서 회선 시간을 더함) → 그 구간의 값과 비교
+int lat_bad = s->lat_p99_us > s->timeout_us * ADAPT_LAT_FRACTION;
+int bad = per > max_per || lat_bad;
+secs_at[cur] += s->secs;
+
+enum adapt_decision d = ADAPT_STAY;
+int next = cur;
+if (probing) {
+probing = 0;
+if (!bad && goodput > probe_base) {
+d = ADAPT_KEEP;
+hold[cur] = ADAPT_HOLD_MIN;
+} else {
+d = ADAPT_REVERT;
+next = probe_from;
+hold[cur] = hold[cur] * 2 > ADAPT_HOLD_MAX ? ADAPT_HOLD_MAX : hold[cur] * 2;
+}
+clean = 0;
+} else if (bad) {
+clean = 0;
+if (cur > 0) {
+d = ADAPT_DOWN;
+next = cur - 1;
+// 잘 되던 속도가 나빠졌으면 다시 올라오기 전에 더 오래 지켜봄
+hold[cur] = hold[cur] * 2 > ADAPT_HOLD_MAX ? ADAPT_HOLD_MAX : hold[cur] * 2;
+}
+} else if (per < max_per / 10.0 && cur < n - 1) {
+if (++clean >= hold[cur + 1]) {
+d = ADAPT_PROBE;
+next = cur + 1;
+probing = 1;
+probe_from = cur;
+probe_base = goodput;
+clean = 0;
+}
+} else {
+clean = 0;
+}
+
+printf("[ADAPT] epoch %ld: %d bps PER=%.2f%% p99=%.1fus goodput=%.0f B/s -> %s",
+epoch, rates[cur], per, s->lat_p99_us, goodput, adapt_names[d]);
+if (next != cur) {
+printf(" %d bps", rates[next]);
+}
+if (d == ADAPT_STAY && cur < n - 1 && clean > 0) {
+printf(" (clean %d/%d)", clean, hold[cur + 1]);
+}
+printf("\n");
+
+time_t t_now = time(NULL);
+char timestamp[64];
+strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&t_now));
+fprintf(log_fp, "%s,%ld,%.2f,%d,%llu,%llu,%llu,%llu,%.4f,%.1f,%.1f,%s,%d\n",
+timestamp, epoch, cable_length, rates[cur],
+(unsigned long long)s->sent, (unsigned long long)s->ok,
+(unsigned long long)s->err, (unsigned long long)s->timeouts,
+per, s->lat_p99_us, goodput, adapt_names[d], rates[next]);
+fflush(log_fp);
+
+if (next != cur && !stop_requested) {
+if (link_switch_baud(fd, &link_rx, rates[cur], rates[next]) < 0) {
+// 전환 자체가 안 됨 (새 속도에서 PING 실패) → 시험 실패로 취급
+fprintf(stderr, "[ADAPT] switch to %d bps failed, staying at %d\n",
+rates[next], rates[cur]);
+if (next > cur) {
+hold[next] = ADAPT_HOLD_MAX;
+probing = 0;
+}
+continue;
+}
+cur = next;
+link_baud = rates[cur];
+}
 }
 
+// 시작 속도로 복귀
+if (link_baud != baudrate && link_switch_baud(fd, &link_rx, link_baud, baudrate) < 0) {
+fprintf(stderr, "[ADAPT] could not return to %d bps (firmware stays at %d)\n",
+baudrate, link_baud);
+}
+printf("\n[ADAPT] time per rate:");
+for (int i = 0; i < n; i++) {
+if (secs_at[i] > 0) {
+printf(" %d=%.1fs", rates[i], secs_at[i]);
+}
+}
+printf("\n");
+fclose(log_fp);
+return rc;
+}
 
 /*
 * ============================================================================
-* UART 한 줄 읽기 함수
+* 연속 스트림 BER 측정 (--ber SECONDS)
 * ============================================================================
 * 
-* 아두이노는 Serial.println()으로 데이터 끝에 \r\n을 붙여서 전송
-* 이 함수는 개행 문자를 만날 때까지 바이트 단위로 읽음
-* 
-* 왜 바이트 단위로 읽나?
-*   - read(fd, buf, 256)으로 한 번에 읽으면 여러 줄이 섞일 수 있음
-*   - 개행 위치를 정확히 알 수 없음
-*   - 바이트 단위 읽기가 더 정확한 파싱 가능
-* 
-* 파라미터:
-*   fd      - UART 파일 디스크립터 (open()의 반환값)
-*   buf     - 읽은 데이터를 저장할 버퍼
-*   max_len - 버퍼의 최대 크기
+* 패킷 에코는 패킷 에러율을 재지만 회선의 절반 가까이가 쉬는 시간
+* 이 모드는 회선을 PRBS로 빈틈없이 채우고 돌아온 비트를 하나하나 비교 (uart_ber.h)
 * 
-* 반환값:
-*   읽은 문자 수 (개행 문자 제외, null 포함 안 함)
+* 순서:
+*   1. 텍스트 명령 "!STREAM" → 펌웨어가 받은 바이트를 그대로 돌려보내는 모드로
+*   2. PRBS를 계속 보내면서 돌아온 바이트를 수신기에 넣음
+*      수신기가 알아서 동기를 잡고, 바이트가 빠지면(슬립) 다시 잡음
+*   3. 1초마다 그 1초의 BER과 95% 신뢰 구간을 출력 + uart_ber.csv에 한 줄
+*   4. 시간이 끝나면 송신을 멈추고 남은 에코를 받음
+*      펌웨어는 STREAM_IDLE_MS 동안 아무것도 안 오면 텍스트 모드로 돌아감 → PING으로 확인
+*   5. 전체 합계와 신뢰 구간 (CSV scope=run)
 * 
-* 타임아웃:
-*   200ms 동안 데이터가 없으면 읽기 종료
-*   (1ms × 200회 = 200ms)
-*   무한 대기 방지
+* 패턴은 --pattern이 PRBS면 그것, 아니면 prbs23
+* 시작 위치는 --seed로 정해지지만 수신기는 어디서든 동기를 잡으므로 상관없음
 */
-int read_line(int fd, char *buf, int max_len) {
-int idx = 0;          // 현재까지 읽은 바이트 수 (버퍼 인덱스)
-char c;               // 읽은 1바이트를 저장할 변수
-int timeout = 0;      // 타임아웃 카운터
-
-printf("[DEBUG] Starting read_line...\n");
-
-// 루프 종료 조건:
-//   1. 버퍼가 꽉 참 (idx >= max_len - 1, null 자리 남김)
-//   2. 타임아웃 (200회 × 1ms = 200ms)
-//   3. 개행 문자 발견 (break)
-while (idx < max_len - 1 && timeout < 200) {
-// 1바이트 읽기 시도
-// read()는 우리 설정(VMIN=0, VTIME=10)에서:
-//   - 데이터 있으면 즉시 반환
-//   - 없으면 1초까지 대기 후 0 반환
-// 하지만 우리는 더 짧은 타임아웃을 위해 직접 폴링
-ssize_t n = read(fd, &c, 1);
+#define BER_CSV_PATH    "uart_ber.csv"
+#define BER_CHUNK       256     // write() 한 번에 보내는 PRBS 바이트
+#define STREAM_IDLE_MS  200     // 펌웨어가 스트림 모드를 끝내는 무입력 시간 (uart_send_input.ino와 같게)
 
-if (n > 0) {
-// 데이터를 성공적으로 읽음
-printf("[DEBUG] Read byte: 0x%02X ('%c')\n", 
-(unsigned char)c,
-(c >= 32 && c <= 126) ? c : '?');  // 출력 불가능하면 '?'
-
-// 개행 문자 처리 (\n = 0x0A, \r = 0x0D)
-if (c == '\n' || c == '\r') {
-if (idx > 0) {
-// 이미 데이터를 읽은 상태에서 개행 발견
-// → 한 줄 완성, 루프 종료
-printf("[DEBUG] Line end detected, idx=%d\n", idx);
+static FILE *open_ber_csv(void) {
+FILE *fp = fopen(BER_CSV_PATH, "a");
+if (!fp) {
+perror("BER CSV open error");
+return NULL;
+}
+if (ftell(fp) == 0) {
+fprintf(fp, "timestamp,cable_length,baudrate,pattern,scope,secs,bits,errors,slips,"
+"unlocked_bits,ber,ber_lo95,ber_hi95\n");
+}
+return fp;
+}
+
+/* [BER] 한 줄 + CSV 한 줄 */
+static void ber_report(FILE *fp, double cable_length, int baudrate, const char *pattern,
+const char *scope, double secs, uint64_t bits, uint64_t errors,
+uint64_t slips, uint64_t unlocked) {
+double lo, hi;
+ber_interval(errors, bits, &lo, &hi);
+double ber = bits ? (double)errors / (double)bits : 0.0;
+printf("[BER] %-4s %6.1fs bits=%llu errors=%llu slips=%llu unlocked=%llu "
+"BER=%.3e [%.3e, %.3e]\n",
+scope, secs, (unsigned long long)bits, (unsigned long long)errors,
+(unsigned long long)slips, (unsigned long long)unlocked, ber, lo, hi);
+
+time_t t_now = time(NULL);
+char timestamp[64];
+strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&t_now));
+fprintf(fp, "%s,%.2f,%d,%s,%s,%.3f,%llu,%llu,%llu,%llu,%.6e,%.6e,%.6e\n",
+timestamp, cable_length, baudrate, pattern, scope, secs,
+(unsigned long long)bits, (unsigned long long)errors,
+(unsigned long long)slips, (unsigned long long)unlocked, ber, lo, hi);
+fflush(fp);
+}
+
+/* 슬립 처리로 카운터가 줄었을 수도 있으므로 음수는 0으로 */
+static uint64_t counter_delta(uint64_t now, uint64_t before) {
+return now > before ? now - before : 0;
+}
+
+/*
+* BER 측정 실행
+*   main()이 이미 열고 설정하고 아두이노 대기까지 끝낸 fd를 사용 (텍스트 모드)
+* 반환값: 성공 0, 실패 -1
+*/
+static int run_ber(int fd, double cable_length, int baudrate, double secs,
+const struct payload_gen *gen) {
+enum payload_kind kind = gen->kind >= PL_PRBS7 && gen->kind <= PL_PRBS31
+? gen->kind : PL_PRBS23;
+struct payload_gen shown = *gen;
+if (kind != gen->kind) {
+payload_parse("prbs23", &shown);
+}
+struct prbs_gen tx;
+struct ber_rx rx;
+prbs_init(&tx, kind, gen->seed);
+ber_rx_init(&rx, kind);
+
+FILE *log_fp = open_ber_csv();
+if (!log_fp) {
+return -1;
+}
+struct uart_rx link_rx;
+uart_rx_init(&link_rx, fd);
+if (link_command(fd, &link_rx, 0, "STREAM", NULL, 0) < 0) {
+fprintf(stderr, "[BER] firmware did not accept STREAM mode\n");
+fclose(log_fp);
+return -1;
+}
+
+int flags = fcntl(fd, F_GETFL);
+fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+printf("BER mode: %s for %.0fs (%d bps, continuous stream)\n\n",
+shown.spec, secs, baudrate);
+
+uint8_t txbuf[BER_CHUNK];
+size_t tx_len = 0, tx_off = 0;
+uint8_t rxbuf[4096];
+uint64_t tx_bytes = 0, rx_bytes = 0;
+int rc = 0;
+
+uint64_t start = mono_ns();
+uint64_t stop_at = start + (uint64_t)(secs * NS_PER_SEC);
+uint64_t next_report = start + NS_PER_SEC;
+uint64_t last_rx = start;
+struct ber_rx prev = rx;
+uint64_t prev_t = start;
+int sending = 1;
+
+for (;;) {
+uint64_t now = mono_ns();
+if (sending && (now >= stop_at || stop_requested)) {
+sending = 0;        // 이제부터는 남은 에코만 받음
+last_rx = now;
+}
+// 송신을 멈춘 뒤 펌웨어가 스트림 모드를 끝낼 만큼 조용하면 끝
+if (!sending && now - last_rx > (uint64_t)(STREAM_IDLE_MS + 100) * NS_PER_MS) {
 break;
 }
-// idx == 0이면 아직 실제 데이터가 없음
-// 줄 시작의 빈 개행(\r\n의 첫 번째 문자)일 수 있음
-// 무시하고 계속
+
+if (now >= next_report) {
+ber_report(log_fp, cable_length, baudrate, shown.spec, "1s",
+(double)(now - prev_t) / NS_PER_SEC,
+counter_delta(rx.bits, prev.bits), counter_delta(rx.errors, prev.errors),
+rx.slips - prev.slips, counter_delta(rx.unlocked_bits, prev.unlocked_bits));
+prev = rx;
+prev_t = now;
+next_report += NS_PER_SEC;
+}
+
+struct pollfd pfd = { fd, POLLIN | (sending ? POLLOUT : 0), 0 };
+if (poll(&pfd, 1, 50) < 0) {
+if (errno == EINTR) {
 continue;
 }
+perror("poll");
+rc = -1;
+break;
+}
 
-// 일반 문자는 버퍼에 저장
-buf[idx++] = c;
-timeout = 0;  // 데이터 받으면 타임아웃 카운터 리셋
-} else {
-// n <= 0: 읽을 데이터 없음
-// 1ms 대기 후 재시도 (busy waiting 방지)
-usleep(1000);  // 1000 마이크로초 = 1ms
-timeout++;
+if (sending && (pfd.revents & POLLOUT)) {
+if (tx_off == tx_len) {
+prbs_fill(&tx, txbuf, sizeof(txbuf));
+tx_len = sizeof(txbuf);
+tx_off = 0;
+}
+ssize_t k = write(fd, txbuf + tx_off, tx_len - tx_off);
+if (k > 0) {
+tx_off += (size_t)k;
+tx_bytes += (uint64_t)k;
+} else if (k < 0 && errno != EAGAIN && errno != EINTR) {
+perror("UART write");
+rc = -1;
+break;
 }
 }
 
-// 문자열 종료 문자 추가 (C 문자열 규약)
-buf[idx] = '\0';
+if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+ssize_t k = read(fd, rxbuf, sizeof(rxbuf));
+if (k > 0) {
+ber_rx_feed(&rx, rxbuf, (size_t)k);
+rx_bytes += (uint64_t)k;
+last_rx = mono_ns();
+} else if (k == 0 || (errno != EAGAIN && errno != EINTR)) {
+perror("UART read");
+rc = -1;
+break;
+}
+}
+}
 
-printf("[DEBUG] read_line complete: idx=%d, timeout=%d\n", idx, timeout);
-return idx;
+double total = (double)(mono_ns() - start) / NS_PER_SEC;
+printf("\n");
+ber_report(log_fp, cable_length, baudrate, shown.spec, "run", total,
+rx.bits, rx.errors, rx.slips, rx.unlocked_bits);
+printf("[BER] sent %llu bytes, received %llu bytes (%.1f%% line use), locks=%llu\n",
+(unsigned long long)tx_bytes, (unsigned long long)rx_bytes,
+total > 0 ? 100.0 * (double)tx_bytes * 10.0 / (total * baudrate) : 0.0,
+(unsigned long long)rx.locks);
+if (rx.locks == 0) {
+printf("[BER] never locked: no echo, or the far end is not in STREAM mode\n");
 }
+fclose(log_fp);
 
+fcntl(fd, F_SETFL, flags);
+uart_rx_flush(&link_rx);
+tcflush(fd, TCIFLUSH);
+if (rc == 0 && link_command(fd, &link_rx, 0, "PING", NULL, 0) < 0) {
+fprintf(stderr, "[BER] firmware did not return to text mode\n");
+rc = -1;
+}
+return rc;
+}
 
 /*
-* ============================================================================
-* 랜덤 패킷 생성 함수
-* ============================================================================
-* 
-* UART 통신 테스트를 위해 무작위 문자열 생성
-* 
-* 왜 랜덤 패킷을 사용하나?
-*   1. 항상 같은 문자열(예: "Hello")을 보내면:
-*      - 버퍼에 이전 데이터가 남아있어도 우연히 일치할 수 있음
-*      - 실제 통신 없이도 "OK"로 판정될 수 있음
-*   
-*   2. 매번 다른 문자열을 보내면:
-*      - 송신한 것과 정확히 일치해야만 OK
-*      - 진짜 통신이 성공했는지 확실히 검증 가능
-*   
-*   3. 다양한 비트 패턴 테스트:
-*      - 특정 문자 조합에서만 에러가 발생할 수 있음
-*      - 랜덤하면 다양한 패턴을 커버
-* 
-* 파라미터:
-*   buf - 생성된 패킷을 저장할 버퍼 (len+1 이상 크기 필요)
-*   len - 생성할 패킷 길이 (null 제외)
-*/
-void generate_random_packet(char *buf, int len) {
-// 사용할 문자 집합: 영문 대문자 + 소문자 + 숫자
-// 총 62개 문자 (26 + 26 + 10)
-// 특수문자 제외 이유: 일부 특수문자는 UART에서 제어 용도로 쓰일 수 있음
-static const char charset[] =
-"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-"abcdefghijklmnopqrstuvwxyz"
-"0123456789";
-
-for (int i = 0; i < len; i++) {
-// rand(): 0 ~ RAND_MAX 사이 난수 생성
-// % (sizeof(charset) - 1): 0 ~ 61 범위로 제한
-//   sizeof(charset)는 62+1=63 (null 포함)
-//   -1 하면 62, % 62하면 0~61
-int random_index = rand() % (sizeof(charset) - 1);
-buf[i] = charset[random_index];
-}
-
-// 문자열 종료
-buf[len] = '\0';
+* 지표 엔드포인트 닫기 (--metrics)
+*/
+static void close_metrics(struct metrics_server *m) {
+if (!m) {
+return;
+}
+printf("[METRICS] %llu scrapes\n",
+(unsigned long long)atomic_load(&m->scrapes));
+metrics_close(m);
+}
+
+/*
+* 캡처 파일 닫기 + 요약
+*/
+static void close_capture(struct uart_capture *cap, const char *path) {
+if (!cap) {
+return;
+}
+uint64_t records = cap->records, bytes = cap->bytes;
+if (cap_close(cap) < 0) {
+fprintf(stderr, "[CAPTURE] %s: write error, capture is incomplete\n", path);
+return;
+}
+printf("[CAPTURE] %s: %llu records, %llu bytes\n", path,
+(unsigned long long)records, (unsigned long long)bytes);
 }
 
 
@@ -326,7 +2907,11 @@ buf[len] = '\0';
 * ============================================================================
 * 메인 함수
 * ============================================================================
+* 
+* uart_bench.c는 CLAUD_VER_NO_MAIN을 정의하고 이 파일을 통째로 include해서
+* 위의 함수들(read_line, generate_random_packet, run_pipelined ...)을 그대로 잼
 */
+#ifndef CLAUD_VER_NO_MAIN
 int main(int argc, char *argv[]) {
 
 // ========================================================================
@@ -344,9 +2929,10 @@ struct termios options;   // UART 설정을 담는 구조체
 char buffer[256];         // 수신 데이터 버퍼
 char send_packet[64];     // 송신 패킷 버퍼
 
-int packet_len = 10;      // 테스트 패킷 길이 (10글자)
+int packet_len = DEFAULT_PACKET_LEN;  // 테스트 패킷 길이 (기본 10글자, --len)
        // 너무 짧으면 우연히 일치할 확률 높음
        // 너무 길면 전송 시간 증가
+       // 기존 루프는 기본 길이만 (send_packet[64]), 나머지는 파이프라인 모드
 
 double cable_length = 0.0;  // 케이블 길이 (미터)
          // 명령줄에서 입력받음
@@ -354,12 +2940,49 @@ double cable_length = 0.0;  // 케이블 길이 (미터)
 int baudrate = 9600;        // 통신 속도 기본값
          // 명령줄에서 입력받으면 덮어씀
 
-// 난수 시드 초기화
-// time(NULL): 1970.1.1부터 현재까지의 초 (매 초 다른 값)
-// srand(): 이 값으로 난수 생성기 초기화
-// 같은 시드 → 같은 난수 시퀀스 (재현성)
-// 다른 시드 → 다른 난수 시퀀스 (매 실행마다 다른 패킷)
-srand(time(NULL));
+unsigned window = 0;        // 파이프라인 윈도우 크기
+         // 0이면 기존 stop-and-wait 루프
+const char *window_arg = NULL;      // --window (범위 확인은 옵션을 다 읽은 뒤)
+
+long max_packets = 0;       // 처리할 패킷 수 (0 = 무한)
+
+int timeout_ms = 200;       // 파이프라인 모드 에코 대기 한도
+         // 기존 read_line()의 200ms와 같은 값
+
+const char *uart_path = UART_PATH;  // --device로 바꿀 수 있음
+
+int flush_ms = LOG_DEFAULT_FLUSH_MS;    // --flush-ms: CSV를 디스크에 내보내는 주기
+         // 0이면 결과가 들어올 때마다 (기존 fflush와 비슷)
+
+const char *capture_path = NULL;    // --capture: 송수신 바이트를 남길 파일
+
+const char *summary_path = STATS_DEFAULT_PATH;  // --summary: 설정별 누적 통계 파일
+
+int threaded = 0;           // --threads: 송신/수신 스레드 분리
+int binary = 0;             // --binary: COBS/CRC 프레임으로 송수신
+int split = 0;              // --split: 상향/하향 에러를 따로 (바이너리 프레임 사용)
+int sweep_rates[MAX_SWEEP_RATES];   // --sweep: 차례로 측정할 속도들
+int n_sweep = 0;
+int sweep_lens[MAX_SWEEP_LENS];     // --len-sweep: 차례로 측정할 페이로드 길이들
+int n_lens = 0;
+int adapt_rates[MAX_SWEEP_RATES];   // --adapt: 오갈 수 있는 속도들
+int n_adapt = 0;
+double adapt_per = ADAPT_DEFAULT_PER;
+double ber_secs = 0;        // --ber: 연속 스트림 BER 측정 시간 (0 = 안 함)
+int verbose = 0;            // --verbose: 트레이스 이벤트를 바로 출력 (예전 루프 출력)
+unsigned trace_errors = 0;  // --trace-errors N: ERR/TIMEOUT마다 최근 N개 패킷 덤프
+const char *metrics_spec = NULL;    // --metrics: 지표 엔드포인트 (포트 번호 또는 unix:경로)
+
+struct uart_port *ports = NULL;     // --port로 지정한 포트들
+int n_ports = 0;
+
+// 페이로드 생성기 (uart_payload.h)
+// 같은 시드 → 같은 패킷 시퀀스 (재현성)
+// 다른 시드 → 다른 패킷 시퀀스 (--seed를 안 주면 매 실행마다 다름)
+struct payload_gen gen;
+memset(&gen, 0, sizeof(gen));
+payload_parse("random", &gen);
+int have_seed = 0;
 
 
 // ========================================================================
@@ -376,33 +2999,319 @@ srand(time(NULL));
 *     argv[2] = "115200"
 */
 
-if (argc < 2) {
+/*
+* 옵션(--window 등)은 getopt_long()이 먼저 처리
+* GNU getopt는 인자 순서를 재배열하므로
+*   ./program 1.5 115200 --window 4
+*   ./program --window 4 1.5 115200
+* 둘 다 동작함. 옵션을 다 읽고 나면 argv[optind]부터가 위치 인자
+*/
+static const struct option long_opts[] = {
+{ "window",  required_argument, NULL, 'w' },
+{ "device",  required_argument, NULL, 'd' },
+{ "port",    required_argument, NULL, 'p' },
+{ "count",   required_argument, NULL, 'n' },
+{ "timeout", required_argument, NULL, 't' },
+{ "threads", no_argument,       NULL, 'T' },
+{ "binary",  no_argument,       NULL, 'b' },
+{ "split",   no_argument,       NULL, 'U' },
+{ "sweep",   required_argument, NULL, 's' },
+{ "len",     required_argument, NULL, 'L' },
+{ "len-sweep", required_argument, NULL, 'K' },
+{ "adapt",   required_argument, NULL, 'A' },
+{ "adapt-per", required_argument, NULL, 'P' },
+{ "flush-ms", required_argument, NULL, 'F' },
+{ "capture", required_argument, NULL, 'C' },
+{ "summary", required_argument, NULL, 'S' },
+{ "pattern", required_argument, NULL, 'G' },
+{ "seed",    required_argument, NULL, 'E' },
+{ "ber",     required_argument, NULL, 'B' },
+{ "verbose", no_argument,       NULL, 'v' },
+{ "trace-errors", required_argument, NULL, 'R' },
+{ "metrics", required_argument, NULL, 'M' },
+{ "help",    no_argument,       NULL, 'h' },
+{ NULL, 0, NULL, 0 }
+};
+
+int opt;
+while ((opt = getopt_long(argc, argv, "w:n:t:d:p:s:L:K:A:P:F:C:S:G:E:B:R:M:TvbUh", long_opts, NULL)) != -1) {
+switch (opt) {
+case 'w': window_arg = optarg; break;
+case 'n': max_packets = atol(optarg); break;
+case 't': timeout_ms = atoi(optarg); break;
+case 'F': flush_ms = atoi(optarg) < 0 ? 0 : atoi(optarg); break;
+case 'd': uart_path = optarg; break;
+case 'C': capture_path = optarg; break;
+case 'S': summary_path = optarg; break;
+case 'T': threaded = 1; break;
+case 'b': binary = 1; break;
+case 'U': split = binary = 1; break;
+case 'G':
+if (payload_parse(optarg, &gen) < 0) {
+printf("Error: bad --pattern '%s'\n", optarg);
+return -1;
+}
+break;
+case 'E':
+gen.seed = strtoull(optarg, NULL, 0);
+have_seed = 1;
+break;
+case 'B':
+ber_secs = atof(optarg);
+if (ber_secs <= 0) {
+printf("Error: --ber must be a positive number of seconds\n");
+return -1;
+}
+break;
+case 'v': verbose = 1; break;
+case 'R': trace_errors = (unsigned)atoi(optarg); break;
+case 'M': metrics_spec = optarg; break;
+case 's':
+n_sweep = parse_rate_list(optarg, sweep_rates, MAX_SWEEP_RATES);
+if (n_sweep <= 0) {
+printf("Error: bad --sweep '%s' (expected RATE,RATE,... or all)\n", optarg);
+return -1;
+}
+break;
+case 'L':
+packet_len = atoi(optarg);
+if (packet_len < 1 || packet_len > WIN_MAX_PAYLOAD) {
+printf("Error: --len must be between 1 and %d\n", WIN_MAX_PAYLOAD);
+return -1;
+}
+break;
+case 'K':
+n_lens = parse_len_list(optarg, sweep_lens, MAX_SWEEP_LENS);
+if (n_lens <= 0) {
+printf("Error: bad --len-sweep '%s' (expected LEN,LEN,..., START:END:STEP or all,\n"
+"       each 1..%d)\n", optarg, WIN_MAX_PAYLOAD);
+return -1;
+}
+break;
+case 'A':
+n_adapt = parse_rate_list(optarg, adapt_rates, MAX_SWEEP_RATES);
+if (n_adapt <= 0) {
+printf("Error: bad --adapt '%s' (expected RATE,RATE,... or all)\n", optarg);
+return -1;
+}
+break;
+case 'P':
+adapt_per = atof(optarg);
+if (adapt_per <= 0 || adapt_per >= 100) {
+printf("Error: --adapt-per must be between 0 and 100\n");
+return -1;
+}
+break;
+case 'p':
+if (n_ports == MAX_PORTS) {
+printf("Error: at most %d ports\n", MAX_PORTS);
+return -1;
+}
+if (!ports && !(ports = calloc(MAX_PORTS, sizeof(*ports)))) {
+perror("port alloc");
+return -1;
+}
+if (parse_port_spec(optarg, &ports[n_ports]) < 0 ||
+!baudrate_supported(ports[n_ports].baudrate)) {
+printf("Error: bad --port '%s' (expected DEV:LEN:BAUD)\n", optarg);
+return -1;
+}
+n_ports++;
+break;
+default:
+print_usage(argv[0]);
+return -1;
+}
+}
+
+if (timeout_ms <= 0) {
+printf("Error: --timeout must be positive\n");
+return -1;
+}
+// 음수는 unsigned로 바뀌면 40억이 됨 → 범위 밖은 여기서 거절 (uart_window.h의 WIN_MAX_WINDOW)
+if (window_arg) {
+char *end;
+long v = strtol(window_arg, &end, 10);
+if (end == window_arg || *end != '\0' || v < 1 || v > WIN_MAX_WINDOW) {
+printf("Error: --window must be between 1 and %d\n", WIN_MAX_WINDOW);
+print_usage(argv[0]);
+return -1;
+}
+window = (unsigned)v;
+}
+if (n_adapt > 0 && (n_sweep > 0 || n_lens > 0 || n_ports > 0)) {
+printf("Error: --adapt cannot be combined with --sweep, --len-sweep or --port\n");
+return -1;
+}
+// 멀티 포트는 run_multiport()에서 끝나므로 스윕까지 가지 않음
+if ((n_sweep > 0 || n_lens > 0) && n_ports > 0) {
+printf("Error: --sweep and --len-sweep cannot be combined with --port\n");
+return -1;
+}
+// 멀티 포트는 늘 epoll 루프 하나로 모든 포트를 돌림 (포트마다 스레드를 두지 않음)
+if (threaded && n_ports > 0) {
+printf("Error: --threads cannot be combined with --port (ports share one epoll loop)\n");
+return -1;
+}
+if (ber_secs > 0 && (n_adapt > 0 || n_sweep > 0 || n_lens > 0 || n_ports > 0 ||
+capture_path || split)) {
+printf("Error: --ber cannot be combined with --adapt, --sweep, --len-sweep, --port,\n"
+"       --capture or --split\n");
+return -1;
+}
+// 방향 분리 모드의 응답 페이로드는 UNO RAM에 맞춘 FRAME_GEN_MAX까지
+if (split) {
+int longest = packet_len;
+for (int i = 0; i < n_lens; i++) {
+if (sweep_lens[i] > longest) {
+longest = sweep_lens[i];
+}
+}
+if (longest > FRAME_GEN_MAX) {
+printf("Error: --split supports payloads up to %d bytes\n", FRAME_GEN_MAX);
+return -1;
+}
+}
+// 개행/0x00/제어 문자가 섞이는 패턴은 텍스트 줄로 보낼 수 없음 (BER 스트림은 원시 바이트)
+if (!binary && ber_secs <= 0 && !payload_text_safe(&gen)) {
+printf("Error: --pattern %s needs --binary\n", gen.spec);
+return -1;
+}
+// 시드를 안 주면 시각과 PID로 정하고 출력 (같은 패킷을 다시 보내려면 --seed로)
+if (!have_seed) {
+uint64_t x = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32) ^ mono_ns();
+gen.seed = splitmix64(&x);
+}
+printf("Payload: pattern=%s seed=%llu\n", gen.spec, (unsigned long long)gen.seed);
+
+// Ctrl+C → stop_requested 플래그만 세움 (루프가 보고 정상 종료)
+// SA_RESTART를 켜지 않음: epoll_wait()/usleep()이 EINTR로 바로 깨어나야 함
+struct sigaction sa;
+memset(&sa, 0, sizeof(sa));
+sa.sa_handler = on_stop_signal;
+sigaction(SIGINT, &sa, NULL);
+sigaction(SIGTERM, &sa, NULL);
+
+// 트레이스 링 (uart_trace.h): kill -USR1 <pid> → 최근 패킷들을 stderr로 덤프
+// --verbose면 이벤트를 쓰는 즉시 stdout에도 (예전 루프처럼 패킷마다 출력)
+trace_init(verbose ? stdout : NULL);
+sa.sa_handler = trace_on_signal;
+sigaction(SIGUSR1, &sa, NULL);
+
+struct run_ctx run = {
+.log = NULL,
+.packet_len = packet_len,
+.window = window,
+.timeout_ns = (uint64_t)timeout_ms * NS_PER_MS,
+.max_packets = max_packets,
+.binary = binary,
+.split = split,
+.gen = gen,
+.trace_errors = trace_errors
+};
+
+// 설정별 누적 통계 (uart_stats.h, 칸 256개로 약 29KB라 static)
+// 기존 요약 파일이 있으면 이어서 셈, 갱신/파일 쓰기는 CSV 기록 스레드가 함
+static struct live_stats stats;
+stats_init(&stats, summary_path);
+
+// 송수신 바이트 캡처 (--capture)
+struct uart_capture capture;
+if (capture_path) {
+if (cap_open(&capture, capture_path, mono_raw_ns()) < 0) {
+perror(capture_path);
+return -1;
+}
+run.cap = &capture;
+}
+
+// 실시간 지표 (--metrics, uart_metrics.h, 약 130KB라 static)
+// 측정 루프는 1초마다 스냅샷만 복사, 요청 처리는 지표 서버 스레드가 함
+static struct metrics_server metrics;
+if (metrics_spec) {
+if (metrics_open(&metrics, metrics_spec) < 0) {
+perror(metrics_spec);
+close_capture(run.cap, capture_path);
+return -1;
+}
+run.metrics = &metrics;
+printf("Metrics: %s%s (OpenMetrics)\n",
+strchr(metrics_spec, '/') ? "" : "http://127.0.0.1:", metrics_spec);
+}
+
+// ========================================================================
+// 멀티 포트 모드 (--port DEV:LEN:BAUD 여러 개)
+// ========================================================================
+// 위치 인자(케이블 길이, Baudrate)는 무시하고 포트별 값을 사용
+// 윈도우를 지정하지 않으면 아두이노 UNO 버퍼에 맞는 4
+if (n_ports > 0) {
+FILE *fp = fopen(CSV_PATH, "a");
+if (!fp) {
+perror("CSV open error");
+return -1;
+}
+FILE *detail_fp = open_detail_csv();
+if (!detail_fp) {
+fclose(fp);
+return -1;
+}
+struct async_log csv_log;
+if (log_open(&csv_log, fp, detail_fp, &stats, (uint64_t)flush_ms * NS_PER_MS) < 0) {
+fprintf(stderr, "CSV writer thread start failed\n");
+fclose(detail_fp);
+fclose(fp);
+return -1;
+}
+run.log = &csv_log;
+if (run.window == 0) {
+run.window = 4;
+}
+int rc = run_multiport(ports, n_ports, &run);
+close_capture(run.cap, capture_path);
+close_metrics(run.metrics);
+log_close(&csv_log);
+if (csv_log.stalls > 0) {
+printf("[LOG] CSV writer fell behind (%llu waits)\n", (unsigned long long)csv_log.stalls);
+}
+fclose(detail_fp);
+fclose(fp);
+free(ports);
+return rc;
+}
+
+if (argc - optind < 1) {
 // 최소 인자 (케이블 길이) 누락
-printf("Usage: %s <cable_length> [baudrate]\n", argv[0]);
-printf("Example: %s 1.5 115200\n", argv[0]);
-printf("\nSupported baudrates: 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600\n");
+print_usage(argv[0]);
 return -1;
 }
 
 // atof (ASCII to Float): 문자열을 double로 변환
 // "1.5" → 1.5
 // 변환 실패 시 0.0 반환 (에러 체크는 생략됨)
-cable_length = atof(argv[1]);
+cable_length = atof(argv[optind]);
 
-if (argc > 2) {
+if (argc - optind > 1) {
 // Baudrate 인자가 있으면 사용
 // atoi (ASCII to Integer): 문자열을 int로 변환
 // "115200" → 115200
-baudrate = atoi(argv[2]);
+baudrate = atoi(argv[optind + 1]);
 }
 
 // Baudrate 유효성 검사
+// 표준 상수가 없는 속도는 termios2로 따로 설정 (아래 tcsetattr 다음)
 speed_t baud_const = get_baudrate_constant(baudrate);
-if (baud_const == (speed_t)-1) {
+int custom_baud = baud_const == (speed_t)-1;
+if (custom_baud && !baudrate_supported(baudrate)) {
 printf("Error: Unsupported baudrate %d\n", baudrate);
 printf("Supported: 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600\n");
+if (uart_baud_other_supported()) {
+printf("           or any integer %d..%d (termios2)\n", UART_BAUD_MIN, UART_BAUD_MAX);
+}
 return -1;
 }
+if (custom_baud) {
+baud_const = B38400;    // 임시값
+}
 
 // 설정 정보 출력
 printf("===========================================\n");
@@ -447,8 +3356,8 @@ printf("===========================================\n\n");
 *         (0=stdin, 1=stdout, 2=stderr는 이미 사용 중)
 *   실패: -1 (errno에 에러 코드 설정)
 */
-printf("Opening UART: %s\n", UART_PATH);
-uart_fd = open(UART_PATH, O_RDWR | O_NOCTTY);
+printf("Opening UART: %s\n", uart_path);
+uart_fd = open(uart_path, O_RDWR | O_NOCTTY);
 
 if (uart_fd < 0) {
 // perror(): errno를 읽어서 해당하는 에러 메시지 출력
@@ -831,6 +3740,11 @@ tcflush(uart_fd, TCIOFLUSH);
 * 이미 tcflush()로 버퍼 비웠으므로
 */
 tcsetattr(uart_fd, TCSANOW, &options);
+if (custom_baud && set_uart_baud(uart_fd, baudrate) < 0) {
+perror("termios2 baudrate");
+close(uart_fd);
+return -1;
+}
 printf("UART configured: %d 8N1\n", baudrate);
 
 /*
@@ -883,6 +3797,30 @@ close(uart_fd);
 return -1;
 }
 
+// 비트 단위 비교 결과 (DETAIL_CSV_PATH 참고)
+FILE *detail_fp = open_detail_csv();
+if (!detail_fp) {
+fclose(fp);
+close(uart_fd);
+return -1;
+}
+
+/*
+* CSV 기록 스레드 (uart_log.h)
+*   측정 루프는 결과를 큐에 넣기만 하고
+*   파일 쓰기/fflush()는 이 스레드가 --flush-ms마다 모아서 함
+*   → SD 카드가 잠깐 멈춰도 UART 읽기는 멈추지 않음
+*/
+struct async_log csv_log;
+if (log_open(&csv_log, fp, detail_fp, &stats, (uint64_t)flush_ms * NS_PER_MS) < 0) {
+fprintf(stderr, "CSV writer thread start failed\n");
+fclose(detail_fp);
+fclose(fp);
+close(uart_fd);
+return -1;
+}
+run.log = &csv_log;
+
 
 // ========================================================================
 // 아두이노 초기화 대기
@@ -917,13 +3855,87 @@ tcflush(uart_fd, TCIOFLUSH);
 
 printf("Starting communication loop...\n\n");
 
+int exit_code = 0;
+
+// ========================================================================
+// 연속 스트림 BER 측정 (--ber)
+// ========================================================================
+if (ber_secs > 0) {
+if (run_ber(uart_fd, cable_length, baudrate, ber_secs, &gen) < 0) {
+exit_code = -1;
+}
+goto cleanup;
+}
+
+// ========================================================================
+// 적응형 Baudrate 제어 (--adapt)
+// ========================================================================
+if (n_adapt > 0) {
+if (run.window == 0) {
+run.window = 4;
+}
+if (run_adapt(uart_fd, uart_path, cable_length, baudrate,
+adapt_rates, n_adapt, adapt_per, threaded, &run) < 0) {
+exit_code = -1;
+}
+goto cleanup;
+}
+
+// ========================================================================
+// Baudrate / 패킷 길이 스윕 (--sweep, --len-sweep)
+// ========================================================================
+// --len-sweep만 주면 지금 속도 하나에서
+if (n_sweep > 0 || n_lens > 0) {
+if (run.window == 0) {
+run.window = 4;
+}
+if (n_sweep == 0) {
+sweep_rates[n_sweep++] = baudrate;
+}
+if (run_sweep(uart_fd, uart_path, cable_length, baudrate,
+sweep_rates, n_sweep, sweep_lens, n_lens, threaded, &run) < 0) {
+exit_code = -1;
+}
+goto cleanup;
+}
+
+// ========================================================================
+// 파이프라인 모드 (--window N)
+// ========================================================================
+// 기존 루프는 텍스트 전용이므로 --binary만 주면 윈도우 1 (한 번에 한 패킷)
+// --capture도 마찬가지 (다시 돌려볼 때 시퀀스 번호로 짝지어야 함)
+// 기본 길이가 아닌 --len도 (기존 루프의 버퍼와 200ms 대기는 10바이트 기준)
+if ((window > 0 || binary || capture_path || packet_len != DEFAULT_PACKET_LEN) &&
+!threaded) {
+if (run.window == 0) {
+run.window = 1;
+}
+if (run_pipelined(uart_fd, uart_path, cable_length, baudrate, &run) < 0) {
+exit_code = -1;
+}
+goto cleanup;
+}
+
+// ========================================================================
+// 스레드 모드 (--threads)
+// ========================================================================
+if (threaded) {
+if (run.window == 0) {
+run.window = 4;
+}
+if (run_threaded(uart_fd, uart_path, cable_length, baudrate, &run) < 0) {
+exit_code = -1;
+}
+goto cleanup;
+}
+
 
 // ========================================================================
 // 메인 통신 루프
 // ========================================================================
 /*
 * 무한 루프로 계속해서 통신 테스트 수행
-* 종료하려면 Ctrl+C
+* 종료하려면 Ctrl+C (또는 --count N개 처리 후 자동 종료)
 * 
 * 각 루프에서:
 *   1. 랜덤 패킷 생성
@@ -932,12 +3944,23 @@ printf("Starting communication loop...\n\n");
 *   4. 비교 및 결과 기록
 */
 int loop_count = 0;
+uint64_t loop_ok = 0, loop_err = 0, loop_timeouts = 0;
+uint64_t loop_tx_bytes = 0, loop_ok_bytes = 0;     // --metrics용
+uint64_t loop_bit_errors = 0, loop_bits_checked = 0;
+uint64_t next_stat = mono_ns() + NS_PER_SEC;
 
-while (1) {
-printf("\n========== Loop %d ==========\n", ++loop_count);
+// 왕복 지연 히스토그램 (약 60KB라 스택 대신 static)
+// 이 루프는 100ms 대기 뒤에 읽으므로 도착 시각도 그만큼 늦게 찍힘
+static struct latency loop_lat;
+latency_reset(&loop_lat);
 
-// 새로운 랜덤 패킷 생성
-generate_random_packet(send_packet, packet_len);
+while (!stop_requested && (max_packets <= 0 || loop_count < max_packets)) {
+// 패킷마다 출력하던 배너/덤프는 트레이스 링으로 (--verbose면 바로 출력)
+++loop_count;
+TRACE_INFO(TE_LOOP, 0, loop_count, 0, NULL, 0);
+
+// 새로운 랜덤 패킷 생성 (패킷 번호는 0부터)
+generate_random_packet(&gen, 0, (uint64_t)(loop_count - 1), send_packet, packet_len);
 
 // 송신 버퍼 비우기 (이전 잔여 데이터 제거)
 tcflush(uart_fd, TCOFLUSH);
@@ -946,7 +3969,6 @@ tcflush(uart_fd, TCOFLUSH);
 // ====================================================================
 // 데이터 송신
 // ====================================================================
-printf("[SEND] Writing packet...\n");
 
 /*
 * write(fd, buffer, count): 데이터 송신
@@ -970,6 +3992,8 @@ ssize_t written = write(uart_fd, send_packet, strlen(send_packet));
 // 개행 문자 전송
 // 아두이노의 Serial.readStringUntil('\n')이 줄 끝을 인식하도록
 write(uart_fd, "\n", 1);
+uint64_t t_write = mono_raw_ns();   // 지연 측정 기준점
+loop_tx_bytes += strlen(send_packet) + 1;
 
 /*
 * tcdrain(fd): 출력 완료까지 대기
@@ -989,14 +4013,13 @@ write(uart_fd, "\n", 1);
 */
 tcdrain(uart_fd);
 
-printf("[SEND] Written %zd bytes\n", written);  // %zd: ssize_t 출력
-print_hex("SENT", send_packet);
+TRACE_INFO(TE_SEND, 0, written, 0, send_packet, strlen(send_packet));
+(void)written;
 
 
 // ====================================================================
 // 데이터 수신
 // ====================================================================
-printf("[RECV] Waiting for response (100ms)...\n");
 
 /*
 * usleep(microseconds): 마이크로초 단위 대기
@@ -1021,7 +4044,13 @@ int len = read_line(uart_fd, buffer, sizeof(buffer));
 
 if (len > 0) {
 // 데이터 수신 성공
-print_hex("RECV_RAW", buffer);
+TRACE_INFO(TE_RECV, 0, 0, 0, buffer, len);
+latency_record(&loop_lat, t_write, line_rx.t_first, line_rx.t_last);
+if (line_rx.t_last >= t_write) {
+TRACE_INFO(TE_LATENCY, 0,
+line_rx.t_first >= t_write ? line_rx.t_first - t_write : 0,
+line_rx.t_last - t_write, NULL, 0);
+}
 
 
 // ================================================================
@@ -1052,7 +4081,7 @@ while (end > trimmed &&
 end--;
 }
 
-print_hex("RECV_TRIMMED", trimmed);
+TRACE_INFO(TE_TRIM, 0, 0, 0, trimmed, strlen(trimmed));
 
 
 // ================================================================
@@ -1069,7 +4098,18 @@ print_hex("RECV_TRIMMED", trimmed);
 * 한 글자라도 다르면 0이 아닌 값 반환
 */
 int cmp_result = strcmp(trimmed, send_packet);
-printf("strcmp(RECV, SENT) = %d\n", cmp_result);
+
+/*
+* 다르면 얼마나 다른지도 계산 (uart_compare.h)
+*   비트 에러 수, 바이트 치환 수, 편집 거리, 에러 위치
+*/
+struct echo_diff diff;
+echo_compare(send_packet, strlen(send_packet), trimmed, strlen(trimmed), &diff);
+if (cmp_result != 0) {
+TRACE_INFO(TE_DIFF, 0, diff.bit_errors, diff.edit_distance, NULL, 0);
+}
+loop_bit_errors += diff.bit_errors;
+loop_bits_checked += (uint64_t)diff.compared * 8;
 
 // 결과 문자열 설정
 // 삼항 연산자: (조건) ? 참일때값 : 거짓일때값
@@ -1084,72 +4124,68 @@ char *result = (cmp_result == 0) ? "OK" : "ERR";
 *   1970년 1월 1일 00:00:00 UTC부터 경과한 초
 *   time_t 타입 (보통 long int)
 * 
-* localtime(&now): 지역 시간으로 변환
-*   struct tm 구조체 포인터 반환
-*   tm_year, tm_mon, tm_mday, tm_hour, tm_min, tm_sec 등 포함
 * 
-* strftime(): 시간을 포맷 문자열로 변환
-*   %Y - 4자리 년도 (2024)
-*   %m - 2자리 월 (01-12)
-*   %d - 2자리 일 (01-31)
-*   %H - 24시간제 시 (00-23)
-*   %M - 분 (00-59)
-*   %S - 초 (00-59)
+* "2024-01-15 14:30:45" 같은 문자열(localtime + strftime)은
+* CSV 기록 스레드가 초가 바뀔 때만 만듦 (uart_log.h)
+* 예전에는 [LOG] 줄을 화면에 찍으려고 여기서도 만들었음
 */
 time_t now = time(NULL);
-struct tm *t = localtime(&now);
-char timestamp[64];
-strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", t);
 
 
 // ================================================================
 // CSV 파일에 결과 저장
 // ================================================================
 /*
-* fprintf(): 파일에 포맷팅된 문자열 출력
+* log_packet(): 결과를 CSV 기록 스레드의 큐에 넣음 (uart_log.h)
 * 
 * CSV 형식:
-*   타임스탬프,결과,패킷내용,케이블길이,Baudrate
+*   타임스탬프,결과,패킷내용,케이블길이,Baudrate,패킷길이
 *   
 * 예:
-*   2024-01-15 14:30:45,OK,AbCd123XyZ,1.50,9600
-*   2024-01-15 14:30:46,ERR,QwErTy9876,1.50,9600
+*   2024-01-15 14:30:45,OK,AbCd123XyZ,1.50,9600,10
+*   2024-01-15 14:30:46,ERR,QwErTy9876,1.50,9600,10
 * 
 * 이 데이터로 나중에:
 *   - 에러율 통계 계산
 *   - 머신러닝 모델 훈련
 *   - 케이블 길이/Baudrate별 신뢰성 분석
-*/
-fprintf(fp, "%s,%s,%s,%.2f,%d\n",
-timestamp,      // %s: 문자열
-result,         // %s: "OK" 또는 "ERR"
-send_packet,    // %s: 보낸 패킷 (비교용)
-cable_length,   // %.2f: 소수점 2자리 실수
-baudrate);      // %d: 정수
-
-/*
-* fflush(fp): 버퍼를 파일에 즉시 기록
 * 
-* 기본적으로 fprintf()는 버퍼에 쓰고,
-* 버퍼가 차거나 파일을 닫을 때 실제 기록
+* 예전에는 여기서 fprintf() + fflush()를 바로 했음
+*   fflush()는 버퍼 내용을 즉시 디스크에 기록 → 전원이 꺼져도 데이터 보존
+*   하지만 SD 카드가 느릴 때 이 줄에서 루프 전체가 멈춤
 * 
-* fflush()를 호출하면:
-*   - 버퍼 내용을 즉시 디스크에 기록
-*   - 전원이 꺼져도 데이터 보존
-*   - 프로그램이 비정상 종료해도 데이터 살아있음
+* 지금은:
+*   - 기록 스레드가 --flush-ms(기본 1초)마다 모아서 fwrite + fflush
+*   - 비정상 종료 시 잃을 수 있는 것은 마지막 1초 분량뿐
+*   - Ctrl+C로 끝내면 정리 단계의 log_close()가 남은 줄을 다 씀
+*   - 파일에 써지는 글자는 예전과 똑같음 (끝의 패킷길이 열만 추가)
 */
-fflush(fp);
+log_packet(&csv_log, now, result, send_packet, cable_length, baudrate,
+-1, strlen(send_packet), strlen(trimmed),
+line_rx.t_last >= t_write ? line_rx.t_last - t_write : 0, &diff);
 
-printf("\n[RESULT] %s\n", result);
-printf("[LOG] %s,%s,%s,%.2f,%d\n",
-timestamp, result, send_packet, cable_length, baudrate);
+TRACE_INFO(TE_RESULT, 0, cmp_result != 0, 0, NULL, 0);
+if (cmp_result == 0) {
+loop_ok++;
+loop_ok_bytes += strlen(send_packet);
+} else {
+loop_err++;
+if (trace_errors > 0) {
+trace_dump(stderr, trace_errors, "ERR");
+}
+}
 } else {
 // 수신 실패
 // len == 0: 타임아웃 (아무 데이터도 안 옴)
 // len < 0: 에러
-printf("[ERROR] No response received (len=%d)\n", len);
+TRACE_WARN(TE_TIMEOUT, 0, len, 0, NULL, 0);
+loop_timeouts++;
+if (trace_errors > 0) {
+trace_dump(stderr, trace_errors, "TIMEOUT");
+}
 
-// 여기서 ERR로 기록해도 좋음 (현재 코드에는 없음)
+// CSV에는 기록하지 않고 설정별 통계의 TIMEOUT으로만 셈
+log_timeout(&csv_log, time(NULL), cable_length, baudrate, -1, strlen(send_packet));
 }
 
 
@@ -1172,8 +4208,38 @@ printf("[ERROR] No response received (len=%d)\n", len);
 *   - 데이터 어긋남 (desynchronization)
 */
 tcflush(uart_fd, TCIFLUSH);
+uart_rx_flush(&line_rx);   // 링 버퍼에 남은 것도 같이 버림
+
+// 화면에는 1초에 한 줄만 (kill -USR1 <pid>로 최근 패킷의 바이트까지 볼 수 있음)
+trace_poll(stderr, TRACE_DUMP_PACKETS);
+if (mono_ns() >= next_stat) {
+printf("[STAT] %s %.2fm %d | loop %d: OK=%llu ERR=%llu TIMEOUT=%llu\n",
+uart_path, cable_length, baudrate, loop_count,
+(unsigned long long)loop_ok, (unsigned long long)loop_err,
+(unsigned long long)loop_timeouts);
+next_stat += NS_PER_SEC;
 
-printf("\n[WAIT] 100ms before next loop...\n");
+if (run.metrics) {
+struct metrics_snapshot ms;
+memset(&ms, 0, sizeof(ms));
+snprintf(ms.device, sizeof(ms.device), "%s", uart_path);
+ms.length = cable_length;
+ms.baud = baudrate;
+ms.sent = (uint64_t)loop_count;
+ms.received = loop_ok + loop_err;
+ms.ok = loop_ok;
+ms.err = loop_err;
+ms.timeouts = loop_timeouts;
+ms.tx_bytes = loop_tx_bytes;
+ms.rx_bytes = line_rx.bytes;
+ms.goodput_bytes = loop_ok_bytes;
+ms.bit_errors = loop_bit_errors;
+ms.bits_checked = loop_bits_checked;
+metrics_fill_latency(&ms, &loop_lat.last);
+metrics_fill_icount(&ms, uart_fd);
+metrics_publish(run.metrics, 0, &ms, mono_ns());
+}
+}
 
 // 다음 루프 전 100ms 대기
 // 아두이노가 완전히 준비되도록
@@ -1182,27 +4248,34 @@ usleep(100000);
 
 
 // ========================================================================
-// 정리 (이 코드는 실행되지 않음)
+// 정리
 // ========================================================================
 /*
-* while(1) 무한 루프이므로 여기 도달 불가
-* 
-* Ctrl+C로 종료하면:
-*   - SIGINT 시그널이 프로세스에 전달
-*   - 프로그램 즉시 종료
-*   - 이 정리 코드는 실행 안 됨
-* 
-* 제대로 정리하려면:
-*   signal(SIGINT, handler) 등록해서
-*   핸들러에서 루프 플래그 설정하고
-*   루프 탈출 후 정리
+* Ctrl+C (SIGINT) 또는 --count 도달 시 여기로 옴
 * 
-* 실제로는 OS가 프로세스 종료 시:
-*   - 열린 파일 디스크립터 자동 닫음
-*   - 메모리 자동 해제
-* 그래서 큰 문제는 없지만, 좋은 습관은 아님
+* on_stop_signal()이 플래그만 세우고 돌아오므로
+* 루프가 끝까지 돌고 나서 파일과 UART를 정상적으로 닫음
+*   - CSV 마지막 줄이 잘리지 않음
+*   - 파이프라인 모드는 최종 통계([DONE])를 출력한 뒤 옴
 */
+cleanup:
+// 실패로 끝나면 무엇을 주고받다가 그랬는지 볼 수 있도록
+if (exit_code != 0) {
+trace_dump(stderr, TRACE_DUMP_PACKETS, "error exit");
+}
+// 기존 루프를 돌았으면 지연 요약 (파이프라인/스레드 모드는 각자 출력함)
+print_latency("DONE", uart_path, &loop_lat);
+append_latency_csv(cable_length, baudrate, &loop_lat);
+close_capture(run.cap, capture_path);
+close_metrics(run.metrics);
+log_close(&csv_log);   // 큐에 남은 줄을 다 쓰고 기록 스레드 종료
+if (csv_log.stalls > 0) {
+// 큐가 꽉 차서 측정 루프가 기다린 적이 있음 (디스크가 측정 속도를 못 따라감)
+printf("[LOG] CSV writer fell behind (%llu waits)\n", (unsigned long long)csv_log.stalls);
+}
+fclose(detail_fp);
 fclose(fp);       // 파일 닫기
 close(uart_fd);   // UART 닫기
-return 0;
-}
\ No newline at end of file
+return exit_code;
+}
+#endif /* CLAUD_VER_NO_MAIN */
@@ -0,0 +1,107 @@
+/*
+ * ============================================================================
+ * 임의 Baudrate 설정 (termios2 / BOTHER)
+ * ============================================================================
+ *
+ * POSIX termios는 B9600, B115200 같은 미리 정해진 상수만 받음
+ *   → 115200과 230400 사이(에러율이 0%에서 25%로 뛰는 구간)를 측정할 수 없음
+ *
+ * 리눅스의 termios2:
+ *   c_cflag의 속도 비트에 BOTHER를 넣고
+ *   c_ispeed/c_ospeed에 숫자(예: 150000)를 그대로 넣으면
+ *   드라이버가 가능한 가장 가까운 분주비로 맞춰 줌
+ *   (라즈베리파이 PL011은 UART 클럭 / (16 * 속도)를 소수 분주로 설정)
+ *
+ * 주의:
+ *   <asm/termbits.h>는 glibc의 <termios.h>와 같은 이름을 정의해서 같이 include 못 함
+ *   → 커널 구조체와 같은 모양의 uart_termios2를 직접 선언하고 ioctl 번호도 직접 만듦
+ *   powerpc/mips/sparc/alpha는 termios 구조가 달라서 제외 (표준 상수만 사용)
+ *
+ * 드라이버는 요청한 속도와 정확히 같지 않을 수 있으므로
+ * 설정 후 다시 읽어서 실제 속도를 돌려줌
+ */
+#ifndef UART_BAUD_H
+#define UART_BAUD_H
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+
+#if defined(__linux__) && !defined(__powerpc__) && !defined(__mips__) && \
+    !defined(__sparc__) && !defined(__alpha__)
+#define UART_HAVE_BOTHER 1
+
+/* 커널의 struct termios2 (include/uapi/asm-generic/termbits.h)와 같은 배치 */
+struct uart_termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t     c_line;
+    cc_t     c_cc[19];
+    speed_t  c_ispeed;
+    speed_t  c_ospeed;
+};
+
+#define UART_TCGETS2  _IOR('T', 0x2A, struct uart_termios2)
+#define UART_TCSETSW2 _IOW('T', 0x2C, struct uart_termios2)  // 송신 중인 데이터를 다 보낸 뒤 적용
+#define UART_BOTHER   0010000
+#define UART_CBAUD    0010017
+#endif
+
+/*
+ * BOTHER로 받을 수 있는 범위
+ * 에코 펌웨어가 "!BAUD n"을 받아 주는 범위(echo_core.h의 ECHO_BAUD_MIN/MAX)와 같게
+ * → 이보다 빠른 속도는 --sweep/--adapt에서 항상 "!ERR BAUD"가 되므로 미리 거절
+ */
+#define UART_BAUD_MIN 300
+#define UART_BAUD_MAX 2000000
+
+static inline int uart_baud_other_supported(void) {
+#ifdef UART_HAVE_BOTHER
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * fd의 속도를 임의의 정수로 설정 (다른 termios 설정은 그대로)
+ *
+ * 파라미터:
+ *   actual - 드라이버가 실제로 맞춘 속도 (NULL 가능)
+ *
+ * 반환값: 성공 0, 실패 -1 (errno 설정, 지원하지 않는 플랫폼이면 ENOTSUP)
+ */
+static inline int uart_set_baud_other(int fd, int baudrate, int *actual) {
+#ifdef UART_HAVE_BOTHER
+    struct uart_termios2 t2;
+    if (baudrate < UART_BAUD_MIN || baudrate > UART_BAUD_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (ioctl(fd, UART_TCGETS2, &t2) < 0) {
+        return -1;
+    }
+    t2.c_cflag &= ~(tcflag_t)UART_CBAUD;
+    t2.c_cflag |= UART_BOTHER;
+    t2.c_ispeed = (speed_t)baudrate;
+    t2.c_ospeed = (speed_t)baudrate;
+    if (ioctl(fd, UART_TCSETSW2, &t2) < 0) {
+        return -1;
+    }
+
+    if (actual) {
+        *actual = ioctl(fd, UART_TCGETS2, &t2) == 0 ? (int)t2.c_ospeed : baudrate;
+    }
+    return 0;
+#else
+    (void)fd;
+    (void)baudrate;
+    (void)actual;
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+#endif /* UART_BAUD_H */
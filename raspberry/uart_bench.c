@@ -0,0 +1,750 @@
+/*
+ * ============================================================================
+ * 벤치마크 모음 (uart_bench)
+ * ============================================================================
+ *
+ * 성능 작업을 할 때마다 claud_ver를 돌려 보고 출력 속도를 눈으로 비교했음
+ *   → 숫자가 실행마다 흔들리고, 어디가 빨라졌는지 (또는 느려졌는지) 알 수 없음
+ *
+ * 이 프로그램은 claud_ver.c를 통째로 include해서 (CLAUD_VER_NO_MAIN)
+ * 측정 프로그램이 실제로 쓰는 함수를 그대로 잼
+ *
+ * 마이크로 벤치마크 (하드웨어 없음, 연산 하나당 ns):
+ *   rx_next_line       메모리 링에서 에코 줄 하나 꺼내기 (uart_rx.h)
+ *   rx_next_frame      COBS 프레임 꺼내기 + cobs_decode + frame_parse
+ *   read_line_pipe     read_line() 전체 경로 (파이프 read() 포함)
+ *   payload_*          generate_random_packet() 패턴별
+ *   compare_*          echo_compare() - 같음 / 비트 하나 뒤집힘 / 바이트 하나 빠짐
+ *   print_hex          print_hex() (stdout은 /dev/null)
+ *   log_format         CSV 두 줄 만들기 (uart_log.h의 기록 스레드가 하는 일)
+ *   trace_emit         트레이스 링에 패킷 이벤트 하나 (uart_trace.h)
+ *   시간이 --min-time 이상 걸릴 때까지 반복 횟수를 두 배씩 늘린 뒤
+ *   같은 횟수로 BENCH_REPEATS번 재서 최솟값과 중앙값을 기록
+ *
+ * 매크로 벤치마크 (uart_sim + pty, 속도마다):
+ *   uart_sim을 띄우고 run_pipelined()로 --count개 패킷을 주고받아
+ *   초당 패킷 수, 유효 처리량, 회선 사용률, 왕복 지연 p99를 잼
+ *   "fast"는 시뮬레이터의 속도 제한을 끈 것 (호스트 코드의 한계)
+ *
+ * 결과는 JSON 하나 (기본 stdout, -o FILE)
+ *   진행 상황은 stderr, 측정 함수들의 printf 출력은 /dev/null로 보냄
+ *   변경 전후의 JSON을 나란히 두고 비교하면 됨
+ *
+ * 사용법:
+ *   ./uart_bench -o before.json
+ *   ./uart_bench --micro-only --min-time 500
+ *   ./uart_bench --macro-only --bauds 115200,fast --count 5000 --sim ./uart_sim
+ *
+ * 빌드 (uart_sim도 같은 디렉터리에 빌드해 둘 것):
+ *   gcc -O2 -Wall -pthread -o uart_bench uart_bench.c -lm
+ */
+#define CLAUD_VER_NO_MAIN
+
+// claud_ver.c의 static 함수 중 벤치마크에서 안 쓰는 것들
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "claud_ver.c"
+#pragma GCC diagnostic pop
+
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#define BENCH_REPEATS        5
+#define BENCH_BLOCK          64      // 링에 한 번에 넣는 줄/프레임 수
+#define BENCH_PIPE_BATCH     1024    // 파이프에 미리 써 두는 줄 수 (64KB 파이프 버퍼 안)
+#define BENCH_MIN_TIME_MS    100
+#define BENCH_MACRO_COUNT    2000
+#define BENCH_SIM_WAIT_MS    2000    // uart_sim이 링크를 만들 때까지 기다리는 한도
+#define BENCH_MAX_BAUDS      32
+
+static const char *const default_bauds = "115200,230400,460800,921600,fast";
+
+/* 컴파일러가 결과를 안 쓰는 호출을 지우지 못하도록 */
+static volatile uint64_t bench_sink;
+
+/* ---------------------------------------------------------------------------
+ * 마이크로 벤치마크
+ * ------------------------------------------------------------------------- */
+
+struct micro_bench {
+    const char *name;
+    uint64_t  (*fn)(const void *arg, uint64_t iters);  // iters번 실행한 시간 (ns)
+    const void *arg;
+    size_t      bytes;      // 연산 하나가 다루는 바이트 (0 = 해당 없음)
+};
+
+struct micro_result {
+    const struct micro_bench *b;
+    uint64_t iters;
+    double   best_ns, median_ns;    // 연산 하나당
+};
+
+/* 랜덤 패킷들을 회선 포맷으로 이어 붙임 (텍스트 줄 또는 COBS 프레임) */
+static size_t bench_wire_block(int binary, int len, int n, char *out, size_t cap) {
+    struct payload_gen g = { .kind = PL_RANDOM, .seed = 1 };
+    struct inflight pkt;
+    char payload[WIN_MAX_PAYLOAD + 1];
+    size_t used = 0;
+    pkt.payload = payload;
+    for (int i = 0; i < n; i++) {
+        pkt.seq = (uint16_t)i;
+        pkt.len = len;
+        generate_random_packet(&g, 0, (uint64_t)i, pkt.payload, len);
+        used += (size_t)window_wire(&pkt, binary, out + used, cap - used);
+    }
+    return used;
+}
+
+static uint64_t bench_rx_next_line(const void *arg, uint64_t iters) {
+    static struct uart_rx rx;
+    static char block[BENCH_BLOCK * 32];
+    static size_t block_len;
+    char line[WIN_MAX_LINE + 1];
+    (void)arg;
+    if (block_len == 0) {
+        block_len = bench_wire_block(0, 10, BENCH_BLOCK, block, sizeof(block));
+    }
+    uart_rx_init(&rx, -1);
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        int n = uart_rx_next_line(&rx, line, sizeof(line));
+        if (n < 0) {
+            uart_rx_feed(&rx, block, block_len);
+            n = uart_rx_next_line(&rx, line, sizeof(line));
+        }
+        bench_sink += (uint64_t)n;
+    }
+    return mono_ns() - t0;
+}
+
+static uint64_t bench_rx_next_frame(const void *arg, uint64_t iters) {
+    static struct uart_rx rx;
+    static char block[BENCH_BLOCK * 32];
+    static size_t block_len;
+    unsigned char frame[WIN_MAX_WIRE];
+    uint8_t raw[WIN_MAX_WIRE];
+    (void)arg;
+    if (block_len == 0) {
+        block_len = bench_wire_block(1, 10, BENCH_BLOCK, block, sizeof(block));
+    }
+    uart_rx_init(&rx, -1);
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        int n = uart_rx_next_frame(&rx, frame, sizeof(frame), NULL);
+        if (n < 0) {
+            uart_rx_feed(&rx, block, block_len);
+            n = uart_rx_next_frame(&rx, frame, sizeof(frame), NULL);
+        }
+        uint8_t type;
+        uint16_t seq, plen;
+        const uint8_t *payload;
+        int d = cobs_decode(frame, (size_t)n, raw);
+        if (d >= 0 && frame_parse(raw, (size_t)d, &type, &seq, &payload, &plen) == 0) {
+            bench_sink += seq;
+        }
+    }
+    return mono_ns() - t0;
+}
+
+/*
+ * read_line()은 파일 디스크립터에서 읽으므로 파이프에 줄을 미리 써 두고
+ * 읽는 부분만 잼 (쓰는 시간은 빼고)
+ */
+static uint64_t bench_read_line_pipe(const void *arg, uint64_t iters) {
+    static int fds[2] = { -1, -1 };
+    static char block[BENCH_PIPE_BATCH * 20];
+    static size_t line_len;
+    char line[WIN_MAX_LINE + 1];
+    (void)arg;
+    if (fds[0] < 0) {
+        if (pipe(fds) < 0) {
+            perror("pipe");
+            exit(1);
+        }
+        size_t used = bench_wire_block(0, 10, BENCH_PIPE_BATCH, block, sizeof(block));
+        line_len = used / BENCH_PIPE_BATCH;     // 모든 줄이 같은 길이
+    }
+
+    uint64_t total = 0;
+    for (uint64_t done = 0; done < iters;) {
+        uint64_t batch = iters - done < BENCH_PIPE_BATCH ? iters - done : BENCH_PIPE_BATCH;
+        if (write_all(fds[1], block, batch * line_len) < 0) {
+            perror("pipe write");
+            exit(1);
+        }
+        uint64_t t0 = mono_ns();
+        for (uint64_t i = 0; i < batch; i++) {
+            bench_sink += (uint64_t)read_line(fds[0], line, sizeof(line));
+        }
+        total += mono_ns() - t0;
+        done += batch;
+    }
+    return total;
+}
+
+struct payload_arg {
+    const char *spec;
+    int         len;
+};
+
+static uint64_t bench_payload(const void *arg, uint64_t iters) {
+    const struct payload_arg *a = arg;
+    struct payload_gen g;
+    char buf[WIN_MAX_PAYLOAD + 1];
+    memset(&g, 0, sizeof(g));
+    payload_parse(a->spec, &g);
+    g.seed = 1;
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        generate_random_packet(&g, 0, i, buf, a->len);
+        bench_sink += (uint8_t)buf[0];
+    }
+    return mono_ns() - t0;
+}
+
+enum compare_case { CMP_EQUAL, CMP_BITFLIP, CMP_DROPPED };
+
+struct compare_arg {
+    enum compare_case what;
+    int               len;
+};
+
+static uint64_t bench_compare(const void *arg, uint64_t iters) {
+    const struct compare_arg *a = arg;
+    struct payload_gen g = { .kind = PL_RANDOM, .seed = 1 };
+    char tx[WIN_MAX_PAYLOAD + 1], rx[WIN_MAX_PAYLOAD + 1];
+    size_t rx_len = (size_t)a->len;
+    struct echo_diff d;
+
+    generate_random_packet(&g, 0, 0, tx, a->len);
+    memcpy(rx, tx, (size_t)a->len + 1);
+    if (a->what == CMP_BITFLIP) {
+        rx[a->len / 2] ^= 0x04;
+    } else if (a->what == CMP_DROPPED) {
+        memmove(rx + a->len / 2, rx + a->len / 2 + 1, (size_t)(a->len - a->len / 2));
+        rx_len--;
+    }
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        bench_sink += (uint64_t)echo_compare(tx, (size_t)a->len, rx, rx_len, &d);
+        bench_sink += d.bit_errors;
+    }
+    return mono_ns() - t0;
+}
+
+static uint64_t bench_print_hex(const void *arg, uint64_t iters) {
+    struct payload_gen g = { .kind = PL_RANDOM, .seed = 1 };
+    char packet[16];
+    (void)arg;
+    generate_random_packet(&g, 0, 0, packet, 10);
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        print_hex("SENT", packet);
+    }
+    fflush(stdout);
+    return mono_ns() - t0;
+}
+
+static uint64_t bench_log_format(const void *arg, uint64_t iters) {
+    static struct async_log lg;
+    struct log_record r;
+    (void)arg;
+    if (!lg.buf_main) {
+        lg.buf_main = malloc(LOG_BUF_SIZE);
+        lg.buf_detail = malloc(LOG_BUF_SIZE);
+        lg.main_fp = fopen("/dev/null", "w");
+        lg.detail_fp = fopen("/dev/null", "w");
+        if (!lg.buf_main || !lg.buf_detail || !lg.main_fp || !lg.detail_fp) {
+            perror("log_format setup");
+            exit(1);
+        }
+        lg.ts_sec = (time_t)-1;
+    }
+
+    memset(&r, 0, sizeof(r));
+    r.t = time(NULL);
+    r.cable_length = 1.5;
+    r.baudrate = 115200;
+    r.seq = 42;
+    r.tx_len = r.rx_len = 10;
+    r.diff.compared = 10;
+    r.diff.first_err = r.diff.last_err = -1;
+    snprintf(r.status, sizeof(r.status), "OK");
+    snprintf(r.payload, sizeof(r.payload), "AbC123xYz0");
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        r.seq = (int32_t)(i & 0xFFFF);
+        log_format(&lg, &r);
+    }
+    return mono_ns() - t0;
+}
+
+static uint64_t bench_trace_emit(const void *arg, uint64_t iters) {
+    static const char packet[] = "AbC123xYz0";
+    (void)arg;
+
+    uint64_t t0 = mono_ns();
+    for (uint64_t i = 0; i < iters; i++) {
+        TRACE_INFO(TE_TX, 0, i & 0xFFFF, 0, packet, sizeof(packet) - 1);
+    }
+    return mono_ns() - t0;
+}
+
+static const struct payload_arg pl_random10 = { "random", 10 };
+static const struct payload_arg pl_random63 = { "random", 63 };
+static const struct payload_arg pl_bytes63 = { "bytes", 63 };
+static const struct payload_arg pl_prbs23 = { "prbs23", 63 };
+static const struct payload_arg pl_walk1 = { "walk1", 63 };
+
+static const struct compare_arg cmp_equal10 = { CMP_EQUAL, 10 };
+static const struct compare_arg cmp_equal63 = { CMP_EQUAL, 63 };
+static const struct compare_arg cmp_bitflip10 = { CMP_BITFLIP, 10 };
+static const struct compare_arg cmp_dropped10 = { CMP_DROPPED, 10 };
+
+static const struct micro_bench micro_benches[] = {
+    { "rx_next_line",      bench_rx_next_line,   NULL,           16 },
+    { "rx_next_frame",     bench_rx_next_frame,  NULL,           0 },
+    { "read_line_pipe",    bench_read_line_pipe, NULL,           16 },
+    { "payload_random_10", bench_payload,        &pl_random10,   10 },
+    { "payload_random_63", bench_payload,        &pl_random63,   63 },
+    { "payload_bytes_63",  bench_payload,        &pl_bytes63,    63 },
+    { "payload_prbs23_63", bench_payload,        &pl_prbs23,     63 },
+    { "payload_walk1_63",  bench_payload,        &pl_walk1,      63 },
+    { "compare_equal_10",  bench_compare,        &cmp_equal10,   10 },
+    { "compare_equal_63",  bench_compare,        &cmp_equal63,   63 },
+    { "compare_bitflip_10", bench_compare,       &cmp_bitflip10, 10 },
+    { "compare_dropped_10", bench_compare,       &cmp_dropped10, 10 },
+    { "print_hex",         bench_print_hex,      NULL,           10 },
+    { "log_format",        bench_log_format,     NULL,           0 },
+    { "trace_emit",        bench_trace_emit,     NULL,           10 },
+};
+
+#define N_MICRO (sizeof(micro_benches) / sizeof(micro_benches[0]))
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void micro_run(const struct micro_bench *b, uint64_t min_ns, struct micro_result *out) {
+    uint64_t iters = 16;
+    uint64_t ns[BENCH_REPEATS];
+
+    // 한 번 돌아서 캐시/페이지/정적 버퍼를 데워 두고, 최소 시간을 넘을 때까지 늘림
+    while (b->fn(b->arg, iters) < min_ns && iters < (1ULL << 40)) {
+        iters *= 2;
+    }
+    for (int i = 0; i < BENCH_REPEATS; i++) {
+        ns[i] = b->fn(b->arg, iters);
+    }
+    qsort(ns, BENCH_REPEATS, sizeof(ns[0]), compare_u64);
+
+    out->b = b;
+    out->iters = iters;
+    out->best_ns = (double)ns[0] / (double)iters;
+    out->median_ns = (double)ns[BENCH_REPEATS / 2] / (double)iters;
+}
+
+/* ---------------------------------------------------------------------------
+ * 매크로 벤치마크 (uart_sim + run_pipelined)
+ * ------------------------------------------------------------------------- */
+
+struct macro_opts {
+    const char *sim;        // uart_sim 절대 경로
+    const char *dir;        // 링크와 uart_latency.csv를 둘 임시 디렉터리
+    long        count;
+    unsigned    window;
+    int         timeout_ms;
+    int         packet_len;
+};
+
+struct macro_result {
+    int      baud;          // 0 = fast (속도 제한 없음)
+    int      rc;            // 0 = 정상, -1 = 시뮬레이터/포트 실패
+    int      wire_len;      // 패킷 하나가 한 방향으로 쓰는 바이트
+    struct run_summary s;
+};
+
+/* uart_sim을 띄우고 링크가 생길 때까지 기다림, 반환값: pid, 실패 시 -1 */
+static pid_t sim_start(const struct macro_opts *o, const char *link, int baud) {
+    char baud_text[16];
+    snprintf(baud_text, sizeof(baud_text), "%d", baud);
+    unlink(link);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        if (baud == 0) {
+            execl(o->sim, "uart_sim", "--link", link, "--fast", "--seed", "1", (char *)NULL);
+        } else {
+            execl(o->sim, "uart_sim", "--link", link, "--baud", baud_text,
+                  "--seed", "1", (char *)NULL);
+        }
+        _exit(127);
+    }
+
+    for (int waited = 0; waited < BENCH_SIM_WAIT_MS; waited += 10) {
+        if (access(link, F_OK) == 0) {
+            return pid;
+        }
+        if (waitpid(pid, NULL, WNOHANG) == pid) {
+            fprintf(stderr, "uart_bench: %s exited before creating %s\n", o->sim, link);
+            return -1;
+        }
+        usleep(10 * 1000);
+    }
+    fprintf(stderr, "uart_bench: %s did not create %s\n", o->sim, link);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+static void sim_stop(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+}
+
+static void macro_run(const struct macro_opts *o, int baud, struct macro_result *out) {
+    char link[64];          // "/tmp/uart_bench.XXXXXX/tty"
+    struct async_log lg;
+    struct inflight probe;
+
+    memset(out, 0, sizeof(*out));
+    out->baud = baud;
+    out->rc = -1;
+
+    // 한 방향 회선 바이트 (텍스트 "SSSS:PAYLOAD\n")
+    char wire[WIN_MAX_WIRE];
+    char probe_payload[WIN_MAX_PAYLOAD + 1];
+    memset(&probe, 0, sizeof(probe));
+    probe.payload = probe_payload;
+    probe.len = o->packet_len;
+    memset(probe.payload, 'A', (size_t)o->packet_len);
+    out->wire_len = window_wire(&probe, 0, wire, sizeof(wire));
+
+    snprintf(link, sizeof(link), "%s/tty", o->dir);
+    pid_t pid = sim_start(o, link, baud);
+    if (pid < 0) {
+        return;
+    }
+    // pty는 termios 속도를 무시함 (속도는 시뮬레이터가 정함)
+    int fd = open_uart(link, baud ? baud : 115200);
+    if (fd < 0) {
+        sim_stop(pid);
+        return;
+    }
+
+    FILE *main_fp = fopen("/dev/null", "w");
+    FILE *detail_fp = fopen("/dev/null", "w");
+    if (!main_fp || !detail_fp ||
+        log_open(&lg, main_fp, detail_fp, NULL,
+                 (uint64_t)LOG_DEFAULT_FLUSH_MS * NS_PER_MS) < 0) {
+        perror("log_open");
+        if (main_fp) fclose(main_fp);
+        if (detail_fp) fclose(detail_fp);
+        close(fd);
+        sim_stop(pid);
+        return;
+    }
+
+    struct run_ctx run = {
+        .log = &lg,
+        .packet_len = o->packet_len,
+        .window = o->window,
+        .timeout_ns = (uint64_t)o->timeout_ms * NS_PER_MS,
+        .max_packets = o->count,
+        .binary = 0,
+        .gen = { .kind = PL_RANDOM, .seed = 1, .spec = "random" }
+    };
+    out->rc = run_pipelined(fd, link, 0.0, baud ? baud : 0, &run) < 0 ? -1 : 0;
+    out->s = run.last;
+
+    log_close(&lg);
+    fclose(main_fp);
+    fclose(detail_fp);
+    close(fd);
+    sim_stop(pid);
+    unlink(link);
+}
+
+/* "115200,921600,fast" → bauds (fast = 0), 반환값: 개수, 형식 오류 -1 */
+static int parse_bench_bauds(const char *spec, int *bauds, int max) {
+    char buf[512];
+    char *save = NULL;
+    int n = 0;
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (n == max) {
+            return -1;
+        }
+        if (strcmp(tok, "fast") == 0) {
+            bauds[n++] = 0;
+        } else if (atoi(tok) > 0) {
+            bauds[n++] = atoi(tok);
+        } else {
+            return -1;
+        }
+    }
+    return n > 0 ? n : -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * JSON 출력
+ * ------------------------------------------------------------------------- */
+
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_json(FILE *out, const char *label, const struct macro_opts *mo,
+                       uint64_t min_ns, const struct micro_result *micro, int n_micro,
+                       const struct macro_result *macro, int n_macro) {
+    struct utsname uts;
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    if (uname(&uts) < 0) {
+        memset(&uts, 0, sizeof(uts));
+    }
+
+    fprintf(out, "{\n  \"tool\": \"uart_bench\",\n  \"version\": 1,\n");
+    fprintf(out, "  \"timestamp\": \"%s\",\n  \"host\": ", stamp);
+    json_string(out, uts.nodename);
+    fprintf(out, ",\n  \"machine\": ");
+    json_string(out, uts.machine);
+    fprintf(out, ",\n  \"compiler\": ");
+    json_string(out, __VERSION__);
+    fprintf(out, ",\n  \"label\": ");
+    json_string(out, label ? label : "");
+    fprintf(out, ",\n  \"config\": {\"min_time_ms\": %llu, \"repeats\": %d, "
+            "\"count\": %ld, \"window\": %u, \"timeout_ms\": %d, \"packet_len\": %d},\n",
+            (unsigned long long)(min_ns / NS_PER_MS), BENCH_REPEATS,
+            mo->count, mo->window, mo->timeout_ms, mo->packet_len);
+
+    fprintf(out, "  \"micro\": [");
+    for (int i = 0; i < n_micro; i++) {
+        const struct micro_result *m = &micro[i];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+                "\"ns_per_op_best\": %.2f, \"ns_per_op_median\": %.2f, "
+                "\"ops_per_sec\": %.0f, \"mb_per_sec\": ",
+                i ? "," : "", m->b->name, (unsigned long long)m->iters,
+                m->best_ns, m->median_ns, m->best_ns > 0 ? 1e9 / m->best_ns : 0.0);
+        if (m->b->bytes && m->best_ns > 0) {
+            fprintf(out, "%.1f}", (double)m->b->bytes * 1e3 / m->best_ns);
+        } else {
+            fprintf(out, "null}");
+        }
+    }
+    fprintf(out, "%s],\n", n_micro ? "\n  " : "");
+
+    fprintf(out, "  \"macro\": [");
+    for (int i = 0; i < n_macro; i++) {
+        const struct macro_result *m = &macro[i];
+        const struct run_summary *s = &m->s;
+        double secs = s->secs > 0 ? s->secs : 0.0;
+        fprintf(out, "%s\n    {\"baud\": ", i ? "," : "");
+        if (m->baud) {
+            fprintf(out, "%d", m->baud);
+        } else {
+            fprintf(out, "\"fast\"");
+        }
+        fprintf(out, ", \"completed\": %s, \"sent\": %llu, \"echo_ok\": %llu, \"echo_err\": %llu, "
+                "\"timeouts\": %llu, \"secs\": %.4f, \"packets_per_sec\": %.1f, "
+                "\"goodput_bytes_per_sec\": %.1f, \"line_utilization\": ",
+                m->rc == 0 ? "true" : "false",
+                (unsigned long long)s->sent, (unsigned long long)s->ok,
+                (unsigned long long)s->err, (unsigned long long)s->timeouts, secs,
+                secs > 0 ? (double)s->sent / secs : 0.0,
+                secs > 0 ? (double)s->ok * mo->packet_len / secs : 0.0);
+        // 8N1: 바이트 하나 = 10비트, 한 방향 기준
+        if (m->baud && secs > 0) {
+            fprintf(out, "%.4f", (double)s->sent * m->wire_len * 10.0 / (m->baud * secs));
+        } else {
+            fprintf(out, "null");
+        }
+        fprintf(out, ", \"latency_p99_us\": %.1f}", s->lat_p99_us);
+    }
+    fprintf(out, "%s]\n}\n", n_macro ? "\n  " : "");
+}
+
+/* ---------------------------------------------------------------------------
+ * main
+ * ------------------------------------------------------------------------- */
+
+static void print_bench_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Micro-benchmarks of the claud_ver hot paths and end-to-end runs over uart_sim.\n");
+    printf("\nOptions:\n");
+    printf("  -o, --output FILE  write the JSON report to FILE (default stdout)\n");
+    printf("  --label TEXT       free-form label stored in the report\n");
+    printf("  --micro-only       skip the uart_sim runs\n");
+    printf("  --macro-only       skip the micro-benchmarks\n");
+    printf("  --min-time MS      minimum time per micro-benchmark repeat (default %d)\n",
+           BENCH_MIN_TIME_MS);
+    printf("  --bauds LIST       rates for the end-to-end runs, 'fast' = unpaced\n");
+    printf("                     (default %s)\n", default_bauds);
+    printf("  --count N          packets per end-to-end run (default %d)\n", BENCH_MACRO_COUNT);
+    printf("  --window N         pipeline window (default 4)\n");
+    printf("  --timeout MS       echo timeout (default 200)\n");
+    printf("  --sim PATH         uart_sim binary (default ./uart_sim)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL, *label = NULL, *sim = "./uart_sim";
+    const char *baud_spec = default_bauds;
+    int do_micro = 1, do_macro = 1;
+    uint64_t min_ns = (uint64_t)BENCH_MIN_TIME_MS * NS_PER_MS;
+    struct macro_opts mo = { NULL, NULL, BENCH_MACRO_COUNT, 4, 200, 10 };
+
+    static const struct option bench_opts[] = {
+        { "output",     required_argument, NULL, 'o' },
+        { "label",      required_argument, NULL, 'L' },
+        { "micro-only", no_argument,       NULL, 'm' },
+        { "macro-only", no_argument,       NULL, 'M' },
+        { "min-time",   required_argument, NULL, 'T' },
+        { "bauds",      required_argument, NULL, 'b' },
+        { "count",      required_argument, NULL, 'n' },
+        { "window",     required_argument, NULL, 'w' },
+        { "timeout",    required_argument, NULL, 't' },
+        { "sim",        required_argument, NULL, 's' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:L:mMT:b:n:w:t:s:h", bench_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'o': output = optarg; break;
+        case 'L': label = optarg; break;
+        case 'm': do_macro = 0; break;
+        case 'M': do_micro = 0; break;
+        case 'T': min_ns = (uint64_t)atol(optarg) * NS_PER_MS; break;
+        case 'b': baud_spec = optarg; break;
+        case 'n': mo.count = atol(optarg); break;
+        case 'w': mo.window = (unsigned)atoi(optarg); break;
+        case 't': mo.timeout_ms = atoi(optarg); break;
+        case 's': sim = optarg; break;
+        default:
+            print_bench_usage(argv[0]);
+            return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    int bauds[BENCH_MAX_BAUDS];
+    int n_bauds = parse_bench_bauds(baud_spec, bauds, BENCH_MAX_BAUDS);
+    if (n_bauds < 0) {
+        fprintf(stderr, "Error: bad --bauds '%s'\n", baud_spec);
+        return -1;
+    }
+    if (mo.window < 1 || mo.count <= 0 || mo.timeout_ms <= 0 || min_ns == 0) {
+        fprintf(stderr, "Error: --window, --count, --timeout and --min-time must be > 0\n");
+        return -1;
+    }
+
+    // 결과 파일은 임시 디렉터리로 옮겨 가기 전에 엶 (상대 경로)
+    // stdout은 측정 함수들의 printf 때문에 /dev/null로 돌리고 JSON은 원래 stdout으로
+    FILE *out = output ? fopen(output, "w") : fdopen(dup(STDOUT_FILENO), "w");
+    if (!out) {
+        perror(output ? output : "stdout");
+        return -1;
+    }
+    char sim_path[PATH_MAX];
+    if (do_macro && !realpath(sim, sim_path)) {
+        perror(sim);
+        fprintf(stderr, "Build it next to uart_bench or pass --sim, or use --micro-only\n");
+        fclose(out);
+        return -1;
+    }
+    fflush(stdout);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+        perror("/dev/null");
+        fclose(out);
+        return -1;
+    }
+    close(null_fd);
+
+    // Ctrl+C → 지금 돌고 있는 매크로 실행을 끝내고 그때까지의 결과를 씀
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+
+    struct micro_result micro[N_MICRO];
+    int n_micro = 0;
+    if (do_micro) {
+        for (size_t i = 0; i < N_MICRO && !stop_requested; i++) {
+            micro_run(&micro_benches[i], min_ns, &micro[n_micro]);
+            fprintf(stderr, "%-20s %10.1f ns/op (median %.1f)\n", micro_benches[i].name,
+                    micro[n_micro].best_ns, micro[n_micro].median_ns);
+            n_micro++;
+        }
+    }
+
+    struct macro_result macro[BENCH_MAX_BAUDS];
+    int n_macro = 0;
+    char dir[] = "/tmp/uart_bench.XXXXXX";
+    if (do_macro && !stop_requested) {
+        if (!mkdtemp(dir) || chdir(dir) < 0) {
+            perror("mkdtemp");
+            fclose(out);
+            return -1;
+        }
+        mo.sim = sim_path;
+        mo.dir = dir;
+        for (int i = 0; i < n_bauds && !stop_requested; i++) {
+            macro_run(&mo, bauds[i], &macro[n_macro]);
+            const struct run_summary *s = &macro[n_macro].s;
+            if (bauds[i]) {
+                fprintf(stderr, "%-8d ", bauds[i]);
+            } else {
+                fprintf(stderr, "%-8s ", "fast");
+            }
+            fprintf(stderr, "%s %llu/%llu ok, %.1f pkt/s, p99 %.1f us\n",
+                    macro[n_macro].rc == 0 ? "done" : "FAILED",
+                    (unsigned long long)s->ok, (unsigned long long)s->sent,
+                    s->secs > 0 ? (double)s->sent / s->secs : 0.0, s->lat_p99_us);
+            n_macro++;
+        }
+        // run_pipelined()이 남긴 uart_latency.csv 정리
+        unlink(LATENCY_CSV_PATH);
+        if (chdir("/") < 0 || rmdir(dir) < 0) {
+            perror(dir);
+        }
+    }
+
+    write_json(out, label, &mo, min_ns, micro, n_micro, macro, n_macro);
+    int rc = fclose(out) == 0 ? 0 : -1;
+    for (int i = 0; i < n_macro; i++) {
+        if (macro[i].rc < 0) {
+            rc = -1;
+        }
+    }
+    return rc;
+}
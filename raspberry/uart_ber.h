@@ -0,0 +1,216 @@
+/*
+ * ============================================================================
+ * 연속 스트림 BER 측정 (PRBS 송신 + 동기/계수 수신기)
+ * ============================================================================
+ *
+ * 패킷 에코 방식은 한 패킷을 보내고 에코를 기다리는 동안 회선이 놀고 있어서
+ * (윈도우를 써도 프레임 사이 간격이 있음) 패킷 에러율만 나옴
+ * 이 모듈은 회선을 PRBS로 꽉 채워서 고전적인 비트 에러율(BER)을 잼
+ *
+ * 송신 (prbs_gen):
+ *   uart_payload.h와 같은 다항식 (prbs7/15/23/31)을 끊김 없이 이어서 생성
+ *   바이트 안에서는 먼저 나온 비트가 최상위 (payload_make()와 같은 순서)
+ *
+ * 수신 (ber_rx): 테스트 장비의 "자기 동기" 방식
+ *   1. 탐색: 받은 비트를 LFSR에 그대로 밀어 넣음 (n비트면 상태가 찼음)
+ *            그 뒤로는 다음 비트를 예측해서 BER_LOCK_BITS번 연속으로 맞으면 동기
+ *   2. 동기: 예측한 비트와 받은 비트를 비교해서 틀린 수를 셈
+ *            LFSR에는 받은 비트가 아니라 예측한 비트를 넣음
+ *            → 비트 하나가 틀려도 뒤의 예측까지 번지지 않음 (에러 1개 = 1개)
+ *   3. 동기 상실: 최근 BER_LOSS_WINDOW비트 중 BER_LOSS_ERRORS개 이상 틀리면
+ *            (바이트가 빠지거나 끼어들면 이후 비트는 절반이 틀림)
+ *            슬립 1회로 세고 탐색부터 다시
+ *            이 창에서 센 에러는 슬립 탓이므로 비트 에러에서 뺌
+ *
+ * 탐색 중에 받은 비트는 unlocked_bits로 따로 셈 (BER 분모에 안 들어감)
+ *
+ * 신뢰 구간 (ber_interval):
+ *   비트 에러가 드물면 에러 수는 포아송 분포
+ *   95% 양측 구간 = [χ²(0.025, 2k) / 2N, χ²(0.975, 2k+2) / 2N]
+ *   χ² 분위수는 Wilson-Hilferty 근사 (k = 0이면 위쪽은 정확히 -ln(0.025)/N ≈ 3.69/N)
+ */
+#ifndef UART_BER_H
+#define UART_BER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "uart_payload.h"
+
+#define BER_LOCK_BITS    64     // 연속으로 이만큼 맞아야 동기
+#define BER_LOSS_WINDOW  64     // 동기 상실 판정 창 (비트)
+#define BER_LOSS_ERRORS  16     // 창 안에서 이만큼 틀리면 상실 (무작위 데이터면 평균 32)
+
+/* ---------------------------------------------------------------------------
+ * 송신 쪽: 끊김 없는 PRBS
+ * ------------------------------------------------------------------------- */
+
+struct prbs_gen {
+    int      n, m;      // x^n + x^m + 1
+    uint32_t mask;
+    uint32_t state;
+};
+
+/*
+ * kind는 PL_PRBS7 ~ PL_PRBS31, seed로 시작 위치를 정함
+ * 반환값: 성공 0, PRBS가 아닌 패턴이면 -1
+ */
+static inline int prbs_init(struct prbs_gen *g, enum payload_kind kind, uint64_t seed) {
+    if (kind < PL_PRBS7 || kind > PL_PRBS31) {
+        return -1;
+    }
+    payload_prbs_poly(kind, &g->n, &g->m);
+    g->mask = (1u << g->n) - 1;
+    uint64_t x = seed;
+    g->state = (uint32_t)splitmix64(&x) & g->mask;
+    if (g->state == 0) {
+        g->state = 1;
+    }
+    return 0;
+}
+
+static inline uint32_t prbs_next_bit(uint32_t s, int n, int m) {
+    return ((s >> (n - 1)) ^ (s >> (m - 1))) & 1u;
+}
+
+static inline void prbs_fill(struct prbs_gen *g, uint8_t *out, size_t len) {
+    uint32_t s = g->state;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) {
+            uint32_t bit = prbs_next_bit(s, g->n, g->m);
+            s = ((s << 1) | bit) & g->mask;
+            byte = (uint8_t)((byte << 1) | bit);
+        }
+        out[i] = byte;
+    }
+    g->state = s;
+}
+
+/* ---------------------------------------------------------------------------
+ * 수신 쪽: 동기 + 계수
+ * ------------------------------------------------------------------------- */
+
+struct ber_rx {
+    int      n, m;
+    uint32_t mask;
+    uint32_t state;
+    int      locked;
+    int      loaded;        // 탐색: LFSR에 들어간 비트 수 (n에서 멈춤)
+    int      matched;       // 탐색: 연속으로 맞은 비트 수
+    uint64_t window;        // 동기: 최근 비트의 에러 여부 (1 = 틀림)
+    int      window_fill;   // 동기 후 창에 들어간 비트 수 (최대 BER_LOSS_WINDOW)
+
+    // 누적 카운터 (초마다 차이를 보려면 호출하는 쪽이 복사해 둠)
+    uint64_t bits;          // 동기 상태에서 비교한 비트
+    uint64_t errors;        // 그중 틀린 비트
+    uint64_t slips;         // 동기 상실 횟수
+    uint64_t unlocked_bits; // 탐색 중에 흘려보낸 비트
+    uint64_t locks;         // 동기 잡은 횟수
+};
+
+static inline int ber_rx_init(struct ber_rx *r, enum payload_kind kind) {
+    if (kind < PL_PRBS7 || kind > PL_PRBS31) {
+        return -1;
+    }
+    memset(r, 0, sizeof(*r));
+    payload_prbs_poly(kind, &r->n, &r->m);
+    r->mask = (1u << r->n) - 1;
+    return 0;
+}
+
+static inline void ber_rx_search(struct ber_rx *r) {
+    r->locked = 0;
+    r->loaded = 0;
+    r->matched = 0;
+    r->state = 0;
+}
+
+static inline void ber_rx_bit(struct ber_rx *r, uint32_t bit) {
+    uint32_t predicted = prbs_next_bit(r->state, r->n, r->m);
+
+    if (!r->locked) {
+        r->unlocked_bits++;
+        if (r->loaded < r->n) {
+            r->loaded++;
+        } else if (predicted == bit && r->state != 0) {
+            // 상태가 0이면 0만 예측함 → 끊긴 회선(계속 0)에 동기되지 않도록
+            if (++r->matched >= BER_LOCK_BITS) {
+                r->locked = 1;
+                r->locks++;
+                r->window = 0;
+                r->window_fill = 0;
+            }
+        } else {
+            r->matched = 0;
+        }
+        r->state = ((r->state << 1) | bit) & r->mask;
+        return;
+    }
+
+    uint32_t err = predicted ^ bit;
+    r->state = ((r->state << 1) | predicted) & r->mask;
+    r->bits++;
+    r->errors += err;
+    r->window = (r->window << 1) | err;
+    if (r->window_fill < BER_LOSS_WINDOW) {
+        r->window_fill++;
+    }
+
+    if (err) {
+        int bad = __builtin_popcountll(r->window);
+        if (bad >= BER_LOSS_ERRORS) {
+            // 슬립: 이 창의 에러는 비트 에러가 아니라 동기가 어긋난 탓
+            r->errors -= (uint64_t)bad;
+            r->bits -= (uint64_t)r->window_fill;
+            r->unlocked_bits += (uint64_t)r->window_fill;
+            r->slips++;
+            ber_rx_search(r);
+        }
+    }
+}
+
+/* 받은 바이트들 처리 (바이트 안에서는 최상위 비트부터) */
+static inline void ber_rx_feed(struct ber_rx *r, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        for (int b = 7; b >= 0; b--) {
+            ber_rx_bit(r, (data[i] >> b) & 1u);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * 95% 신뢰 구간
+ * ------------------------------------------------------------------------- */
+
+/* 자유도 nu인 χ² 분포의 분위수 (z = 표준 정규 분위수), Wilson-Hilferty 근사 */
+static inline double ber_chi2_quantile(double nu, double z) {
+    double a = 2.0 / (9.0 * nu);
+    double c = 1.0 - a + z * sqrt(a);
+    return c > 0.0 ? nu * c * c * c : 0.0;
+}
+
+/*
+ * errors / bits의 95% 양측 신뢰 구간
+ * bits가 0이면 [0, 1]
+ */
+static inline void ber_interval(uint64_t errors, uint64_t bits, double *lo, double *hi) {
+    const double z = 1.959964;
+    if (bits == 0) {
+        *lo = 0.0;
+        *hi = 1.0;
+        return;
+    }
+    double n2 = 2.0 * (double)bits;
+    double k = (double)errors;
+    *lo = errors == 0 ? 0.0 : ber_chi2_quantile(2.0 * k, -z) / n2;
+    *hi = errors == 0 ? -log(0.025) / (double)bits
+                      : ber_chi2_quantile(2.0 * k + 2.0, z) / n2;
+    if (*hi > 1.0) {
+        *hi = 1.0;
+    }
+}
+
+#endif /* UART_BER_H */
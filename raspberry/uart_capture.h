@@ -0,0 +1,276 @@
+/*
+ * ============================================================================
+ * 송수신 바이트 캡처 파일 (--capture) + 읽기
+ * ============================================================================
+ *
+ * CSV에는 보낸 페이로드와 OK/ERR만 남음
+ *   → ERR가 몰린 구간을 나중에 다시 보려고 해도 실제로 받은 바이트가 없음
+ *
+ * 캡처 파일에는 write()로 보낸 덩어리와 read()로 받은 덩어리를
+ * 단조 시계 시각과 함께 그대로 이어 붙임 (추가만 하는 파일)
+ *   → uart_replay로 같은 프레이머/비교기/통계 코드에 메모리 속도로 다시 넣을 수 있음
+ *      (분류 규칙을 바꾼 뒤 몇 주 분량을 몇 초 만에 재분석, 하드웨어 없이 수신 경로 벤치마크)
+ *
+ * 형식 (리틀 엔디언, 라즈베리파이/x86 그대로):
+ *   파일 헤더 8바이트: "UCAP", version(2), hdr_len(2)
+ *   레코드: 헤더 8바이트 + 데이터 len바이트
+ *     dt_ns(4) - 앞 레코드로부터 지난 시간 (CLOCK_MONOTONIC_RAW)
+ *     len(2)   - 데이터 길이
+ *     kind(1)  - CAP_TX / CAP_RX / CAP_RUN / CAP_CLOCK
+ *     port(1)  - 포트 번호 (멀티 포트 모드의 --port 순서)
+ *
+ *   CAP_CLOCK: 절대 시각 (단조 시계 8바이트 + 벽시계 ns 8바이트)
+ *              파일을 열 때마다, 그리고 dt가 4초를 넘거나 뒤로 가면 (스레드 모드) 씀
+ *   CAP_RUN  : 측정 하나의 시작, 설정을 "key=value ..." 텍스트로 (늘어나도 호환)
+ *
+ * 측정 스레드에서 fwrite() 하지만 stdio 버퍼가 커서 대부분은 memcpy뿐
+ * (스레드 모드는 송신/수신 스레드가 같이 쓰므로 mutex로 보호)
+ */
+#ifndef UART_CAPTURE_H
+#define UART_CAPTURE_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CAP_MAGIC       "UCAP"
+#define CAP_VERSION     1
+#define CAP_STDIO_BUF   (256 * 1024)
+
+enum cap_kind {
+    CAP_TX    = 1,      // write()로 보낸 바이트
+    CAP_RX    = 2,      // read()로 받은 바이트
+    CAP_RUN   = 3,      // 측정 시작 + 설정 텍스트
+    CAP_CLOCK = 4       // 절대 시각 (이후 dt의 기준)
+};
+
+struct cap_file_hdr {
+    char     magic[4];
+    uint16_t version;
+    uint16_t hdr_len;   // 이 헤더의 크기 (필드가 늘면 읽는 쪽이 나머지를 건너뜀)
+};
+
+struct cap_rec_hdr {
+    uint32_t dt_ns;
+    uint16_t len;
+    uint8_t  kind;
+    uint8_t  port;
+};
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 쓰기
+ * ----------------------------------------------------------------------------
+ */
+struct uart_capture {
+    FILE           *fp;
+    pthread_mutex_t lock;
+    uint64_t        last_t;     // 마지막 레코드 시각 (dt 기준)
+    uint64_t        records;
+    uint64_t        bytes;      // 기록한 데이터 바이트 (헤더 제외)
+    int             failed;     // 디스크 에러 후에는 조용히 무시
+};
+
+static inline void cap_put(struct uart_capture *c, uint8_t kind, uint8_t port,
+                           uint32_t dt, const void *data, uint16_t len) {
+    struct cap_rec_hdr h = { dt, len, kind, port };
+    if (fwrite(&h, sizeof(h), 1, c->fp) != 1 ||
+        (len > 0 && fwrite(data, 1, len, c->fp) != len)) {
+        c->failed = 1;
+        return;
+    }
+    c->records++;
+    c->bytes += len;
+}
+
+/* 절대 시각 레코드 (호출자가 lock을 잡고 있어야 함) */
+static inline void cap_put_clock(struct uart_capture *c, uint64_t t) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t v[2] = { t, (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec };
+    cap_put(c, CAP_CLOCK, 0, 0, v, sizeof(v));
+    c->last_t = t;
+}
+
+/*
+ * 레코드 하나 추가
+ *   t - CLOCK_MONOTONIC_RAW 시각 (mono_raw_ns)
+ *   65535바이트보다 길면 같은 시각으로 나눠서 씀
+ */
+static inline void cap_write(struct uart_capture *c, uint8_t kind, uint8_t port,
+                             uint64_t t, const void *data, size_t len) {
+    if (!c || !c->fp) {
+        return;
+    }
+    pthread_mutex_lock(&c->lock);
+    if (!c->failed) {
+        if (t < c->last_t || t - c->last_t > UINT32_MAX) {
+            cap_put_clock(c, t);
+        }
+        uint32_t dt = (uint32_t)(t - c->last_t);
+        c->last_t = t;
+
+        const uint8_t *p = data;
+        do {
+            uint16_t n = len > UINT16_MAX ? UINT16_MAX : (uint16_t)len;
+            cap_put(c, kind, port, dt, p, n);
+            dt = 0;
+            p += n;
+            len -= n;
+        } while (len > 0);
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+/*
+ * 캡처 파일 열기 (이어 쓰기, 새 파일이면 헤더부터)
+ * 반환값: 성공 0, 실패 -1 (errno 설정)
+ */
+static inline int cap_open(struct uart_capture *c, const char *path, uint64_t now) {
+    memset(c, 0, sizeof(*c));
+    c->fp = fopen(path, "ab");
+    if (!c->fp) {
+        return -1;
+    }
+    setvbuf(c->fp, NULL, _IOFBF, CAP_STDIO_BUF);
+    pthread_mutex_init(&c->lock, NULL);
+
+    if (ftell(c->fp) == 0) {
+        struct cap_file_hdr h;
+        memcpy(h.magic, CAP_MAGIC, 4);
+        h.version = CAP_VERSION;
+        h.hdr_len = sizeof(h);
+        fwrite(&h, sizeof(h), 1, c->fp);
+    }
+    // 이전 실행의 단조 시계와는 이어지지 않으므로 항상 절대 시각부터
+    cap_put_clock(c, now);
+    return 0;
+}
+
+/* 반환값: 기록 중 에러가 있었으면 -1 */
+static inline int cap_close(struct uart_capture *c) {
+    if (!c->fp) {
+        return 0;
+    }
+    int rc = (fclose(c->fp) != 0 || c->failed) ? -1 : 0;
+    c->fp = NULL;
+    pthread_mutex_destroy(&c->lock);
+    return rc;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 읽기 (uart_replay)
+ * ----------------------------------------------------------------------------
+ * 파일 전체를 mmap해서 포인터만 옮기며 읽음 (복사/시스템 콜 없음)
+ */
+struct cap_reader {
+    const uint8_t *base;
+    const uint8_t *pos;
+    const uint8_t *end;
+    size_t         size;
+    uint64_t       t;           // 현재 레코드의 절대 시각
+    uint64_t       wall_ns;     // 마지막 CAP_CLOCK의 벽시계 (0 = 없음)
+    uint64_t       wall_mono;   //             그때의 단조 시계
+};
+
+struct cap_rec {
+    uint64_t       t;           // CLOCK_MONOTONIC_RAW
+    uint8_t        kind;
+    uint8_t        port;
+    uint16_t       len;
+    const uint8_t *data;
+};
+
+/* 반환값: 성공 0, 실패 -1 (errno 설정, 형식이 틀리면 EINVAL) */
+static inline int cap_reader_open(struct cap_reader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(struct cap_file_hdr)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        return -1;
+    }
+    madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    struct cap_file_hdr h;
+    memcpy(&h, m, sizeof(h));
+    if (memcmp(h.magic, CAP_MAGIC, 4) != 0 || h.version != CAP_VERSION ||
+        h.hdr_len < sizeof(h) || h.hdr_len > (size_t)st.st_size) {
+        munmap(m, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    r->base = m;
+    r->size = (size_t)st.st_size;
+    r->pos = r->base + h.hdr_len;
+    r->end = r->base + r->size;
+    return 0;
+}
+
+/*
+ * 다음 레코드 (CAP_CLOCK은 시각만 갱신하고 호출자에게도 넘겨줌)
+ * 반환값: 1 레코드 있음, 0 파일 끝, -1 마지막 레코드가 잘림 (기록 중 종료)
+ */
+static inline int cap_next(struct cap_reader *r, struct cap_rec *out) {
+    if (r->pos == r->end) {
+        return 0;
+    }
+    struct cap_rec_hdr h;
+    if ((size_t)(r->end - r->pos) < sizeof(h)) {
+        return -1;
+    }
+    memcpy(&h, r->pos, sizeof(h));
+    if ((size_t)(r->end - r->pos) - sizeof(h) < h.len) {
+        return -1;
+    }
+    out->data = r->pos + sizeof(h);
+    r->pos += sizeof(h) + h.len;
+
+    if (h.kind == CAP_CLOCK && h.len >= 16) {
+        uint64_t v[2];
+        memcpy(v, out->data, sizeof(v));
+        r->t = v[0];
+        r->wall_mono = v[0];
+        r->wall_ns = v[1];
+    } else {
+        r->t += h.dt_ns;
+    }
+    out->t = r->t;
+    out->kind = h.kind;
+    out->port = h.port;
+    out->len = h.len;
+    return 1;
+}
+
+static inline void cap_reader_close(struct cap_reader *r) {
+    if (r->base) {
+        munmap((void *)r->base, r->size);
+        r->base = NULL;
+    }
+}
+
+#endif /* UART_CAPTURE_H */
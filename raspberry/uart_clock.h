@@ -0,0 +1,40 @@
+/*
+ * ============================================================================
+ * 단조 시계 (monotonic clock) 헬퍼
+ * ============================================================================
+ *
+ * time(NULL)은 1초 해상도이고, NTP가 시각을 고치면 앞뒤로 튈 수 있음
+ * → 타임아웃/처리량 계산에는 부적합
+ *
+ * CLOCK_MONOTONIC:
+ *   부팅 이후 흐른 시간 (절대 뒤로 가지 않음)
+ *   나노초 단위로 받아서 uint64_t 하나로 다루면 계산이 간단함
+ *   (2^64 ns ≈ 584년 → 오버플로 걱정 없음)
+ *
+ * CLOCK_MONOTONIC_RAW:
+ *   NTP의 속도 보정(slew)도 받지 않는 하드웨어 카운터 그대로의 시간
+ *   지연 측정(송신 완료 → 에코 도착)처럼 짧은 구간을 정밀하게 잴 때 사용
+ *   CLOCK_MONOTONIC과 기준점이 다르므로 두 시계 값을 서로 빼면 안 됨
+ */
+#ifndef UART_CLOCK_H
+#define UART_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define NS_PER_MS  1000000ULL
+#define NS_PER_SEC 1000000000ULL
+
+static inline uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t mono_raw_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+#endif /* UART_CLOCK_H */
@@ -0,0 +1,228 @@
+/*
+ * ============================================================================
+ * 에코 비교기: 비트/바이트 단위 에러 분류
+ * ============================================================================
+ *
+ * strcmp()는 "같다/다르다"만 알려줌
+ *   → 한 비트가 뒤집힌 패킷과 절반이 날아간 패킷이 똑같이 ERR
+ *   → 패킷 에러율(PER)만 나오고 비트 에러율(BER)은 계산할 수 없음
+ *
+ * 이 비교기가 알려주는 것:
+ *   bit_errors    - 같은 위치끼리 XOR한 뒤 1인 비트 수 (popcount)
+ *                   길이가 다르면 겹치는 부분만 셈
+ *   byte_subs     - 같은 위치인데 값이 다른 바이트 수
+ *   edit_distance - 삽입/삭제/치환 최소 횟수 (Levenshtein, EDIT_MAX에서 자름)
+ *                   바이트 하나가 빠지면 byte_subs는 뒤쪽 전부가 되지만
+ *                   edit_distance는 1 → 빠짐/끼어듦과 진짜 치환을 구분
+ *   first_err     - 처음 달라지는 위치 (없으면 -1)
+ *   last_err      - 마지막으로 달라지는 위치 (없으면 -1)
+ *                   길이가 다르면 짧은 쪽 끝도 에러 위치로 봄
+ *
+ * 속도:
+ *   XOR/popcount는 8바이트 워드 단위 (SWAR)
+ *   AArch64(라즈베리파이 3/4/5의 64비트 OS)에서는 NEON으로 16바이트씩 먼저 걸러냄
+ *   편집 거리는 대각선 주변 폭 2*EDIT_MAX+1만 계산 → O(n * EDIT_MAX)
+ *   게다가 바이트가 전부 같고 길이도 같으면 (정상 패킷) 계산하지 않음
+ */
+#ifndef UART_COMPARE_H
+#define UART_COMPARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define COMPARE_NEON 1
+#endif
+
+/* 이보다 큰 편집 거리는 EDIT_MAX + 1로 보고 (더 세도 쓸모가 없음) */
+#define EDIT_MAX 8
+
+struct echo_diff {
+    uint32_t compared;          // 위치끼리 비교한 바이트 수 (짧은 쪽 길이)
+    uint32_t bit_errors;
+    uint32_t byte_subs;
+    uint32_t edit_distance;
+    int32_t  first_err;
+    int32_t  last_err;
+};
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 같은 위치끼리 비교 (XOR + popcount)
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * 8바이트 워드에서 0이 아닌 바이트마다 그 바이트의 최상위 비트만 1
+ *   (x & 0x7F..) + 0x7F.. : 하위 7비트 중 하나라도 1이면 최상위 비트로 올림
+ *   | x                   : 최상위 비트 자체가 1인 경우
+ */
+static inline uint64_t cmp_nonzero_bytes(uint64_t x) {
+    const uint64_t lo7 = 0x7F7F7F7F7F7F7F7FULL;
+    return (((x & lo7) + lo7) | x) & ~lo7;
+}
+
+static inline uint64_t cmp_load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));   // 정렬 안 된 주소도 안전 (컴파일러가 한 번에 읽음)
+    return v;
+}
+
+/* 워드 안에서 처음/마지막 에러 바이트 위치 갱신 (리틀 엔디언 기준) */
+static inline void cmp_mark(struct echo_diff *d, size_t base, uint64_t nz) {
+    int first = (int)(base + (size_t)(__builtin_ctzll(nz) >> 3));
+    int last = (int)(base + (size_t)((63 - __builtin_clzll(nz)) >> 3));
+    if (d->first_err < 0) {
+        d->first_err = first;
+    }
+    d->last_err = last;
+}
+
+static inline void cmp_words(const uint8_t *a, const uint8_t *b, size_t i,
+                             size_t end, struct echo_diff *d) {
+    for (; i + 8 <= end; i += 8) {
+        uint64_t x = cmp_load64(a + i) ^ cmp_load64(b + i);
+        if (x == 0) {
+            continue;
+        }
+        uint64_t nz = cmp_nonzero_bytes(x);
+        d->bit_errors += (uint32_t)__builtin_popcountll(x);
+        d->byte_subs += (uint32_t)__builtin_popcountll(nz);
+        cmp_mark(d, i, nz);
+    }
+    for (; i < end; i++) {
+        uint8_t x = a[i] ^ b[i];
+        if (x == 0) {
+            continue;
+        }
+        d->bit_errors += (uint32_t)__builtin_popcount(x);
+        d->byte_subs++;
+        if (d->first_err < 0) {
+            d->first_err = (int32_t)i;
+        }
+        d->last_err = (int32_t)i;
+    }
+}
+
+/*
+ * a[0..n)와 b[0..n)를 위치끼리 비교해서 bit_errors/byte_subs/first/last를 채움
+ */
+static inline void compare_aligned(const uint8_t *a, const uint8_t *b, size_t n,
+                                   struct echo_diff *d) {
+    size_t i = 0;
+#ifdef COMPARE_NEON
+    // 16바이트씩 XOR해서 가로 최댓값이 0인 블록(= 전부 일치)은 바로 건너뜀
+    // 에러가 있는 블록만 워드 단위로 다시 보며 비트/바이트 수와 위치를 셈
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t x = veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        if (vmaxvq_u8(x) == 0) {
+            continue;
+        }
+        cmp_words(a, b, i, i + 16, d);
+    }
+#endif
+    cmp_words(a, b, i, n, d);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 제한된 편집 거리 (banded Levenshtein)
+ * ----------------------------------------------------------------------------
+ * 표 전체(n*m) 대신 대각선에서 EDIT_MAX 이내의 칸만 계산
+ *   거리가 EDIT_MAX 이하라면 최적 경로가 이 띠 밖으로 나갈 수 없음
+ * 한 행을 다 돌았는데 띠 안의 최솟값이 EDIT_MAX를 넘으면 바로 포기
+ */
+static inline uint32_t edit_distance_bounded(const uint8_t *a, size_t n,
+                                             const uint8_t *b, size_t m) {
+    const int k = EDIT_MAX;
+    const int big = EDIT_MAX + 1;
+    if ((n > m ? n - m : m - n) > (size_t)k) {
+        return (uint32_t)big;
+    }
+
+    // 행 i에서 열 j는 띠 안의 인덱스 j - i + k (0..2k)에 저장
+    int prev[2 * EDIT_MAX + 1], cur[2 * EDIT_MAX + 1];
+    for (int t = 0; t <= 2 * k; t++) {
+        int j = t - k;
+        prev[t] = (j >= 0 && (size_t)j <= m) ? j : big;
+    }
+
+    for (size_t i = 1; i <= n; i++) {
+        int row_min = big;
+        for (int t = 0; t <= 2 * k; t++) {
+            long j = (long)i + t - k;
+            if (j < 0 || (size_t)j > m) {
+                cur[t] = big;
+                continue;
+            }
+            int v;
+            if (j == 0) {
+                v = (int)i;
+            } else {
+                // 치환/일치: (i-1, j-1) → 이전 행의 같은 띠 인덱스
+                v = prev[t] + (a[i - 1] != b[j - 1]);
+                // 삭제: (i-1, j) → 이전 행의 t+1
+                if (t + 1 <= 2 * k && prev[t + 1] + 1 < v) {
+                    v = prev[t + 1] + 1;
+                }
+                // 삽입: (i, j-1) → 현재 행의 t-1
+                if (t > 0 && cur[t - 1] + 1 < v) {
+                    v = cur[t - 1] + 1;
+                }
+            }
+            cur[t] = v > big ? big : v;
+            if (cur[t] < row_min) {
+                row_min = cur[t];
+            }
+        }
+        if (row_min > k) {
+            return (uint32_t)big;
+        }
+        memcpy(prev, cur, sizeof(prev));
+    }
+
+    int r = prev[(long)m - (long)n + k];
+    return (uint32_t)(r > big ? big : r);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 보낸 것(tx)과 받은 것(rx) 비교
+ * ----------------------------------------------------------------------------
+ * 반환값: 완전히 같으면 0, 다르면 1
+ */
+static inline int echo_compare(const void *tx, size_t tx_len,
+                               const void *rx, size_t rx_len,
+                               struct echo_diff *d) {
+    const uint8_t *a = tx, *b = rx;
+    size_t n = tx_len < rx_len ? tx_len : rx_len;
+
+    memset(d, 0, sizeof(*d));
+    d->first_err = -1;
+    d->last_err = -1;
+    d->compared = (uint32_t)n;
+
+    compare_aligned(a, b, n, d);
+
+    if (tx_len != rx_len) {
+        // 짧은 쪽이 끝난 자리부터 어긋남
+        if (d->first_err < 0) {
+            d->first_err = (int32_t)n;
+        }
+        d->last_err = (int32_t)(tx_len > rx_len ? tx_len : rx_len) - 1;
+    } else if (d->byte_subs == 0) {
+        return 0;
+    }
+
+    // 길이가 같고 치환만 있는 경우가 대부분 → 편집 거리 = 치환 수인지는
+    // 띠 계산으로 확인 (밀린 바이트가 있으면 치환 수보다 작게 나옴)
+    d->edit_distance = edit_distance_bounded(a, tx_len, b, rx_len);
+    return 1;
+}
+
+#endif /* UART_COMPARE_H */
@@ -0,0 +1,129 @@
+/*
+ * ============================================================================
+ * HDR 스타일 지연 시간 히스토그램
+ * ============================================================================
+ *
+ * 평균만 보면 가끔 생기는 긴 지연(타임아웃을 정하는 데 중요한 값)이 묻힘
+ * → 모든 샘플의 분포를 남겨서 p50/p99/p99.9/max를 구함
+ *
+ * 샘플을 전부 저장하면 메모리가 계속 늘어나므로
+ * 값의 크기에 비례하는 폭의 칸(bucket)에 개수만 셈 (HdrHistogram 방식):
+ *   - 2^k ~ 2^(k+1) 구간마다 HIST_SUB_COUNT(128)칸으로 나눔
+ *   - 어느 크기에서도 상대 오차 1/128 (약 0.8%) 이내 → 유효숫자 2자리
+ *   - 0 ~ 2^64 ns 전체를 고정 크기 배열 하나로 표현 (약 30KB, malloc 없음)
+ *
+ * 예: 1,000 ns 근처는 8 ns 폭, 1,000,000 ns 근처는 8,192 ns 폭
+ *
+ * 기록은 O(1) (비트 연산 몇 개), 백분위 계산은 칸 수만큼 O(HIST_BUCKETS)
+ */
+#ifndef UART_HIST_H
+#define UART_HIST_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HIST_SUB_BITS   7
+#define HIST_SUB_COUNT  (1u << HIST_SUB_BITS)
+/* 선형 구간 1개 + 지수 구간 (64 - HIST_SUB_BITS)개, 각 HIST_SUB_COUNT칸 */
+#define HIST_BUCKETS    ((65 - HIST_SUB_BITS) * HIST_SUB_COUNT)
+
+struct hist {
+    uint64_t count;
+    uint64_t min, max;
+    uint64_t sum;               // 평균용
+    uint32_t counts[HIST_BUCKETS];
+};
+
+static inline void hist_reset(struct hist *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/*
+ * 값 → 칸 번호
+ *   v < 128: 그대로 (1 ns 단위)
+ *   그 이상: 최상위 비트 위치 e로 구간을 정하고, 그 아래 7비트로 구간 안의 칸을 정함
+ */
+static inline unsigned hist_index(uint64_t v) {
+    if (v < HIST_SUB_COUNT) {
+        return (unsigned)v;
+    }
+    unsigned e = 63u - (unsigned)__builtin_clzll(v);
+    unsigned shift = e - HIST_SUB_BITS;
+    unsigned top = (unsigned)(v >> shift);  // 128 ~ 255
+    return (shift + 1) * HIST_SUB_COUNT + (top - HIST_SUB_COUNT);
+}
+
+/* 칸 번호 → 그 칸에 들어가는 가장 큰 값 */
+static inline uint64_t hist_highest(unsigned idx) {
+    if (idx < HIST_SUB_COUNT) {
+        return idx;
+    }
+    unsigned shift = idx / HIST_SUB_COUNT - 1;
+    uint64_t low = (uint64_t)(HIST_SUB_COUNT + idx % HIST_SUB_COUNT) << shift;
+    return low + ((1ULL << shift) - 1);
+}
+
+static inline void hist_record(struct hist *h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min) {
+        h->min = v;
+    }
+    if (v > h->max) {
+        h->max = v;
+    }
+}
+
+/*
+ * 백분위 값 (q = 0.5, 0.99, 0.999 ...)
+ *   q 이하에 들어가는 마지막 칸의 상한 (실제 최댓값보다 커지지 않게 자름)
+ * 샘플이 없으면 0
+ */
+static inline uint64_t hist_percentile(const struct hist *h, double q) {
+    if (h->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)h->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > h->count) {
+        rank = h->count;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = hist_highest(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+static inline double hist_mean(const struct hist *h) {
+    return h->count ? (double)h->sum / (double)h->count : 0.0;
+}
+
+/* 다른 히스토그램을 더함 (여러 포트 합계 등) */
+static inline void hist_merge(struct hist *dst, const struct hist *src) {
+    if (src->count == 0) {
+        return;
+    }
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+#endif /* UART_HIST_H */
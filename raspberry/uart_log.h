@@ -0,0 +1,294 @@
+/*
+ * ============================================================================
+ * 비동기 CSV 기록기 (백그라운드 스레드)
+ * ============================================================================
+ *
+ * 기존 방식: 패킷마다 측정 스레드에서
+ *   localtime() + strftime() + fprintf() + fflush()
+ *   → SD 카드는 가끔 fflush 한 번에 수십~수백 ms 멈춤
+ *   → 그동안 UART를 못 읽어서 커널 수신 버퍼가 넘침 (측정 자체가 틀어짐)
+ *
+ * 이 모듈:
+ *   측정 스레드 - 고정 크기 이진 레코드를 락 없는 링(uart_spsc.h)에 넣기만 함
+ *                 (time(NULL) 한 번 + 복사, 파일 I/O 없음)
+ *   기록 스레드 - 레코드를 꺼내서 CSV 텍스트로 만들고 큰 버퍼에 모아 한 번에 씀
+ *                 타임스탬프 문자열은 초가 바뀔 때만 다시 만듦
+ *                 flush_ns마다 (또는 버퍼가 차면) fwrite + fflush
+ *
+ * 출력 형식은 기존 fprintf()에 packet_len 열 하나만 덧붙임
+ *   uart_dataset.csv: timestamp,status,payload,cable_length,baudrate,packet_len
+ *     payload는 레코드 크기(LOG_PAYLOAD_MAX)까지만 (--len이 길면 앞부분만)
+ *     → 패킷 길이는 payload의 길이가 아니라 packet_len 열로 읽어야 함
+ *     (AI/uart_csv.hpp는 packet_len 열이 없는 옛 파일도 읽음)
+ *   uart_detail.csv : timestamp,status,seq,tx_len,rx_len,bit_errors,...
+ *
+ * 링이 꽉 차면 측정 스레드가 잠깐 기다림 (데이터셋에서 줄이 빠지면 안 되므로)
+ * 생산자는 한 번에 한 스레드만 (SPSC)
+ *   - 멀티 포트 모드: epoll 루프 스레드
+ *   - 스레드 모드: 수신 스레드
+ *
+ * 비정상 종료 시 잃을 수 있는 것은 마지막 flush 이후의 줄뿐
+ * (Ctrl+C는 정상 종료 경로로 log_close()까지 감)
+ *
+ * 설정별 누적 통계(uart_stats.h)도 이 스레드가 레코드를 꺼낼 때 갱신하고
+ * STATS_WRITE_MS마다 요약 파일을 다시 씀
+ *   TIMEOUT은 CSV에는 안 쓰고 (기존 형식 유지) 통계에만 들어감
+ */
+#ifndef UART_LOG_H
+#define UART_LOG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uart_clock.h"
+#include "uart_compare.h"
+#include "uart_spsc.h"
+#include "uart_stats.h"
+
+#define LOG_RING_RECORDS  16384         // 링에 쌓아 둘 수 있는 레코드 수
+#define LOG_BUF_SIZE      (64 * 1024)   // 파일마다 모아서 쓰는 버퍼 크기
+#define LOG_LINE_MAX      256           // 한 줄의 최대 길이 (버퍼 여유 판단용)
+#define LOG_PAYLOAD_MAX   127           // 데이터셋에 남기는 페이로드 글자 수
+#define LOG_DEFAULT_FLUSH_MS 1000
+
+/* 패킷 하나의 결과 (CSV 두 파일의 한 줄씩) */
+struct log_record {
+    int64_t  t;                 // time(NULL)
+    double   cable_length;
+    int32_t  baudrate;
+    int32_t  seq;               // 시퀀스 번호 (기존 루프는 -1)
+    uint32_t tx_len;
+    uint32_t rx_len;
+    uint64_t latency_ns;        // 송신 완료 → 에코 끝 (0 = 모름)
+    struct echo_diff diff;
+    int32_t  result;            // enum stats_result (TIMEOUT은 통계에만)
+    char     status[8];         // "OK" / "ERR"
+    char     payload[LOG_PAYLOAD_MAX + 1]; // 텍스트, 또는 바이너리 패턴의 16진수 (앞부분만)
+};
+
+struct async_log {
+    struct spsc_ring ring;
+    FILE      *main_fp;         // uart_dataset.csv
+    FILE      *detail_fp;       // uart_detail.csv (NULL 가능)
+    uint64_t   flush_ns;        // 0이면 링이 빌 때마다 flush
+    struct live_stats *stats;   // 설정별 누적 통계 (NULL = 안 함)
+    pthread_t  thread;
+    atomic_int stop;
+
+    // 생산자 쪽 통계
+    uint64_t   records;
+    uint64_t   stalls;          // 링이 꽉 차서 기다린 횟수
+
+    // 기록 스레드 전용
+    time_t     ts_sec;          // ts_text를 만든 초
+    char       ts_text[32];
+    char      *buf_main, *buf_detail;
+    size_t     len_main, len_detail;
+};
+
+static inline void log_flush_buffers(struct async_log *lg) {
+    if (lg->len_main > 0) {
+        fwrite(lg->buf_main, 1, lg->len_main, lg->main_fp);
+        fflush(lg->main_fp);
+        lg->len_main = 0;
+    }
+    if (lg->len_detail > 0 && lg->detail_fp) {
+        fwrite(lg->buf_detail, 1, lg->len_detail, lg->detail_fp);
+        fflush(lg->detail_fp);
+    }
+    lg->len_detail = 0;
+}
+
+/* 레코드 하나를 두 파일의 버퍼에 CSV 텍스트로 추가 */
+static inline void log_format(struct async_log *lg, const struct log_record *r) {
+    // localtime()/strftime()은 초가 바뀔 때만
+    if ((time_t)r->t != lg->ts_sec || lg->ts_text[0] == '\0') {
+        time_t t = (time_t)r->t;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(lg->ts_text, sizeof(lg->ts_text), "%Y-%m-%d %H:%M:%S", &tm);
+        lg->ts_sec = t;
+    }
+
+    if (lg->len_main + LOG_LINE_MAX > LOG_BUF_SIZE ||
+        lg->len_detail + LOG_LINE_MAX > LOG_BUF_SIZE) {
+        log_flush_buffers(lg);
+    }
+
+    lg->len_main += (size_t)snprintf(lg->buf_main + lg->len_main,
+                                     LOG_BUF_SIZE - lg->len_main,
+                                     "%s,%s,%s,%.2f,%d,%u\n",
+                                     lg->ts_text, r->status, r->payload,
+                                     r->cable_length, r->baudrate, r->tx_len);
+    if (lg->detail_fp) {
+        const struct echo_diff *d = &r->diff;
+        lg->len_detail += (size_t)snprintf(lg->buf_detail + lg->len_detail,
+                                           LOG_BUF_SIZE - lg->len_detail,
+                                           "%s,%s,%d,%u,%u,%u,%u,%u,%d,%d,%.2f,%d\n",
+                                           lg->ts_text, r->status, r->seq,
+                                           r->tx_len, r->rx_len,
+                                           d->bit_errors, d->byte_subs, d->edit_distance,
+                                           d->first_err, d->last_err,
+                                           r->cable_length, r->baudrate);
+    }
+}
+
+/* 레코드 하나를 설정별 통계에 반영 */
+static inline void log_count(struct async_log *lg, const struct log_record *r) {
+    if (!lg->stats) {
+        return;
+    }
+    stats_add(lg->stats, r->cable_length, r->baudrate, (int)r->tx_len,
+              (enum stats_result)r->result,
+              r->diff.bit_errors, (uint64_t)r->diff.compared * 8, r->latency_ns);
+}
+
+static inline void *log_thread_main(void *arg) {
+    struct async_log *lg = arg;
+    struct log_record r;
+    uint64_t last_flush = mono_ns();
+    uint64_t last_summary = last_flush;
+
+    for (;;) {
+        int got = 0;
+        while (spsc_pop(&lg->ring, &r) == 0) {
+            if (r.result != STATS_TIMEOUT) {
+                log_format(lg, &r);
+            }
+            log_count(lg, &r);
+            got++;
+        }
+
+        uint64_t now = mono_ns();
+        if ((lg->len_main > 0 || lg->len_detail > 0) &&
+            (lg->flush_ns == 0 || now - last_flush >= lg->flush_ns)) {
+            log_flush_buffers(lg);
+            last_flush = now;
+        }
+        if (lg->stats && lg->stats->dirty &&
+            now - last_summary >= (uint64_t)STATS_WRITE_MS * NS_PER_MS) {
+            stats_write(lg->stats);
+            last_summary = now;
+        }
+
+        if (!got) {
+            // stop 이후에 들어온 레코드까지 다 꺼낸 뒤 종료
+            if (atomic_load(&lg->stop) && spsc_size(&lg->ring) == 0) {
+                break;
+            }
+            usleep(1000);
+        }
+    }
+
+    log_flush_buffers(lg);
+    if (lg->stats && lg->stats->dirty && stats_write(lg->stats) < 0) {
+        perror(lg->stats->path);
+    }
+    return NULL;
+}
+
+/*
+ * 기록 스레드 시작
+ *   main_fp, detail_fp는 호출자가 열고 닫음 (log_close() 뒤에 fclose)
+ *   stats는 stats_init()을 마친 것 (log_close() 뒤까지 살아 있어야 함)
+ * 반환값: 성공 0, 실패 -1
+ */
+static inline int log_open(struct async_log *lg, FILE *main_fp, FILE *detail_fp,
+                           struct live_stats *stats, uint64_t flush_ns) {
+    memset(lg, 0, sizeof(*lg));
+    lg->main_fp = main_fp;
+    lg->detail_fp = detail_fp;
+    lg->stats = stats;
+    lg->flush_ns = flush_ns;
+    lg->ts_sec = (time_t)-1;
+    atomic_init(&lg->stop, 0);
+
+    lg->buf_main = malloc(LOG_BUF_SIZE);
+    lg->buf_detail = malloc(LOG_BUF_SIZE);
+    if (!lg->buf_main || !lg->buf_detail ||
+        spsc_init(&lg->ring, LOG_RING_RECORDS, sizeof(struct log_record)) < 0) {
+        goto fail;
+    }
+    if (pthread_create(&lg->thread, NULL, log_thread_main, lg) != 0) {
+        spsc_free(&lg->ring);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    free(lg->buf_main);
+    free(lg->buf_detail);
+    lg->buf_main = lg->buf_detail = NULL;
+    return -1;
+}
+
+static inline void log_push(struct async_log *lg, const struct log_record *r) {
+    lg->records++;
+    while (spsc_push(&lg->ring, r) < 0) {
+        lg->stalls++;
+        usleep(100);
+    }
+}
+
+/*
+ * 패킷 결과 하나 기록 (측정 스레드에서 호출)
+ *   t는 time(NULL) 값 (문자열 변환은 기록 스레드가 함)
+ *   latency_ns는 통계용 왕복 지연 (0 = 모름)
+ *   링이 꽉 차면 기록 스레드가 비울 때까지 기다림
+ */
+static inline void log_packet(struct async_log *lg, time_t t, const char *status,
+                              const char *payload, double cable_length, int baudrate,
+                              int seq, size_t tx_len, size_t rx_len,
+                              uint64_t latency_ns, const struct echo_diff *diff) {
+    struct log_record r;
+    r.t = (int64_t)t;
+    r.cable_length = cable_length;
+    r.baudrate = baudrate;
+    r.seq = seq;
+    r.tx_len = (uint32_t)tx_len;
+    r.rx_len = (uint32_t)rx_len;
+    r.latency_ns = latency_ns;
+    r.diff = *diff;
+    r.result = strcmp(status, "OK") == 0 ? STATS_OK : STATS_ERR;
+    snprintf(r.status, sizeof(r.status), "%s", status);
+    snprintf(r.payload, sizeof(r.payload), "%s", payload);
+    log_push(lg, &r);
+}
+
+/* 응답 없음 (CSV에는 안 쓰고 통계에만) */
+static inline void log_timeout(struct async_log *lg, time_t t, double cable_length,
+                               int baudrate, int seq, size_t tx_len) {
+    struct log_record r;
+    memset(&r, 0, sizeof(r));
+    r.t = (int64_t)t;
+    r.cable_length = cable_length;
+    r.baudrate = baudrate;
+    r.seq = seq;
+    r.tx_len = (uint32_t)tx_len;
+    r.diff.first_err = r.diff.last_err = -1;
+    r.result = STATS_TIMEOUT;
+    snprintf(r.status, sizeof(r.status), "TIMEOUT");
+    log_push(lg, &r);
+}
+
+/*
+ * 남은 레코드를 모두 쓰고 기록 스레드 종료
+ */
+static inline void log_close(struct async_log *lg) {
+    if (!lg->buf_main) {
+        return;     // 열린 적 없음
+    }
+    atomic_store(&lg->stop, 1);
+    pthread_join(lg->thread, NULL);
+    spsc_free(&lg->ring);
+    free(lg->buf_main);
+    free(lg->buf_detail);
+    lg->buf_main = lg->buf_detail = NULL;
+}
+
+#endif /* UART_LOG_H */
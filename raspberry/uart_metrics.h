@@ -0,0 +1,512 @@
+/*
+ * ============================================================================
+ * 실시간 지표 엔드포인트 (OpenMetrics 텍스트, --metrics)
+ * ============================================================================
+ *
+ * 지금까지는 리그마다 stdout을 tail로 보면서 감시했음
+ *   → 리그가 여러 대면 감당이 안 되고, 출력 자체가 라즈베리파이의 CPU를 씀
+ *
+ * 이 모듈은 localhost TCP 포트나 유닉스 도메인 소켓에서
+ * 포트별(장치/케이블 길이/Baudrate) 카운터와 지연 분위수를 OpenMetrics 형식으로 내줌
+ *   curl http://127.0.0.1:9100/metrics
+ *   curl --unix-socket /tmp/uart.sock http://x/metrics
+ *   socat - UNIX-CONNECT:/tmp/uart.sock   (요청 없이 연결만 해도 본문을 보냄)
+ * Prometheus가 긁어 가거나 여러 리그를 스크립트 하나로 모아 볼 수 있음
+ *
+ * 측정 스레드는 절대 기다리지 않음:
+ *   측정 스레드 - 1초마다 (기존 [STAT] 출력 시점) 스냅샷을 자기 슬롯에 복사만 함
+ *                 슬롯마다 seqlock (쓰기 전후로 seq를 1씩 올림, 홀수 = 쓰는 중)
+ *   서버 스레드 - accept/요청 읽기/응답 쓰기를 전부 맡음
+ *                 seq가 짝수이고 복사 전후로 같을 때만 그 스냅샷을 사용 (아니면 다시)
+ *                 느린 클라이언트는 서버 스레드만 붙잡음
+ *
+ * 지표 (모두 device, length, baud 라벨):
+ *   uart_packets_sent_total / uart_packets_received_total
+ *   uart_packet_results_total{result="ok|err|timeout"}
+ *   uart_tx_bytes_total / uart_rx_bytes_total    회선 바이트 (헤더, 개행 포함)
+ *   uart_goodput_bytes_total                     OK 패킷의 페이로드 바이트
+ *   uart_bit_errors_total / uart_bits_checked_total
+ *   uart_packets_per_second, uart_tx_bytes_per_second, uart_goodput_bytes_per_second
+ *                                                직전 스냅샷과의 차이 (gauge)
+ *   uart_packet_error_ratio                      (ERR + TIMEOUT) / 판정 수, 시작부터
+ *   uart_rtt_seconds{quantile=...}               왕복 지연 요약 (0.5, 0.9, 0.99, 0.999)
+ *   uart_kernel_errors_total{kind=...}           TIOCGICOUNT: frame, overrun, parity,
+ *                                                brk, buf_overrun (pty 등 지원 안 하면 생략)
+ *   uart_snapshot_age_seconds                    마지막 스냅샷 이후 시간 (멈춤 감지용)
+ */
+#ifndef UART_METRICS_H
+#define UART_METRICS_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/serial.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "uart_clock.h"
+#include "uart_hist.h"
+
+#define METRICS_MAX_SLOTS   16          // 포트 수 (claud_ver의 MAX_PORTS와 같게)
+#define METRICS_BODY_MAX    (64 * 1024)
+#define METRICS_REQ_WAIT_MS 200         // 요청을 기다리는 시간 (없으면 본문만 보냄)
+
+static const double metrics_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+#define METRICS_N_QUANTILES 4
+
+/* 측정 스레드가 채우는 값 (한 포트, 한 시점) */
+struct metrics_snapshot {
+    char     device[128];
+    double   length;
+    int      baud;
+    uint64_t sent, received;            // received = 짝지어진 에코 (OK + ERR)
+    uint64_t ok, err, timeouts;
+    uint64_t tx_bytes, rx_bytes, goodput_bytes;
+    uint64_t bit_errors, bits_checked;
+    uint64_t rtt_count;
+    double   rtt_sum;                   // 초
+    double   rtt_q[METRICS_N_QUANTILES];// 초
+    int      have_icount;               // TIOCGICOUNT 성공 여부
+    struct serial_icounter_struct ic;
+
+    // metrics_publish()가 채움
+    uint64_t t_ns;
+    double   pkt_rate, tx_rate, goodput_rate;
+};
+
+struct metrics_slot {
+    atomic_uint seq;                    // 홀수 = 쓰는 중
+    atomic_int  used;
+    struct metrics_snapshot s;
+    // 쓰는 쪽 전용 (직전 값, 속도 계산)
+    uint64_t prev_t, prev_done, prev_tx, prev_goodput;
+};
+
+struct metrics_server {
+    int        listen_fd;
+    char       unix_path[108];          // 유닉스 소켓이면 닫을 때 지움
+    pthread_t  thread;
+    atomic_int stop;
+    atomic_uint_fast64_t scrapes;
+    struct metrics_slot slots[METRICS_MAX_SLOTS];
+    char       body[METRICS_BODY_MAX];  // 서버 스레드 전용
+};
+
+/* ---------------------------------------------------------------------------
+ * 측정 스레드 쪽
+ * ------------------------------------------------------------------------- */
+
+/* 지연 히스토그램(ns) → 요약 값 */
+static inline void metrics_fill_latency(struct metrics_snapshot *s, const struct hist *h) {
+    s->rtt_count = h->count;
+    s->rtt_sum = (double)h->sum / 1e9;
+    for (int i = 0; i < METRICS_N_QUANTILES; i++) {
+        s->rtt_q[i] = (double)hist_percentile(h, metrics_quantiles[i]) / 1e9;
+    }
+}
+
+/* 커널 UART 드라이버의 에러 카운터 (pty처럼 지원하지 않으면 have_icount = 0) */
+static inline void metrics_fill_icount(struct metrics_snapshot *s, int fd) {
+    s->have_icount = fd >= 0 && ioctl(fd, TIOCGICOUNT, &s->ic) == 0;
+}
+
+/*
+ * 슬롯 하나에 스냅샷 복사 (슬롯마다 쓰는 스레드는 하나)
+ * m이 NULL이면 (--metrics 없음) 아무것도 안 함
+ */
+static inline void metrics_publish(struct metrics_server *m, int slot,
+                                   struct metrics_snapshot *s, uint64_t now) {
+    if (!m || slot < 0 || slot >= METRICS_MAX_SLOTS) {
+        return;
+    }
+    struct metrics_slot *sl = &m->slots[slot];
+    uint64_t done = s->ok + s->err + s->timeouts;
+
+    s->t_ns = now;
+    s->pkt_rate = s->tx_rate = s->goodput_rate = 0.0;
+    if (sl->prev_t && now > sl->prev_t && done >= sl->prev_done) {
+        double dt = (double)(now - sl->prev_t) / 1e9;
+        s->pkt_rate = (double)(done - sl->prev_done) / dt;
+        s->tx_rate = (double)(s->tx_bytes - sl->prev_tx) / dt;
+        s->goodput_rate = (double)(s->goodput_bytes - sl->prev_goodput) / dt;
+    }
+    // 스윕처럼 포트를 새로 만들면 카운터가 0부터 다시 → 다음 속도는 다음 스냅샷부터
+    if (done < sl->prev_done) {
+        s->pkt_rate = s->tx_rate = s->goodput_rate = 0.0;
+    }
+    sl->prev_t = now;
+    sl->prev_done = done;
+    sl->prev_tx = s->tx_bytes;
+    sl->prev_goodput = s->goodput_bytes;
+
+    unsigned seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    atomic_store_explicit(&sl->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&sl->s, s, sizeof(*s));
+    atomic_store_explicit(&sl->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&sl->used, 1, memory_order_release);
+}
+
+/* ---------------------------------------------------------------------------
+ * 서버 스레드 쪽
+ * ------------------------------------------------------------------------- */
+
+/* 쓰는 중이 아닌 스냅샷을 복사 (계속 겹치면 포기, 측정 쪽은 기다리게 하지 않음) */
+static inline int metrics_read_slot(struct metrics_slot *sl, struct metrics_snapshot *out) {
+    if (!atomic_load_explicit(&sl->used, memory_order_acquire)) {
+        return -1;
+    }
+    for (int tries = 0; tries < 100; tries++) {
+        unsigned s1 = atomic_load_explicit(&sl->seq, memory_order_acquire);
+        if (s1 & 1) {
+            continue;
+        }
+        memcpy(out, &sl->s, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&sl->seq, memory_order_relaxed) == s1) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+struct metrics_buf {
+    char  *p;
+    size_t len, cap;
+};
+
+static inline void metrics_printf(struct metrics_buf *b, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static inline void metrics_printf(struct metrics_buf *b, const char *fmt, ...) {
+    if (b->len >= b->cap) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->p + b->len, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        b->len += (size_t)n < b->cap - b->len ? (size_t)n : b->cap - b->len - 1;
+    }
+}
+
+/* device="...",length="1.50",baud="115200" (라벨 값의 \, ", 개행은 이스케이프) */
+static inline void metrics_labels(const struct metrics_snapshot *s, char *out, size_t cap) {
+    char dev[2 * sizeof(s->device)];
+    size_t o = 0;
+    for (const char *c = s->device; *c && o + 2 < sizeof(dev); c++) {
+        if (*c == '\\' || *c == '"') {
+            dev[o++] = '\\';
+            dev[o++] = *c;
+        } else if (*c == '\n') {
+            dev[o++] = '\\';
+            dev[o++] = 'n';
+        } else {
+            dev[o++] = *c;
+        }
+    }
+    dev[o] = '\0';
+    snprintf(out, cap, "device=\"%s\",length=\"%.2f\",baud=\"%d\"", dev, s->length, s->baud);
+}
+
+enum metrics_field {
+    MF_SENT, MF_RECEIVED, MF_TX_BYTES, MF_RX_BYTES, MF_GOODPUT, MF_BIT_ERRORS, MF_BITS
+};
+
+static inline uint64_t metrics_counter(const struct metrics_snapshot *s, int f) {
+    switch (f) {
+    case MF_SENT:       return s->sent;
+    case MF_RECEIVED:   return s->received;
+    case MF_TX_BYTES:   return s->tx_bytes;
+    case MF_RX_BYTES:   return s->rx_bytes;
+    case MF_GOODPUT:    return s->goodput_bytes;
+    case MF_BIT_ERRORS: return s->bit_errors;
+    default:            return s->bits_checked;
+    }
+}
+
+/* 모든 슬롯의 스냅샷 → OpenMetrics 본문, 반환값: 길이 */
+static inline size_t metrics_render(struct metrics_server *m, uint64_t now) {
+    static const struct { const char *name, *help; int field; } counters[] = {
+        { "uart_packets_sent", "Packets written to the UART", MF_SENT },
+        { "uart_packets_received", "Echoes matched to a sent packet (OK or ERR)", MF_RECEIVED },
+        { "uart_tx_bytes", "Bytes written to the UART including framing", MF_TX_BYTES },
+        { "uart_rx_bytes", "Bytes read from the UART", MF_RX_BYTES },
+        { "uart_goodput_bytes", "Payload bytes of packets echoed intact", MF_GOODPUT },
+        { "uart_bit_errors", "Bit errors found in compared echoes", MF_BIT_ERRORS },
+        { "uart_bits_checked", "Bits compared in echoes", MF_BITS },
+    };
+    static const char *const ic_kinds[] = { "frame", "overrun", "parity", "brk", "buf_overrun" };
+
+    struct metrics_snapshot snaps[METRICS_MAX_SLOTS];
+    char labels[METRICS_MAX_SLOTS][320];
+    int n = 0;
+    for (int i = 0; i < METRICS_MAX_SLOTS; i++) {
+        if (metrics_read_slot(&m->slots[i], &snaps[n]) == 0) {
+            metrics_labels(&snaps[n], labels[n], sizeof(labels[n]));
+            n++;
+        }
+    }
+
+    struct metrics_buf b = { m->body, 0, sizeof(m->body) };
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+        metrics_printf(&b, "# TYPE %s counter\n# HELP %s %s.\n",
+                       counters[c].name, counters[c].name, counters[c].help);
+        for (int i = 0; i < n; i++) {
+            metrics_printf(&b, "%s_total{%s} %llu\n", counters[c].name, labels[i],
+                           (unsigned long long)metrics_counter(&snaps[i], counters[c].field));
+        }
+    }
+
+    metrics_printf(&b, "# TYPE uart_packet_results counter\n"
+                   "# HELP uart_packet_results Packet verdicts by result.\n");
+    for (int i = 0; i < n; i++) {
+        metrics_printf(&b, "uart_packet_results_total{%s,result=\"ok\"} %llu\n"
+                       "uart_packet_results_total{%s,result=\"err\"} %llu\n"
+                       "uart_packet_results_total{%s,result=\"timeout\"} %llu\n",
+                       labels[i], (unsigned long long)snaps[i].ok,
+                       labels[i], (unsigned long long)snaps[i].err,
+                       labels[i], (unsigned long long)snaps[i].timeouts);
+    }
+
+    metrics_printf(&b, "# TYPE uart_packets_per_second gauge\n"
+                   "# HELP uart_packets_per_second Verdicts per second over the last snapshot.\n");
+    for (int i = 0; i < n; i++) {
+        metrics_printf(&b, "uart_packets_per_second{%s} %.3f\n", labels[i], snaps[i].pkt_rate);
+    }
+    metrics_printf(&b, "# TYPE uart_tx_bytes_per_second gauge\n"
+                   "# HELP uart_tx_bytes_per_second Line bytes written per second.\n");
+    for (int i = 0; i < n; i++) {
+        metrics_printf(&b, "uart_tx_bytes_per_second{%s} %.3f\n", labels[i], snaps[i].tx_rate);
+    }
+    metrics_printf(&b, "# TYPE uart_goodput_bytes_per_second gauge\n"
+                   "# HELP uart_goodput_bytes_per_second Intact payload bytes per second.\n");
+    for (int i = 0; i < n; i++) {
+        metrics_printf(&b, "uart_goodput_bytes_per_second{%s} %.3f\n",
+                       labels[i], snaps[i].goodput_rate);
+    }
+    metrics_printf(&b, "# TYPE uart_packet_error_ratio gauge\n"
+                   "# HELP uart_packet_error_ratio (ERR + TIMEOUT) / verdicts since start.\n");
+    for (int i = 0; i < n; i++) {
+        uint64_t done = snaps[i].ok + snaps[i].err + snaps[i].timeouts;
+        metrics_printf(&b, "uart_packet_error_ratio{%s} %.6f\n", labels[i],
+                       done ? (double)(snaps[i].err + snaps[i].timeouts) / (double)done : 0.0);
+    }
+
+    metrics_printf(&b, "# TYPE uart_rtt_seconds summary\n# UNIT uart_rtt_seconds seconds\n"
+                   "# HELP uart_rtt_seconds Round trip from write() to the last echo byte.\n");
+    for (int i = 0; i < n; i++) {
+        for (int q = 0; q < METRICS_N_QUANTILES; q++) {
+            metrics_printf(&b, "uart_rtt_seconds{%s,quantile=\"%g\"} %.9f\n",
+                           labels[i], metrics_quantiles[q], snaps[i].rtt_q[q]);
+        }
+        metrics_printf(&b, "uart_rtt_seconds_sum{%s} %.9f\nuart_rtt_seconds_count{%s} %llu\n",
+                       labels[i], snaps[i].rtt_sum, labels[i],
+                       (unsigned long long)snaps[i].rtt_count);
+    }
+
+    metrics_printf(&b, "# TYPE uart_kernel_errors counter\n"
+                   "# HELP uart_kernel_errors UART driver error counters (TIOCGICOUNT).\n");
+    for (int i = 0; i < n; i++) {
+        if (!snaps[i].have_icount) {
+            continue;
+        }
+        const struct serial_icounter_struct *ic = &snaps[i].ic;
+        const int vals[] = { ic->frame, ic->overrun, ic->parity, ic->brk, ic->buf_overrun };
+        for (int k = 0; k < 5; k++) {
+            metrics_printf(&b, "uart_kernel_errors_total{%s,kind=\"%s\"} %d\n",
+                           labels[i], ic_kinds[k], vals[k]);
+        }
+    }
+
+    metrics_printf(&b, "# TYPE uart_snapshot_age_seconds gauge\n"
+                   "# HELP uart_snapshot_age_seconds Time since the measurement loop last published.\n");
+    for (int i = 0; i < n; i++) {
+        metrics_printf(&b, "uart_snapshot_age_seconds{%s} %.3f\n", labels[i],
+                       now > snaps[i].t_ns ? (double)(now - snaps[i].t_ns) / 1e9 : 0.0);
+    }
+    metrics_printf(&b, "# EOF\n");
+    return b.len;
+}
+
+static inline int metrics_send_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t k = send(fd, p, len, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) {
+            continue;
+        }
+        if (k <= 0) {
+            return -1;
+        }
+        p += k;
+        len -= (size_t)k;
+    }
+    return 0;
+}
+
+/*
+ * 클라이언트 하나 처리
+ *   HTTP 요청이 오면 HTTP 응답 (GET /metrics 또는 GET /, 나머지는 404)
+ *   METRICS_REQ_WAIT_MS 안에 아무것도 안 오면 본문만 보냄 (socat, nc 등)
+ */
+static inline void metrics_serve_client(struct metrics_server *m, int fd) {
+    char req[1024];
+    size_t got = 0;
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // 요청 줄과 헤더 끝(빈 줄)까지 또는 시간 초과까지
+    uint64_t deadline = mono_ns() + (uint64_t)METRICS_REQ_WAIT_MS * NS_PER_MS;
+    while (got < sizeof(req) - 1) {
+        uint64_t now = mono_ns();
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (now >= deadline ||
+            poll(&pfd, 1, (int)((deadline - now + NS_PER_MS - 1) / NS_PER_MS)) <= 0) {
+            break;
+        }
+        ssize_t k = recv(fd, req + got, sizeof(req) - 1 - got, 0);
+        if (k <= 0) {
+            break;
+        }
+        got += (size_t)k;
+        req[got] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) {
+            break;
+        }
+    }
+    req[got] = '\0';
+
+    size_t len = metrics_render(m, mono_ns());
+    atomic_fetch_add_explicit(&m->scrapes, 1, memory_order_relaxed);
+    if (got == 0) {
+        metrics_send_all(fd, m->body, len);
+        return;
+    }
+
+    char hdr[256];
+    if (strncmp(req, "GET /metrics", 12) == 0 || strncmp(req, "GET / ", 6) == 0) {
+        int h = snprintf(hdr, sizeof(hdr),
+                         "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                         "Content-Length: %zu\r\nConnection: close\r\n\r\n", len);
+        if (metrics_send_all(fd, hdr, (size_t)h) == 0) {
+            metrics_send_all(fd, m->body, len);
+        }
+    } else {
+        static const char not_found[] =
+            "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        metrics_send_all(fd, not_found, sizeof(not_found) - 1);
+    }
+}
+
+static inline void *metrics_thread_main(void *arg) {
+    struct metrics_server *m = arg;
+    while (!atomic_load(&m->stop)) {
+        struct pollfd pfd = { m->listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;       // 200ms마다 stop 확인
+        }
+        int fd = accept(m->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        metrics_serve_client(m, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+/*
+ * 엔드포인트 열기 + 서버 스레드 시작
+ *   spec: "9100" → 127.0.0.1:9100 (localhost만)
+ *         "unix:/tmp/uart.sock" 또는 "/tmp/uart.sock" → 유닉스 도메인 소켓
+ * 반환값: 성공 0, 실패 -1 (errno)
+ */
+static inline int metrics_open(struct metrics_server *m, const char *spec) {
+    memset(m, 0, sizeof(*m));
+    atomic_init(&m->stop, 0);
+    atomic_init(&m->scrapes, 0);
+    for (int i = 0; i < METRICS_MAX_SLOTS; i++) {
+        atomic_init(&m->slots[i].seq, 0);
+        atomic_init(&m->slots[i].used, 0);
+    }
+
+    const char *path = strncmp(spec, "unix:", 5) == 0 ? spec + 5 : spec[0] == '/' ? spec : NULL;
+    if (path) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(sa.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(sa.sun_path, path);
+        m->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(path);       // 지난 실행이 남긴 소켓 파일
+        if (m->listen_fd < 0 || bind(m->listen_fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+            goto fail;
+        }
+        snprintf(m->unix_path, sizeof(m->unix_path), "%s", path);
+    } else {
+        char *end;
+        long port = strtol(spec, &end, 10);
+        if (*end != '\0' || port <= 0 || port > 65535) {
+            errno = EINVAL;
+            return -1;
+        }
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((uint16_t)port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+        m->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m->listen_fd < 0) {
+            goto fail;
+        }
+        setsockopt(m->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(m->listen_fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+            goto fail;
+        }
+    }
+    if (listen(m->listen_fd, 8) < 0) {
+        goto fail;
+    }
+    if (pthread_create(&m->thread, NULL, metrics_thread_main, m) != 0) {
+        goto fail;
+    }
+    return 0;
+
+fail:;
+    int saved = errno;
+    if (m->listen_fd >= 0) {
+        close(m->listen_fd);
+    }
+    if (m->unix_path[0]) {
+        unlink(m->unix_path);
+    }
+    errno = saved;
+    return -1;
+}
+
+static inline void metrics_close(struct metrics_server *m) {
+    atomic_store(&m->stop, 1);
+    pthread_join(m->thread, NULL);
+    close(m->listen_fd);
+    if (m->unix_path[0]) {
+        unlink(m->unix_path);
+    }
+}
+
+#endif /* UART_METRICS_H */
@@ -0,0 +1,274 @@
+/*
+ * ============================================================================
+ * 페이로드 생성기 (시드 고정 PRNG + PRBS + 스트레스 패턴)
+ * ============================================================================
+ *
+ * 기존 generate_random_packet():
+ *   rand() % 62 → 느리고 (전역 락), 62로 나눈 나머지라 앞쪽 문자가 조금 더 자주 나옴
+ *   srand(time(NULL)) → 같은 패킷을 다시 만들 수 없음
+ *   영숫자만 → UART를 괴롭히는 비트 패턴(긴 0/1 연속, 0x55/0xAA, 최상위 비트)이 안 나감
+ *
+ * 이 모듈은 패킷 하나를 (seed, stream, index)만으로 만듦
+ *   seed   - 실행마다 하나 (--seed, 안 주면 시각으로 정하고 출력)
+ *   stream - 포트 번호 (멀티 포트에서 포트끼리 같은 패킷을 보내지 않도록)
+ *   index  - 그 포트에서 몇 번째 패킷인지 (0부터)
+ *   → 로그에 페이로드를 남기지 않아도 같은 바이트를 다시 만들 수 있음
+ *
+ * 패턴 (--pattern):
+ *   random     영숫자 62자 균등 (기본, 기존 CSV와 같은 모양)
+ *   bytes      0x00~0xFF 균등
+ *   prbs7 / prbs15 / prbs23 / prbs31
+ *              ITU-T O.150 다항식 x^7+x^6+1, x^15+x^14+1, x^23+x^18+1, x^31+x^28+1
+ *              패킷마다 (seed, stream, index)로 정한 위치에서 시작하는 구간
+ *   walk1      0x01, 0x02, 0x04 ... 0x80 반복 (1비트 하나가 이동)
+ *   walk0      0xFE, 0xFD ... 0x7F 반복
+ *   fixed:HEX  주어진 바이트 반복 (fixed:55AA, fixed:00, fixed:FF ...)
+ *
+ * random 말고는 개행/0x00/제어 문자가 섞이므로 --binary(COBS 프레임)가 필요함
+ * (payload_text_safe()로 확인)
+ *
+ * 난수: SplitMix64로 (seed, stream, index)를 섞어 xoshiro256**의 상태를 만듦
+ *   xoshiro256**: 64비트 출력, 주기 2^256-1, 곱셈 한 번 + 시프트 몇 번
+ *   영숫자는 곱셈-시프트로 범위를 줄이고 남는 쪽을 버려서 정확히 균등
+ */
+#ifndef UART_PAYLOAD_H
+#define UART_PAYLOAD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAYLOAD_FIXED_MAX 32
+
+enum payload_kind {
+    PL_RANDOM,
+    PL_BYTES,
+    PL_PRBS7,
+    PL_PRBS15,
+    PL_PRBS23,
+    PL_PRBS31,
+    PL_WALK1,
+    PL_WALK0,
+    PL_FIXED
+};
+
+struct payload_gen {
+    enum payload_kind kind;
+    uint64_t seed;
+    uint8_t  fixed[PAYLOAD_FIXED_MAX];
+    int      fixed_len;
+    char     spec[8 + 2 * PAYLOAD_FIXED_MAX];  // --pattern 문자열 (캡처 RUN 기록용)
+};
+
+static const char payload_charset[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789";
+
+static inline uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct xoshiro256 {
+    uint64_t s[4];
+};
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t xoshiro_next(struct xoshiro256 *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+/* (seed, stream, index) → 그 패킷 전용 난수 상태 */
+static inline void payload_rng(const struct payload_gen *g, uint64_t stream, uint64_t index,
+                               struct xoshiro256 *r) {
+    uint64_t x = g->seed;
+    x ^= splitmix64(&x) ^ stream * 0xD1B54A32D192ED03ULL;
+    x ^= index * 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < 4; i++) {
+        r->s[i] = splitmix64(&x);
+    }
+}
+
+/* PRBS 다항식 x^n + x^m + 1 */
+static inline void payload_prbs_poly(enum payload_kind k, int *n, int *m) {
+    switch (k) {
+    case PL_PRBS7:  *n = 7;  *m = 6;  break;
+    case PL_PRBS15: *n = 15; *m = 14; break;
+    case PL_PRBS23: *n = 23; *m = 18; break;
+    default:        *n = 31; *m = 28; break;
+    }
+}
+
+/*
+ * 패킷 하나 생성 (out에 len바이트, 문자열 종료 문자는 안 붙임)
+ */
+static inline void payload_make(const struct payload_gen *g, uint64_t stream, uint64_t index,
+                                uint8_t *out, int len) {
+    struct xoshiro256 r;
+
+    switch (g->kind) {
+    case PL_RANDOM:
+        payload_rng(g, stream, index, &r);
+        for (int i = 0; i < len;) {
+            uint64_t v = xoshiro_next(&r);
+            // 32비트씩 두 번: (x * 62) >> 32가 0~61, 하위 32비트가 62로 안 나눠떨어지는
+            // 몫(2^32 mod 62 = 4)보다 작으면 버림 → 정확히 균등
+            for (int h = 0; h < 2 && i < len; h++, v >>= 32) {
+                uint64_t m = (v & 0xFFFFFFFFULL) * 62;
+                if ((uint32_t)m < 4) {
+                    continue;
+                }
+                out[i++] = (uint8_t)payload_charset[m >> 32];
+            }
+        }
+        break;
+
+    case PL_BYTES:
+        payload_rng(g, stream, index, &r);
+        for (int i = 0; i < len; i += 8) {
+            uint64_t v = xoshiro_next(&r);
+            int n = len - i < 8 ? len - i : 8;
+            memcpy(out + i, &v, (size_t)n);
+        }
+        break;
+
+    case PL_PRBS7:
+    case PL_PRBS15:
+    case PL_PRBS23:
+    case PL_PRBS31: {
+        int n, m;
+        payload_prbs_poly(g->kind, &n, &m);
+        uint32_t mask = (1u << n) - 1;
+        payload_rng(g, stream, index, &r);
+        uint32_t s = (uint32_t)xoshiro_next(&r) & mask;
+        if (s == 0) {
+            s = 1;      // 0 상태는 영원히 0만 나옴
+        }
+        // 피보나치 LFSR: 새 비트 = b[n] ^ b[m], 바이트는 먼저 나온 비트가 최상위
+        for (int i = 0; i < len; i++) {
+            uint8_t byte = 0;
+            for (int b = 0; b < 8; b++) {
+                uint32_t bit = ((s >> (n - 1)) ^ (s >> (m - 1))) & 1u;
+                s = ((s << 1) | bit) & mask;
+                byte = (uint8_t)((byte << 1) | bit);
+            }
+            out[i] = byte;
+        }
+        break;
+    }
+
+    case PL_WALK1:
+    case PL_WALK0:
+        // 패킷이 바뀌어도 이어지도록 전체 바이트 위치 기준
+        for (int i = 0; i < len; i++) {
+            uint8_t b = (uint8_t)(1u << ((index * (uint64_t)len + (uint64_t)i) & 7));
+            out[i] = g->kind == PL_WALK1 ? b : (uint8_t)~b;
+        }
+        break;
+
+    case PL_FIXED:
+        for (int i = 0; i < len; i++) {
+            out[i] = g->fixed[i % g->fixed_len];
+        }
+        break;
+    }
+}
+
+static inline int payload_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/*
+ * "--pattern" 문자열 해석 (seed는 따로 설정)
+ * 반환값: 성공 0, 형식 오류 -1
+ */
+static inline int payload_parse(const char *spec, struct payload_gen *g) {
+    static const struct { const char *name; enum payload_kind kind; } names[] = {
+        { "random", PL_RANDOM }, { "bytes", PL_BYTES },
+        { "prbs7", PL_PRBS7 }, { "prbs15", PL_PRBS15 },
+        { "prbs23", PL_PRBS23 }, { "prbs31", PL_PRBS31 },
+        { "walk1", PL_WALK1 }, { "walk0", PL_WALK0 }
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(spec, names[i].name) == 0) {
+            g->kind = names[i].kind;
+            snprintf(g->spec, sizeof(g->spec), "%s", spec);
+            return 0;
+        }
+    }
+    if (strncmp(spec, "fixed:", 6) != 0) {
+        return -1;
+    }
+    const char *hex = spec + 6;
+    size_t n = strlen(hex);
+    if (n == 0 || n % 2 != 0 || n / 2 > PAYLOAD_FIXED_MAX) {
+        return -1;
+    }
+    for (size_t i = 0; i < n / 2; i++) {
+        int hi = payload_hex_digit(hex[2 * i]), lo = payload_hex_digit(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        g->fixed[i] = (uint8_t)(hi << 4 | lo);
+    }
+    g->fixed_len = (int)(n / 2);
+    g->kind = PL_FIXED;
+    snprintf(g->spec, sizeof(g->spec), "%s", spec);
+    return 0;
+}
+
+/*
+ * 텍스트 모드("SSSS:PAYLOAD\n")로 보낼 수 있는 패턴인지
+ *   개행, 0x00 (strlen), 앞뒤 공백 (에코 쪽 trim), 최상위 비트가 없어야 함
+ *   텍스트 패턴은 uart_dataset.csv의 sent 열에 그대로 남으므로 ','와 '"'도 안 됨
+ *   (열이 늘어나거나 따옴표로 읽혀서 AI.py/uart_agg가 그 줄을 못 읽음)
+ */
+static inline int payload_text_safe(const struct payload_gen *g) {
+    if (g->kind == PL_RANDOM) {
+        return 1;
+    }
+    if (g->kind != PL_FIXED) {
+        return 0;
+    }
+    for (int i = 0; i < g->fixed_len; i++) {
+        if (g->fixed[i] <= 0x20 || g->fixed[i] >= 0x7F ||
+            g->fixed[i] == ',' || g->fixed[i] == '"') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * CSV에 남길 수 있도록 16진수 문자열로 (out은 2*len+1 이상)
+ *   텍스트가 아닌 패턴의 sent/recv 열에 사용
+ */
+static inline void payload_hex(const uint8_t *data, int len, char *out) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (int i = 0; i < len; i++) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 15];
+    }
+    out[2 * len] = '\0';
+}
+
+#endif /* UART_PAYLOAD_H */
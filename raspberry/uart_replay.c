@@ -0,0 +1,490 @@
+/*
+ * ============================================================================
+ * 캡처 파일 재생기 (uart_replay)
+ * ============================================================================
+ *
+ * claud_ver --capture FILE 로 남긴 송수신 바이트를
+ * 측정 때와 같은 프레이머(uart_rx.h), 짝짓기 엔진(uart_window.h),
+ * 비교기(uart_compare.h), 지연 히스토그램(uart_hist.h)에 그대로 다시 넣음
+ *
+ * 하드웨어도 sleep도 없으므로 메모리 속도로 돎:
+ *   - 판정 규칙이나 비교기를 고친 뒤 지난 몇 주 분량의 캡처를 몇 초 만에 재분류
+ *   - --timeout으로 타임아웃 한도를 바꿨을 때 결과가 어떻게 달라지는지 확인
+ *   - 실제 잡음이 섞인 입력으로 수신 경로 벤치마크 (--repeat)
+ *
+ * 시각은 캡처된 도착 시각을 그대로 씀
+ *   → 타임아웃/지연 판정은 측정 당시와 같은 기준 (해상도는 read() 한 번 단위)
+ *
+ * 사용법:
+ *   ./uart_replay [--timeout MS] [--errors] [--repeat N] FILE...
+ *
+ * 빌드:
+ *   gcc -O2 -Wall -o uart_replay uart_replay.c
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "uart_clock.h"
+#include "uart_window.h"
+#include "uart_rx.h"
+#include "uart_compare.h"
+#include "uart_hist.h"
+#include "uart_capture.h"
+
+/* 재생에서는 송신 쪽 크레딧 제한이 없으므로 윈도우를 넉넉하게 */
+#define REPLAY_WINDOW 1024
+#define REPLAY_PORTS  256       // 레코드의 port는 1바이트
+
+struct replay_opts {
+    uint64_t timeout_ns;        // 0이면 캡처에 기록된 값
+    int      show_errors;
+    int      quiet;             // 결과 출력 안 함 (--repeat의 앞쪽 반복)
+};
+
+/* 캡처 안의 측정 하나 (CAP_RUN부터 같은 포트의 다음 CAP_RUN 또는 파일 끝까지) */
+struct replay_run {
+    const struct replay_opts *opts;
+    char     path[128];
+    double   cable_length;
+    int      baudrate;
+    int      binary;
+    int      split;             // 방향 분리 모드 (--split): 비교 대상은 펌웨어가 만든 페이로드
+    uint64_t timeout_ns;
+    uint64_t wall_start;        // 측정 시작 벽시계 (ns, 0 = 모름)
+    uint64_t t_start, t_end;
+
+    struct echo_window win;
+    struct uart_rx     tx;      // 보낸 바이트 → 패킷으로 다시 자름
+    struct uart_rx     rx;      // 받은 바이트 → 에코로 자름
+    uint64_t tx_bytes, rx_bytes;
+    uint64_t tx_unmatched;      // 보낸 번호가 윈도우 번호와 안 맞음 (캡처 중간부터 등)
+    uint64_t bit_errors, bits_checked;
+    struct hist lat_first, lat_last;
+};
+
+/* 모든 파일의 합계 */
+struct replay_total {
+    uint64_t records, bytes, runs;
+    uint64_t ok, err, timeouts;
+};
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 판정 결과 (claud_ver의 port_on_result와 같은 계산)
+ * ----------------------------------------------------------------------------
+ */
+static void replay_on_result(void *ctx, const struct inflight *pkt,
+                             enum echo_result r,
+                             const char *rx, int rx_len, uint64_t now) {
+    struct replay_run *run = ctx;
+    (void)now;
+    if (r == ECHO_TIMEOUT) {
+        return;
+    }
+
+    uint64_t t_first = run->win.echo_first, t_last = run->win.echo_last;
+    if (pkt->t_write && t_last >= pkt->t_write) {
+        if (t_first >= pkt->t_write) {
+            hist_record(&run->lat_first, t_first - pkt->t_write);
+        }
+        hist_record(&run->lat_last, t_last - pkt->t_write);
+    }
+
+    struct echo_diff d;
+    if (r == ECHO_ERR && !run->win.echo_raw) {
+        char expect[WIN_MAX_PAYLOAD];
+        echo_compare(window_expect(&run->win, pkt, expect), pkt->len, rx, rx_len, &d);
+    } else {
+        memset(&d, 0, sizeof(d));
+        d.compared = r == ECHO_OK ? pkt->len : 0;
+    }
+    run->bit_errors += d.bit_errors;
+    run->bits_checked += (uint64_t)d.compared * 8;
+
+    if (r != ECHO_ERR || !run->opts->show_errors || run->opts->quiet) {
+        return;
+    }
+    printf("[ERR] %s seq=%04X t=%.6fs bits=%u edit=%u SENT=%s RECV=",
+           run->path, pkt->seq, (double)(pkt->t_write - run->t_start) / NS_PER_SEC,
+           d.bit_errors, d.edit_distance, pkt->payload);
+    if (!run->binary) {
+        printf("%.*s\n", rx_len, rx);
+        return;
+    }
+    // 바이너리 모드의 수신 데이터는 제어 문자가 섞일 수 있으므로 16진수로
+    for (int i = 0; i < rx_len; i++) {
+        printf("%02X", (unsigned char)rx[i]);
+    }
+    printf("\n");
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 측정 하나의 시작/끝
+ * ----------------------------------------------------------------------------
+ */
+
+/* "key=value ..." 설정 텍스트에서 값 하나 */
+static const char *run_field(const char *desc, const char *key, char *out, size_t cap) {
+    size_t klen = strlen(key);
+    for (const char *p = desc; (p = strstr(p, key)) != NULL; p += klen) {
+        if ((p == desc || p[-1] == ' ') && p[klen] == '=') {
+            p += klen + 1;
+            size_t n = strcspn(p, " ");
+            if (n >= cap) {
+                n = cap - 1;
+            }
+            memcpy(out, p, n);
+            out[n] = '\0';
+            return out;
+        }
+    }
+    return NULL;
+}
+
+static int run_begin(struct replay_run *run, const struct replay_opts *opts,
+                     const char *desc, size_t len, uint64_t t, uint64_t wall) {
+    char text[256], v[128];
+    snprintf(text, sizeof(text), "%.*s", (int)len, desc);
+
+    memset(run, 0, sizeof(*run));
+    run->opts = opts;
+    snprintf(run->path, sizeof(run->path), "%s",
+             run_field(text, "path", v, sizeof(v)) ? v : "?");
+    run->cable_length = run_field(text, "cable", v, sizeof(v)) ? atof(v) : 0.0;
+    run->baudrate = run_field(text, "baud", v, sizeof(v)) ? atoi(v) : 0;
+    run->binary = run_field(text, "binary", v, sizeof(v)) ? atoi(v) : 0;
+    run->split = run_field(text, "split", v, sizeof(v)) ? atoi(v) : 0;
+    run->timeout_ns = opts->timeout_ns ? opts->timeout_ns
+                    : (uint64_t)(run_field(text, "timeout_ms", v, sizeof(v)) ? atoi(v) : 200)
+                      * NS_PER_MS;
+    // 윈도우의 페이로드 풀은 측정 때의 길이만큼 (len이 없거나 이상하면 최대)
+    int max_len = run_field(text, "len", v, sizeof(v)) ? atoi(v) : 0;
+    if (max_len < 1 || max_len > WIN_MAX_PAYLOAD) {
+        max_len = WIN_MAX_PAYLOAD;
+    }
+    run->t_start = run->t_end = t;
+    run->wall_start = wall;
+
+    hist_reset(&run->lat_first);
+    hist_reset(&run->lat_last);
+    uart_rx_init(&run->tx, -1);
+    uart_rx_init(&run->rx, -1);
+    if (window_init(&run->win, REPLAY_WINDOW, max_len, run->timeout_ns,
+                    replay_on_result, run) < 0) {
+        return -1;
+    }
+    run->win.split = run->split;
+    return 0;
+}
+
+static void print_hist(const char *path, const char *name, const struct hist *h) {
+    if (h->count == 0) {
+        return;
+    }
+    printf("[REPLAY] %s latency %-5s n=%llu p50=%.1f p99=%.1f p99.9=%.1f max=%.1f us\n",
+           path, name, (unsigned long long)h->count,
+           hist_percentile(h, 0.50) / 1e3, hist_percentile(h, 0.99) / 1e3,
+           hist_percentile(h, 0.999) / 1e3, h->max / 1e3);
+}
+
+/* 남은 패킷을 타임아웃으로 정리하고 요약 출력 */
+static void run_end(struct replay_run *run, struct replay_total *total) {
+    window_expire(&run->win, UINT64_MAX);
+    const struct echo_window *w = &run->win;
+    total->runs++;
+    total->ok += w->ok;
+    total->err += w->err;
+    total->timeouts += w->timeouts;
+    if (run->opts->quiet) {
+        window_free(&run->win);
+        return;
+    }
+    double secs = (double)(run->t_end - run->t_start) / NS_PER_SEC;
+
+    char started[32] = "?";
+    if (run->wall_start) {
+        time_t ts = (time_t)(run->wall_start / NS_PER_SEC);
+        struct tm tm;
+        strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S", localtime_r(&ts, &tm));
+    }
+
+    printf("[REPLAY] %s %.2fm %d %s | %s, %.1fs sent=%llu OK=%llu ERR=%llu TIMEOUT=%llu\n",
+           run->path, run->cable_length, run->baudrate, run->binary ? "binary" : "text",
+           started, secs,
+           (unsigned long long)w->sent, (unsigned long long)w->ok,
+           (unsigned long long)w->err, (unsigned long long)w->timeouts);
+    if (run->bits_checked > 0) {
+        printf("[REPLAY] %s bit errors: %llu / %llu bits (BER %.3e)\n",
+               run->path, (unsigned long long)run->bit_errors,
+               (unsigned long long)run->bits_checked,
+               (double)run->bit_errors / run->bits_checked);
+    }
+    if (w->split) {
+        printf("[REPLAY] %s uplink %llu / %llu bad, downlink %llu / %llu bad\n",
+               run->path, (unsigned long long)w->up_err,
+               (unsigned long long)(w->up_ok + w->up_err),
+               (unsigned long long)w->down_err,
+               (unsigned long long)(w->down_ok + w->down_err));
+    }
+    if (w->stale > 0 || w->bad_frames > 0 || run->tx_unmatched > 0) {
+        printf("[REPLAY] %s stale echoes: %llu, bad frames: %llu (%llu misaligned, "
+               "not in BER), unmatched TX: %llu\n",
+               run->path, (unsigned long long)w->stale,
+               (unsigned long long)w->bad_frames, (unsigned long long)w->raw_echoes,
+               (unsigned long long)run->tx_unmatched);
+    }
+    print_hist(run->path, "first", &run->lat_first);
+    print_hist(run->path, "last", &run->lat_last);
+    window_free(&run->win);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 바이트 덩어리 처리
+ * ----------------------------------------------------------------------------
+ */
+
+/* 보낸 패킷 하나를 윈도우에 등록 (측정 때 window_push()와 같은 순서) */
+static void run_push(struct replay_run *run, int seq, const char *payload, int len,
+                     uint64_t t) {
+    struct echo_window *w = &run->win;
+    if (seq >= 0 && (uint16_t)seq != w->next_seq) {
+        if (w->outstanding == 0) {
+            // 캡처가 측정 중간부터 시작됐거나 앞의 패킷이 잘림 → 번호를 맞춤
+            w->next_seq = w->oldest = (uint16_t)seq;
+        } else {
+            run->tx_unmatched++;
+        }
+    }
+    struct inflight *p = window_push(w, payload, len, t);
+    if (p) {
+        p->t_write = t;
+    } else {
+        run->tx_unmatched++;
+    }
+}
+
+static void run_tx_packets(struct replay_run *run, uint64_t t) {
+    if (run->binary) {
+        unsigned char frame[WIN_MAX_WIRE];
+        uint8_t raw[WIN_MAX_WIRE];
+        int len;
+        while ((len = uart_rx_next_frame(&run->tx, frame, sizeof(frame), NULL)) >= 0) {
+            int n = cobs_decode(frame, len, raw);
+            uint8_t type;
+            uint16_t seq, plen;
+            const uint8_t *payload;
+            if (n < 0 || frame_parse(raw, n, &type, &seq, &payload, &plen) < 0 ||
+                type != FRAME_TYPE_DATA || plen > WIN_MAX_PAYLOAD) {
+                continue;   // CTRL 프레임 (모드 전환 명령)
+            }
+            run_push(run, seq, (const char *)payload, plen, t);
+        }
+        return;
+    }
+
+    char line[WIN_MAX_LINE + 64];
+    int len;
+    while ((len = uart_rx_next_line(&run->tx, line, sizeof(line))) >= 0) {
+        if (len == 0 || line[0] == '!') {
+            continue;       // 제어 명령
+        }
+        int seq = window_parse_seq(line, len);
+        if (seq < 0 || len - WIN_HDR_LEN > WIN_MAX_PAYLOAD) {
+            continue;
+        }
+        run_push(run, seq, line + WIN_HDR_LEN, len - WIN_HDR_LEN, t);
+    }
+}
+
+static void run_rx_echoes(struct replay_run *run, uint64_t t) {
+    struct echo_window *w = &run->win;
+    if (run->binary) {
+        unsigned char frame[WIN_MAX_WIRE];
+        int len;
+        while ((len = uart_rx_next_frame(&run->rx, frame, sizeof(frame),
+                                         &w->bad_frames)) >= 0) {
+            w->echo_first = run->rx.t_first;
+            w->echo_last = run->rx.t_last;
+            window_on_frame(w, frame, len, t);
+        }
+        return;
+    }
+
+    char line[WIN_MAX_LINE + 64];
+    int len;
+    while ((len = uart_rx_next_line(&run->rx, line, sizeof(line))) >= 0) {
+        w->echo_first = run->rx.t_first;
+        w->echo_last = run->rx.t_last;
+        window_on_line(w, line, len, t);
+    }
+}
+
+/*
+ * 덩어리를 링에 넣고 완성된 패킷/에코를 처리
+ * 링보다 큰 덩어리는 나눠서 (처리하면서 링이 비워짐)
+ */
+static void run_feed(struct replay_run *run, struct uart_rx *ring, int is_tx,
+                     const uint8_t *data, size_t len, uint64_t t) {
+    while (len > 0) {
+        size_t n = uart_rx_feed(ring, data, len);
+        uart_rx_mark(ring, t);
+        if (is_tx) {
+            run_tx_packets(run, t);
+        } else {
+            run_rx_echoes(run, t);
+        }
+        if (n == 0) {
+            uart_rx_flush(ring);    // 개행/구분자 없는 쓰레기로 꽉 참
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 파일 하나 재생
+ * ----------------------------------------------------------------------------
+ */
+static int replay_file(const char *path, const struct replay_opts *opts,
+                       struct replay_run **runs, struct replay_total *total) {
+    struct cap_reader r;
+    if (cap_reader_open(&r, path) < 0) {
+        perror(path);
+        return -1;
+    }
+
+    struct cap_rec rec;
+    int rc;
+    while ((rc = cap_next(&r, &rec)) > 0) {
+        total->records++;
+        total->bytes += rec.len;
+
+        struct replay_run *run = runs[rec.port];
+        switch (rec.kind) {
+        case CAP_RUN:
+            if (run) {
+                run_end(run, total);
+            } else if (!(run = runs[rec.port] = malloc(sizeof(*run)))) {
+                perror("alloc");
+                cap_reader_close(&r);
+                return -1;
+            }
+            if (run_begin(run, opts, (const char *)rec.data, rec.len, rec.t,
+                          r.wall_ns ? r.wall_ns + (rec.t - r.wall_mono) : 0) < 0) {
+                perror("alloc");
+                free(run);
+                runs[rec.port] = NULL;
+                cap_reader_close(&r);
+                return -1;
+            }
+            break;
+
+        case CAP_TX:
+        case CAP_RX:
+            if (!run) {
+                break;      // CAP_RUN 전의 바이트 (해석할 설정이 없음)
+            }
+            // 측정 때와 같이: 시간이 흐른 만큼 타임아웃 먼저 정리
+            window_expire(&run->win, rec.t);
+            run->t_end = rec.t;
+            if (rec.kind == CAP_TX) {
+                run->tx_bytes += rec.len;
+                run_feed(run, &run->tx, 1, rec.data, rec.len, rec.t);
+            } else {
+                run->rx_bytes += rec.len;
+                run_feed(run, &run->rx, 0, rec.data, rec.len, rec.t);
+            }
+            break;
+
+        default:
+            break;          // CAP_CLOCK (시각은 cap_next가 처리), 모르는 종류
+        }
+    }
+    if (rc < 0) {
+        fprintf(stderr, "%s: truncated last record (capture was interrupted)\n", path);
+    }
+
+    // 다음 파일은 다른 실행이므로 여기서 모두 마무리
+    for (int i = 0; i < REPLAY_PORTS; i++) {
+        if (runs[i]) {
+            run_end(runs[i], total);
+            free(runs[i]);
+            runs[i] = NULL;
+        }
+    }
+    cap_reader_close(&r);
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] CAPTURE...\n", prog);
+    printf("Re-run captured TX/RX bytes (claud_ver --capture) through the echo engine.\n");
+    printf("\nOptions:\n");
+    printf("  --timeout MS   re-classify with a different echo timeout\n");
+    printf("  --errors       print every ERR packet with the received bytes\n");
+    printf("  --repeat N     replay N times (benchmark; only the last pass prints)\n");
+}
+
+int main(int argc, char *argv[]) {
+    struct replay_opts opts = { 0, 0, 0 };
+    int repeat = 1;
+
+    static const struct option long_opts[] = {
+        { "timeout", required_argument, NULL, 't' },
+        { "errors",  no_argument,       NULL, 'e' },
+        { "repeat",  required_argument, NULL, 'r' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:er:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 't': opts.timeout_ns = (uint64_t)atoi(optarg) * NS_PER_MS; break;
+        case 'e': opts.show_errors = 1; break;
+        case 'r': repeat = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    static struct replay_run *runs[REPLAY_PORTS];
+    struct replay_total total;
+    uint64_t t0 = mono_ns();
+    int rc = 0;
+
+    for (int pass = 0; pass < repeat; pass++) {
+        // 벤치마크 반복 중에는 마지막 한 번만 결과 출력
+        opts.quiet = pass + 1 < repeat;
+        memset(&total, 0, sizeof(total));
+        for (int i = optind; i < argc; i++) {
+            if (replay_file(argv[i], &opts, runs, &total) < 0) {
+                rc = -1;
+            }
+        }
+    }
+
+    double secs = (double)(mono_ns() - t0) / NS_PER_SEC;
+    printf("[REPLAY] %llu runs | OK=%llu ERR=%llu TIMEOUT=%llu\n",
+           (unsigned long long)total.runs, (unsigned long long)total.ok,
+           (unsigned long long)total.err, (unsigned long long)total.timeouts);
+    printf("[REPLAY] %llu records, %.1f MB x %d in %.3f s (%.1f MB/s, %.0f records/s)\n",
+           (unsigned long long)total.records, total.bytes / 1e6, repeat, secs,
+           secs > 0 ? total.bytes * (double)repeat / 1e6 / secs : 0.0,
+           secs > 0 ? total.records * (double)repeat / secs : 0.0);
+    return rc;
+}
@@ -0,0 +1,434 @@
+/*
+ * ============================================================================
+ * 수신 링 버퍼 + 줄 단위 프레이머
+ * ============================================================================
+ *
+ * 기존 read_line()의 문제:
+ *   - read(fd, &c, 1): 1바이트마다 시스템 콜 1번
+ *     921600 bps면 초당 9만 번 이상의 시스템 콜
+ *   - 데이터가 없으면 usleep(1000)
+ *     → 지연 측정값이 전부 1ms 단위로 뭉개짐
+ *   - 타임아웃이 "1ms × 200회" 카운터
+ *     → 부하가 걸리면 usleep이 길어져서 실제 타임아웃이 늘어남
+ *
+ * 이 모듈:
+ *   - read() 한 번에 커널 버퍼에 있는 만큼 전부 링 버퍼로 가져옴
+ *   - memchr()로 개행 위치를 찾음 (libc가 SIMD로 구현해서 매우 빠름)
+ *     바이너리 모드에서는 개행 대신 0x00 (COBS 프레임 구분자)
+ *   - 기다릴 때는 poll()로 "데이터가 오는 순간" 깨어남
+ *     타임아웃은 CLOCK_MONOTONIC 기준의 절대 마감 시각(deadline)
+ *   - 개행 뒤에 같이 들어온 바이트(다음 줄의 앞부분)는 링에 남겨둠
+ *     → 다음 호출에서 그대로 사용 (데이터 손실 없음)
+ *
+ * 링 버퍼:
+ *   head, tail은 계속 증가만 하는 누적 카운터
+ *   실제 위치는 (카운터 & (RX_RING_SIZE-1))
+ *   head - tail = 현재 쌓여 있는 바이트 수
+ *
+ *      tail                head
+ *       ↓                   ↓
+ *   [...|AB12:xyz\n0A13:q|.........]
+ *        └─ 꺼낼 데이터 ─┘
+ *
+ * 도착 시각:
+ *   read()가 데이터를 가져올 때마다 (링 위치, CLOCK_MONOTONIC_RAW 시각)을 기록
+ *   줄/프레임을 꺼낼 때 첫 바이트와 마지막 바이트가 들어온 read()의 시각을
+ *   t_first, t_last에 남김 → 왕복 지연 측정용 (해상도는 read() 한 번 단위)
+ */
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "uart_clock.h"
+
+/*
+ * 링 크기 (2의 거듭제곱이어야 함)
+ * 가장 긴 에코(WIN_MAX_PAYLOAD = 4KB의 프레임)가 여러 개 쌓여도 read()가 막히지 않도록
+ */
+#define RX_RING_SIZE 16384
+
+/* 도착 시각 기록 개수 (넘치면 가장 오래된 것부터 버림) */
+#define RX_MARKS 64
+
+struct rx_mark {
+    size_t   end;               // 이 read()로 채워진 구간의 끝 (누적 위치)
+    uint64_t t;                 // 그 read()가 끝난 시각 (CLOCK_MONOTONIC_RAW)
+};
+
+/*
+ * read()로 받은 덩어리를 그대로 넘겨받는 콜백 (캡처용, NULL이면 안 부름)
+ *   data는 링 안을 가리키므로 콜백 안에서만 유효
+ */
+typedef void (*uart_rx_tap_fn)(void *ctx, const unsigned char *data, size_t len,
+                               uint64_t t);
+
+struct uart_rx {
+    int           fd;
+    size_t        head;         // 다음에 쓸 위치 (누적)
+    size_t        tail;         // 다음에 꺼낼 위치 (누적)
+    uint64_t      reads;        // read() 호출 횟수 (데이터가 있었던 것만)
+    uint64_t      bytes;        // 받은 총 바이트 수
+    int           discarding;   // 너무 긴 프레임을 다음 0x00까지 버리는 중
+    uint64_t      t_first;      // 마지막으로 꺼낸 줄/프레임의 첫 바이트 도착 시각
+    uint64_t      t_last;       //                         마지막 바이트 도착 시각
+    unsigned      mark_head, mark_tail;
+    struct rx_mark marks[RX_MARKS];
+    uart_rx_tap_fn tap;
+    void          *tap_ctx;
+    unsigned char buf[RX_RING_SIZE];
+};
+
+/*
+ * 초기화
+ *   fd를 O_NONBLOCK으로 바꿈: VMIN=0, VTIME=10 설정 그대로 두면
+ *   데이터가 없을 때 read()가 최대 1초 블록되어 poll() 마감 시각을 넘길 수 있음
+ *   (fd가 음수면 uart_rx_feed()로만 채우는 메모리 전용 링)
+ */
+static inline void uart_rx_init(struct uart_rx *rx, int fd) {
+    if (fd >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    rx->fd = fd;
+    rx->head = rx->tail = 0;
+    rx->reads = rx->bytes = 0;
+    rx->discarding = 0;
+    rx->t_first = rx->t_last = 0;
+    rx->mark_head = rx->mark_tail = 0;
+    rx->tap = NULL;
+    rx->tap_ctx = NULL;
+}
+
+/* 쌓여 있는 바이트 수 */
+static inline size_t uart_rx_avail(const struct uart_rx *rx) {
+    return rx->head - rx->tail;
+}
+
+/*
+ * 링 비우기
+ * tcflush(TCIFLUSH)로 커널 버퍼를 버릴 때 같이 호출해야 함
+ * (안 그러면 링에 남은 옛날 데이터가 다음 줄에 섞임)
+ */
+static inline void uart_rx_flush(struct uart_rx *rx) {
+    rx->tail = rx->head;
+    rx->discarding = 0;
+    rx->mark_tail = rx->mark_head;
+}
+
+/*
+ * 지금까지 링에 들어온 데이터(head까지)의 도착 시각 기록
+ * uart_rx_fill()이 알아서 부름, uart_rx_feed()를 쓸 때는 호출자가 시각을 줌
+ */
+static inline void uart_rx_mark(struct uart_rx *rx, uint64_t t) {
+    if (rx->mark_head - rx->mark_tail == RX_MARKS) {
+        rx->mark_tail++;
+    }
+    struct rx_mark *m = &rx->marks[rx->mark_head++ % RX_MARKS];
+    m->end = rx->head;
+    m->t = t;
+}
+
+/* 누적 위치 pos의 바이트가 들어온 시각 (기록이 없으면 0) */
+static inline uint64_t uart_rx_time_of(const struct uart_rx *rx, size_t pos) {
+    for (unsigned i = rx->mark_tail; i != rx->mark_head; i++) {
+        const struct rx_mark *m = &rx->marks[i % RX_MARKS];
+        if (m->end > pos) {
+            return m->t;
+        }
+    }
+    return 0;
+}
+
+/*
+ * 꺼낼 줄/프레임의 [first, last] 바이트 시각을 남기고
+ * 이미 다 소비된 구간의 기록은 정리 (tail을 옮긴 뒤 호출)
+ */
+static inline void uart_rx_stamp(struct uart_rx *rx, size_t first, size_t last) {
+    rx->t_first = uart_rx_time_of(rx, first);
+    rx->t_last = uart_rx_time_of(rx, last);
+    while (rx->mark_tail != rx->mark_head &&
+           rx->marks[rx->mark_tail % RX_MARKS].end <= rx->tail) {
+        rx->mark_tail++;
+    }
+}
+
+/*
+ * 메모리에 있는 바이트를 링에 넣기 (fd 대신 다른 입력원을 쓸 때)
+ * 반환값: 실제로 넣은 바이트 수 (링이 차면 len보다 작을 수 있음)
+ */
+static inline size_t uart_rx_feed(struct uart_rx *rx, const void *data, size_t len) {
+    size_t space = RX_RING_SIZE - uart_rx_avail(rx);
+    if (len > space) {
+        len = space;
+    }
+
+    size_t pos = rx->head & (RX_RING_SIZE - 1);
+    size_t first = RX_RING_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(rx->buf + pos, data, first);
+    memcpy(rx->buf, (const unsigned char *)data + first, len - first);
+
+    rx->head += len;
+    rx->bytes += len;
+    return len;
+}
+
+/*
+ * fd에서 읽을 수 있는 만큼 읽어서 링에 추가 (블록하지 않음)
+ *   (uart_rx_init()에서 fd를 O_NONBLOCK으로 만들어 둠)
+ *   링의 빈 공간이 끝에서 잘려 있으면 두 번에 나눠서 읽음
+ *
+ * 반환값: 읽은 바이트 수, 데이터 없음 0, 에러 -1
+ */
+static inline ssize_t uart_rx_fill(struct uart_rx *rx) {
+    ssize_t total = 0;
+
+    while (uart_rx_avail(rx) < RX_RING_SIZE) {
+        size_t pos = rx->head & (RX_RING_SIZE - 1);
+        size_t space = RX_RING_SIZE - uart_rx_avail(rx);
+        size_t chunk = RX_RING_SIZE - pos;
+        if (chunk > space) {
+            chunk = space;
+        }
+
+        ssize_t n = read(rx->fd, rx->buf + pos, chunk);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return total > 0 ? total : -1;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        rx->head += n;
+        rx->bytes += n;
+        rx->reads++;
+        total += n;
+        uint64_t t = mono_raw_ns();
+        uart_rx_mark(rx, t);
+        if (rx->tap) {
+            rx->tap(rx->tap_ctx, rx->buf + pos, (size_t)n, t);
+        }
+
+        // 요청한 것보다 적게 왔으면 커널 버퍼가 비었다는 뜻
+        if ((size_t)n < chunk) {
+            break;
+        }
+    }
+    return total;
+}
+
+/*
+ * [from, from+len) 구간에서 첫 번째 '\n' 또는 '\r' 찾기
+ * 반환값: 구간 시작부터의 오프셋, 없으면 len
+ */
+static inline size_t uart_rx_find_eol(const unsigned char *p, size_t len) {
+    const unsigned char *nl = memchr(p, '\n', len);
+    size_t limit = nl ? (size_t)(nl - p) : len;
+    const unsigned char *cr = memchr(p, '\r', limit);
+    return cr ? (size_t)(cr - p) : limit;
+}
+
+/*
+ * 링에서 [tail, tail+len) 구간을 out으로 복사 (끝에서 감긴 경우 두 번에 나눠서)
+ */
+static inline void uart_rx_copy(const struct uart_rx *rx, char *out, size_t len) {
+    size_t pos = rx->tail & (RX_RING_SIZE - 1);
+    size_t first = RX_RING_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(out, rx->buf + pos, first);
+    memcpy(out + first, rx->buf, len - first);
+}
+
+/*
+ * 링에 완성된 줄이 있으면 하나 꺼냄 (기다리지 않음)
+ *
+ * 기존 read_line()과 같은 규칙:
+ *   - '\n' 또는 '\r'에서 줄이 끝남 (개행 문자는 버림)
+ *   - 줄 맨 앞의 빈 개행(\r\n의 \n 등)은 건너뜀
+ *   - max_len-1 바이트를 넘으면 거기서 자르고 나머지는 다음 줄로
+ *
+ * 반환값: 줄 길이 (buf는 null 종료됨), 완성된 줄이 없으면 -1
+ */
+static inline int uart_rx_next_line(struct uart_rx *rx, char *buf, int max_len) {
+    for (;;) {
+        size_t avail = uart_rx_avail(rx);
+        if (avail == 0) {
+            return -1;
+        }
+
+        // 링은 끝에서 감길 수 있으므로 연속 구간 두 개를 차례로 검색
+        size_t pos = rx->tail & (RX_RING_SIZE - 1);
+        size_t seg1 = RX_RING_SIZE - pos;
+        if (seg1 > avail) {
+            seg1 = avail;
+        }
+        size_t eol = uart_rx_find_eol(rx->buf + pos, seg1);
+        if (eol == seg1 && seg1 < avail) {
+            eol = seg1 + uart_rx_find_eol(rx->buf, avail - seg1);
+        }
+
+        if (eol == 0) {
+            rx->tail++;     // 줄 맨 앞의 빈 개행 → 건너뜀
+            continue;
+        }
+
+        size_t limit = (size_t)max_len - 1;
+        if (eol == avail && avail < limit) {
+            return -1;      // 아직 개행이 안 옴
+        }
+
+        size_t len = eol < limit ? eol : limit;
+        uart_rx_copy(rx, buf, len);
+        buf[len] = '\0';
+
+        // 개행 문자까지 소비 (잘린 긴 줄이면 개행은 다음 번에)
+        size_t start = rx->tail;
+        size_t used = len + (len == eol && eol < avail ? 1 : 0);
+        rx->tail += used;
+        uart_rx_stamp(rx, start, start + used - 1);
+        return (int)len;
+    }
+}
+
+/*
+ * 링에서 0x00으로 끝나는 프레임 하나를 꺼냄 (바이너리 COBS 모드, 기다리지 않음)
+ *
+ * 줄과 다른 점:
+ *   - 구분자는 0x00 하나뿐 ('\n', '\r'은 평범한 데이터)
+ *   - max_len을 넘는 프레임은 자르지 않고 다음 구분자까지 통째로 버림
+ *     (COBS는 잘린 조각을 해석할 수 없음, 다음 프레임에서 자동으로 다시 맞춰짐)
+ *
+ * 반환값: 프레임 길이 (구분자 제외), 완성된 프레임이 없으면 -1
+ */
+static inline int uart_rx_next_frame(struct uart_rx *rx, unsigned char *buf,
+                                     int max_len, uint64_t *dropped) {
+    for (;;) {
+        size_t avail = uart_rx_avail(rx);
+        if (avail == 0) {
+            return -1;
+        }
+
+        size_t pos = rx->tail & (RX_RING_SIZE - 1);
+        size_t seg1 = RX_RING_SIZE - pos;
+        if (seg1 > avail) {
+            seg1 = avail;
+        }
+        const unsigned char *z = memchr(rx->buf + pos, 0x00, seg1);
+        size_t end = z ? (size_t)(z - (rx->buf + pos)) : seg1;
+        if (!z && seg1 < avail) {
+            z = memchr(rx->buf, 0x00, avail - seg1);
+            end = z ? seg1 + (size_t)(z - rx->buf) : avail;
+        }
+
+        if (!z) {
+            // 구분자가 아직 안 옴
+            if (rx->discarding) {
+                rx->tail = rx->head;
+            } else if (avail >= (size_t)max_len || avail == RX_RING_SIZE) {
+                // 너무 긴 프레임 → 지금까지 온 것을 버리고 다음 0x00까지 계속 버림
+                rx->tail = rx->head;
+                rx->discarding = 1;
+                if (dropped) {
+                    (*dropped)++;
+                }
+            }
+            return -1;
+        }
+
+        if (rx->discarding) {
+            rx->tail += end + 1;    // 버리던 프레임의 끝
+            rx->discarding = 0;
+            continue;
+        }
+
+        if (end == 0) {
+            rx->tail++;     // 빈 프레임 (연속된 0x00) → 건너뜀
+            continue;
+        }
+        if (end > (size_t)max_len) {
+            rx->tail += end + 1;
+            if (dropped) {
+                (*dropped)++;
+            }
+            continue;
+        }
+
+        uart_rx_copy(rx, (char *)buf, end);
+        size_t start = rx->tail;
+        rx->tail += end + 1;
+        uart_rx_stamp(rx, start, start + end);
+        return (int)end;
+    }
+}
+
+/*
+ * 한 줄이 완성될 때까지 기다렸다가 꺼냄 (read_line()의 대체)
+ *
+ * 파라미터:
+ *   timeout_ns - 호출 시점부터의 최대 대기 시간
+ *                (1ms 카운터가 아니라 단조 시계 기준 마감 시각)
+ *
+ * 반환값: 줄 길이 (null 제외), 타임아웃 0, 에러 -1
+ *   타임아웃 시 그때까지 받은 미완성 줄은 기존처럼 반환
+ */
+static inline int uart_rx_read_line(struct uart_rx *rx, char *buf, int max_len,
+                                    uint64_t timeout_ns) {
+    uint64_t deadline = mono_ns() + timeout_ns;
+
+    for (;;) {
+        int len = uart_rx_next_line(rx, buf, max_len);
+        if (len >= 0) {
+            return len;
+        }
+
+        uint64_t now = mono_ns();
+        if (now >= deadline) {
+            break;
+        }
+
+        // 올림해서 ms로: 0ms로 잘려서 바쁜 대기(busy loop)가 되지 않도록
+        int wait_ms = (int)((deadline - now + NS_PER_MS - 1) / NS_PER_MS);
+        struct pollfd pfd = { rx->fd, POLLIN, 0 };
+        int n = poll(&pfd, 1, wait_ms);
+        if (n < 0) {
+            if (errno == EINTR) {
+                break;      // Ctrl+C 등 → 호출자가 종료 플래그 확인
+            }
+            return -1;
+        }
+        if (n > 0 && uart_rx_fill(rx) < 0) {
+            return -1;
+        }
+    }
+
+    // 타임아웃: 개행 없이 들어온 데이터라도 있으면 돌려줌 (기존 동작 유지)
+    size_t avail = uart_rx_avail(rx);
+    if (avail == 0) {
+        buf[0] = '\0';
+        return 0;
+    }
+    size_t len = avail < (size_t)max_len - 1 ? avail : (size_t)max_len - 1;
+    uart_rx_copy(rx, buf, len);
+    buf[len] = '\0';
+    size_t start = rx->tail;
+    rx->tail += len;
+    uart_rx_stamp(rx, start, start + len - 1);
+    return (int)len;
+}
+
+#endif /* UART_RX_H */
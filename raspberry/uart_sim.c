@@ -0,0 +1,752 @@
+/*
+ * ============================================================================
+ * 에코 펌웨어 + 케이블 시뮬레이터 (uart_sim)
+ * ============================================================================
+ *
+ * claud_ver를 시험하려면 지금까지는 라즈베리파이 + 아두이노 + 케이블이 필요했음
+ * → 노트북이나 CI에서는 호스트 코드의 성능 작업을 할 수 없음
+ *
+ * 이 프로그램은 의사 터미널(pty) 한 쌍을 만들고 반대쪽 끝에서
+ * uart_send_input.ino와 같은 동작을 흉내 냄:
+ *   텍스트 모드   줄을 trim해서 돌려보냄, '!' 명령 (BIN, TEXT, PING, BAUD n, STREAM)
+ *                 줄 끝 없이 100ms가 지나면 그때까지 받은 것으로 처리 (Serial.setTimeout)
+ *   바이너리 모드 받은 바이트를 즉시 에코하면서 CTRL 프레임("TEXT", "PING")만 처리
+ *   스트림 모드   받은 바이트를 그대로 에코, 200ms 동안 입력이 없으면 텍스트 모드로
+ *   방향 분리     "!SPLIT": 프레임마다 CRC를 확인하고 seq로 만든 페이로드로 응답 (GEN/GEN_BAD)
+ *                 CTRL "STATS" → "OK STATS <정상> <깨짐>", 256프레임마다 저절로도
+ *                 (--uplink와 함께 쓰면 claud_ver --split의 방향 구분을 확인할 수 있음)
+ *   BAUD n        2초 안에 PING이 없으면 이전 속도로 복귀
+ *
+ * 회선 모델 (기본은 에코 방향만, --uplink면 호스트 → 펌웨어 방향에도):
+ *   --ber P          비트마다 P 확률로 뒤집힘 (기하 분포로 다음 에러까지 건너뜀)
+ *   --ber-at B:P     속도가 B 이상이면 비트 에러 확률 P (여러 번, 케이블 길이 흉내)
+ *   --drop P         바이트마다 P 확률로 사라짐
+ *   --insert P       바이트마다 P 확률로 뒤에 쓰레기 바이트 하나가 끼어듦
+ *   --burst P:LEN    바이트마다 P 확률로 LEN바이트짜리 버스트 시작 (버스트 안의 비트는 반반)
+ *   --baud N         바이트 하나 = 10비트 / N초 (8N1), "!BAUD n"을 받으면 따라 바뀜
+ *                    pty는 termios 속도를 무시하므로 속도는 시뮬레이터가 정함
+ *   --fast           속도 제한 없음 (호스트 코드를 한계까지 돌려볼 때)
+ *   --turnaround US  줄을 다 받고 에코를 시작할 때까지 펌웨어 처리 시간 (기본 20us)
+ *
+ * 사용법:
+ *   ./uart_sim --link /tmp/ttySIM --baud 115200 --ber 1e-5 &
+ *   ./claud_ver 1.5 115200 --device /tmp/ttySIM --window 4 --count 10000
+ *
+ *   (claud_ver는 시작할 때 아두이노 리셋을 2초 기다림, 시뮬레이터는 바로 준비됨)
+ *   Ctrl+C로 끝내면 회선 모델 통계를 출력하고 링크를 지움
+ *
+ * 빌드:
+ *   gcc -O2 -Wall -o uart_sim uart_sim.c -lm
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uart_clock.h"
+#include "uart_payload.h"       // xoshiro256**, splitmix64
+#include "../uart_send_input/uart_frame.h"
+
+#define SIM_DEFAULT_LINK    "/tmp/ttySIM"
+#define SIM_QUEUE_CAP       (1u << 16)  // 방향마다 대기 바이트 (2의 거듭제곱)
+#define SIM_LINE_MAX        8192    // claud_ver --len의 상한(4KB)에 헤더가 붙어도 한 줄로
+#define SIM_UP_AHEAD        64      // 회선 위에 미리 올려 두는 바이트 (나머지는 pty 버퍼에서
+                                    // 기다림 → 실제 UART 송신 버퍼처럼 호스트 write()가 막힘)
+#define SIM_MAX_RATE_BER    16
+#define SIM_LINE_TIMEOUT_MS 100     // 펌웨어의 Serial.setTimeout(100)
+#define SIM_STREAM_IDLE_MS  200     // uart_send_input.ino의 STREAM_IDLE_MS
+#define SIM_BAUD_CONFIRM_MS 2000    // uart_send_input.ino의 BAUD_CONFIRM_MS
+
+/* ---------------------------------------------------------------------------
+ * 회선 모델
+ * ------------------------------------------------------------------------- */
+
+struct rate_ber {
+    long   baud;
+    double ber;
+};
+
+struct channel {
+    // 설정
+    double ber;                 // 기본 비트 에러 확률
+    struct rate_ber at[SIM_MAX_RATE_BER];
+    int    n_at;
+    double drop, insert;
+    double burst_p;
+    int    burst_len;
+
+    // 상태
+    double   cur_ber;           // 지금 속도에서의 비트 에러 확률
+    uint64_t skip;              // 다음 비트 에러까지 건너뛸 비트 수
+    int      burst_left;
+
+    // 통계
+    uint64_t bytes, flipped_bits, dropped, inserted, bursts;
+};
+
+static double uniform01(struct xoshiro256 *r) {
+    return (double)(xoshiro_next(r) >> 11) * 0x1.0p-53;
+}
+
+/* 다음 에러까지의 정상 비트 수 (기하 분포) */
+static uint64_t channel_next_skip(double p, struct xoshiro256 *r) {
+    if (p <= 0.0) {
+        return UINT64_MAX;
+    }
+    if (p >= 1.0) {
+        return 0;
+    }
+    double u = 1.0 - uniform01(r);      // (0, 1]
+    double k = floor(log(u) / log1p(-p));
+    return k >= 1.8e19 ? UINT64_MAX : (uint64_t)k;
+}
+
+/* 속도가 바뀌면 비트 에러 확률을 다시 고름 (--ber-at 중 baud 이하에서 가장 큰 것) */
+static void channel_set_baud(struct channel *c, long baud, struct xoshiro256 *r) {
+    double p = c->ber;
+    long best = -1;
+    for (int i = 0; i < c->n_at; i++) {
+        if (c->at[i].baud <= baud && c->at[i].baud > best) {
+            best = c->at[i].baud;
+            p = c->at[i].ber;
+        }
+    }
+    if (p != c->cur_ber || c->bytes == 0) {
+        c->cur_ber = p;
+        c->skip = channel_next_skip(p, r);
+    }
+}
+
+/*
+ * 바이트 하나를 회선에 통과시킴
+ * 반환값: 나온 바이트 수 (0 = 사라짐, 1, 2 = 쓰레기 바이트가 끼어듦)
+ */
+static int channel_apply(struct channel *c, struct xoshiro256 *r, uint8_t b, uint8_t out[2]) {
+    c->bytes++;
+    if (c->drop > 0.0 && uniform01(r) < c->drop) {
+        c->dropped++;
+        return 0;
+    }
+
+    if (c->burst_left == 0 && c->burst_p > 0.0 && uniform01(r) < c->burst_p) {
+        c->burst_left = c->burst_len;
+        c->bursts++;
+    }
+    if (c->burst_left > 0) {
+        uint8_t noise = (uint8_t)xoshiro_next(r);
+        b ^= noise;
+        c->flipped_bits += (uint64_t)__builtin_popcount(noise);
+        c->burst_left--;
+    }
+
+    // 비트 에러: 바이트 안의 위치 pos부터 skip비트 뒤가 다음 에러
+    int pos = 0;
+    while (c->skip < (uint64_t)(8 - pos)) {
+        pos += (int)c->skip;
+        b ^= (uint8_t)(1u << pos);
+        pos++;
+        c->flipped_bits++;
+        c->skip = channel_next_skip(c->cur_ber, r);
+    }
+    if (c->skip != UINT64_MAX) {
+        c->skip -= (uint64_t)(8 - pos);
+    }
+
+    out[0] = b;
+    if (c->insert > 0.0 && uniform01(r) < c->insert) {
+        out[1] = (uint8_t)xoshiro_next(r);
+        c->inserted++;
+        return 2;
+    }
+    return 1;
+}
+
+static void channel_print(const char *name, const struct channel *c) {
+    printf("[SIM] %-8s bytes=%llu flipped_bits=%llu dropped=%llu inserted=%llu bursts=%llu\n",
+           name, (unsigned long long)c->bytes, (unsigned long long)c->flipped_bits,
+           (unsigned long long)c->dropped, (unsigned long long)c->inserted,
+           (unsigned long long)c->bursts);
+}
+
+/* ---------------------------------------------------------------------------
+ * 시각이 붙은 바이트 큐 (방향마다 하나)
+ * ------------------------------------------------------------------------- */
+
+struct timed_byte {
+    uint64_t due;               // 이 바이트가 회선 반대쪽에 다 도착하는 시각
+    uint8_t  b;
+};
+
+struct byte_queue {
+    struct timed_byte *q;
+    uint32_t head, tail;        // head - tail = 대기 중인 바이트 수
+    uint64_t line_free;         // 회선이 비는 시각 (다음 바이트는 이 뒤부터)
+};
+
+static uint32_t queue_len(const struct byte_queue *q) {
+    return q->head - q->tail;
+}
+
+static uint32_t queue_room(const struct byte_queue *q) {
+    return SIM_QUEUE_CAP - queue_len(q);
+}
+
+static const struct timed_byte *queue_peek(const struct byte_queue *q) {
+    return queue_len(q) ? &q->q[q->tail & (SIM_QUEUE_CAP - 1)] : NULL;
+}
+
+/* earliest 이후, 앞 바이트가 다 나간 뒤부터 byte_ns 동안 전송 */
+static void queue_push(struct byte_queue *q, uint8_t b, uint64_t earliest, uint64_t byte_ns) {
+    uint64_t start = earliest > q->line_free ? earliest : q->line_free;
+    struct timed_byte *t = &q->q[q->head++ & (SIM_QUEUE_CAP - 1)];
+    t->due = start + byte_ns;
+    t->b = b;
+    q->line_free = t->due;
+}
+
+/* ---------------------------------------------------------------------------
+ * 펌웨어 흉내
+ * ------------------------------------------------------------------------- */
+
+enum sim_mode { MODE_TEXT, MODE_BINARY, MODE_STREAM, MODE_SPLIT };
+
+struct sim {
+    int  master;
+    int  fast;                  // 1 = 속도 제한 없음
+    int  uplink;                // 1 = 호스트 → 펌웨어 방향에도 회선 모델
+    int  verbose;
+    uint64_t turnaround_ns;
+
+    enum sim_mode mode;
+    long     baud, prev_baud;
+    int      baud_pending;
+    uint64_t baud_changed_at;
+
+    struct byte_queue up;       // 호스트가 쓴 바이트 → 펌웨어에 도착
+    struct byte_queue down;     // 펌웨어가 보낸 바이트 → 호스트에 도착
+
+    char     line[SIM_LINE_MAX];
+    size_t   line_len;
+    uint64_t line_last;         // 줄의 마지막 바이트가 도착한 시각
+    struct frame_stream fs;
+    struct frame_split  split;  // 방향 분리 모드의 상향 판정
+    uint64_t stream_last;
+
+    struct channel down_ch, up_ch;
+    struct xoshiro256 rng;
+
+    uint64_t lines, frames, commands;
+};
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static uint64_t sim_byte_ns(const struct sim *s) {
+    return s->fast ? 0 : (uint64_t)(10.0 * NS_PER_SEC / (double)s->baud);
+}
+
+/* 펌웨어가 보냄: 회선 모델을 거쳐 호스트 쪽 큐로 */
+static void sim_send(struct sim *s, const void *data, size_t n, uint64_t earliest) {
+    const uint8_t *p = data;
+    uint64_t byte_ns = sim_byte_ns(s);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t out[2];
+        int k = channel_apply(&s->down_ch, &s->rng, p[i], out);
+        for (int j = 0; j < k; j++) {
+            queue_push(&s->down, out[j], earliest, byte_ns);
+        }
+    }
+}
+
+static void sim_set_baud(struct sim *s, long baud) {
+    s->baud = baud;
+    channel_set_baud(&s->down_ch, baud, &s->rng);
+    channel_set_baud(&s->up_ch, baud, &s->rng);
+}
+
+static void sim_reply(struct sim *s, const char *verdict, const char *cmd, uint64_t t) {
+    char msg[SIM_LINE_MAX + 16];
+    int n = snprintf(msg, sizeof(msg), "!%s %s\n", verdict, cmd);
+    sim_send(s, msg, n < (int)sizeof(msg) ? (size_t)n : sizeof(msg) - 1, t);
+}
+
+/* 텍스트 모드 제어 명령 (uart_send_input.ino의 handle_text_command) */
+static void sim_text_command(struct sim *s, const char *cmd, uint64_t t) {
+    s->commands++;
+    if (s->verbose) {
+        printf("[SIM] !%s\n", cmd);
+    }
+    if (strncmp(cmd, "BAUD ", 5) == 0) {
+        long baud = atol(cmd + 5);
+        if (baud < 300 || baud > 2000000) {
+            sim_reply(s, "ERR", cmd, t);
+            return;
+        }
+        sim_reply(s, "OK", cmd, t);
+        // Serial.flush() 뒤에 전환: 응답은 이전 속도로 다 나감
+        s->prev_baud = s->baud;
+        sim_set_baud(s, baud);
+        s->baud_pending = 1;
+        s->baud_changed_at = s->down.line_free;
+    } else if (strcmp(cmd, "BIN") == 0) {
+        sim_reply(s, "OK", cmd, t);
+        frame_stream_reset(&s->fs);
+        s->mode = MODE_BINARY;
+    } else if (strcmp(cmd, "SPLIT") == 0) {
+        sim_reply(s, "OK", cmd, t);
+        frame_stream_reset(&s->fs);
+        frame_split_reset(&s->split);
+        s->mode = MODE_SPLIT;
+    } else if (strcmp(cmd, "STREAM") == 0) {
+        sim_reply(s, "OK", cmd, t);
+        s->mode = MODE_STREAM;
+        s->stream_last = t;
+    } else if (strcmp(cmd, "PING") == 0 || strcmp(cmd, "TEXT") == 0) {
+        if (strcmp(cmd, "PING") == 0) {
+            s->baud_pending = 0;
+        }
+        sim_reply(s, "OK", cmd, t);
+    } else {
+        sim_reply(s, "ERR", cmd, t);
+    }
+}
+
+/* 한 줄 처리 (String::trim()과 같게 앞뒤 공백/제어 문자 제거) */
+static void sim_text_line(struct sim *s, uint64_t t) {
+    char *p = s->line;
+    size_t n = s->line_len;
+    s->line_len = 0;
+    while (n > 0 && (unsigned char)p[0] <= ' ') {
+        p++;
+        n--;
+    }
+    while (n > 0 && (unsigned char)p[n - 1] <= ' ') {
+        n--;
+    }
+    if (n == 0) {
+        return;
+    }
+    p[n] = '\0';
+    uint64_t reply_at = t + s->turnaround_ns;
+    if (p[0] == '!') {
+        sim_text_command(s, p + 1, reply_at);
+        return;
+    }
+    s->lines++;
+    p[n] = '\n';
+    sim_send(s, p, n + 1, reply_at);
+}
+
+/* 바이너리 모드 CTRL 프레임 (uart_send_input.ino의 handle_ctrl_frame) */
+static void sim_ctrl_frame(struct sim *s, const char *cmd, uint64_t t) {
+    char reply[FRAME_CTRL_REPLY_MAX + 8];
+    uint8_t scratch[sizeof(reply) + FRAME_OVERHEAD];
+    uint8_t wire[FRAME_MAX_WIRE(sizeof(reply))];
+
+    s->commands++;
+    if (s->verbose) {
+        printf("[SIM] CTRL %s\n", cmd);
+    }
+    if (strcmp(cmd, "STATS") == 0) {
+        snprintf(reply, sizeof(reply), "OK STATS %lu %lu",
+                 (unsigned long)s->split.ok, (unsigned long)s->split.bad);
+    } else if (strcmp(cmd, "TEXT") == 0) {
+        snprintf(reply, sizeof(reply), "OK TEXT");
+        s->mode = MODE_TEXT;
+        s->line_len = 0;
+    } else if (strcmp(cmd, "PING") == 0 || strcmp(cmd, "BIN") == 0) {
+        snprintf(reply, sizeof(reply), "OK %s", cmd);
+    } else {
+        snprintf(reply, sizeof(reply), "ERR %s", cmd);
+    }
+    size_t len = strlen(reply);
+    if (len > FRAME_CTRL_REPLY_MAX) {
+        len = FRAME_CTRL_REPLY_MAX;
+    }
+    size_t n = frame_encode(FRAME_TYPE_CTRL, 0, (const uint8_t *)reply, (uint16_t)len,
+                            scratch, wire);
+    sim_send(s, wire, n, t + s->turnaround_ns);
+}
+
+/* 펌웨어에 바이트 하나가 도착함 (시각 t) */
+static void sim_on_byte(struct sim *s, uint8_t b, uint64_t t) {
+    switch (s->mode) {
+    case MODE_STREAM:
+        sim_send(s, &b, 1, t);
+        s->stream_last = t;
+        break;
+
+    case MODE_BINARY:
+        // 받는 즉시 에코, CTRL 프레임이면 구분자까지 보낸 뒤 응답
+        sim_send(s, &b, 1, t);
+        if (frame_stream_feed(&s->fs, b) == FRAME_STREAM_OK) {
+            s->frames++;
+            if (s->fs.type == FRAME_TYPE_CTRL) {
+                sim_ctrl_frame(s, s->fs.ctrl, t);
+            }
+        }
+        break;
+
+    case MODE_SPLIT: {
+        // 에코 없음: 프레임이 끝나면 펌웨어의 처리 시간 뒤에 응답 프레임
+        int r = frame_stream_feed(&s->fs, b);
+        if (r == FRAME_STREAM_NONE) {
+            break;
+        }
+        if (r == FRAME_STREAM_OK && s->fs.type == FRAME_TYPE_CTRL) {
+            s->frames++;
+            sim_ctrl_frame(s, s->fs.ctrl, t);
+            break;
+        }
+        s->frames += r == FRAME_STREAM_OK;
+        uint8_t scratch[FRAME_GEN_MAX + FRAME_OVERHEAD];
+        uint8_t wire[FRAME_MAX_WIRE(FRAME_GEN_MAX)];
+        size_t n = frame_split_reply(&s->split, &s->fs, r, scratch, wire);
+        sim_send(s, wire, n, t + s->turnaround_ns);
+        if (n > 0 && (s->split.ok + s->split.bad) % FRAME_SPLIT_STATS_EVERY == 0) {
+            sim_ctrl_frame(s, "STATS", t);
+            s->commands--;      // 스스로 보낸 것은 명령으로 세지 않음
+        }
+        break;
+    }
+
+    case MODE_TEXT:
+        if (b == '\n') {
+            sim_text_line(s, t);
+        } else if (s->line_len < SIM_LINE_MAX - 1) {
+            s->line[s->line_len++] = (char)b;
+        }
+        s->line_last = t;
+        break;
+    }
+}
+
+/* t부터 지난 시간 (t가 아직 안 왔으면 0: 응답 시각은 turnaround만큼 미래일 수 있음) */
+static uint64_t elapsed_ms(uint64_t now, uint64_t t) {
+    return now > t ? (now - t) / NS_PER_MS : 0;
+}
+
+/* 시간이 지나서 생기는 일들 (줄 타임아웃, 스트림 종료, 속도 복귀) */
+static void sim_timers(struct sim *s, uint64_t now) {
+    if (s->mode == MODE_TEXT && s->line_len > 0 &&
+        elapsed_ms(now, s->line_last) >= SIM_LINE_TIMEOUT_MS) {
+        sim_text_line(s, now);
+    }
+    if (s->mode == MODE_STREAM && queue_len(&s->up) == 0 &&
+        elapsed_ms(now, s->stream_last) >= SIM_STREAM_IDLE_MS) {
+        s->mode = MODE_TEXT;
+        s->line_len = 0;
+    }
+    if (s->baud_pending && elapsed_ms(now, s->baud_changed_at) >= SIM_BAUD_CONFIRM_MS) {
+        if (s->verbose) {
+            printf("[SIM] no PING at %ld bps, back to %ld\n", s->baud, s->prev_baud);
+        }
+        sim_set_baud(s, s->prev_baud);
+        s->baud_pending = 0;
+    }
+}
+
+/* 다음에 깨어나야 하는 시각 */
+static uint64_t sim_next_event(const struct sim *s, uint64_t now) {
+    uint64_t t = now + 100 * NS_PER_MS;
+    const struct timed_byte *b;
+    if ((b = queue_peek(&s->up)) && b->due < t) {
+        t = b->due;
+    }
+    if ((b = queue_peek(&s->down)) && b->due < t) {
+        t = b->due;
+    }
+    if (s->mode == MODE_TEXT && s->line_len > 0) {
+        uint64_t d = s->line_last + (uint64_t)SIM_LINE_TIMEOUT_MS * NS_PER_MS + 1;
+        t = d < t ? d : t;
+    }
+    if (s->mode == MODE_STREAM) {
+        uint64_t d = s->stream_last + (uint64_t)SIM_STREAM_IDLE_MS * NS_PER_MS + 1;
+        t = d < t ? d : t;
+    }
+    return t > now ? t : now;
+}
+
+/* 호스트가 쓴 바이트를 읽어서 도착 시각을 매김 */
+static int sim_read_host(struct sim *s, uint64_t now) {
+    uint8_t buf[4096];
+    uint32_t room = queue_room(&s->up) / 2;     // --insert로 늘어날 수 있음
+    if (!s->fast) {
+        room = queue_len(&s->up) < SIM_UP_AHEAD ? SIM_UP_AHEAD - queue_len(&s->up) : 0;
+    }
+    size_t want = room < sizeof(buf) ? room : sizeof(buf);
+    if (want == 0) {
+        return 0;
+    }
+    ssize_t k = read(s->master, buf, want);
+    if (k < 0) {
+        return errno == EAGAIN || errno == EINTR || errno == EIO ? 0 : -1;
+    }
+    uint64_t byte_ns = sim_byte_ns(s);
+    for (ssize_t i = 0; i < k; i++) {
+        uint8_t out[2] = { buf[i], 0 };
+        int n = s->uplink ? channel_apply(&s->up_ch, &s->rng, buf[i], out) : 1;
+        for (int j = 0; j < n; j++) {
+            queue_push(&s->up, out[j], now, byte_ns);
+        }
+    }
+    return 0;
+}
+
+/* 도착 시각이 된 바이트를 호스트에 씀 */
+static int sim_write_host(struct sim *s, uint64_t now) {
+    uint8_t buf[4096];
+    size_t n = 0;
+    uint32_t tail = s->down.tail;
+    while (n < sizeof(buf) && tail != s->down.head) {
+        const struct timed_byte *b = &s->down.q[tail & (SIM_QUEUE_CAP - 1)];
+        if (b->due > now) {
+            break;
+        }
+        buf[n++] = b->b;
+        tail++;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    ssize_t k = write(s->master, buf, n);
+    if (k < 0) {
+        return errno == EAGAIN || errno == EINTR ? 0 : -1;
+    }
+    s->down.tail += (uint32_t)k;
+    return 0;
+}
+
+static int parse_prob(const char *text, double *p) {
+    char *end;
+    *p = strtod(text, &end);
+    return *end == '\0' && *p >= 0.0 && *p <= 1.0 ? 0 : -1;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Pretends to be the uart_send_input echo firmware behind a pty.\n");
+    printf("\nOptions:\n");
+    printf("  --link PATH      symlink to the pty (default %s)\n", SIM_DEFAULT_LINK);
+    printf("  --baud N         starting line rate, follows !BAUD (default 115200)\n");
+    printf("  --fast           no line-rate pacing\n");
+    printf("  --turnaround US  firmware delay before echoing a line (default 20)\n");
+    printf("  --ber P          bit flip probability\n");
+    printf("  --ber-at B:P     bit flip probability P at B bps and above (repeatable)\n");
+    printf("  --drop P         byte drop probability\n");
+    printf("  --insert P       probability of a garbage byte after each byte\n");
+    printf("  --burst P:LEN    per-byte probability of a LEN-byte noise burst\n");
+    printf("  --uplink         apply the channel model to host-to-firmware bytes too\n");
+    printf("  --seed N         channel random seed (default from the clock)\n");
+    printf("  --verbose        print commands and baud changes\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct sim s;
+    const char *link_path = SIM_DEFAULT_LINK;
+    uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    struct channel ch;
+    memset(&ch, 0, sizeof(ch));
+    s.baud = 115200;
+    s.turnaround_ns = 20 * 1000;
+
+    static const struct option long_opts[] = {
+        { "link",       required_argument, NULL, 'l' },
+        { "baud",       required_argument, NULL, 'b' },
+        { "fast",       no_argument,       NULL, 'f' },
+        { "turnaround", required_argument, NULL, 'a' },
+        { "ber",        required_argument, NULL, 'e' },
+        { "ber-at",     required_argument, NULL, 'E' },
+        { "drop",       required_argument, NULL, 'd' },
+        { "insert",     required_argument, NULL, 'i' },
+        { "burst",      required_argument, NULL, 'u' },
+        { "uplink",     no_argument,       NULL, 'U' },
+        { "seed",       required_argument, NULL, 's' },
+        { "verbose",    no_argument,       NULL, 'v' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "l:b:fa:e:E:d:i:u:Us:vh", long_opts, NULL)) != -1) {
+        char *sep;
+        switch (opt) {
+        case 'l': link_path = optarg; break;
+        case 'b': s.baud = atol(optarg); break;
+        case 'f': s.fast = 1; break;
+        case 'a': s.turnaround_ns = (uint64_t)(atof(optarg) * 1000.0); break;
+        case 'U': s.uplink = 1; break;
+        case 's': seed = strtoull(optarg, NULL, 0); break;
+        case 'v': s.verbose = 1; break;
+        case 'e':
+            if (parse_prob(optarg, &ch.ber) < 0) {
+                fprintf(stderr, "Error: bad --ber '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'd':
+            if (parse_prob(optarg, &ch.drop) < 0) {
+                fprintf(stderr, "Error: bad --drop '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'i':
+            if (parse_prob(optarg, &ch.insert) < 0) {
+                fprintf(stderr, "Error: bad --insert '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'E':
+            sep = strchr(optarg, ':');
+            if (!sep || ch.n_at == SIM_MAX_RATE_BER ||
+                parse_prob(sep + 1, &ch.at[ch.n_at].ber) < 0 || atol(optarg) <= 0) {
+                fprintf(stderr, "Error: bad --ber-at '%s' (expected BAUD:P)\n", optarg);
+                return -1;
+            }
+            ch.at[ch.n_at++].baud = atol(optarg);
+            break;
+        case 'u':
+            sep = strchr(optarg, ':');
+            if (sep) {
+                *sep = '\0';
+            }
+            if (!sep || parse_prob(optarg, &ch.burst_p) < 0 || atoi(sep + 1) <= 0) {
+                fprintf(stderr, "Error: bad --burst (expected P:LEN)\n");
+                return -1;
+            }
+            ch.burst_len = atoi(sep + 1);
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (s.baud < 300 || s.baud > 2000000) {
+        fprintf(stderr, "Error: --baud must be 300..2000000\n");
+        return -1;
+    }
+
+    s.down_ch = ch;
+    s.up_ch = ch;
+    uint64_t x = seed;
+    for (int i = 0; i < 4; i++) {
+        s.rng.s[i] = splitmix64(&x);
+    }
+    sim_set_baud(&s, s.baud);
+    s.prev_baud = s.baud;
+    s.up.q = calloc(SIM_QUEUE_CAP, sizeof(struct timed_byte));
+    s.down.q = calloc(SIM_QUEUE_CAP, sizeof(struct timed_byte));
+    if (!s.up.q || !s.down.q) {
+        perror("alloc");
+        return -1;
+    }
+
+    // pty 한 쌍: master는 이 프로그램, slave는 claud_ver가 여는 쪽
+    s.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (s.master < 0 || grantpt(s.master) < 0 || unlockpt(s.master) < 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    const char *slave_name = ptsname(s.master);
+    // slave를 하나 열어 둠: 호스트가 닫았다 다시 열어도 master가 EIO로 끊기지 않도록
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror(slave_name);
+        return -1;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(s.master, F_SETFL, fcntl(s.master, F_GETFL) | O_NONBLOCK);
+
+    unlink(link_path);
+    if (symlink(slave_name, link_path) < 0) {
+        perror(link_path);
+        return -1;
+    }
+    printf("[SIM] %s -> %s, %ld bps%s, seed %llu\n", link_path, slave_name, s.baud,
+           s.fast ? " (unpaced)" : "", (unsigned long long)seed);
+    fflush(stdout);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int rc = 0;
+    while (!stop_requested) {
+        uint64_t now = mono_ns();
+
+        // 도착 시각이 된 바이트를 펌웨어가 처리 (에코가 들어갈 자리가 있을 때만)
+        const struct timed_byte *b;
+        while ((b = queue_peek(&s.up)) && b->due <= now && queue_room(&s.down) > 1024) {
+            uint8_t v = b->b;
+            uint64_t t = b->due;
+            s.up.tail++;
+            sim_on_byte(&s, v, t);
+        }
+        sim_timers(&s, now);
+        if (sim_write_host(&s, now) < 0) {
+            perror("pty write");
+            rc = -1;
+            break;
+        }
+
+        uint64_t wake = sim_next_event(&s, mono_ns());
+        struct pollfd pfd = { s.master, 0, 0 };
+        if (s.fast ? queue_room(&s.up) > 8192 : queue_len(&s.up) < SIM_UP_AHEAD) {
+            pfd.events |= POLLIN;
+        }
+        if ((b = queue_peek(&s.down)) && b->due <= now) {
+            pfd.events |= POLLOUT;      // 보낼 것이 밀려 있음 (호스트가 안 읽는 중)
+        }
+        uint64_t wait = wake > now ? wake - now : 0;
+        struct timespec ts = { (time_t)(wait / NS_PER_SEC), (long)(wait % NS_PER_SEC) };
+        int n = ppoll(&pfd, 1, &ts, NULL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("ppoll");
+            rc = -1;
+            break;
+        }
+        if (n > 0 && (pfd.revents & POLLIN) && sim_read_host(&s, mono_ns()) < 0) {
+            perror("pty read");
+            rc = -1;
+            break;
+        }
+    }
+
+    printf("\n[SIM] lines=%llu frames=%llu commands=%llu, final %ld bps\n",
+           (unsigned long long)s.lines, (unsigned long long)s.frames,
+           (unsigned long long)s.commands, s.baud);
+    if (s.split.ok + s.split.bad > 0) {
+        printf("[SIM] split: uplink frames ok=%lu bad=%lu\n",
+               (unsigned long)s.split.ok, (unsigned long)s.split.bad);
+    }
+    channel_print("downlink", &s.down_ch);
+    if (s.uplink) {
+        channel_print("uplink", &s.up_ch);
+    }
+    unlink(link_path);
+    close(slave);
+    close(s.master);
+    free(s.up.q);
+    free(s.down.q);
+    return rc;
+}
@@ -0,0 +1,113 @@
+/*
+ * ============================================================================
+ * 락 없는 단일 생산자 / 단일 소비자 (SPSC) 링 큐
+ * ============================================================================
+ *
+ * 스레드 두 개가 데이터를 주고받을 때 보통은 mutex를 씀
+ *   → 한쪽이 락을 잡고 있으면 다른 쪽이 멈춤 (송신 스레드가 수신 때문에 멈추면 안 됨)
+ *
+ * 생산자(push하는 스레드)와 소비자(pop하는 스레드)가 각각 딱 하나라면
+ * 락 없이 원자적(atomic) 카운터 두 개로 충분함:
+ *   head - 생산자만 증가시킴 (다음에 쓸 위치)
+ *   tail - 소비자만 증가시킴 (다음에 읽을 위치)
+ *   head - tail = 큐에 들어 있는 원소 수
+ *
+ * 메모리 순서:
+ *   push: 슬롯에 데이터 복사 → head를 release로 증가
+ *   pop : head를 acquire로 읽음 → 슬롯에서 복사 → tail을 release로 증가
+ *   release/acquire 짝 덕분에 소비자는 head가 보이면 슬롯 내용도 반드시 보임
+ *
+ * head와 tail을 다른 캐시 라인에 두는 이유:
+ *   같은 캐시 라인이면 두 코어가 서로의 캐시를 계속 무효화함 (false sharing)
+ *
+ * 원소는 고정 크기 바이트 덩어리 (elem_size)로 복사됨
+ *   → 어떤 구조체든 담을 수 있음
+ */
+#ifndef UART_SPSC_H
+#define UART_SPSC_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPSC_CACHE_LINE 64
+
+struct spsc_ring {
+    alignas(SPSC_CACHE_LINE) atomic_size_t head;    // 생산자 전용
+    alignas(SPSC_CACHE_LINE) atomic_size_t tail;    // 소비자 전용
+    alignas(SPSC_CACHE_LINE) size_t mask;           // 용량 - 1
+    size_t         elem_size;
+    unsigned char *slots;
+};
+
+/*
+ * 초기화
+ *   capacity는 2의 거듭제곱으로 올림됨
+ * 반환값: 성공 0, 메모리 부족 -1
+ */
+static inline int spsc_init(struct spsc_ring *r, size_t capacity, size_t elem_size) {
+    size_t cap = 1;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    r->slots = calloc(cap, elem_size);
+    if (!r->slots) {
+        return -1;
+    }
+    r->mask = cap - 1;
+    r->elem_size = elem_size;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return 0;
+}
+
+static inline void spsc_free(struct spsc_ring *r) {
+    free(r->slots);
+    r->slots = NULL;
+}
+
+static inline size_t spsc_capacity(const struct spsc_ring *r) {
+    return r->mask + 1;
+}
+
+/* 현재 원소 수 (어느 스레드에서 불러도 되지만 값은 근사치) */
+static inline size_t spsc_size(struct spsc_ring *r) {
+    return atomic_load_explicit(&r->head, memory_order_acquire) -
+           atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+/*
+ * 생산자: 원소 하나 넣기
+ * 반환값: 성공 0, 큐가 꽉 참 -1
+ */
+static inline int spsc_push(struct spsc_ring *r, const void *elem) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) {
+        return -1;
+    }
+
+    memcpy(r->slots + (head & r->mask) * r->elem_size, elem, r->elem_size);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/*
+ * 소비자: 원소 하나 꺼내기
+ * 반환값: 성공 0, 큐가 비어 있음 -1
+ */
+static inline int spsc_pop(struct spsc_ring *r, void *out) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (head == tail) {
+        return -1;
+    }
+
+    memcpy(out, r->slots + (tail & r->mask) * r->elem_size, r->elem_size);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+#endif /* UART_SPSC_H */
@@ -0,0 +1,236 @@
+/*
+ * ============================================================================
+ * 설정별 누적 통계 + 요약 파일 (uart_summary.csv)
+ * ============================================================================
+ *
+ * uart_dataset.csv에는 패킷마다 한 줄씩 쌓이기만 함
+ *   → "3m / 230400에서 에러율이 얼마냐"를 보려면 매번 전체 파일을 다시 읽어야 함
+ *
+ * 이 모듈은 (케이블 길이, Baudrate, 패킷 길이)마다 카운터를 들고 패킷마다 갱신:
+ *   (패킷 길이가 다르면 PER/지연이 완전히 다르므로 --len-sweep의 단계를 섞지 않음)
+ *   attempts, OK, ERR, TIMEOUT, 비트 에러, 비교한 비트 수,
+ *   왕복 지연의 개수/평균/분산(Welford)/최소/최대
+ *
+ * 몇 초마다, 그리고 종료할 때 작은 CSV 하나로 통째로 다시 씀
+ *   → 대시보드와 모델은 수백 바이트만 읽으면 됨
+ *   임시 파일에 다 쓰고 rename() → 읽는 쪽은 항상 완성된 파일만 봄
+ *
+ * 시작할 때 기존 요약 파일을 읽어서 이어서 셈 (실행을 거듭해도 전체 누적)
+ *
+ * 갱신과 파일 쓰기는 모두 CSV 기록 스레드(uart_log.h)에서만 함
+ *   → 락 없음, 측정 스레드는 파일 I/O를 하지 않음
+ */
+#ifndef UART_STATS_H
+#define UART_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STATS_MAX_CONFIGS   256         // 속도 스윕 × 길이 스윕 + 멀티 포트 (넘치면 dropped)
+#define STATS_DEFAULT_PATH  "uart_summary.csv"
+#define STATS_WRITE_MS      5000        // 요약 파일을 다시 쓰는 주기
+
+enum stats_result {
+    STATS_OK,
+    STATS_ERR,
+    STATS_TIMEOUT
+};
+
+struct config_stats {
+    double   cable_length;
+    int      length_cm;         // 비교용 (부동소수 == 회피)
+    int      baudrate;
+    int      packet_len;        // 페이로드 길이 (예전 요약 파일에서 읽은 줄은 0 = 모름)
+    uint64_t attempts;          // OK + ERR + TIMEOUT
+    uint64_t ok, err, timeouts;
+    uint64_t bit_errors;
+    uint64_t bits_checked;      // BER의 분모
+
+    // 왕복 지연 (ns), Welford 방식으로 평균/분산을 한 번에 갱신
+    uint64_t lat_count;
+    double   lat_mean;
+    double   lat_m2;            // 편차 제곱의 합
+    double   lat_min, lat_max;
+};
+
+struct live_stats {
+    const char *path;
+    struct config_stats cfg[STATS_MAX_CONFIGS];
+    int      n;
+    int      last;              // 마지막으로 찾은 칸 (보통 연속으로 같은 설정)
+    int      dirty;             // 마지막 쓰기 이후 바뀜
+    uint64_t dropped;           // 칸이 모자라서 못 센 패킷
+};
+
+static inline int stats_cm(double cable_length) {
+    return (int)(cable_length * 100.0 + (cable_length < 0 ? -0.5 : 0.5));
+}
+
+static inline int stats_match(const struct config_stats *c, int cm, int baudrate,
+                              int packet_len) {
+    return c->length_cm == cm && c->baudrate == baudrate && c->packet_len == packet_len;
+}
+
+/* 설정에 해당하는 칸 (없으면 새로 만듦, 꽉 차면 NULL) */
+static inline struct config_stats *stats_find(struct live_stats *s, double cable_length,
+                                              int baudrate, int packet_len) {
+    int cm = stats_cm(cable_length);
+    if (s->n > 0 && stats_match(&s->cfg[s->last], cm, baudrate, packet_len)) {
+        return &s->cfg[s->last];
+    }
+    for (int i = 0; i < s->n; i++) {
+        if (stats_match(&s->cfg[i], cm, baudrate, packet_len)) {
+            s->last = i;
+            return &s->cfg[i];
+        }
+    }
+    if (s->n == STATS_MAX_CONFIGS) {
+        return NULL;
+    }
+    struct config_stats *c = &s->cfg[s->n];
+    memset(c, 0, sizeof(*c));
+    c->cable_length = cable_length;
+    c->length_cm = cm;
+    c->baudrate = baudrate;
+    c->packet_len = packet_len;
+    s->last = s->n++;
+    return c;
+}
+
+/*
+ * 패킷 하나 반영
+ *   latency_ns - 송신 완료 → 에코 마지막 바이트 (0 = 모름)
+ */
+static inline void stats_add(struct live_stats *s, double cable_length, int baudrate,
+                             int packet_len, enum stats_result r, uint32_t bit_errors,
+                             uint64_t bits_checked, uint64_t latency_ns) {
+    struct config_stats *c = stats_find(s, cable_length, baudrate, packet_len);
+    if (!c) {
+        s->dropped++;
+        return;
+    }
+    c->attempts++;
+    if (r == STATS_OK) {
+        c->ok++;
+    } else if (r == STATS_ERR) {
+        c->err++;
+    } else {
+        c->timeouts++;
+    }
+    c->bit_errors += bit_errors;
+    c->bits_checked += bits_checked;
+
+    if (latency_ns > 0) {
+        double x = (double)latency_ns;
+        c->lat_count++;
+        double delta = x - c->lat_mean;
+        c->lat_mean += delta / (double)c->lat_count;
+        c->lat_m2 += delta * (x - c->lat_mean);
+        if (c->lat_count == 1 || x < c->lat_min) {
+            c->lat_min = x;
+        }
+        if (x > c->lat_max) {
+            c->lat_max = x;
+        }
+    }
+    s->dirty = 1;
+}
+
+/*
+ * 요약 파일 형식 (첫 줄 헤더, 지연 단위 us):
+ *   cable_length,baudrate,packet_len,attempts,ok,err,timeouts,bit_errors,bits_checked,
+ *   lat_count,lat_mean_us,lat_std_us,lat_min_us,lat_max_us
+ */
+#define STATS_HEADER "cable_length,baudrate,packet_len,attempts,ok,err,timeouts," \
+                     "bit_errors,bits_checked," \
+                     "lat_count,lat_mean_us,lat_std_us,lat_min_us,lat_max_us"
+
+/*
+ * 초기화 + 기존 요약 파일이 있으면 이어서 셈
+ *   path는 호출자가 계속 들고 있는 문자열이어야 함
+ *   분산은 표준편차에서 다시 만듦 (출력 자릿수만큼의 오차는 있음)
+ *   packet_len 열이 없던 예전 파일의 줄은 packet_len 0으로 이어받음
+ */
+static inline void stats_init(struct live_stats *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    s->path = path;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return;     // 처음 실행
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        double len, mean, sd, mn, mx;
+        int baud, plen;
+        unsigned long long att, ok, err, to, be, bc, lc;
+        if (sscanf(line, "%lf,%d,%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%lf,%lf,%lf,%lf",
+                   &len, &baud, &plen, &att, &ok, &err, &to, &be, &bc, &lc,
+                   &mean, &sd, &mn, &mx) != 14) {
+            plen = 0;
+            if (sscanf(line, "%lf,%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%lf,%lf,%lf,%lf",
+                       &len, &baud, &att, &ok, &err, &to, &be, &bc, &lc,
+                       &mean, &sd, &mn, &mx) != 13) {
+                continue;   // 헤더, 깨진 줄
+            }
+        }
+        struct config_stats *c = stats_find(s, len, baud, plen);
+        if (!c) {
+            break;
+        }
+        c->attempts = att;
+        c->ok = ok;
+        c->err = err;
+        c->timeouts = to;
+        c->bit_errors = be;
+        c->bits_checked = bc;
+        c->lat_count = lc;
+        c->lat_mean = mean * 1e3;
+        c->lat_m2 = lc > 1 ? (sd * 1e3) * (sd * 1e3) * (double)(lc - 1) : 0.0;
+        c->lat_min = mn * 1e3;
+        c->lat_max = mx * 1e3;
+    }
+    fclose(fp);
+}
+
+/*
+ * 요약 파일을 통째로 다시 씀 (path.tmp에 쓰고 fsync → rename)
+ * 반환값: 성공 0, 실패 -1
+ */
+static inline int stats_write(struct live_stats *s) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s->path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        return -1;
+    }
+    fprintf(fp, STATS_HEADER "\n");
+    for (int i = 0; i < s->n; i++) {
+        const struct config_stats *c = &s->cfg[i];
+        double sd = c->lat_count > 1 ? sqrt(c->lat_m2 / (double)(c->lat_count - 1)) : 0.0;
+        fprintf(fp, "%.2f,%d,%d,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.3f,%.3f,%.3f,%.3f\n",
+                c->cable_length, c->baudrate, c->packet_len,
+                (unsigned long long)c->attempts, (unsigned long long)c->ok,
+                (unsigned long long)c->err, (unsigned long long)c->timeouts,
+                (unsigned long long)c->bit_errors, (unsigned long long)c->bits_checked,
+                (unsigned long long)c->lat_count,
+                c->lat_mean / 1e3, sd / 1e3, c->lat_min / 1e3, c->lat_max / 1e3);
+    }
+    // rename() 전에 내용이 디스크에 있어야 전원이 나가도 빈 파일이 안 남음
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        fclose(fp);
+        unlink(tmp);
+        return -1;
+    }
+    if (fclose(fp) != 0 || rename(tmp, s->path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    s->dirty = 0;
+    return 0;
+}
+
+#endif /* UART_STATS_H */
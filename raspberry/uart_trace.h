@@ -0,0 +1,266 @@
+/*
+ * ============================================================================
+ * 메모리 안의 트레이스 링 (printf 대신)
+ * ============================================================================
+ *
+ * 기존 루프는 패킷 하나마다 10줄 가까이 출력했음
+ *   (배너, [SEND]/[RECV], print_hex 두세 번, read_line의 [DEBUG] 두 줄)
+ *   → 빠른 Baudrate에서는 터미널 출력이 측정보다 오래 걸리고 타이밍까지 흔듦
+ *
+ * 이 모듈:
+ *   측정 경로 - 고정 크기 이벤트를 미리 잡아 둔 링에 쓰기만 함 (I/O 없음)
+ *               시각, 종류, 숫자 두 개, 바이트 최대 TRACE_DATA_MAX개
+ *   덤프      - 필요할 때만 최근 N개 패킷 분량을 사람이 읽는 형태로 출력
+ *               SIGUSR1을 받았을 때 (kill -USR1 <pid>), 에러가 났을 때
+ *   --verbose - 이벤트를 쓰는 순간 바로 출력도 함 (예전처럼 보고 싶을 때)
+ *
+ * 레벨은 컴파일할 때 정함 (TRACE_LEVEL보다 자세한 호출은 코드에서 사라짐)
+ *   기본 TRACE_LVL_INFO  - 패킷 송수신/결과 (릴리스)
+ *   -DTRACE_LEVEL=3      - read_line 내부 같은 디버그 이벤트까지
+ *
+ * 락 없이 여러 스레드가 씀 (스레드 모드는 송신/수신 스레드 둘 다):
+ *   쓰기: head를 fetch_add로 하나 가져가서 그 슬롯을 씀
+ *         슬롯의 seq를 0(쓰는 중)으로 → 내용 → seq = 번호+1 (release)
+ *   읽기: seq를 읽고 → 내용 복사 → seq를 다시 읽어서 같을 때만 사용 (seqlock)
+ *         쓰는 중이거나 그 사이에 덮어써진 슬롯은 건너뜀
+ *   링이 한 바퀴 돌면 가장 오래된 이벤트부터 덮어씀 (측정은 절대 기다리지 않음)
+ */
+#ifndef UART_TRACE_H
+#define UART_TRACE_H
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "uart_clock.h"
+
+#define TRACE_LVL_ERROR 0
+#define TRACE_LVL_WARN  1
+#define TRACE_LVL_INFO  2
+#define TRACE_LVL_DEBUG 3
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LVL_INFO
+#endif
+
+#define TRACE_RING_EVENTS  2048     // 2의 거듭제곱 (패킷당 이벤트 4~6개 → 수백 패킷)
+#define TRACE_DATA_MAX     80       // 이벤트 하나에 남기는 바이트 (긴 줄은 앞부분만)
+#define TRACE_DUMP_PACKETS 16       // SIGUSR1 덤프의 기본 패킷 수
+
+enum trace_kind {
+    TE_LOOP,        // 기존 루프 한 바퀴 시작 (a = 루프 번호)
+    TE_SEND,        // 보낸 패킷 (a = write() 반환값)
+    TE_RECV,        // read_line()으로 받은 줄 그대로
+    TE_TRIM,        // 앞뒤 공백을 잘라낸 에코
+    TE_LATENCY,     // a, b = 첫/마지막 바이트 도착까지 (ns)
+    TE_DIFF,        // a = 비트 에러, b = 편집 거리
+    TE_RESULT,      // a = 0 OK, 1 ERR
+    TE_TIMEOUT,     // 응답 없음 (a = read_line 반환값)
+    TE_READ,        // read_line() 내부 (a = 길이, b = read() 횟수)
+    TE_TX,          // 윈도우 모드에서 보낸 패킷 (a = 시퀀스)
+    TE_ECHO,        // 윈도우 모드의 판정 (a = 시퀀스, b = enum echo_result, 데이터 = 에코)
+    TE_NOTE         // 자유 문자열
+};
+
+struct trace_event {
+    atomic_uint_fast64_t seq;   // 0 = 쓰는 중, 아니면 이벤트 번호 + 1
+    uint64_t t;                 // mono_ns()
+    uint8_t  kind;
+    uint8_t  level;
+    uint8_t  port;              // 포트 번호 (--port 순서, 단일 포트는 0)
+    uint8_t  n;                 // data에 남긴 바이트 수
+    uint32_t len;               // 원래 길이 (n보다 크면 잘린 것)
+    int64_t  a, b;
+    uint8_t  data[TRACE_DATA_MAX];
+};
+
+struct trace_ring {
+    atomic_uint_fast64_t head;  // 다음 이벤트 번호
+    uint64_t t0;                // 덤프의 시각 기준 (trace_init)
+    FILE    *echo;              // NULL이 아니면 쓰는 즉시 출력 (--verbose)
+    struct trace_event ev[TRACE_RING_EVENTS];
+};
+
+/* 프로그램 하나에 링 하나 (약 230KB) */
+static struct trace_ring trace_buf;
+
+/* SIGUSR1 → 플래그만 세우고, 측정 루프가 trace_poll()에서 덤프 */
+static volatile sig_atomic_t trace_dump_requested = 0;
+
+static inline void trace_on_signal(int sig) {
+    (void)sig;
+    trace_dump_requested = 1;
+}
+
+static inline void trace_init(FILE *echo) {
+    atomic_init(&trace_buf.head, 0);
+    for (int i = 0; i < TRACE_RING_EVENTS; i++) {
+        atomic_init(&trace_buf.ev[i].seq, 0);
+    }
+    trace_buf.t0 = mono_ns();
+    trace_buf.echo = echo;
+}
+
+static inline const char *trace_kind_name(int kind) {
+    static const char *const names[] = {
+        "LOOP", "SEND", "RECV", "TRIM", "LATENCY", "DIFF",
+        "RESULT", "TIMEOUT", "READ", "TX", "ECHO", "NOTE"
+    };
+    return kind >= 0 && kind <= TE_NOTE ? names[kind] : "?";
+}
+
+/* 이벤트 한 줄 (바이트는 16진수 + 출력 가능한 글자) */
+static inline void trace_format(FILE *fp, const struct trace_event *e) {
+    static const char *const echo_names[] = { "OK", "ERR", "TIMEOUT" };
+    double t = e->t >= trace_buf.t0 ? (double)(e->t - trace_buf.t0) / 1e9 : 0.0;
+    const char *sep = " ";
+
+    fprintf(fp, "[%11.6f] p%u %-7s ", t, e->port, trace_kind_name(e->kind));
+    switch (e->kind) {
+    case TE_LOOP:    fprintf(fp, "loop %lld", (long long)e->a); break;
+    case TE_SEND:    fprintf(fp, "written %lld", (long long)e->a); break;
+    case TE_LATENCY: fprintf(fp, "first %.1f us, last %.1f us", e->a / 1e3, e->b / 1e3); break;
+    case TE_DIFF:    fprintf(fp, "bits=%lld edit=%lld", (long long)e->a, (long long)e->b); break;
+    case TE_RESULT:  fprintf(fp, "%s", e->a ? "ERR" : "OK"); break;
+    case TE_TIMEOUT: fprintf(fp, "no response (len=%lld)", (long long)e->a); break;
+    case TE_READ:    fprintf(fp, "idx=%lld reads=%lld", (long long)e->a, (long long)e->b); break;
+    case TE_TX:      fprintf(fp, "seq=%04llX", (unsigned long long)e->a); break;
+    case TE_ECHO:
+        fprintf(fp, "seq=%04llX %s", (unsigned long long)e->a,
+                e->b >= 0 && e->b <= 2 ? echo_names[e->b] : "?");
+        break;
+    default: sep = ""; break;
+    }
+    if (e->len > 0 || e->kind == TE_RECV || e->kind == TE_TRIM) {
+        fprintf(fp, "%s[len=%u]:", sep, e->len);
+        for (int i = 0; i < e->n; i++) {
+            fprintf(fp, " %02X", e->data[i]);
+        }
+        fprintf(fp, "%s | \"", e->n < e->len ? " ..." : "");
+        for (int i = 0; i < e->n; i++) {
+            fputc(e->data[i] >= 32 && e->data[i] <= 126 ? e->data[i] : '.', fp);
+        }
+        fputc('"', fp);
+    }
+    fputc('\n', fp);
+}
+
+/* 이벤트 하나 기록 (측정 경로, 어느 스레드에서든) */
+static inline void trace_emit(int level, int kind, int port, int64_t a, int64_t b,
+                              const void *data, size_t len) {
+    uint64_t idx = atomic_fetch_add_explicit(&trace_buf.head, 1, memory_order_relaxed);
+    struct trace_event *e = &trace_buf.ev[idx & (TRACE_RING_EVENTS - 1)];
+
+    atomic_store_explicit(&e->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    e->t = mono_ns();
+    e->kind = (uint8_t)kind;
+    e->level = (uint8_t)level;
+    e->port = (uint8_t)port;
+    e->a = a;
+    e->b = b;
+    e->len = (uint32_t)len;
+    e->n = (uint8_t)(len < TRACE_DATA_MAX ? len : TRACE_DATA_MAX);
+    if (e->n > 0) {
+        memcpy(e->data, data, e->n);
+    }
+    atomic_store_explicit(&e->seq, idx + 1, memory_order_release);
+
+    if (trace_buf.echo) {
+        trace_format(trace_buf.echo, e);
+    }
+}
+
+/*
+ * 컴파일할 때 걸러지는 기록 매크로
+ *   TRACE_LEVEL보다 자세한 레벨은 인자까지 통째로 사라짐
+ */
+#define TRACE_AT(lvl, kind, port, a, b, data, len) \
+    trace_emit((lvl), (kind), (port), (int64_t)(a), (int64_t)(b), (data), (size_t)(len))
+
+#define TRACE_ERROR(...) TRACE_AT(TRACE_LVL_ERROR, __VA_ARGS__)
+
+#if TRACE_LEVEL >= TRACE_LVL_WARN
+#define TRACE_WARN(...) TRACE_AT(TRACE_LVL_WARN, __VA_ARGS__)
+#else
+#define TRACE_WARN(...) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LVL_INFO
+#define TRACE_INFO(...) TRACE_AT(TRACE_LVL_INFO, __VA_ARGS__)
+#else
+#define TRACE_INFO(...) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LVL_DEBUG
+#define TRACE_DEBUG(...) TRACE_AT(TRACE_LVL_DEBUG, __VA_ARGS__)
+#else
+#define TRACE_DEBUG(...) ((void)0)
+#endif
+
+/*
+ * 최근 packets개 패킷 분량을 오래된 것부터 출력 (0 = 링 전체)
+ *   패킷의 시작은 TE_LOOP(기존 루프) 또는 TE_TX(윈도우 모드)
+ *   덤프하는 동안에도 측정 스레드는 계속 써도 됨 (덮어써진 슬롯은 건너뜀)
+ */
+static inline void trace_dump(FILE *fp, unsigned packets, const char *why) {
+    static struct trace_event copy[TRACE_RING_EVENTS];     // 덤프는 한 번에 하나
+    uint64_t head = atomic_load_explicit(&trace_buf.head, memory_order_acquire);
+    uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+    int n = 0;
+
+    for (uint64_t i = first; i < head; i++) {
+        struct trace_event *e = &trace_buf.ev[i & (TRACE_RING_EVENTS - 1)];
+        uint64_t s1 = atomic_load_explicit(&e->seq, memory_order_acquire);
+        if (s1 != i + 1) {
+            continue;       // 쓰는 중이거나 이미 새 이벤트로 덮어씀
+        }
+        copy[n].t = e->t;
+        copy[n].kind = e->kind;
+        copy[n].level = e->level;
+        copy[n].port = e->port;
+        copy[n].n = e->n;
+        copy[n].len = e->len;
+        copy[n].a = e->a;
+        copy[n].b = e->b;
+        memcpy(copy[n].data, e->data, sizeof(copy[n].data));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&e->seq, memory_order_relaxed) == s1) {
+            n++;
+        }
+    }
+
+    // 뒤에서부터 패킷 시작 이벤트를 packets개 셈
+    int start = 0;
+    if (packets > 0) {
+        unsigned seen = 0;
+        for (int i = n - 1; i >= 0; i--) {
+            if (copy[i].kind == TE_LOOP || copy[i].kind == TE_TX) {
+                if (++seen == packets) {
+                    start = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    fprintf(fp, "---- trace dump (%s): %d events, %llu written ----\n",
+            why, n - start, (unsigned long long)head);
+    for (int i = start; i < n; i++) {
+        trace_format(fp, &copy[i]);
+    }
+    fprintf(fp, "---- end of trace ----\n");
+    fflush(fp);
+}
+
+/* SIGUSR1을 받았으면 덤프 (측정 루프가 한 바퀴마다 부름, 평소에는 플래그 확인뿐) */
+static inline void trace_poll(FILE *fp, unsigned packets) {
+    if (trace_dump_requested) {
+        trace_dump_requested = 0;
+        trace_dump(fp, packets, "SIGUSR1");
+    }
+}
+
+#endif /* UART_TRACE_H */
@@ -0,0 +1,617 @@
+/*
+ * ============================================================================
+ * 슬라이딩 윈도우 에코 엔진 (파이프라이닝)
+ * ============================================================================
+ *
+ * 기존 루프 (stop-and-wait):
+ *   보내기 → tcdrain → 100ms 대기 → 한 줄 읽기 → 100ms 대기 → 반복
+ *   Baudrate와 무관하게 초당 4~5 패킷이 한계
+ *   (921600 bps에서도 9600 bps와 같은 수의 샘플밖에 못 모음)
+ *
+ * 이 엔진:
+ *   응답을 기다리지 않고 최대 N개의 패킷을 동시에 "비행 중(in-flight)"으로 유지
+ *   각 패킷 앞에 시퀀스 번호를 붙여서, 돌아온 에코를 번호로 짝지음
+ *   → 처리량이 sleep이 아니라 선로 속도(wire rate)로 결정됨
+ *
+ * 회선 포맷 (텍스트 모드):
+ *   "SSSS:PAYLOAD\n"
+ *   SSSS    = 16진수 4자리 시퀀스 번호 (0000 ~ FFFF, 한 바퀴 돌면 다시 0000)
+ *   PAYLOAD = 기존과 같은 랜덤 영숫자 문자열
+ *   아두이노 에코 펌웨어는 줄 단위로 그대로 돌려보내므로 수정 불필요
+ *
+ * 회선 포맷 (바이너리 모드, uart_frame.h):
+ *   COBS(DATA 프레임: type, seq, len, payload, CRC-16) + 0x00
+ *   번호는 프레임 헤더의 seq, CRC가 틀리면 "헤더 깨짐"(규칙 4)으로 처리
+ *
+ * 방향 분리 모드 (--split, uart_frame.h 참고):
+ *   펌웨어는 에코 대신 seq로 만든 페이로드를 GEN/GEN_BAD 프레임으로 돌려보냄
+ *   짝짓기 규칙은 같고, 비교 대상만 보낸 페이로드 대신 window_expect()
+ *   상향: 프레임 종류 (GEN = 펌웨어가 받은 프레임 정상, GEN_BAD = 깨짐)
+ *   하향: 돌아온 프레임의 CRC (깨졌으면 비트 비교도 하향 에러만 셈)
+ *         깨진 프레임은 보냈을 프레임과 회선 바이트끼리 맞춰서 비교 (window_split_realign)
+ *         인코딩 길이부터 다르면 비교하지 않음 (BER에서 빠짐)
+ *   왕복 판정(OK/ERR)은 지금과 같음: 어느 한쪽이라도 깨지면 ERR
+ *
+ * 짝짓기 규칙:
+ *   아두이노는 받은 순서대로 돌려보냄 (FIFO) → 기대하는 번호는 항상 "가장 오래된 패킷"
+ *   1. 번호가 가장 오래된 패킷과 같음     → 페이로드 비교 → OK / ERR
+ *   2. 번호가 더 뒤의 패킷과 같음          → 그 앞의 패킷들은 에코가 사라진 것 → TIMEOUT
+ *      (단, 페이로드가 가장 오래된 패킷과 같으면 헤더 숫자만 깨진 것 → 그 패킷 ERR)
+ *   3. 번호가 이미 처리된 패킷 (늦은 에코) → 버림 (stale)
+ *   4. 헤더가 깨져서 번호를 못 읽음        → 가장 오래된 패킷의 깨진 에코로 보고 ERR
+ *   그리고 timeout_ns 안에 에코가 안 오면 TIMEOUT
+ *
+ * 페이로드 길이 (--len, 1 ~ WIN_MAX_PAYLOAD):
+ *   슬롯마다 최대 길이를 잡아 두면 4KB × 윈도우 1024 = 4MB를 늘 들고 있게 되므로
+ *   window_init()에서 실제 최대 길이(max_len)만큼의 페이로드 풀을 한 번에 잡고
+ *   슬롯은 풀의 자기 자리를 가리키기만 함 (측정 중에는 malloc 없음)
+ *
+ * I/O는 하지 않음 (소켓/파일 디스크립터를 모름)
+ *   → 호출하는 쪽에서 write/read 하고 결과만 이 엔진에 넘김
+ *   → 같은 엔진을 여러 포트, 여러 실행 모드에서 재사용 가능
+ */
+#ifndef UART_WINDOW_H
+#define UART_WINDOW_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../uart_send_input/uart_frame.h"   // 바이너리 모드 (COBS + CRC)
+
+/*
+ * 페이로드 최대 길이 (null 제외, --len의 상한)
+ * 바이너리 프레임의 len 필드는 16비트지만 수신 링(RX_RING_SIZE)에
+ * 에코 여러 개가 들어가야 하므로 4KB로 제한
+ */
+#define WIN_MAX_PAYLOAD 4096
+
+/*
+ * 윈도우 크기 N의 상한
+ * 시퀀스 번호가 16비트라서 비행 중인 번호가 번호 공간의 절반을 넘으면
+ * 늦은 에코(stale)와 앞선 에코를 거리로 구별할 수 없음
+ */
+#define WIN_MAX_WINDOW 32768
+
+/* "SSSS:" 헤더 길이 */
+#define WIN_HDR_LEN 5
+
+/* 회선에 나가는 한 줄의 최대 길이: 헤더 + 페이로드 + '\n' */
+#define WIN_MAX_LINE (WIN_HDR_LEN + WIN_MAX_PAYLOAD + 1)
+
+/*
+ * 회선에 나가는 패킷 하나의 최대 길이 (텍스트 줄과 바이너리 프레임 중 큰 쪽)
+ * 바이너리 프레임 = COBS(헤더 5 + 페이로드 + CRC 2) + 구분자
+ */
+#define WIN_MAX_WIRE FRAME_MAX_WIRE(WIN_MAX_PAYLOAD)
+
+enum echo_result {
+    ECHO_OK,        // 에코가 보낸 것과 정확히 일치
+    ECHO_ERR,       // 에코가 왔지만 내용이 다름
+    ECHO_TIMEOUT    // 에코가 오지 않음
+};
+
+static inline const char *echo_result_name(enum echo_result r) {
+    switch (r) {
+    case ECHO_OK:  return "OK";
+    case ECHO_ERR: return "ERR";
+    default:       return "TIMEOUT";
+    }
+}
+
+/*
+ * 비행 중인 패킷 하나
+ */
+struct inflight {
+    uint16_t seq;                        // 시퀀스 번호
+    int      len;                        // 페이로드 길이
+    uint64_t t_send;                     // write() 완료 시각 (mono_ns)
+    uint64_t t_write;                    // 지연 측정용 write() 시각 (mono_raw_ns, 0 = 모름)
+    char    *payload;                    // 페이로드 풀의 자기 자리 (len + 1바이트 이상)
+};
+
+/*
+ * 결과 콜백
+ *   pkt    - 완료된 패킷 (콜백이 끝나면 슬롯이 재사용되므로 복사해서 쓸 것)
+ *   r      - 판정
+ *   rx     - 수신된 페이로드 (헤더와 앞뒤 공백 제거됨, TIMEOUT이면 NULL)
+ *   rx_len - rx 길이
+ *   now    - 판정 시각 (mono_ns)
+ */
+typedef void (*echo_result_fn)(void *ctx, const struct inflight *pkt,
+                               enum echo_result r,
+                               const char *rx, int rx_len, uint64_t now);
+
+struct echo_window {
+    struct inflight *slots;
+    char     *pool;           // 슬롯들의 페이로드 (cap × (max_len + 1))
+    int       max_len;        // 등록할 수 있는 페이로드 최대 길이
+    unsigned  cap;            // 슬롯 배열 크기 (2의 거듭제곱, size 이상)
+    unsigned  size;           // 윈도우 크기 N (동시에 비행 가능한 패킷 수)
+    unsigned  outstanding;    // 현재 비행 중인 패킷 수
+    uint16_t  next_seq;       // 다음에 보낼 번호
+    uint16_t  oldest;         // 가장 오래된 비행 중 패킷 번호
+    uint64_t  timeout_ns;     // 에코 대기 한도
+
+    // 통계
+    uint64_t  sent;
+    uint64_t  ok;
+    uint64_t  err;
+    uint64_t  timeouts;
+    uint64_t  stale;          // 이미 처리된 번호로 늦게 도착한 에코
+    uint64_t  bad_frames;     // CRC/COBS가 깨진 프레임 (바이너리 모드)
+    uint64_t  raw_echoes;     // 그중 페이로드 위치를 몰라서 비트 비교를 안 한 것
+    uint64_t  ok_bytes;       // OK 패킷의 페이로드 바이트 합 (goodput 계산용)
+
+    // 방향 분리 모드 (split = 1일 때만)
+    int       split;
+    uint64_t  up_ok, up_err;        // 하향이 멀쩡히 온 응답의 상향 판정 (GEN / GEN_BAD)
+    uint64_t  down_ok, down_err;    // 응답 프레임의 CRC가 맞음 / 깨짐
+    uint64_t  fw_up_ok, fw_up_bad;  // 펌웨어가 대역 안으로 알려 준 상향 누적 (CTRL "OK STATS")
+    int       fw_stats;             // fw_up_*를 한 번이라도 받았는지
+
+    // 지금 처리 중인 에코의 첫/마지막 바이트 도착 시각 (mono_raw_ns, 0 = 모름)
+    // window_on_line()/window_on_frame() 전에 호출자가 uart_rx의 t_first/t_last로 채움
+    uint64_t  echo_first;
+    uint64_t  echo_last;
+
+    // 지금 넘기는 에코의 페이로드 위치를 모름 (window_on_frame()이 결과 콜백 동안만 1)
+    // → 콜백은 ERR로만 세고 비트 비교(BER)에서 뺌
+    int       echo_raw;
+
+    echo_result_fn on_result;
+    void          *ctx;
+};
+
+/*
+ * 윈도우 초기화
+ *   size    - 윈도우 크기 (1 ~ WIN_MAX_WINDOW)
+ *   max_len - 보낼 페이로드의 최대 길이 (1 ~ WIN_MAX_PAYLOAD)
+ * 반환값: 성공 0, 메모리 부족 또는 크기/길이 범위 밖 -1
+ */
+static inline int window_init(struct echo_window *w, unsigned size, int max_len,
+                              uint64_t timeout_ns,
+                              echo_result_fn on_result, void *ctx) {
+    memset(w, 0, sizeof(*w));
+
+    // 범위를 먼저 봐야 아래 루프가 끝남 (size > 2^31이면 cap이 0으로 넘쳐서 무한 루프)
+    if (size < 1 || size > WIN_MAX_WINDOW || max_len < 1 || max_len > WIN_MAX_PAYLOAD) {
+        return -1;
+    }
+
+    // 시퀀스 번호로 슬롯을 바로 찾기 위해 (seq & (cap-1))
+    // cap은 2의 거듭제곱이어야 함 → 65536의 약수이므로 번호가 한 바퀴 돌아도 안전
+    unsigned cap = 1;
+    while (cap < size) {
+        cap <<= 1;
+    }
+
+    w->slots = calloc(cap, sizeof(*w->slots));
+    w->pool = malloc((size_t)cap * (size_t)(max_len + 1));
+    if (!w->slots || !w->pool) {
+        free(w->slots);
+        free(w->pool);
+        w->slots = NULL;
+        w->pool = NULL;
+        return -1;
+    }
+    for (unsigned i = 0; i < cap; i++) {
+        w->slots[i].payload = w->pool + (size_t)i * (size_t)(max_len + 1);
+    }
+    w->max_len = max_len;
+    w->cap = cap;
+    w->size = size;
+    w->timeout_ns = timeout_ns;
+    w->on_result = on_result;
+    w->ctx = ctx;
+    return 0;
+}
+
+static inline void window_free(struct echo_window *w) {
+    free(w->slots);
+    free(w->pool);
+    w->slots = NULL;
+    w->pool = NULL;
+}
+
+static inline int window_has_room(const struct echo_window *w) {
+    return w->outstanding < w->size;
+}
+
+static inline struct inflight *window_slot(struct echo_window *w, uint16_t seq) {
+    return &w->slots[seq & (w->cap - 1)];
+}
+
+/*
+ * 새 패킷을 윈도우에 등록
+ *   payload를 복사하고 번호를 매김
+ *   payload가 NULL이면 복사하지 않음 → 호출자가 반환된 슬롯의 payload에 직접 채움
+ *   회선에 보낼 문자열은 window_format()으로 만듦
+ * 반환값: 등록된 슬롯 (윈도우가 꽉 찼으면 NULL)
+ */
+static inline struct inflight *window_push(struct echo_window *w,
+                                           const char *payload, int len,
+                                           uint64_t now) {
+    if (!window_has_room(w) || len > w->max_len) {
+        return NULL;
+    }
+
+    struct inflight *p = window_slot(w, w->next_seq);
+    p->seq = w->next_seq;
+    p->len = len;
+    p->t_send = now;
+    p->t_write = 0;
+    if (payload) {
+        memcpy(p->payload, payload, len);
+        p->payload[len] = '\0';
+    }
+
+    w->next_seq++;
+    w->outstanding++;
+    w->sent++;
+    return p;
+}
+
+/*
+ * first부터 연속으로 보낸 n개 패킷의 write() 완료 시각 기록 (지연 측정용)
+ * 그 사이에 판정이 끝나 윈도우에서 빠진 패킷은 건너뜀
+ */
+static inline void window_mark_written(struct echo_window *w, uint16_t first,
+                                       unsigned n, uint64_t t_raw) {
+    for (unsigned i = 0; i < n; i++) {
+        uint16_t seq = (uint16_t)(first + i);
+        if ((uint16_t)(seq - w->oldest) < w->outstanding) {
+            window_slot(w, seq)->t_write = t_raw;
+        }
+    }
+}
+
+/*
+ * 회선 포맷 "SSSS:PAYLOAD\n" 으로 변환
+ * 반환값: 만든 바이트 수 (null 제외)
+ */
+static inline int window_format(const struct inflight *p, char *out, size_t cap) {
+    return snprintf(out, cap, "%04X:%s\n", p->seq, p->payload);
+}
+
+/*
+ * 에코로 돌아와야 하는 페이로드
+ *   보통은 보낸 페이로드 그대로, 방향 분리 모드에서는 펌웨어가 seq로 만든 것
+ *   buf는 WIN_MAX_PAYLOAD 이상 (방향 분리 모드에서만 씀)
+ */
+static inline const char *window_expect(const struct echo_window *w,
+                                        const struct inflight *p, char *buf) {
+    if (!w->split) {
+        return p->payload;
+    }
+    frame_gen_payload(p->seq, (uint8_t *)buf, (size_t)p->len);
+    return buf;
+}
+
+/*
+ * 가장 오래된 패킷을 판정하고 윈도우에서 제거
+ */
+static inline void window_retire(struct echo_window *w, enum echo_result r,
+                                 const char *rx, int rx_len, uint64_t now) {
+    struct inflight *p = window_slot(w, w->oldest);
+
+    switch (r) {
+    case ECHO_OK:
+        w->ok++;
+        w->ok_bytes += p->len;
+        break;
+    case ECHO_ERR:
+        w->err++;
+        break;
+    case ECHO_TIMEOUT:
+        w->timeouts++;
+        break;
+    }
+
+    if (w->on_result) {
+        w->on_result(w->ctx, p, r, rx, rx_len, now);
+    }
+
+    w->oldest++;
+    w->outstanding--;
+}
+
+/*
+ * 16진수 4자리 + ':' 헤더 해석
+ * 반환값: 시퀀스 번호 (0~65535), 형식이 깨졌으면 -1
+ */
+static inline int window_parse_seq(const char *s, int len) {
+    if (len < WIN_HDR_LEN || s[4] != ':') {
+        return -1;
+    }
+
+    int seq = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        int v;
+        if (c >= '0' && c <= '9')      v = c - '0';
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else return -1;
+        seq = (seq << 4) | v;
+    }
+    return seq;
+}
+
+/*
+ * 시퀀스 번호를 읽어낸 에코를 윈도우와 짝지음 (텍스트/바이너리 공통)
+ *   seq        - 에코의 번호, 헤더가 깨져서 믿을 수 없으면 -1
+ *   rx, rx_len - 에코의 페이로드 (헤더가 깨졌으면 페이로드로 추정되는 부분)
+ *                결과 콜백에 그대로 넘어가서 비트 단위 비교에 쓰임
+ *   up_bad     - 펌웨어가 상향 프레임이 깨졌다고 알려 옴 (GEN_BAD)
+ *                페이로드가 맞아도 ERR
+ */
+static inline void window_match_dir(struct echo_window *w, int seq,
+                                    const char *rx, int rx_len, int up_bad,
+                                    uint64_t now) {
+    char expect[WIN_MAX_PAYLOAD];
+    if (w->outstanding == 0) {
+        w->stale++; // 기다리는 패킷이 없는데 온 에코
+        return;
+    }
+
+    if (seq < 0) {
+        // 헤더가 깨짐 → 번호를 믿을 수 없으니 가장 오래된 패킷의 에코로 간주
+        window_retire(w, ECHO_ERR, rx, rx_len, now);
+        return;
+    }
+
+    // 가장 오래된 패킷으로부터의 거리 (uint16_t로 계산해서 번호 순환 처리)
+    uint16_t dist = (uint16_t)((uint16_t)seq - w->oldest);
+    if (dist >= w->outstanding) {
+        w->stale++; // 이미 타임아웃 처리된 패킷의 늦은 에코
+        return;
+    }
+
+    // 헤더의 숫자 하나가 다른 유효한 16진수로 깨진 경우:
+    // 페이로드가 가장 오래된 패킷과 같으면 그 패킷의 (헤더가 깨진) 에코로 봄
+    if (dist > 0) {
+        struct inflight *head = window_slot(w, w->oldest);
+        if (rx_len == head->len && memcmp(rx, window_expect(w, head, expect), rx_len) == 0) {
+            window_retire(w, ECHO_ERR, rx, rx_len, now);
+            return;
+        }
+    }
+
+    // 중간에 빠진 에코들은 사라진 것으로 처리
+    while (dist-- > 0) {
+        window_retire(w, ECHO_TIMEOUT, NULL, 0, now);
+    }
+
+    struct inflight *p = window_slot(w, w->oldest);
+    enum echo_result r = (!up_bad && rx_len == p->len &&
+                          memcmp(rx, window_expect(w, p, expect), rx_len) == 0)
+                         ? ECHO_OK : ECHO_ERR;
+    window_retire(w, r, rx, rx_len, now);
+}
+
+static inline void window_match(struct echo_window *w, int seq,
+                                const char *rx, int rx_len, uint64_t now) {
+    window_match_dir(w, seq, rx, rx_len, 0, now);
+}
+
+/*
+ * 펌웨어의 CTRL "OK STATS <정상> <깨짐>" (방향 분리 모드의 상향 누적 카운터)
+ * 반환값: 해석했으면 1
+ */
+static inline int window_on_stats(struct echo_window *w, const char *msg, size_t len) {
+    char text[FRAME_CTRL_REPLY_MAX + 1];
+    unsigned long long ok, bad;
+    if (len >= sizeof(text)) {
+        return 0;
+    }
+    memcpy(text, msg, len);
+    text[len] = '\0';
+    if (sscanf(text, "OK STATS %llu %llu", &ok, &bad) != 2) {
+        return 0;
+    }
+    w->fw_up_ok = ok;
+    w->fw_up_bad = bad;
+    w->fw_stats = 1;
+    return 1;
+}
+
+/*
+ * 수신된 한 줄 처리 (개행 제외)
+ *   기존 main 루프와 같은 방식으로 앞뒤 공백/제어문자를 잘라낸 뒤 비교
+ *   '!'로 시작하는 줄은 펌웨어의 제어 응답이므로 에코로 보지 않음
+ */
+static inline void window_on_line(struct echo_window *w,
+                                  const char *line, int len, uint64_t now) {
+    // 앞쪽 공백/탭 제거
+    while (len > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        len--;
+    }
+    // 뒤쪽 공백/탭/CR/LF 제거
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t' ||
+                       line[len - 1] == '\r' || line[len - 1] == '\n')) {
+        len--;
+    }
+    if (len == 0 || line[0] == '!') {
+        return;     // 빈 줄 (\r\n의 잔여물 등) 또는 제어 응답
+    }
+
+    // 헤더 길이도 안 되는 줄은 전체를 페이로드로 봄
+    if (len < WIN_HDR_LEN) {
+        window_match(w, -1, line, len, now);
+        return;
+    }
+    window_match(w, window_parse_seq(line, len),
+                 line + WIN_HDR_LEN, len - WIN_HDR_LEN, now);
+}
+
+/*
+ * 방향 분리 모드에서 깨진 응답 프레임의 페이로드 자리를 회선 바이트로 복원
+ *   가장 오래된 패킷에 펌웨어가 보냈을 프레임은 seq로 정해짐 (GEN/GEN_BAD 중 가까운 쪽)
+ *   FRAME_GEN_MAX 프레임은 254바이트보다 짧아서 COBS의 i+1번째 바이트 = 원래의 i번째 바이트
+ *   → 받은 바이트와 보냈을 바이트의 XOR이 곧 회선에서 뒤집힌 비트
+ *     (코드 바이트가 깨져 0x00 위치가 틀어져도 풀어서 비교할 때처럼 밀리지 않음)
+ * 인코딩 길이가 다르면 (바이트 유실/끼어듦, 프레임 두 개가 붙음) 맞출 수 없음
+ * 비트의 1/4 넘게 다르면 가장 오래된 패킷의 프레임이 아닌 것으로 봄
+ * 반환값: 복원한 페이로드 길이, 못 맞추면 -1
+ */
+static inline int window_split_realign(struct echo_window *w,
+                                       const uint8_t *enc, int len, uint8_t *out) {
+    const struct inflight *p = window_slot(w, w->oldest);
+    if (p->len > FRAME_GEN_MAX) {
+        return -1;
+    }
+
+    uint8_t payload[FRAME_GEN_MAX];
+    uint8_t scratch[FRAME_GEN_MAX + FRAME_OVERHEAD];
+    uint8_t wire[2][FRAME_MAX_WIRE(FRAME_GEN_MAX)];
+    static const uint8_t types[2] = { FRAME_TYPE_GEN, FRAME_TYPE_GEN_BAD };
+    int best = -1, best_bits = 0;
+    frame_gen_payload(p->seq, payload, (size_t)p->len);
+    for (int t = 0; t < 2; t++) {
+        size_t n = frame_encode(types[t], p->seq, payload, (uint16_t)p->len,
+                                scratch, wire[t]);
+        if ((int)n - 1 != len) {            // n은 구분자 포함
+            return -1;
+        }
+        int bits = 0;
+        for (int i = 0; i < len; i++) {
+            bits += __builtin_popcount(enc[i] ^ wire[t][i]);
+        }
+        if (best < 0 || bits < best_bits) {
+            best = t;
+            best_bits = bits;
+        }
+    }
+    // 가장 오래된 패킷의 에코가 사라지고 다음 패킷의 응답이 깨져서 온 경우:
+    // 길이는 같아도 다른 seq의 프레임이라 비트의 절반쯤이 다름 → 반전으로 볼 수 없음
+    if (best_bits * 4 > len * 8) {
+        return -1;
+    }
+
+    const uint8_t *at = enc + 1 + FRAME_HDR_LEN;
+    const uint8_t *exp = wire[best] + 1 + FRAME_HDR_LEN;
+    for (int i = 0; i < p->len; i++) {
+        out[i] = (uint8_t)(payload[i] ^ at[i] ^ exp[i]);
+    }
+    return p->len;
+}
+
+/*
+ * 수신된 COBS 프레임 처리 (구분자 0x00 제외, 바이너리 모드)
+ *   CRC가 맞으면 번호를 믿을 수 있음
+ *   CRC가 틀리면 번호도 믿을 수 없으므로 텍스트의 "헤더 깨짐"과 같게 처리
+ *   CTRL 프레임(펌웨어 응답 또는 우리가 보낸 명령의 에코)은 무시
+ *   (방향 분리 모드의 "OK STATS"만 읽음)
+ */
+static inline void window_on_frame(struct echo_window *w,
+                                   const uint8_t *enc, int len, uint64_t now) {
+    uint8_t raw[WIN_MAX_WIRE];
+    int n = len <= (int)sizeof(raw) ? cobs_decode(enc, len, raw) : -1;
+
+    uint8_t type;
+    uint16_t seq, plen;
+    const uint8_t *payload;
+    if (n < 0 || frame_parse(raw, n, &type, &seq, &payload, &plen) < 0) {
+        // 헤더와 CRC를 뺀 가운데를 페이로드로 추정 (COBS부터 깨졌으면 통째로)
+        w->bad_frames++;
+        // 풀린 길이가 가장 오래된 패킷과 맞을 때만 가운데가 페이로드 자리와 일치
+        // COBS부터 깨졌거나 구분자가 깨져서 프레임 두 개가 붙은 경우는
+        // 코드 바이트/헤더/CRC까지 섞여서 밀려 있으므로 비교하면
+        // 비트 에러 대부분이 반전이 아니라 어긋남 → ERR로만 셈
+        int aligned = n >= FRAME_OVERHEAD && w->outstanding > 0 &&
+                      n - FRAME_OVERHEAD == window_slot(w, w->oldest)->len;
+        if (w->split) {
+            w->down_err++;
+            // 방향 분리 모드는 보냈을 프레임을 알고 있으므로 회선 바이트끼리 맞춤
+            // (풀린 길이가 맞아도 코드 바이트가 깨지면 0x00 자리가 틀어져 있음)
+            // 못 맞추면 다른 패킷의 응답일 수도 있으므로 비교하지 않음
+            uint8_t fixed[FRAME_GEN_MAX];
+            int flen = w->outstanding > 0 ? window_split_realign(w, enc, len, fixed) : -1;
+            if (flen >= 0) {
+                window_match(w, -1, (const char *)fixed, flen, now);
+                return;
+            }
+            aligned = 0;
+        }
+        if (!aligned && w->outstanding > 0) {
+            w->raw_echoes++;
+        }
+        w->echo_raw = !aligned;
+        if (n >= FRAME_OVERHEAD) {
+            window_match(w, -1, (const char *)raw + FRAME_HDR_LEN,
+                         n - FRAME_OVERHEAD, now);
+        } else {
+            window_match(w, -1, (const char *)(n < 0 ? enc : raw),
+                         n < 0 ? len : n, now);
+        }
+        w->echo_raw = 0;
+        return;
+    }
+    if (w->split) {
+        if (type == FRAME_TYPE_CTRL) {
+            window_on_stats(w, (const char *)payload, plen);
+            return;
+        }
+        if (type != FRAME_TYPE_GEN && type != FRAME_TYPE_GEN_BAD) {
+            return;
+        }
+        w->down_ok++;
+        if (type == FRAME_TYPE_GEN) {
+            w->up_ok++;
+        } else {
+            w->up_err++;
+        }
+        window_match_dir(w, seq, (const char *)payload, plen,
+                         type == FRAME_TYPE_GEN_BAD, now);
+        return;
+    }
+    if (type != FRAME_TYPE_DATA) {
+        return;
+    }
+
+    window_match(w, seq, (const char *)payload, plen, now);
+}
+
+/*
+ * 회선에 보낼 바이트 만들기
+ *   텍스트:   "SSSS:PAYLOAD\n"
+ *   바이너리: COBS(DATA 프레임) + 0x00
+ * out은 WIN_MAX_WIRE 이상이어야 함
+ * 반환값: 바이트 수
+ */
+static inline int window_wire(const struct inflight *p, int binary,
+                              char *out, size_t cap) {
+    if (!binary) {
+        return window_format(p, out, cap);
+    }
+    uint8_t scratch[WIN_MAX_PAYLOAD + FRAME_OVERHEAD];
+    return (int)frame_encode(FRAME_TYPE_DATA, p->seq,
+                             (const uint8_t *)p->payload, (uint16_t)p->len,
+                             scratch, (uint8_t *)out);
+}
+
+/*
+ * 가장 오래된 패킷의 타임아웃 시각
+ * 비행 중인 패킷이 없으면 UINT64_MAX
+ */
+static inline uint64_t window_next_deadline(const struct echo_window *w) {
+    if (w->outstanding == 0) {
+        return UINT64_MAX;
+    }
+    const struct inflight *p = &w->slots[w->oldest & (w->cap - 1)];
+    return p->t_send + w->timeout_ns;
+}
+
+/*
+ * 타임아웃이 지난 패킷 정리
+ */
+static inline void window_expire(struct echo_window *w, uint64_t now) {
+    while (w->outstanding > 0 && window_next_deadline(w) <= now) {
+        window_retire(w, ECHO_TIMEOUT, NULL, 0, now);
+    }
+}
+
+#endif /* UART_WINDOW_H */
@@ -0,0 +1,454 @@
+/*
+ * ============================================================================
+ * 에코 펌웨어 코어 (고정 링 버퍼, 컷스루, 힙 사용 없음)
+ * ============================================================================
+ *
+ * uart_send_input.ino가 loop()마다 echo_service()만 부름
+ * Serial 종류를 템플릿 인자로 받으므로 같은 코드를 리눅스에서
+ * 모의 Serial(host/echo_mock.h)로 빌드해서 부하 시험할 수 있음 (host/echo_host.cpp)
+ *
+ * 예전 구조의 문제:
+ *   readStringUntil('\n') → 힙 String에 줄 전체를 모은 뒤 trim() → print → flush()
+ *     - 줄이 다 들어올 때까지 에코가 시작되지 않음 (패킷 하나 분량의 저장 후 전달 지연)
+ *     - flush()가 송신 완료까지 기다리는 동안 수신을 안 읽음
+ *       → UNO의 수신 버퍼(64바이트)가 넘쳐서 460800 이상에서 바이트가 사라짐
+ *       → 호스트는 그걸 케이블 에러(ERR)로 셈
+ *     - String이 매 줄 할당/해제 → 2KB RAM에서 힙 단편화
+ *
+ * 지금 구조:
+ *   1. 수신: Serial.available()만큼 전부 바로 읽음 (하드웨어 버퍼가 찰 틈이 없음)
+ *   2. 바이트마다 에코할 바이트를 링 버퍼(ECHO_RING_SIZE)에 넣음 (컷스루)
+ *   3. 송신: Serial.availableForWrite()만큼만 씀 → write()가 절대 막히지 않음
+ *   flush()는 Baudrate를 바꾸기 직전에만 (응답이 이전 속도로 다 나가야 함)
+ *
+ * 텍스트 모드의 trim()을 바이트 단위로:
+ *   줄 앞의 공백은 버림, 줄 중간의 공백은 뒤에 공백이 아닌 글자가 올 때까지 보류
+ *   '\n'이 오면 보류한 공백을 버리고 '\n'만 보냄 → 결과는 trim()한 줄 + '\n'과 같음
+ *   '!'로 시작하는 줄은 에코하지 않고 cmd[]에 모아서 '\n'에서 처리
+ *   ECHO_LINE_IDLE_MS 동안 '\n'이 안 오면 줄이 끝난 것으로 봄 (예전 setTimeout(100))
+ *
+ * 방향 분리 모드 ("!SPLIT", uart_frame.h의 설명 참고):
+ *   상향 DATA 프레임을 에코하지 않고 CRC를 직접 확인한 뒤
+ *   seq로 만든 페이로드(frame_gen_payload)를 GEN/GEN_BAD 프레임으로 보냄
+ *   → 호스트는 하향 에러만 따로 보고, 상향 에러는 프레임 종류와 STATS로 앎
+ *
+ * 카운터 (echo_counters, "!STATS" 명령으로 조회):
+ *   ring_overflow - 링이 가득 차서 버린 에코 바이트 (0이 아니면 펌웨어 탓, 케이블 아님)
+ *   rx_high       - 한 번에 본 Serial.available() 최대값
+ *                   수신 버퍼 크기(UNO 64)에 닿았으면 그 사이에 바이트를 잃었을 수 있음
+ */
+#ifndef ECHO_CORE_H
+#define ECHO_CORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uart_frame.h"
+
+#define ECHO_DEFAULT_BAUD    460800
+#define ECHO_RING_SIZE       256    // 2의 거듭제곱 (UNO RAM 2KB)
+#define ECHO_CMD_MAX         24     // 텍스트 명령 최대 길이 ('!' 제외)
+#define ECHO_LINE_IDLE_MS    100    // '\n' 없이 이만큼 조용하면 줄 끝
+#define ECHO_STREAM_IDLE_MS  200    // 스트림 모드에서 이만큼 입력이 없으면 텍스트 모드로
+#define ECHO_BAUD_CONFIRM_MS 2000   // 새 속도에서 이 시간 안에 PING이 없으면 이전 속도로
+#define ECHO_BAUD_MIN        300
+#define ECHO_BAUD_MAX        2000000
+
+enum echo_mode {
+    ECHO_TEXT = 0,
+    ECHO_BINARY,        // "!BIN" 이후: COBS 프레임을 바이트 단위로 에코, CTRL 프레임 처리
+    ECHO_STREAM,        // "!STREAM" 이후: 해석 없이 에코 (호스트의 --ber)
+    ECHO_SPLIT          // "!SPLIT" 이후: 상향은 검사만, 하향은 만든 페이로드 (호스트의 --split)
+};
+
+enum echo_line {
+    LINE_START = 0,     // 줄 시작 (앞 공백 건너뜀)
+    LINE_DATA,          // 에코 중
+    LINE_CMD            // '!' 명령 모으는 중
+};
+
+struct echo_counters {
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t lines;         // 에코한 텍스트 줄
+    uint32_t commands;      // 처리한 텍스트/CTRL 명령
+    uint32_t frames_ok;     // 바이너리 모드에서 CRC가 맞은 프레임
+    uint32_t frames_bad;    // CRC/COBS가 깨진 프레임 (상향 링크 에러)
+    uint32_t ring_overflow; // 링이 가득 차서 버린 바이트
+    uint16_t ring_high;     // 링 사용량 최대값
+    uint16_t rx_high;       // Serial.available() 최대값
+};
+
+struct echo_core {
+    uint8_t  ring[ECHO_RING_SIZE];
+    uint16_t head, tail;    // head = 다음에 넣을 자리, tail = 다음에 보낼 자리
+
+    uint8_t  mode;          // enum echo_mode
+    uint8_t  line;          // enum echo_line
+    uint8_t  echoed;        // 이 줄에서 에코한 바이트가 있는지 (빈 줄은 '\n'도 안 보냄)
+    uint8_t  ws_held;       // 보류 중인 공백 수
+    uint8_t  ws[8];         // 보류 중인 공백 (넘치면 그냥 보냄)
+    uint8_t  cmd_len;
+    uint8_t  cmd_overflow;  // 명령이 ECHO_CMD_MAX보다 김 → !ERR
+    char     cmd[ECHO_CMD_MAX + 1];
+    unsigned long last_rx;  // 마지막 수신 시각 (ms)
+
+    struct frame_stream rx_stream;
+    struct frame_split  split;
+
+    long     baud;
+    long     previous_baud;
+    long     switch_to;     // 0이 아니면 링을 다 보낸 뒤 이 속도로 전환
+    uint8_t  baud_pending;  // 새 속도로 바꾼 뒤 아직 PING을 못 받음
+    unsigned long baud_changed_at;
+
+    struct echo_counters cnt;
+};
+
+static inline void echo_init(struct echo_core *c, long baud) {
+    memset(c, 0, sizeof(*c));
+    c->baud = c->previous_baud = baud;
+    frame_stream_reset(&c->rx_stream);
+}
+
+/* ---------------------------------------------------------------------------
+ * 링 버퍼
+ * ------------------------------------------------------------------------- */
+
+static inline uint16_t echo_ring_used(const struct echo_core *c) {
+    return (uint16_t)((c->head - c->tail) & (ECHO_RING_SIZE - 1));
+}
+
+static inline void echo_put(struct echo_core *c, uint8_t b) {
+    uint16_t used = echo_ring_used(c);
+    if (used >= ECHO_RING_SIZE - 1) {
+        c->cnt.ring_overflow++;
+        return;
+    }
+    c->ring[c->head] = b;
+    c->head = (uint16_t)((c->head + 1) & (ECHO_RING_SIZE - 1));
+    if (used + 1 > c->cnt.ring_high) {
+        c->cnt.ring_high = (uint16_t)(used + 1);
+    }
+}
+
+static inline void echo_write(struct echo_core *c, const uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        echo_put(c, p[i]);
+    }
+}
+
+static inline void echo_puts(struct echo_core *c, const char *s) {
+    echo_write(c, (const uint8_t *)s, strlen(s));
+}
+
+/* ---------------------------------------------------------------------------
+ * 명령 처리
+ * ------------------------------------------------------------------------- */
+
+// CTRL 프레임 응답 (예: "OK TEXT")
+static inline void echo_ctrl_reply(struct echo_core *c, const char *msg) {
+    uint8_t scratch[FRAME_CTRL_REPLY_MAX + FRAME_OVERHEAD];
+    uint8_t wire[FRAME_MAX_WIRE(FRAME_CTRL_REPLY_MAX)];
+    size_t len = strlen(msg);
+    if (len > FRAME_CTRL_REPLY_MAX) {
+        len = FRAME_CTRL_REPLY_MAX;
+    }
+    size_t n = frame_encode(FRAME_TYPE_CTRL, 0, (const uint8_t *)msg, (uint16_t)len,
+                            scratch, wire);
+    echo_write(c, wire, n);
+}
+
+// "!OK STATS rx=.. tx=.. ..." (한 줄)
+static inline void echo_stats_reply(struct echo_core *c) {
+    char buf[112];
+    snprintf(buf, sizeof(buf),
+             "!OK STATS rx=%lu tx=%lu lines=%lu bad=%lu ovf=%lu ring=%u rxhigh=%u\n",
+             (unsigned long)c->cnt.rx_bytes, (unsigned long)c->cnt.tx_bytes,
+             (unsigned long)c->cnt.lines, (unsigned long)c->cnt.frames_bad,
+             (unsigned long)c->cnt.ring_overflow, (unsigned)c->cnt.ring_high,
+             (unsigned)c->cnt.rx_high);
+    echo_puts(c, buf);
+}
+
+// 텍스트 모드 제어 명령 ("!BIN" → "!OK BIN")
+static inline void echo_text_command(struct echo_core *c, const char *cmd, unsigned long now) {
+    c->cnt.commands++;
+    if (c->cmd_overflow) {
+        echo_puts(c, "!ERR ");
+        echo_puts(c, cmd);
+        echo_puts(c, "\n");
+    } else if (strncmp(cmd, "BAUD ", 5) == 0) {
+        long baud = atol(cmd + 5);
+        echo_puts(c, baud < ECHO_BAUD_MIN || baud > ECHO_BAUD_MAX ? "!ERR " : "!OK ");
+        echo_puts(c, cmd);
+        echo_puts(c, "\n");
+        if (baud >= ECHO_BAUD_MIN && baud <= ECHO_BAUD_MAX) {
+            // 응답이 이전 속도로 다 나간 뒤에 전환 (echo_service)
+            c->previous_baud = c->baud;
+            c->switch_to = baud;
+            c->baud_pending = 1;
+            c->baud_changed_at = now;
+        }
+    } else if (strcmp(cmd, "BIN") == 0) {
+        echo_puts(c, "!OK BIN\n");
+        frame_stream_reset(&c->rx_stream);
+        c->mode = ECHO_BINARY;
+    } else if (strcmp(cmd, "SPLIT") == 0) {
+        echo_puts(c, "!OK SPLIT\n");
+        frame_stream_reset(&c->rx_stream);
+        frame_split_reset(&c->split);
+        c->mode = ECHO_SPLIT;
+    } else if (strcmp(cmd, "STREAM") == 0) {
+        echo_puts(c, "!OK STREAM\n");
+        c->mode = ECHO_STREAM;
+    } else if (strcmp(cmd, "STATS") == 0) {
+        echo_stats_reply(c);
+    } else if (strcmp(cmd, "PING") == 0 || strcmp(cmd, "TEXT") == 0) {
+        if (cmd[0] == 'P') {
+            c->baud_pending = 0;    // 호스트가 새 속도로 말을 걸어옴 → 확정
+        }
+        echo_puts(c, "!OK ");
+        echo_puts(c, cmd);
+        echo_puts(c, "\n");
+    } else {
+        echo_puts(c, "!ERR ");
+        echo_puts(c, cmd);
+        echo_puts(c, "\n");
+    }
+}
+
+// 상향 프레임 판정 누적: CTRL "OK STATS <정상> <깨짐>"
+// 방향 분리 모드는 DATA 프레임만, 바이너리 모드는 CTRL을 포함한 전체
+static inline void echo_ctrl_stats(struct echo_core *c) {
+    char reply[FRAME_CTRL_REPLY_MAX + 1];
+    int split = c->mode == ECHO_SPLIT;
+    snprintf(reply, sizeof(reply), "OK STATS %lu %lu",
+             (unsigned long)(split ? c->split.ok : c->cnt.frames_ok),
+             (unsigned long)(split ? c->split.bad : c->cnt.frames_bad));
+    echo_ctrl_reply(c, reply);
+}
+
+// 바이너리 모드 CTRL 프레임
+static inline void echo_ctrl_command(struct echo_core *c, const char *cmd) {
+    char reply[FRAME_STREAM_CTRL_MAX + 5];   // "ERR " + 명령
+    c->cnt.commands++;
+    if (strcmp(cmd, "STATS") == 0) {
+        echo_ctrl_stats(c);
+    } else if (strcmp(cmd, "TEXT") == 0) {
+        echo_ctrl_reply(c, "OK TEXT");
+        c->mode = ECHO_TEXT;
+        c->line = LINE_START;
+    } else if (strcmp(cmd, "PING") == 0 || strcmp(cmd, "BIN") == 0) {
+        snprintf(reply, sizeof(reply), "OK %s", cmd);
+        echo_ctrl_reply(c, reply);
+    } else {
+        snprintf(reply, sizeof(reply), "ERR %s", cmd);
+        echo_ctrl_reply(c, reply);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * 바이트 처리
+ * ------------------------------------------------------------------------- */
+
+static inline int echo_is_space(uint8_t b) {
+    return b == ' ' || b == '\t' || b == '\r' || b == '\v' || b == '\f';
+}
+
+// 텍스트 줄 끝 ('\n' 또는 ECHO_LINE_IDLE_MS 동안 조용함)
+static inline void echo_end_line(struct echo_core *c, unsigned long now) {
+    if (c->line == LINE_CMD) {
+        while (c->cmd_len > 0 && echo_is_space((uint8_t)c->cmd[c->cmd_len - 1])) {
+            c->cmd_len--;       // trim()의 뒤쪽 공백 제거
+        }
+        c->cmd[c->cmd_len] = '\0';
+        echo_text_command(c, c->cmd, now);
+    } else if (c->echoed) {
+        echo_put(c, '\n');
+        c->cnt.lines++;
+    }
+    c->line = LINE_START;
+    c->echoed = 0;
+    c->ws_held = 0;
+    c->cmd_len = 0;
+    c->cmd_overflow = 0;
+}
+
+static inline void echo_text_byte(struct echo_core *c, uint8_t b, unsigned long now) {
+    if (b == '\n') {
+        echo_end_line(c, now);
+        return;
+    }
+    switch (c->line) {
+    case LINE_START:
+        if (echo_is_space(b)) {
+            return;
+        }
+        if (b == '!') {
+            c->line = LINE_CMD;
+            return;
+        }
+        c->line = LINE_DATA;
+        // fall through
+    case LINE_DATA:
+        if (echo_is_space(b)) {
+            if (c->ws_held == sizeof(c->ws)) {
+                echo_write(c, c->ws, c->ws_held);   // 공백이 아주 길면 그냥 보냄
+                c->ws_held = 0;
+            }
+            c->ws[c->ws_held++] = b;
+            return;
+        }
+        if (c->ws_held > 0) {
+            echo_write(c, c->ws, c->ws_held);
+            c->ws_held = 0;
+        }
+        echo_put(c, b);
+        c->echoed = 1;
+        return;
+    case LINE_CMD:
+        if (c->cmd_len < ECHO_CMD_MAX) {
+            c->cmd[c->cmd_len++] = (char)b;
+        } else {
+            c->cmd_overflow = 1;
+        }
+        return;
+    }
+}
+
+/* 받은 바이트 하나 처리 (now = millis()) */
+static inline void echo_rx_byte(struct echo_core *c, uint8_t b, unsigned long now) {
+    c->cnt.rx_bytes++;
+    c->last_rx = now;
+
+    switch (c->mode) {
+    case ECHO_STREAM:
+        echo_put(c, b);
+        return;
+    case ECHO_BINARY: {
+        // CTRL 프레임도 에코는 그대로 나감 (호스트는 DATA가 아닌 프레임을 무시)
+        // 구분자까지 넣은 뒤 응답 프레임을 이어서 넣음
+        echo_put(c, b);
+        int r = frame_stream_feed(&c->rx_stream, b);
+        if (r == FRAME_STREAM_OK) {
+            c->cnt.frames_ok++;
+            if (c->rx_stream.type == FRAME_TYPE_CTRL) {
+                echo_ctrl_command(c, c->rx_stream.ctrl);
+            }
+        } else if (r == FRAME_STREAM_BAD) {
+            c->cnt.frames_bad++;
+        }
+        return;
+    }
+    case ECHO_SPLIT: {
+        // 에코 없음: 프레임이 끝날 때마다 응답 프레임 하나
+        int r = frame_stream_feed(&c->rx_stream, b);
+        if (r == FRAME_STREAM_NONE) {
+            return;
+        }
+        if (r == FRAME_STREAM_OK) {
+            c->cnt.frames_ok++;
+            if (c->rx_stream.type == FRAME_TYPE_CTRL) {
+                echo_ctrl_command(c, c->rx_stream.ctrl);
+                return;
+            }
+        } else {
+            c->cnt.frames_bad++;
+        }
+        uint8_t scratch[FRAME_GEN_MAX + FRAME_OVERHEAD];
+        uint8_t wire[FRAME_MAX_WIRE(FRAME_GEN_MAX)];
+        size_t n = frame_split_reply(&c->split, &c->rx_stream, r, scratch, wire);
+        echo_write(c, wire, n);
+        if (n > 0 && (c->split.ok + c->split.bad) % FRAME_SPLIT_STATS_EVERY == 0) {
+            echo_ctrl_stats(c);     // 주기적으로 누적 카운터를 대역 안에서 알림
+        }
+        return;
+    }
+    default:
+        echo_text_byte(c, b, now);
+        return;
+    }
+}
+
+/* 시간 조건 (수신이 없어도 loop()마다) */
+static inline void echo_tick(struct echo_core *c, unsigned long now) {
+    // 새 속도에서 호스트가 연락이 없으면 (속도가 케이블에 너무 높음 등) 이전 속도로
+    if (c->baud_pending && !c->switch_to && now - c->baud_changed_at > ECHO_BAUD_CONFIRM_MS) {
+        c->switch_to = c->previous_baud;
+        c->baud_pending = 0;
+    }
+    if (c->mode == ECHO_STREAM && now - c->last_rx > ECHO_STREAM_IDLE_MS) {
+        c->mode = ECHO_TEXT;
+        c->line = LINE_START;
+    }
+    if (c->mode == ECHO_TEXT && c->line != LINE_START && now - c->last_rx > ECHO_LINE_IDLE_MS) {
+        echo_end_line(c, now);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Serial 연결 (아두이노 HardwareSerial 또는 host/echo_mock.h)
+ *   S에 필요한 것: available(), read(), availableForWrite(),
+ *                 write(const uint8_t *, size_t), flush(), end(), begin(long)
+ * ------------------------------------------------------------------------- */
+
+// 링 → Serial: 송신 버퍼에 빈 만큼만 (write()가 기다리지 않도록)
+template <class S>
+static inline void echo_drain(struct echo_core *c, S &serial) {
+    uint16_t used = echo_ring_used(c);
+    while (used > 0) {
+        int room = serial.availableForWrite();
+        if (room <= 0) {
+            return;
+        }
+        // 링 끝에서 끊기지 않는 구간만 한 번에
+        uint16_t chunk = (uint16_t)(ECHO_RING_SIZE - c->tail);
+        if (chunk > used) {
+            chunk = used;
+        }
+        if (chunk > room) {
+            chunk = (uint16_t)room;
+        }
+        serial.write(c->ring + c->tail, chunk);
+        c->tail = (uint16_t)((c->tail + chunk) & (ECHO_RING_SIZE - 1));
+        c->cnt.tx_bytes += chunk;
+        used -= chunk;
+    }
+}
+
+/* loop()마다 한 번 */
+template <class S>
+static inline void echo_service(struct echo_core *c, S &serial, unsigned long now) {
+    // 속도 전환 대기: 응답을 다 보낸 뒤에 (이때만 flush()로 송신 완료를 기다림)
+    if (c->switch_to) {
+        echo_drain(c, serial);
+        if (echo_ring_used(c) > 0) {
+            return;
+        }
+        serial.flush();
+        serial.end();
+        serial.begin(c->switch_to);
+        c->baud = c->switch_to;
+        c->switch_to = 0;
+        c->baud_changed_at = now;
+        return;
+    }
+
+    echo_tick(c, now);
+
+    // 수신 버퍼는 있는 만큼 전부 비움 (명령이 속도 전환을 걸면 거기서 멈춤)
+    int n = serial.available();
+    if (n > c->cnt.rx_high) {
+        c->cnt.rx_high = (uint16_t)n;
+    }
+    while (n-- > 0 && !c->switch_to) {
+        echo_rx_byte(c, (uint8_t)serial.read(), now);
+    }
+
+    echo_drain(c, serial);
+}
+
+#endif /* ECHO_CORE_H */
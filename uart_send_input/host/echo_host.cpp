@@ -0,0 +1,479 @@
+/*
+ * ============================================================================
+ * 에코 펌웨어 코어 호스트 시험 도구 (echo_host)
+ * ============================================================================
+ *
+ * echo_core.h를 아두이노가 아니라 리눅스에서 그대로 컴파일해서 돌림
+ * (.ino가 쓰는 것과 같은 echo_service(), Serial만 바꿔 끼움)
+ *
+ * 1. 부하 시험 (기본): 모의 Serial(echo_mock.h)에 호스트가 빈틈없이 패킷을 쏟아부음
+ *      Baudrate마다 잃은 바이트, 링 넘침, 망가진 패킷, 에코 지연(마지막 바이트 기준)
+ *      --legacy면 예전 루프(readStringUntil + print + flush)를 같은 모델로 돌려서 비교
+ *        → 460800 이상에서 rx FIFO가 넘쳐 바이트를 잃는 것이 재현됨
+ *      CPU 비용(--loop-us, --byte-us)은 16MHz UNO 기준 대략값
+ *
+ * 2. pty 모드 (--link PATH): 의사 터미널 반대쪽에서 코어를 실시간으로 돌림
+ *      claud_ver --device PATH로 실제 펌웨어 로직과 호스트를 맞물려 볼 수 있음
+ *      (uart_sim은 펌웨어를 따로 흉내 낸 것, 이쪽은 펌웨어 코드 자체)
+ *
+ * 사용법:
+ *   ./echo_host [--bauds LIST] [--count N] [--len L] [--mode text|binary|stream|split]
+ *               [--loop-us US] [--byte-us US] [--rx-buf N] [--legacy]
+ *   ./echo_host --link /tmp/ttyECHO &
+ *   ./claud_ver 1.5 460800 --device /tmp/ttyECHO --window 4 --count 10000
+ *
+ * 빌드 (uart_send_input/host에서):
+ *   g++ -O2 -std=c++17 -Wall -o echo_host echo_host.cpp
+ *   (아두이노 IDE는 스케치 폴더의 src/ 밖 하위 폴더를 컴파일하지 않음)
+ */
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../echo_core.h"
+#include "echo_mock.h"
+
+namespace {
+
+constexpr uint64_t NS_PER_US = 1000ULL;
+constexpr uint64_t NS_PER_MS = 1000000ULL;
+
+volatile sig_atomic_t stop_requested = 0;
+
+void on_stop_signal(int) {
+    stop_requested = 1;
+}
+
+uint64_t mono_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ---------------------------------------------------------------------------
+ * 부하 시험
+ * ------------------------------------------------------------------------- */
+
+enum class load_mode { text, binary, stream, split };
+
+struct load_opts {
+    load_mode mode = load_mode::text;
+    long      count = 2000;
+    int       len = 10;
+    uint64_t  loop_ns = 5 * NS_PER_US;
+    uint64_t  byte_ns = 4 * NS_PER_US;
+    size_t    rx_buf = 64;
+    bool      legacy = false;
+};
+
+struct load_result {
+    size_t   units = 0;         // 보낸 패킷(프레임)
+    size_t   intact = 0;        // 그대로 돌아온 패킷
+    uint64_t lost = 0;          // 모의 rx FIFO가 넘쳐서 잃은 바이트
+    uint32_t ring_overflow = 0;
+    uint32_t ring_high = 0;
+    uint32_t rx_high = 0;
+    double   lat_p50_us = 0;
+    double   lat_max_us = 0;
+    double   secs = 0;          // 가상 시간
+};
+
+// 단위(패킷/프레임)와 그 마지막 바이트가 장치에 도착한 시각
+// reply는 돌아와야 하는 바이트 (에코면 bytes와 같음, 방향 분리 모드는 GEN 프레임)
+struct unit {
+    std::string bytes;
+    std::string reply;
+    uint64_t    arrival = 0;
+};
+
+uint32_t xorshift(uint32_t &s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+std::vector<unit> make_units(const load_opts &o, uint32_t seed) {
+    static const char alnum[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    std::vector<unit> units;
+    uint32_t s = seed | 1;
+    std::vector<uint8_t> payload(o.len), scratch(o.len + FRAME_OVERHEAD),
+        wire(FRAME_MAX_WIRE(o.len));
+    for (long i = 0; i < o.count; i++) {
+        unit u;
+        if (o.mode == load_mode::text) {
+            for (int k = 0; k < o.len; k++) {
+                u.bytes += alnum[xorshift(s) % (sizeof(alnum) - 1)];
+            }
+            u.bytes += '\n';
+        } else {
+            for (int k = 0; k < o.len; k++) {
+                payload[k] = (uint8_t)xorshift(s);
+            }
+            if (o.mode == load_mode::binary || o.mode == load_mode::split) {
+                size_t n = frame_encode(FRAME_TYPE_DATA, (uint16_t)i, payload.data(),
+                                        (uint16_t)o.len, scratch.data(), wire.data());
+                u.bytes.assign((const char *)wire.data(), n);
+            } else {
+                u.bytes.assign((const char *)payload.data(), o.len);
+            }
+        }
+        u.reply = u.bytes;
+        if (o.mode == load_mode::split) {
+            // 펌웨어가 만들 응답: 같은 seq, 같은 길이의 frame_gen_payload()
+            frame_gen_payload((uint16_t)i, payload.data(), (size_t)o.len);
+            size_t n = frame_encode(FRAME_TYPE_GEN, (uint16_t)i, payload.data(),
+                                    (uint16_t)o.len, scratch.data(), wire.data());
+            u.reply.assign((const char *)wire.data(), n);
+        }
+        units.push_back(std::move(u));
+    }
+    return units;
+}
+
+/*
+ * 예전 uart_send_input.ino의 텍스트 루프 (비교용)
+ *   readStringUntil('\n') (100ms 타임아웃) → trim → print + '\n' → flush()
+ *   String에 붙이는 비용은 글자마다 byte_ns 하나 더
+ */
+void legacy_service(mock_serial &s) {
+    if (s.available() <= 0) {
+        return;
+    }
+    std::string line;
+    uint64_t deadline = s.now + 100 * NS_PER_MS;
+    while (s.now < deadline) {
+        if (s.available() > 0) {
+            int c = s.read();
+            s.spend(s.byte_ns);
+            if (c == '\n') {
+                break;
+            }
+            line += (char)c;
+            deadline = s.now + 100 * NS_PER_MS;
+        }
+    }
+    size_t a = line.find_first_not_of(" \t\r\v\f");
+    size_t b = line.find_last_not_of(" \t\r\v\f");
+    if (a == std::string::npos) {
+        return;
+    }
+    line = line.substr(a, b - a + 1) + "\n";
+    s.write((const uint8_t *)line.data(), line.size());
+    s.flush();
+}
+
+load_result run_load(long baud, const load_opts &o) {
+    mock_serial s;
+    s.loop_ns = o.loop_ns;
+    s.byte_ns = o.byte_ns;
+    s.rx_cap = o.rx_buf;
+    s.begin(baud);
+
+    static struct echo_core core;   // 링 포함, 스택 대신 static (아두이노와 같게)
+    echo_init(&core, baud);
+
+    // 모드 전환 명령 + 패킷을 시각 0부터 빈틈없이 (윈도우가 무한한 호스트)
+    std::string expect;
+    if (o.mode == load_mode::binary) {
+        s.host_send((const uint8_t *)"!BIN\n", 5, 0);
+        expect = "!OK BIN\n";
+    } else if (o.mode == load_mode::stream) {
+        s.host_send((const uint8_t *)"!STREAM\n", 8, 0);
+        expect = "!OK STREAM\n";
+    } else if (o.mode == load_mode::split) {
+        s.host_send((const uint8_t *)"!SPLIT\n", 7, 0);
+        expect = "!OK SPLIT\n";
+    }
+    size_t skip = expect.size();
+    std::vector<unit> units = make_units(o, (uint32_t)baud);
+    for (unit &u : units) {
+        u.arrival = s.host_send((const uint8_t *)u.bytes.data(), u.bytes.size(), 0);
+    }
+    uint64_t last_arrival = units.empty() ? 0 : units.back().arrival;
+
+    // 들어온 것을 다 처리하고 다 내보낼 때까지
+    while (!(s.now > last_arrival && s.rx.empty() && s.tx.empty() && echo_ring_used(&core) == 0)) {
+        if (o.legacy) {
+            legacy_service(s);
+        } else {
+            echo_service(&core, s, s.millis());
+        }
+    }
+
+    load_result r;
+    r.units = units.size();
+    r.lost = s.rx_dropped;
+    r.ring_overflow = core.cnt.ring_overflow;
+    r.ring_high = core.cnt.ring_high;
+    r.rx_high = core.cnt.rx_high;
+    r.secs = (double)s.now / 1e9;
+
+    // 받은 바이트를 순서대로 단위와 맞춰 봄 (구분자: 텍스트 '\n', 바이너리 0x00)
+    // 스트림은 구분자가 없으므로 len바이트씩 위치로 맞춤
+    std::vector<double> lat;
+    size_t pos = skip;
+    if (s.out.size() < skip || std::string(s.out.begin(), s.out.begin() + skip) != expect) {
+        pos = 0;    // 모드 전환 응답이 깨짐 → 아래에서 대부분 불일치로 나옴
+    }
+    char delim = o.mode == load_mode::text ? '\n' : 0;
+    size_t next = 0;
+    while (pos < s.out.size() && next < units.size()) {
+        size_t end;
+        if (o.mode == load_mode::stream) {
+            end = std::min(pos + (size_t)o.len, s.out.size()) - 1;
+        } else {
+            end = pos;
+            while (end < s.out.size() && s.out[end] != (uint8_t)delim) {
+                end++;
+            }
+            if (end == s.out.size()) {
+                break;
+            }
+        }
+        std::string got(s.out.begin() + pos, s.out.begin() + end + 1);
+        pos = end + 1;
+        // 방향 분리 모드의 주기적 STATS (CTRL 프레임)는 패킷이 아님
+        if (o.mode == load_mode::split && got.size() > 1 && got[1] == FRAME_TYPE_CTRL) {
+            continue;
+        }
+        // 바이트가 빠져서 두 패킷이 붙었을 수 있으므로 몇 개 앞까지 찾아봄
+        for (size_t k = next; k < units.size() && k < next + 4; k++) {
+            if (units[k].reply == got) {
+                r.intact++;
+                lat.push_back((double)(s.out_t[end] - units[k].arrival) / 1e3);
+                next = k;
+                break;
+            }
+        }
+        next++;
+    }
+    if (!lat.empty()) {
+        std::sort(lat.begin(), lat.end());
+        r.lat_p50_us = lat[lat.size() / 2];
+        r.lat_max_us = lat.back();
+    }
+    return r;
+}
+
+/* ---------------------------------------------------------------------------
+ * pty 모드: 실제 시간으로 코어 구동
+ * ------------------------------------------------------------------------- */
+
+struct pty_serial {
+    int fd = -1;
+    long baud = 0;
+
+    void begin(long b) {
+        baud = b;
+        printf("[ECHO] baud %ld\n", b);
+        fflush(stdout);
+    }
+    void end() {}
+    // pty에는 속도 제한이 없으므로 UNO 수신 버퍼(64바이트)만큼만 보여줌
+    // (한꺼번에 다 읽으면 회선에서는 생길 수 없는 속도로 링이 넘침)
+    int available() {
+        int n = 0;
+        return ioctl(fd, FIONREAD, &n) == 0 ? std::min(n, 64) : 0;
+    }
+    int read() {
+        uint8_t b;
+        return ::read(fd, &b, 1) == 1 ? b : -1;
+    }
+    // pty는 송신 FIFO가 없으므로 커널 버퍼 여유만큼 (POLLOUT이면 한 청크)
+    int availableForWrite() {
+        struct pollfd p = { fd, POLLOUT, 0 };
+        return poll(&p, 1, 0) == 1 && (p.revents & POLLOUT) ? 256 : 0;
+    }
+    size_t write(const uint8_t *p, size_t n) {
+        size_t done = 0;
+        while (done < n) {
+            ssize_t k = ::write(fd, p + done, n - done);
+            if (k > 0) {
+                done += (size_t)k;
+            } else if (k < 0 && errno != EAGAIN && errno != EINTR) {
+                break;
+            }
+        }
+        return done;
+    }
+    void flush() {}
+};
+
+int run_pty(const char *link_path) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *slave_name = ptsname(master);
+    // slave를 하나 열어 둠: 호스트가 닫았다 다시 열어도 master가 EIO로 끊기지 않도록
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror(slave_name);
+        return 1;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    unlink(link_path);
+    if (symlink(slave_name, link_path) < 0) {
+        perror(link_path);
+        return 1;
+    }
+    printf("[ECHO] %s -> %s (echo_core, Ctrl+C to stop)\n", link_path, slave_name);
+    fflush(stdout);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    pty_serial serial;
+    serial.fd = master;
+    static struct echo_core core;
+    echo_init(&core, ECHO_DEFAULT_BAUD);
+    uint64_t t0 = mono_ns();
+
+    while (!stop_requested) {
+        // 받을 것도 보낼 자리도 없으면 1ms까지 잠 (줄/스트림 타임아웃은 ms 단위)
+        struct pollfd p = { master, (short)(POLLIN | (echo_ring_used(&core) ? POLLOUT : 0)), 0 };
+        poll(&p, 1, 1);
+        echo_service(&core, serial, (unsigned long)((mono_ns() - t0) / NS_PER_MS));
+    }
+
+    const echo_counters &c = core.cnt;
+    printf("\n[ECHO] rx=%lu tx=%lu lines=%lu frames=%lu bad=%lu commands=%lu"
+           " ring_overflow=%lu ring_high=%u rx_high=%u\n",
+           (unsigned long)c.rx_bytes, (unsigned long)c.tx_bytes, (unsigned long)c.lines,
+           (unsigned long)c.frames_ok, (unsigned long)c.frames_bad,
+           (unsigned long)c.commands, (unsigned long)c.ring_overflow,
+           (unsigned)c.ring_high, (unsigned)c.rx_high);
+    unlink(link_path);
+    close(slave);
+    close(master);
+    return 0;
+}
+
+void usage(const char *prog) {
+    printf("Usage: %s [options]          load test echo_core against a modelled UART\n", prog);
+    printf("       %s --link PATH        run echo_core behind a pty (for claud_ver)\n", prog);
+    printf("\nOptions:\n");
+    printf("  --bauds LIST    comma-separated rates (default 115200,230400,460800,921600,1000000,2000000)\n");
+    printf("  --count N       packets per rate (default 2000)\n");
+    printf("  --len L         payload bytes per packet (default 10)\n");
+    printf("  --mode M        text, binary (COBS frames), stream or split (default text)\n");
+    printf("  --loop-us US    firmware cost of one loop() pass (default 5)\n");
+    printf("  --byte-us US    firmware cost per echoed byte (default 4)\n");
+    printf("  --rx-buf N      UART receive buffer in bytes (default 64, as on an UNO)\n");
+    printf("  --legacy        model the old readStringUntil/print/flush loop (text only)\n");
+    printf("  --link PATH     pty mode: symlink PATH to the device side\n");
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_opts[] = {
+        { "bauds",   required_argument, nullptr, 'b' },
+        { "count",   required_argument, nullptr, 'n' },
+        { "len",     required_argument, nullptr, 'l' },
+        { "mode",    required_argument, nullptr, 'm' },
+        { "loop-us", required_argument, nullptr, 'L' },
+        { "byte-us", required_argument, nullptr, 'B' },
+        { "rx-buf",  required_argument, nullptr, 'r' },
+        { "legacy",  no_argument,       nullptr, 'g' },
+        { "link",    required_argument, nullptr, 'k' },
+        { "help",    no_argument,       nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    load_opts o;
+    std::string bauds = "115200,230400,460800,921600,1000000,2000000";
+    const char *link_path = nullptr;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:n:l:m:L:B:r:gk:h", long_opts, nullptr)) != -1) {
+        switch (opt) {
+        case 'b': bauds = optarg; break;
+        case 'n': o.count = atol(optarg); break;
+        case 'l': o.len = atoi(optarg); break;
+        case 'm':
+            if (strcmp(optarg, "text") == 0) {
+                o.mode = load_mode::text;
+            } else if (strcmp(optarg, "binary") == 0) {
+                o.mode = load_mode::binary;
+            } else if (strcmp(optarg, "stream") == 0) {
+                o.mode = load_mode::stream;
+            } else if (strcmp(optarg, "split") == 0) {
+                o.mode = load_mode::split;
+            } else {
+                fprintf(stderr, "Error: --mode must be text, binary, stream or split\n");
+                return 1;
+            }
+            break;
+        case 'L': o.loop_ns = (uint64_t)(atof(optarg) * NS_PER_US); break;
+        case 'B': o.byte_ns = (uint64_t)(atof(optarg) * NS_PER_US); break;
+        case 'r': o.rx_buf = (size_t)atol(optarg); break;
+        case 'g': o.legacy = true; break;
+        case 'k': link_path = optarg; break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (link_path) {
+        return run_pty(link_path);
+    }
+    if (o.count <= 0 || o.len <= 0 || o.len > 4096 || o.rx_buf == 0) {
+        fprintf(stderr, "Error: bad --count, --len or --rx-buf\n");
+        return 1;
+    }
+    if (o.mode == load_mode::split && o.len > FRAME_GEN_MAX) {
+        fprintf(stderr, "Error: --mode split replies carry at most %d bytes\n", FRAME_GEN_MAX);
+        return 1;
+    }
+    if (o.legacy && o.mode != load_mode::text) {
+        fprintf(stderr, "Error: --legacy models the text loop only\n");
+        return 1;
+    }
+
+    printf("# %s echo, %ld x %d-byte packets, loop %.1f us, byte %.1f us, rx buffer %zu\n",
+           o.legacy ? "legacy" : "echo_core", o.count, o.len, o.loop_ns / 1e3,
+           o.byte_ns / 1e3, o.rx_buf);
+    printf("%8s %8s %8s %8s %6s %6s %6s %10s %10s\n", "baud", "intact", "broken",
+           "lost_B", "ovf", "ring", "rxhi", "p50_us", "max_us");
+    int rc = 0;
+    for (const char *p = bauds.c_str(); *p;) {
+        long baud = strtol(p, nullptr, 10);
+        if (baud < ECHO_BAUD_MIN || baud > ECHO_BAUD_MAX) {
+            fprintf(stderr, "Error: bad baud in --bauds\n");
+            return 1;
+        }
+        load_result r = run_load(baud, o);
+        printf("%8ld %8zu %8zu %8llu %6u %6u %6u %10.1f %10.1f\n", baud, r.intact,
+               r.units - r.intact, (unsigned long long)r.lost, r.ring_overflow,
+               r.ring_high, r.rx_high, r.lat_p50_us, r.lat_max_us);
+        if (r.intact != r.units) {
+            rc = 2;
+        }
+        const char *comma = strchr(p, ',');
+        p = comma ? comma + 1 : p + strlen(p);
+    }
+    return rc;
+}
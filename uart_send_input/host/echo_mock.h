@@ -0,0 +1,153 @@
+/*
+ * ============================================================================
+ * 모의 Serial (리눅스에서 echo_core.h를 돌리기 위한 UART 모델)
+ * ============================================================================
+ *
+ * 아두이노 HardwareSerial과 같은 이름의 함수를 제공하고
+ * 안쪽에서는 가상 시계(ns)로 회선과 UART 하드웨어를 흉내 냄:
+ *
+ *   호스트 → [회선: 바이트당 10비트 시간] → rx FIFO (UNO는 64바이트)
+ *                                             ↓ read()
+ *                                          펌웨어 코어
+ *                                             ↓ write()
+ *   호스트 ← [회선: 바이트당 10비트 시간] ← tx FIFO (UNO는 64바이트)
+ *
+ *   rx FIFO가 꽉 찬 상태에서 바이트가 도착하면 버림 (AVR 수신 인터럽트와 같음)
+ *     → rx_dropped: 실제 보드라면 아무도 모르게 사라져서 호스트가 ERR로 셌을 바이트
+ *   write()는 tx FIFO가 꽉 차면 빈자리가 날 때까지 가상 시간을 보냄 (AVR처럼 막힘)
+ *
+ * 펌웨어의 CPU 시간도 가상 시계에 더함 (16MHz UNO 기준 대략값, 옵션으로 조정):
+ *   loop_ns - available() 한 번 (= loop() 한 바퀴의 고정 비용)
+ *   byte_ns - 바이트 하나 read() + 처리 + write()
+ */
+#ifndef ECHO_MOCK_H
+#define ECHO_MOCK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct mock_serial {
+    // 설정
+    uint64_t loop_ns = 5000;
+    uint64_t byte_ns = 4000;
+    size_t   rx_cap = 64;
+    size_t   tx_cap = 64;
+
+    // 가상 시계와 회선
+    uint64_t now = 0;
+    uint64_t byte_time = 0;         // 바이트 하나의 회선 시간 (10비트)
+    long     baud = 0;
+
+    // 호스트 → 장치: 회선에 올라간 바이트 (도착 시각 순)
+    std::deque<std::pair<uint64_t, uint8_t>> wire_in;
+    std::deque<uint8_t> rx;
+    uint64_t rx_dropped = 0;
+
+    // 장치 → 호스트
+    std::deque<std::pair<uint64_t, uint8_t>> tx;   // (write() 시각, 바이트)
+    uint64_t tx_busy_until = 0;     // 마지막으로 나간 바이트의 끝
+    std::vector<uint8_t>  out;      // 호스트가 받은 바이트
+    std::vector<uint64_t> out_t;    // 각 바이트를 다 받은 시각
+
+    uint64_t baud_changes = 0;
+
+    // ---- 아두이노 쪽 API ----
+
+    void begin(long b) {
+        baud = b;
+        byte_time = 10ULL * 1000000000ULL / (uint64_t)b;
+        baud_changes++;
+    }
+
+    void end() {}
+
+    int available() {
+        spend(loop_ns);
+        return (int)rx.size();
+    }
+
+    int read() {
+        spend(byte_ns / 2);
+        if (rx.empty()) {
+            return -1;
+        }
+        int b = rx.front();
+        rx.pop_front();
+        return b;
+    }
+
+    int availableForWrite() {
+        advance();
+        return (int)(tx_cap - tx.size());
+    }
+
+    size_t write(const uint8_t *p, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            spend(byte_ns / 2);
+            while (tx.size() >= tx_cap) {
+                spend(byte_time);   // 막힘: 한 바이트가 나갈 때까지
+            }
+            tx.emplace_back(now, p[i]);
+            advance();
+        }
+        return n;
+    }
+
+    // 송신 완료까지 대기
+    void flush() {
+        while (!tx.empty()) {
+            spend(byte_time);
+        }
+    }
+
+    unsigned long millis() const {
+        return (unsigned long)(now / 1000000ULL);
+    }
+
+    // ---- 시험 도구 쪽 ----
+
+    // 호스트가 t에 쓰기 시작한 바이트들을 회선에 올림 (앞 바이트에 이어서 빈틈없이)
+    uint64_t host_send(const uint8_t *p, size_t n, uint64_t t) {
+        uint64_t at = wire_in.empty() ? t : std::max(t, wire_in.back().first);
+        for (size_t i = 0; i < n; i++) {
+            at += byte_time;
+            wire_in.emplace_back(at, p[i]);
+        }
+        return at;
+    }
+
+    // 펌웨어가 CPU를 쓴 시간 (그동안 회선은 계속 움직임)
+    void spend(uint64_t ns) {
+        now += ns;
+        advance();
+    }
+
+    // now까지 회선/FIFO 상태 갱신
+    void advance() {
+        while (!wire_in.empty() && wire_in.front().first <= now) {
+            if (rx.size() < rx_cap) {
+                rx.push_back(wire_in.front().second);
+            } else {
+                rx_dropped++;
+            }
+            wire_in.pop_front();
+        }
+        // 송신은 앞 바이트가 끝나는 즉시 (또는 write()된 즉시) 시작
+        // 다 나갈 때까지 FIFO 자리를 차지하는 것으로 봄 (실제보다 1바이트 보수적)
+        while (!tx.empty()) {
+            uint64_t done = std::max(tx_busy_until, tx.front().first) + byte_time;
+            if (done > now) {
+                break;
+            }
+            out.push_back(tx.front().second);
+            out_t.push_back(done);
+            tx.pop_front();
+            tx_busy_until = done;
+        }
+    }
+};
+
+#endif /* ECHO_MOCK_H */
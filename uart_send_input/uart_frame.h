@@ -0,0 +1,395 @@
+/*
+ * ============================================================================
+ * 바이너리 프레임 프로토콜 (COBS + CRC-16)
+ * ============================================================================
+ *
+ * 라즈베리파이(claud_ver.c)와 아두이노 에코 스케치가 같이 쓰는 헤더
+ * C와 C++(아두이노) 양쪽에서 컴파일되도록 표준 C만 사용
+ *
+ * 왜 필요한가?
+ *   텍스트 프로토콜은 '\n'으로 패킷을 구분하므로
+ *     - 페이로드에 0x0A, 0x0D가 들어갈 수 없음 (8비트 데이터 불가)
+ *     - 개행 하나가 깨지면 두 패킷이 붙어서 스트림이 어긋남
+ *       → tcflush(TCIFLUSH)로 데이터를 버려야 복구됨
+ *
+ * 프레임 구조 (인코딩 전):
+ *   +------+---------+---------+-------------+----------+
+ *   | type | seq(LE) | len(LE) | payload     | crc(BE)  |
+ *   | 1B   | 2B      | 2B      | len 바이트   | 2B       |
+ *   +------+---------+---------+-------------+----------+
+ *   crc = CRC-16/CCITT-FALSE (다항식 0x1021, 초기값 0xFFFF)
+ *         type부터 payload 끝까지 계산, 빅엔디언으로 붙임
+ *         → 받는 쪽은 crc까지 포함해서 다시 계산하면 0이 나와야 정상
+ *           (바이트를 받는 대로 계산할 수 있어서 아두이노에서도 버퍼가 필요 없음)
+ *
+ * COBS (Consistent Overhead Byte Stuffing):
+ *   프레임 안의 0x00을 모두 없애고, 0x00을 프레임 구분자로만 사용
+ *   원리: 각 0x00 자리에 "다음 0x00까지의 거리"를 적음
+ *     원본:   11 22 00 33
+ *     인코딩: 03 11 22 02 33 00(구분자)
+ *   오버헤드: 254바이트당 최대 1바이트
+ *
+ *   바이트가 깨져도 다음 0x00에서 무조건 새 프레임이 시작됨
+ *   → 포트를 비우지(flush) 않아도 다음 프레임부터 자동으로 다시 맞춰짐
+ */
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* 프레임 종류 */
+#define FRAME_TYPE_DATA 0x01    // 측정용 데이터 (에코 대상)
+#define FRAME_TYPE_CTRL 0x02    // 제어 명령/응답 (ASCII, 예: "TEXT", "OK TEXT")
+#define FRAME_TYPE_GEN     0x03 // 방향 분리 모드: 펌웨어가 만든 페이로드 (상향 프레임 정상)
+#define FRAME_TYPE_GEN_BAD 0x04 // 〃 상향 프레임의 CRC/COBS가 깨졌음
+
+#define FRAME_HDR_LEN   5       // type + seq + len
+#define FRAME_CRC_LEN   2
+#define FRAME_OVERHEAD  (FRAME_HDR_LEN + FRAME_CRC_LEN)
+
+/* n바이트를 COBS로 인코딩했을 때의 최대 길이 (구분자 제외) */
+#define COBS_MAX_ENCODED(n) ((n) + (n) / 254 + 1)
+
+/* 구분자까지 포함한 인코딩 프레임 최대 길이 */
+#define FRAME_MAX_WIRE(payload_len) \
+    (COBS_MAX_ENCODED((payload_len) + FRAME_OVERHEAD) + 1)
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * CRC-16/CCITT-FALSE
+ * ----------------------------------------------------------------------------
+ * 4비트(니블) 단위 테이블: 16개 × 2바이트 = 32바이트
+ *   256개 테이블(512바이트)은 아두이노 UNO RAM(2KB)에 부담
+ *   비트 단위 계산보다 4배 정도 빠름
+ */
+static const uint16_t crc16_nibble_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+#define CRC16_INIT 0xFFFF
+
+static inline uint16_t crc16_update(uint16_t crc, uint8_t b) {
+    crc = (uint16_t)((crc << 4) ^ crc16_nibble_table[((crc >> 12) ^ (b >> 4)) & 0x0F]);
+    crc = (uint16_t)((crc << 4) ^ crc16_nibble_table[((crc >> 12) ^ (b & 0x0F)) & 0x0F]);
+    return crc;
+}
+
+static inline uint16_t crc16(const uint8_t *p, size_t n) {
+    uint16_t crc = CRC16_INIT;
+    while (n--) {
+        crc = crc16_update(crc, *p++);
+    }
+    return crc;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * COBS 인코딩 / 디코딩
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * in[0..len) → out (0x00 없음, 구분자는 붙이지 않음)
+ * out은 COBS_MAX_ENCODED(len) 이상이어야 함
+ * 반환값: 인코딩된 길이
+ */
+static inline size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t code_pos = 0;    // 현재 블록의 코드 바이트 자리
+    size_t o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                // 254바이트 연속으로 0이 없으면 블록을 강제로 끊음
+                out[code_pos] = code;
+                code_pos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    return o;
+}
+
+/*
+ * in[0..len) (구분자 제외) → out
+ * out은 len 이상이어야 함
+ * 반환값: 디코딩된 길이, 형식이 깨졌으면 -1
+ */
+static inline int cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) {
+            return -1;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            uint8_t b = in[i++];
+            if (b == 0) {
+                return -1;
+            }
+            out[o++] = b;
+        }
+        // 0xFF 블록이 아니고 마지막 블록도 아니면 원래 0x00이 있던 자리
+        if (code != 0xFF && i < len) {
+            out[o++] = 0;
+        }
+    }
+    return (int)o;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 프레임 만들기 / 해석하기
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * 헤더 + 페이로드 + CRC를 raw에 채움 (COBS 인코딩 전)
+ * raw는 len + FRAME_OVERHEAD 이상이어야 함
+ * 반환값: raw 길이
+ */
+static inline size_t frame_build(uint8_t type, uint16_t seq,
+                                 const uint8_t *payload, uint16_t len,
+                                 uint8_t *raw) {
+    raw[0] = type;
+    raw[1] = (uint8_t)(seq & 0xFF);
+    raw[2] = (uint8_t)(seq >> 8);
+    raw[3] = (uint8_t)(len & 0xFF);
+    raw[4] = (uint8_t)(len >> 8);
+    if (len > 0 && payload != raw + FRAME_HDR_LEN) {   // 이미 제자리에 있으면 그대로
+        memcpy(raw + FRAME_HDR_LEN, payload, len);
+    }
+
+    size_t n = FRAME_HDR_LEN + len;
+    uint16_t crc = crc16(raw, n);
+    raw[n++] = (uint8_t)(crc >> 8);
+    raw[n++] = (uint8_t)(crc & 0xFF);
+    return n;
+}
+
+/*
+ * 프레임을 만들어서 COBS 인코딩 + 구분자(0x00)까지 붙임
+ *   scratch - len + FRAME_OVERHEAD 이상의 임시 버퍼
+ *   out     - FRAME_MAX_WIRE(len) 이상
+ * 반환값: 회선에 보낼 바이트 수
+ */
+static inline size_t frame_encode(uint8_t type, uint16_t seq,
+                                  const uint8_t *payload, uint16_t len,
+                                  uint8_t *scratch, uint8_t *out) {
+    size_t raw_len = frame_build(type, seq, payload, len, scratch);
+    size_t n = cobs_encode(scratch, raw_len, out);
+    out[n++] = 0x00;
+    return n;
+}
+
+/*
+ * 디코딩된 프레임(raw)의 길이와 CRC를 확인하고 필드를 꺼냄
+ * 반환값: 정상 0, 길이 불일치 또는 CRC 에러 -1
+ */
+static inline int frame_parse(const uint8_t *raw, size_t n,
+                              uint8_t *type, uint16_t *seq,
+                              const uint8_t **payload, uint16_t *len) {
+    if (n < FRAME_OVERHEAD) {
+        return -1;
+    }
+    uint16_t plen = (uint16_t)(raw[3] | (raw[4] << 8));
+    if ((size_t)plen + FRAME_OVERHEAD != n || crc16(raw, n) != 0) {
+        return -1;
+    }
+
+    *type = raw[0];
+    *seq = (uint16_t)(raw[1] | (raw[2] << 8));
+    *payload = raw + FRAME_HDR_LEN;
+    *len = plen;
+    return 0;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 스트리밍 디코더 (아두이노용)
+ * ----------------------------------------------------------------------------
+ * 프레임 전체를 버퍼에 담지 않고 바이트가 들어오는 대로 COBS를 풀고 CRC를 계산
+ * 헤더 5바이트와 짧은 제어 명령만 보관
+ */
+#define FRAME_STREAM_CTRL_MAX 24
+
+enum {
+    FRAME_STREAM_NONE = 0,      // 프레임 진행 중
+    FRAME_STREAM_OK,            // 정상 프레임 끝 (type/seq/len/ctrl 유효)
+    FRAME_STREAM_BAD            // 깨진 프레임 끝 (CRC/길이/COBS 에러)
+};
+
+struct frame_stream {
+    uint8_t  left;              // 현재 COBS 블록에서 남은 데이터 바이트 수
+    uint8_t  code;              // 현재 COBS 블록 코드 (0 = 프레임 시작 전)
+    uint16_t n;                 // 지금까지 디코딩된 바이트 수
+    uint16_t crc;               // 디코딩된 바이트의 누적 CRC
+    uint8_t  hdr[FRAME_HDR_LEN];
+
+    // FRAME_STREAM_OK일 때 유효
+    uint8_t  type;
+    uint16_t seq;
+    uint16_t len;
+    char     ctrl[FRAME_STREAM_CTRL_MAX + 1];   // CTRL 프레임의 명령 (null 종료)
+};
+
+static inline void frame_stream_reset(struct frame_stream *st) {
+    st->left = 0;
+    st->code = 0;
+    st->n = 0;
+    st->crc = CRC16_INIT;
+}
+
+/* 디코딩된 바이트 하나 처리 */
+static inline void frame_stream_byte(struct frame_stream *st, uint8_t b) {
+    if (st->n < FRAME_HDR_LEN) {
+        st->hdr[st->n] = b;
+    } else if (st->hdr[0] == FRAME_TYPE_CTRL &&
+               st->n - FRAME_HDR_LEN < FRAME_STREAM_CTRL_MAX) {
+        st->ctrl[st->n - FRAME_HDR_LEN] = (char)b;
+    }
+    st->crc = crc16_update(st->crc, b);
+    if (st->n < 0xFFFF) {
+        st->n++;
+    }
+}
+
+/*
+ * 회선에서 받은 (인코딩된) 바이트 하나를 넣음
+ * 반환값: FRAME_STREAM_NONE / FRAME_STREAM_OK / FRAME_STREAM_BAD
+ */
+static inline int frame_stream_feed(struct frame_stream *st, uint8_t b) {
+    if (b == 0x00) {
+        // 구분자: 프레임 끝
+        int result = FRAME_STREAM_NONE;
+        if (st->code != 0) {
+            uint16_t plen = (uint16_t)(st->hdr[3] | (st->hdr[4] << 8));
+            if (st->left != 0 || st->n < FRAME_OVERHEAD ||
+                (uint32_t)plen + FRAME_OVERHEAD != st->n || st->crc != 0) {
+                result = FRAME_STREAM_BAD;
+            } else {
+                result = FRAME_STREAM_OK;
+                st->type = st->hdr[0];
+                st->seq = (uint16_t)(st->hdr[1] | (st->hdr[2] << 8));
+                st->len = plen;
+                size_t clen = plen < FRAME_STREAM_CTRL_MAX ? plen : FRAME_STREAM_CTRL_MAX;
+                st->ctrl[st->type == FRAME_TYPE_CTRL ? clen : 0] = '\0';
+            }
+        }
+        frame_stream_reset(st);
+        return result;
+    }
+
+    if (st->left == 0) {
+        // 새 COBS 블록의 코드 바이트
+        // 앞 블록이 0xFF가 아니었으면 블록 사이에 원래 0x00이 있었음
+        if (st->code != 0 && st->code != 0xFF) {
+            frame_stream_byte(st, 0x00);
+        }
+        st->code = b;
+        st->left = (uint8_t)(b - 1);
+    } else {
+        frame_stream_byte(st, b);
+        st->left--;
+    }
+    return FRAME_STREAM_NONE;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * 방향 분리 모드 ("!SPLIT", 호스트의 --split)
+ * ----------------------------------------------------------------------------
+ * 에코는 왕복이라 ERR가 어느 쪽 회선에서 생겼는지 모름
+ *   파이 → 아두이노 (상향): 펌웨어가 DATA 프레임의 CRC를 직접 확인해서 셈
+ *   아두이노 → 파이 (하향): 펌웨어는 에코 대신 seq로 만든 페이로드를 보냄
+ *                          호스트가 같은 seq로 다시 만들어서 비교
+ *
+ * 상향 프레임 하나마다 응답 프레임 하나 (페이로드 길이는 받은 DATA와 같음):
+ *   GEN     - 받은 프레임이 정상, seq는 받은 seq
+ *   GEN_BAD - 받은 프레임이 깨짐, seq는 직전 정상 seq + 1 (호스트는 순서대로 보냄)
+ *             길이는 직전 정상 프레임의 길이 (깨진 헤더는 믿을 수 없음)
+ * 누적 카운터는 FRAME_SPLIT_STATS_EVERY 프레임마다 CTRL "OK STATS <정상> <깨짐>"으로
+ * (응답 프레임이 하향에서 깨지면 그 패킷의 상향 판정은 모르므로 펌웨어 쪽 합계가 기준)
+ */
+#define FRAME_GEN_MAX           63      // 응답 페이로드 최대 길이 (호스트 --split의 --len 상한)
+#define FRAME_SPLIT_STATS_EVERY 256
+#define FRAME_CTRL_REPLY_MAX    40      // CTRL 응답 최대 길이 ("OK STATS 4294967295 ...")
+
+/*
+ * seq로 정해지는 페이로드 (xorshift16, AVR에서도 바이트당 몇 사이클)
+ * 0x00을 포함한 모든 바이트 값이 나옴
+ */
+static inline void frame_gen_payload(uint16_t seq, uint8_t *out, size_t len) {
+    uint16_t x = (uint16_t)(seq ^ 0xACE1u);
+    if (x == 0) {
+        x = 1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        x ^= (uint16_t)(x << 7);
+        x ^= (uint16_t)(x >> 9);
+        x ^= (uint16_t)(x << 8);
+        out[i] = (uint8_t)x;
+    }
+}
+
+struct frame_split {
+    uint16_t next_seq;      // 다음에 올 것으로 보는 seq (깨진 프레임에 붙임)
+    uint16_t len;           // 직전 정상 DATA 프레임의 페이로드 길이
+    uint32_t ok, bad;       // 상향 프레임 판정 누적
+};
+
+static inline void frame_split_reset(struct frame_split *sp) {
+    memset(sp, 0, sizeof(*sp));
+}
+
+/*
+ * 상향 프레임 하나가 끝났을 때 (frame_stream_feed()가 OK/BAD를 돌려줌) 응답 만들기
+ *   scratch - FRAME_GEN_MAX + FRAME_OVERHEAD 이상
+ *   out     - FRAME_MAX_WIRE(FRAME_GEN_MAX) 이상
+ * 반환값: 보낼 바이트 수 (CTRL 프레임이면 0: 명령 처리는 호출한 쪽이)
+ */
+static inline size_t frame_split_reply(struct frame_split *sp, const struct frame_stream *st,
+                                       int result, uint8_t *scratch, uint8_t *out) {
+    uint8_t type;
+    uint16_t seq;
+    if (result == FRAME_STREAM_OK) {
+        if (st->type != FRAME_TYPE_DATA) {
+            return 0;
+        }
+        sp->ok++;
+        sp->len = st->len < FRAME_GEN_MAX ? st->len : FRAME_GEN_MAX;
+        type = FRAME_TYPE_GEN;
+        seq = st->seq;
+    } else {
+        sp->bad++;
+        type = FRAME_TYPE_GEN_BAD;
+        seq = sp->next_seq;
+    }
+    sp->next_seq = (uint16_t)(seq + 1);
+
+    // 페이로드를 헤더 자리 뒤에 바로 만들고 frame_build가 제자리에서 헤더/CRC를 붙임
+    uint8_t *payload = scratch + FRAME_HDR_LEN;
+    frame_gen_payload(seq, payload, sp->len);
+    size_t raw_len = frame_build(type, seq, payload, sp->len, scratch);
+    size_t n = cobs_encode(scratch, raw_len, out);
+    out[n++] = 0x00;
+    return n;
+}
+
+#endif /* UART_FRAME_H */
@@ -1,24 +1,45 @@
+/*
+ * UART 에코 펌웨어
+ *
+ * 텍스트 모드 (기본):
+ *   받은 줄을 trim해서 그대로 돌려보냄 (줄을 모으지 않고 바이트가 오는 대로)
+ *   '!'로 시작하는 줄은 제어 명령 (BIN, SPLIT, TEXT, PING, BAUD n, STREAM, STATS)
+ *
+ * 바이너리 모드 ("!BIN" 이후):
+ *   COBS 프레임 (uart_frame.h) 을 한 바이트씩 받는 즉시 그대로 돌려보냄
+ *   → 프레임을 버퍼에 모으지 않으므로 지연이 바이트 하나 분량뿐
+ *   받는 동안 스트리밍 디코더로 CRC만 확인해서 CTRL 프레임("TEXT", "PING")을 처리
+ *
+ * 방향 분리 모드 ("!SPLIT" 이후, 호스트의 --split):
+ *   에코하지 않고 받은 DATA 프레임의 CRC를 직접 확인 (상향 에러는 펌웨어가 셈)
+ *   프레임마다 seq로 만든 페이로드를 GEN/GEN_BAD 프레임으로 보냄 (하향 에러는 호스트가 셈)
+ *   256프레임마다, 그리고 CTRL "STATS"에 CTRL "OK STATS <정상> <깨짐>"으로 응답
+ *
+ * 스트림 모드 ("!STREAM" 이후, 호스트의 --ber):
+ *   받은 바이트를 해석 없이 그대로 돌려보냄 (PRBS 연속 스트림용)
+ *   데이터에 어떤 바이트든 올 수 있으므로 명령으로는 못 빠져나옴
+ *   → ECHO_STREAM_IDLE_MS 동안 아무것도 안 오면 텍스트 모드로 복귀
+ *
+ * 실제 처리는 전부 echo_core.h (고정 링 버퍼, String/힙 사용 없음)
+ * 같은 코드를 리눅스에서 돌려보려면 host/echo_host.cpp
+ *
+ * "!STATS" → "!OK STATS rx=.. tx=.. lines=.. bad=.. ovf=.. ring=.. rxhigh=.."
+ *   ovf가 0이 아니면 펌웨어가 따라가지 못해서 버린 바이트 (케이블 에러 아님)
+ */
+#include "uart_frame.h"
+#include "echo_core.h"
+
+static struct echo_core core;
+
 void setup() {
-    Serial.begin(460800);
+    Serial.begin(ECHO_DEFAULT_BAUD);
     while (!Serial) {
         ; // 시리얼 포트 준비 대기
     }
-    Serial.setTimeout(100);
+    echo_init(&core, ECHO_DEFAULT_BAUD);
     delay(1000);
 }
 
 void loop() {
-    if (Serial.available() > 0) {
-        String received = Serial.readStringUntil('\n');
-        
-        // 공백 및 제어문자 제거
-        received.trim();
-        
-        if (received.length() > 0) {
-            // 순수 패킷만 반환 (println 대신 print + \n)
-            Serial.print(received);
-            Serial.print('\n');
-            Serial.flush();
-        }
-    }
-}
\ No newline at end of file
+    echo_service(&core, Serial, millis());
+}
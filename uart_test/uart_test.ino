@@ -1,25 +1,52 @@
+/*
+ * 문장 수신 시험 스케치
+ *   줄 단위로 받아서 "RECV: <문장>"으로 돌려보냄
+ *   String에 한 글자씩 붙이면 매번 재할당 → UNO RAM(2KB)에서 힙 단편화
+ *   → 고정 버퍼에 모으고, 넘치면 잘린 글자 수만 셈
+ */
+#define SENTENCE_MAX 96
+
+static char sentence[SENTENCE_MAX + 1];
+static size_t sentence_len = 0;
+static unsigned long dropped = 0;   // 버퍼가 넘쳐서 버린 글자 수
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f';
+}
+
 void setup() {
     Serial.begin(9600);              // UNO에서는 Serial1 없음
     Serial.println("== Arduino UART Sentence Receiver Ready ==");
 }
 
 void loop() {
-    static String sentence = "";
-
     while (Serial.available() > 0) {
         char c = Serial.read();
 
         if (c == '\n' || c == '\r') {
-            if (sentence.length() > 0) {
-                sentence.trim();
-
+            // trim(): 앞뒤 공백 제거
+            size_t start = 0, end = sentence_len;
+            while (start < end && is_space(sentence[start])) {
+                start++;
+            }
+            while (end > start && is_space(sentence[end - 1])) {
+                end--;
+            }
+            if (sentence_len > 0) {
+                sentence[end] = '\0';
                 Serial.print("RECV: ");
-                Serial.println(sentence);
-
-                sentence = "";
+                Serial.println(sentence + start);
+            }
+            if (dropped > 0) {
+                Serial.print("DROPPED: ");
+                Serial.println(dropped);
+                dropped = 0;
             }
+            sentence_len = 0;
+        } else if (sentence_len < SENTENCE_MAX) {
+            sentence[sentence_len++] = c;
         } else {
-            sentence += c;
+            dropped++;
         }
     }
 }